@@ -0,0 +1,382 @@
+// src/datastructure/candset.c
+#include "candset.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Get the size of the bitmap of a block, in whole 64-bit words.
+ *
+ * @param block The block.
+ * @param align Spacing of possible candidates.
+ * @return Bytes of the bitmap.
+ */
+static size_t bitmap_bytes(const cand_block_t *block, size_t align) {
+    size_t bits = (block->len + align - 1) / align;
+    return (bits + 63) / 64 * sizeof(uint64_t);
+}
+
+/**
+ * Get the length of the LEB128 encoding of a value.
+ */
+static size_t varint_len(uint64_t value) {
+    size_t n = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        n++;
+    }
+    return n;
+}
+
+/**
+ * Decode a LEB128 varint.
+ *
+ * @param data The encoded bytes.
+ * @param pos Position of the varint, advanced past it.
+ * @return The decoded value.
+ */
+static uint64_t varint_get(const uint8_t *data, // [in]
+                           size_t *pos          // [in/out]
+) {
+    uint64_t value = 0;
+    for (unsigned shift = 0;; shift += 7) {
+        uint8_t byte = data[(*pos)++];
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+}
+
+/**
+ * Re-encode the hits of a block as a bitmap.
+ *
+ * @param block The block, encoded as deltas.
+ * @param align Spacing of possible candidates.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int convert_to_bitmap(cand_block_t *block, size_t align) {
+    size_t bytes = bitmap_bytes(block, align);
+    uint8_t *bitmap = calloc(1, bytes);
+    if (!bitmap) {
+        return -1;
+    }
+    uint64_t unit = 0;
+    for (size_t pos = 0, k = 0; pos < block->size; k++) {
+        uint64_t delta = varint_get(block->data, &pos);
+        unit = k == 0 ? delta : unit + delta;
+        bitmap[unit / 8] |= (uint8_t)(1u << (unit % 8));
+    }
+    free(block->data);
+    block->data = bitmap;
+    block->size = bytes;
+    block->cap = bytes;
+    block->enc = CAND_BITMAP;
+    return 0;
+}
+
+/**
+ * Initialize an empty block covering [start, start + len).
+ *
+ * @param block The block to initialize.
+ * @param start First byte covered by the block.
+ * @param len Bytes covered by the block.
+ */
+void cand_block_init(cand_block_t *block, uintptr_t start, size_t len) {
+    memset(block, 0, sizeof(*block));
+    block->start = start;
+    block->len = len;
+    block->enc = CAND_DELTAS;
+}
+
+/**
+ * Add a candidate to a block. Candidates must be added in ascending order,
+ * on multiples of `align` from the block start.
+ *
+ * @param block The block to add to.
+ * @param align Spacing of possible candidates.
+ * @param addr Address of the candidate.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int cand_block_push(cand_block_t *block, // [in/out]
+                    size_t align,        // [in]
+                    uintptr_t addr       // [in]
+) {
+    uint64_t unit = (addr - block->start) / align;
+
+    if (block->enc == CAND_DELTAS) {
+        uint64_t delta =
+            block->count ? (addr - block->last) / align : unit;
+        size_t n = varint_len(delta);
+        if (block->size + n > bitmap_bytes(block, align)) {
+            if (convert_to_bitmap(block, align) != 0) {
+                return -1;
+            }
+        } else {
+            if (block->size + n > block->cap) {
+                size_t new_cap = block->cap ? block->cap * 2 : 64;
+                uint8_t *tmp = realloc(block->data, new_cap);
+                if (!tmp) {
+                    return -1;
+                }
+                block->data = tmp;
+                block->cap = new_cap;
+            }
+            while (delta >= 0x80) {
+                block->data[block->size++] = (uint8_t)(delta | 0x80);
+                delta >>= 7;
+            }
+            block->data[block->size++] = (uint8_t)delta;
+        }
+    }
+    if (block->enc == CAND_BITMAP) {
+        block->data[unit / 8] |= (uint8_t)(1u << (unit % 8));
+    }
+
+    block->count++;
+    block->last = addr;
+    return 0;
+}
+
+/**
+ * Release the slack of a block once every candidate was added.
+ *
+ * @param block The block.
+ */
+void cand_block_finish(cand_block_t *block) {
+    if (block->enc == CAND_DELTAS && block->size > 0 &&
+        block->size < block->cap) {
+        uint8_t *tmp = realloc(block->data, block->size);
+        if (tmp) {
+            block->data = tmp;
+            block->cap = block->size;
+        }
+    }
+}
+
+/**
+ * Free the encoded hits of a block.
+ *
+ * @param block The block.
+ */
+void cand_block_free(cand_block_t *block) {
+    free(block->data);
+    block->data = NULL;
+    block->size = 0;
+    block->cap = 0;
+    block->count = 0;
+}
+
+/**
+ * Initialize an empty candidate set.
+ *
+ * @param set The set to initialize.
+ * @param elem_size Bytes every candidate refers to.
+ * @param align Spacing of possible candidates (at least 1).
+ */
+void candset_init(candset_t *set, size_t elem_size, size_t align) {
+    memset(set, 0, sizeof(*set));
+    set->elem_size = elem_size;
+    set->align = align ? align : 1;
+}
+
+/**
+ * Free every block of a candidate set, leaving it empty.
+ *
+ * @param set The set to free.
+ */
+void candset_free(candset_t *set) {
+    for (size_t i = 0; i < set->block_count; i++) {
+        cand_block_free(&set->blocks[i]);
+    }
+    free(set->blocks);
+    set->blocks = NULL;
+    set->block_count = 0;
+    set->block_cap = 0;
+    set->count = 0;
+}
+
+/**
+ * Append a block to a candidate set, which takes over its hits. Blocks must
+ * be appended in ascending address order. Empty blocks are simply freed.
+ *
+ * @param set The set to append to.
+ * @param block The block, left empty by this call.
+ * @return 0 on success, -1 on allocation failure (the block is freed).
+ */
+int candset_append(candset_t *set,     // [in/out]
+                   cand_block_t *block // [in/out]
+) {
+    if (block->count == 0) {
+        cand_block_free(block);
+        return 0;
+    }
+    if (set->block_count == set->block_cap) {
+        size_t new_cap = set->block_cap ? set->block_cap * 2 : 16;
+        cand_block_t *tmp =
+            realloc(set->blocks, new_cap * sizeof(cand_block_t));
+        if (!tmp) {
+            cand_block_free(block);
+            return -1;
+        }
+        set->blocks = tmp;
+        set->block_cap = new_cap;
+    }
+    cand_block_finish(block);
+    set->blocks[set->block_count++] = *block;
+    set->count += block->count;
+    block->data = NULL;
+    cand_block_free(block);
+    return 0;
+}
+
+/**
+ * Move every candidate of a set by the same distance, e.g. from one field
+ * of a struct to another. The blocks move along, so nothing is re-encoded.
+ *
+ * @param set The set to move.
+ * @param delta Distance in bytes (wrapping, so it may be "negative").
+ * @param elem_size Bytes every candidate refers to from now on.
+ */
+void candset_shift(candset_t *set, uintptr_t delta, size_t elem_size) {
+    for (size_t b = 0; b < set->block_count; b++) {
+        set->blocks[b].start += delta;
+    }
+    set->elem_size = elem_size;
+}
+
+/**
+ * Keep only the first `count` candidates of a set.
+ *
+ * @param set The set to cut.
+ * @param count Number of candidates to keep.
+ * @return 0 on success, -1 on allocation failure (the set is unchanged).
+ */
+int candset_truncate(candset_t *set, size_t count) {
+    if (count >= set->count) {
+        return 0;
+    }
+
+    // Find the block holding the last candidate to keep
+    size_t i = 0, before = 0;
+    while (before + set->blocks[i].count <= count) {
+        before += set->blocks[i++].count;
+    }
+
+    // Re-encode its first candidates into a block of their own
+    cand_block_t cut;
+    cand_block_init(&cut, set->blocks[i].start, set->blocks[i].len);
+    cand_iter_t it;
+    cand_iter_init_block(&it, set, i);
+    uintptr_t addr;
+    for (size_t k = before; k < count && cand_iter_next(&it, &addr); k++) {
+        if (cand_block_push(&cut, set->align, addr) != 0) {
+            cand_block_free(&cut);
+            return -1;
+        }
+    }
+
+    for (size_t j = i; j < set->block_count; j++) {
+        cand_block_free(&set->blocks[j]);
+    }
+    set->block_count = i;
+    set->count = before;
+    return candset_append(set, &cut);
+}
+
+/**
+ * Get the number of candidates in a set.
+ *
+ * @param set The set.
+ * @return Number of candidates.
+ */
+size_t candset_count(const candset_t *set) { return set->count; }
+
+/**
+ * Get the memory used by a candidate set.
+ *
+ * @param set The set.
+ * @return Bytes allocated for the set.
+ */
+size_t candset_bytes(const candset_t *set) {
+    size_t bytes = set->block_cap * sizeof(cand_block_t);
+    for (size_t i = 0; i < set->block_count; i++) {
+        bytes += set->blocks[i].cap;
+    }
+    return bytes;
+}
+
+/**
+ * Start an iteration over the candidates of a set, in address order.
+ *
+ * @param it The iterator to initialize.
+ * @param set The set to iterate (must outlive the iteration).
+ */
+void cand_iter_init(cand_iter_t *it, const candset_t *set) {
+    it->set = set;
+    it->block = 0;
+    it->end = set->block_count;
+    it->pos = 0;
+    it->addr = 0;
+}
+
+/**
+ * Start an iteration over the candidates of a single block of a set.
+ *
+ * @param it The iterator to initialize.
+ * @param set The set to iterate (must outlive the iteration).
+ * @param block Index of the block.
+ */
+void cand_iter_init_block(cand_iter_t *it, const candset_t *set,
+                          size_t block) {
+    cand_iter_init(it, set);
+    it->block = block;
+    it->end = block + 1;
+}
+
+/**
+ * Get the next candidate of an iteration.
+ *
+ * @param it The iterator.
+ * @param addr Pointer to store the address of the candidate.
+ * @return true if there was one, false at the end of the set.
+ */
+bool cand_iter_next(cand_iter_t *it, // [in/out]
+                    uintptr_t *addr  // [out]
+) {
+    const candset_t *set = it->set;
+    while (it->block < it->end) {
+        const cand_block_t *block = &set->blocks[it->block];
+
+        if (block->enc == CAND_DELTAS) {
+            if (it->pos < block->size) {
+                uintptr_t base = it->pos == 0 ? block->start : it->addr;
+                uint64_t delta = varint_get(block->data, &it->pos);
+                it->addr = base + delta * set->align;
+                *addr = it->addr;
+                return true;
+            }
+        } else {
+            // Find the next set bit, a 64-bit word at a time
+            size_t bits = (block->len + set->align - 1) / set->align;
+            size_t words = (bits + 63) / 64;
+            for (size_t w = it->pos / 64; w < words; w++) {
+                uint64_t word;
+                memcpy(&word, block->data + w * sizeof(word), sizeof(word));
+                if (w == it->pos / 64 && it->pos % 64) {
+                    word &= ~0ULL << (it->pos % 64);
+                }
+                if (word) {
+                    size_t bit = w * 64 + (size_t)__builtin_ctzll(word);
+                    it->pos = bit + 1;
+                    it->addr = block->start + bit * set->align;
+                    *addr = it->addr;
+                    return true;
+                }
+            }
+        }
+
+        it->block++;
+        it->pos = 0;
+    }
+    return false;
+}
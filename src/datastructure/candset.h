@@ -0,0 +1,72 @@
+// src/datastructure/candset.h
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * candset_t is a compact set of candidate addresses, the outcome of a search
+ * that later scans narrow down. It is a list of blocks in ascending address
+ * order, each covering a byte range [start, start + len). Candidates lie on
+ * multiples of `align` from the block start, and every block picks the
+ * smaller of two encodings for its own hits:
+ *
+ * - CAND_DELTAS: LEB128 varints of the distance (in units of `align`) from
+ *   the previous candidate, about one byte per hit when hits are sparse.
+ * - CAND_BITMAP: one bit per aligned offset, len / align / 8 bytes however
+ *   many hits there are, so dense hits cost at most one bit each.
+ *
+ * A block starts as deltas and turns into a bitmap as soon as the deltas
+ * outgrow it.
+ */
+typedef enum {
+    CAND_DELTAS,
+    CAND_BITMAP,
+} cand_encoding_t;
+
+typedef struct {
+    uintptr_t start; // first byte covered by the block
+    size_t len;      // bytes covered by the block
+    size_t count;    // candidates in the block
+    uintptr_t last;  // last candidate added, while building
+    cand_encoding_t enc;
+    uint8_t *data; // varints or bitmap (padded to whole 64-bit words)
+    size_t size;   // bytes of data in use
+    size_t cap;    // bytes of data allocated
+} cand_block_t;
+
+typedef struct {
+    size_t elem_size; // bytes every candidate refers to
+    size_t align;     // spacing of possible candidates
+    cand_block_t *blocks;
+    size_t block_count;
+    size_t block_cap;
+    size_t count; // candidates in all blocks
+} candset_t;
+
+// Position of an iteration over a candidate set
+typedef struct {
+    const candset_t *set;
+    size_t block; // current block
+    size_t end;   // block to stop at
+    size_t pos;   // byte (deltas) or bit (bitmap) position in the block
+    uintptr_t addr;
+} cand_iter_t;
+
+void cand_block_init(cand_block_t *block, uintptr_t start, size_t len);
+int cand_block_push(cand_block_t *block, size_t align, uintptr_t addr);
+void cand_block_finish(cand_block_t *block);
+void cand_block_free(cand_block_t *block);
+
+void candset_init(candset_t *set, size_t elem_size, size_t align);
+void candset_free(candset_t *set);
+int candset_append(candset_t *set, cand_block_t *block);
+void candset_shift(candset_t *set, uintptr_t delta, size_t elem_size);
+int candset_truncate(candset_t *set, size_t count);
+size_t candset_count(const candset_t *set);
+size_t candset_bytes(const candset_t *set);
+
+void cand_iter_init(cand_iter_t *it, const candset_t *set);
+void cand_iter_init_block(cand_iter_t *it, const candset_t *set,
+                          size_t block);
+bool cand_iter_next(cand_iter_t *it, uintptr_t *addr);
@@ -0,0 +1,178 @@
+// src/datastructure/strtab.c
+#include "strtab.h"
+#include <stdlib.h>
+#include <string.h>
+
+// The main string table structure
+struct strtab_t {
+    char *data; // NUL-terminated strings back to back, data[0] == '\0'
+    size_t len;
+    size_t cap;
+    uint32_t *slots; // open-addressing index of offsets, 0 marks a free slot
+    size_t slot_count;
+    size_t used;
+};
+
+/**
+ * Calculate the FNV-1a hash of a string.
+ *
+ * @param str The string to hash.
+ * @param len Length of the string.
+ * @return The hash value.
+ */
+static size_t hash_str(const char *str, size_t len) {
+    size_t hash = 0xcbf29ce484222325;
+    for (size_t i = 0; i < len; ++i) {
+        hash ^= (unsigned char)str[i];
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+/**
+ * Create a new, empty string table.
+ *
+ * @return A pointer to the newly created table, or NULL on failure.
+ */
+strtab_t *strtab_create(void) {
+    strtab_t *table = calloc(1, sizeof(strtab_t));
+    if (!table) {
+        return NULL;
+    }
+    table->cap = 4096;
+    table->data = malloc(table->cap);
+    table->slot_count = 256;
+    table->slots = calloc(table->slot_count, sizeof(uint32_t));
+    if (!table->data || !table->slots) {
+        strtab_destroy(table);
+        return NULL;
+    }
+    table->data[0] = '\0';
+    table->len = 1;
+    return table;
+}
+
+/**
+ * Destroy a string table and free all strings in it.
+ *
+ * @param table The table to destroy.
+ */
+void strtab_destroy(strtab_t *table) {
+    if (!table) {
+        return;
+    }
+    free(table->data);
+    free(table->slots);
+    free(table);
+}
+
+/**
+ * Double the index and re-insert every stored string.
+ *
+ * @param table The table to grow.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int grow_slots(strtab_t *table) {
+    size_t new_count = table->slot_count * 2;
+    uint32_t *slots = calloc(new_count, sizeof(uint32_t));
+    if (!slots) {
+        return -1;
+    }
+    for (size_t i = 0; i < table->slot_count; i++) {
+        uint32_t offset = table->slots[i];
+        if (offset == 0) {
+            continue;
+        }
+        const char *str = table->data + offset;
+        size_t s = hash_str(str, strlen(str)) & (new_count - 1);
+        while (slots[s] != 0) {
+            s = (s + 1) & (new_count - 1);
+        }
+        slots[s] = offset;
+    }
+    free(table->slots);
+    table->slots = slots;
+    table->slot_count = new_count;
+    return 0;
+}
+
+/**
+ * Intern a string: return the offset of an equal string already in the
+ * table, or append a copy of it.
+ *
+ * @param table The table to intern into.
+ * @param str The string (need not be NUL-terminated).
+ * @param len Length of the string.
+ * @return The offset of the string, or STRTAB_INVALID on failure.
+ */
+uint32_t strtab_intern(strtab_t *table, const char *str, size_t len) {
+    if (len == 0) {
+        return 0;
+    }
+
+    size_t mask = table->slot_count - 1;
+    size_t s = hash_str(str, len) & mask;
+    while (table->slots[s] != 0) {
+        const char *cand = table->data + table->slots[s];
+        if (strncmp(cand, str, len) == 0 && cand[len] == '\0') {
+            return table->slots[s];
+        }
+        s = (s + 1) & mask;
+    }
+
+    // Not found, append it
+    if (table->len + len + 1 > STRTAB_INVALID) {
+        return STRTAB_INVALID;
+    }
+    if (table->len + len + 1 > table->cap) {
+        size_t new_cap = table->cap * 2;
+        while (new_cap < table->len + len + 1) {
+            new_cap *= 2;
+        }
+        char *tmp = realloc(table->data, new_cap);
+        if (!tmp) {
+            return STRTAB_INVALID;
+        }
+        table->data = tmp;
+        table->cap = new_cap;
+    }
+    uint32_t offset = (uint32_t)table->len;
+    memcpy(table->data + offset, str, len);
+    table->data[offset + len] = '\0';
+
+    // Keep the index at most half full
+    if ((table->used + 1) * 2 > table->slot_count) {
+        if (grow_slots(table) != 0) {
+            return STRTAB_INVALID;
+        }
+        mask = table->slot_count - 1;
+        s = hash_str(str, len) & mask;
+        while (table->slots[s] != 0) {
+            s = (s + 1) & mask;
+        }
+    }
+    table->slots[s] = offset;
+    table->used++;
+    table->len += len + 1;
+    return offset;
+}
+
+/**
+ * Get a string of the table by its offset.
+ * NOTE: The pointer is invalidated by the next strtab_intern() call.
+ *
+ * @param table The table to look into.
+ * @param offset Offset returned by strtab_intern().
+ * @return The NUL-terminated string.
+ */
+const char *strtab_get(const strtab_t *table, uint32_t offset) {
+    return table->data + offset;
+}
+
+/**
+ * Get the number of bytes used by the strings of the table.
+ *
+ * @param table The table to measure.
+ * @return Bytes used, including the terminators.
+ */
+size_t strtab_size(const strtab_t *table) { return table->len; }
@@ -0,0 +1,20 @@
+// src/datastructure/strtab.h
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * strtab_t is an interning string table. Every distinct string is stored
+ * once in a single growing buffer and referred to by its 32-bit offset, so
+ * records that repeat the same string (e.g. the many VMAs of one shared
+ * library) only carry 4 bytes each. Offset 0 is always the empty string.
+ */
+typedef struct strtab_t strtab_t;
+
+#define STRTAB_INVALID UINT32_MAX
+
+strtab_t *strtab_create(void);
+void strtab_destroy(strtab_t *table);
+uint32_t strtab_intern(strtab_t *table, const char *str, size_t len);
+const char *strtab_get(const strtab_t *table, uint32_t offset);
+size_t strtab_size(const strtab_t *table);
@@ -0,0 +1,94 @@
+// src/test/test_candset.c
+#include "../datastructure/candset.h"
+#include <assert.h>
+#include <stdio.h>
+
+// Build a set of one block over [start, start + len) from the given hits
+static void build(candset_t *set, uintptr_t start, size_t len,
+                  const uintptr_t *addrs, size_t n) {
+    cand_block_t block;
+    cand_block_init(&block, start, len);
+    for (size_t i = 0; i < n; i++) {
+        assert(cand_block_push(&block, set->align, addrs[i]) == 0);
+    }
+    assert(candset_append(set, &block) == 0);
+}
+
+// Check that iterating a set yields exactly the given hits
+static void expect(const candset_t *set, const uintptr_t *addrs, size_t n) {
+    cand_iter_t it;
+    cand_iter_init(&it, set);
+    uintptr_t addr;
+    size_t k = 0;
+    while (cand_iter_next(&it, &addr)) {
+        assert(k < n && addr == addrs[k]);
+        k++;
+    }
+    assert(k == n && candset_count(set) == n);
+}
+
+void test_sparse(void) {
+    printf("Running test: %s\n", __func__);
+    candset_t set;
+    candset_init(&set, 4, 4);
+
+    // A few far apart hits stay delta-encoded, including long distances
+    uintptr_t addrs[] = {0x10000, 0x10004, 0x10400, 0x8f000, 0xfffc0};
+    build(&set, 0x10000, 0xf0000, addrs, 5);
+    assert(set.block_count == 1 && set.blocks[0].enc == CAND_DELTAS);
+    expect(&set, addrs, 5);
+
+    candset_free(&set);
+    printf("OK\n");
+}
+
+void test_dense(void) {
+    printf("Running test: %s\n", __func__);
+    candset_t set;
+    candset_init(&set, 1, 1);
+
+    // Every third byte of 4 KiB turns into a bitmap of 512 bytes
+    static uintptr_t addrs[1366];
+    size_t n = 0;
+    for (uintptr_t a = 0x2000; a < 0x3000; a += 3) {
+        addrs[n++] = a;
+    }
+    build(&set, 0x2000, 0x1000, addrs, n);
+    assert(set.blocks[0].enc == CAND_BITMAP);
+    assert(set.blocks[0].size == 0x1000 / 8);
+    expect(&set, addrs, n);
+
+    candset_free(&set);
+    printf("OK\n");
+}
+
+void test_blocks(void) {
+    printf("Running test: %s\n", __func__);
+    candset_t set;
+    candset_init(&set, 2, 2);
+
+    // Empty blocks vanish, the others are iterated in order
+    uintptr_t first[] = {0x1000, 0x1ffe};
+    uintptr_t second[] = {0x5000};
+    build(&set, 0x1000, 0x1000, first, 2);
+    build(&set, 0x3000, 0x1000, NULL, 0);
+    build(&set, 0x5000, 0x1000, second, 1);
+    assert(set.block_count == 2);
+    uintptr_t all[] = {0x1000, 0x1ffe, 0x5000};
+    expect(&set, all, 3);
+
+    // Cutting inside a block keeps its first hits only
+    assert(candset_truncate(&set, 1) == 0);
+    expect(&set, all, 1);
+    assert(set.block_count == 1);
+
+    candset_free(&set);
+    printf("OK\n");
+}
+
+int main(void) {
+    test_sparse();
+    test_dense();
+    test_blocks();
+    return 0;
+}
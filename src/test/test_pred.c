@@ -0,0 +1,95 @@
+// src/test/test_pred.c
+#include "../utils/pred.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+// Run a predicate over a few dwords and return the hits as a bit set
+static unsigned run_i32(const char *expr, bool is_signed, const int32_t *v,
+                        size_t n) {
+    pred_t pred;
+    uint32_t hits[16];
+    assert(pred_compile(expr, sizeof(int32_t), is_signed, &pred) == 0);
+    size_t k = pred_run(&pred, (const uint8_t *)v, n, hits);
+    pred_free(&pred);
+    unsigned set = 0;
+    for (size_t i = 0; i < k; i++) {
+        set |= 1u << hits[i];
+    }
+    return set;
+}
+
+void test_signed(void) {
+    printf("Running test: %s\n", __func__);
+    int32_t v[] = {-100, -50, 0, 50, 51, 0x17f, -0x81, 127};
+
+    // Signed bounds around zero, and a mask on the low byte
+    assert(run_i32("x >= -50 && x <= 50", true, v, 8) == 0x0E);
+    assert(run_i32("x >= -50 && x <= 50 && (x & 0xff) == 0x7f", true, v,
+                   8) == 0x00);
+    assert(run_i32("(x & 0xff) == 0x7f", true, v, 8) == 0xE0);
+    assert(run_i32("x < 0", true, v, 8) == 0x43);
+
+    // Unsigned, -100 is a large number and -1 is below every value
+    assert(run_i32("x > 1000", false, v, 8) == 0x43);
+    assert(run_i32("x > -1", false, v, 8) == 0xFF);
+    printf("OK\n");
+}
+
+void test_logic(void) {
+    printf("Running test: %s\n", __func__);
+    int32_t v[] = {1, 2, 3, 4, 5, 6, 0x1234, 0};
+
+    assert(run_i32("x in 2..4", true, v, 8) == 0x0E);
+    assert(run_i32("not x in 2..4 and x != 0", true, v, 8) == 0x71);
+    assert(run_i32("x == 1 || x == 6 || (x >> 8) == 0x12", true, v, 8) ==
+           0x61);
+    assert(run_i32("!(x & 1)", true, v, 8) == 0xEA);
+    assert(run_i32("x", true, v, 8) == 0x7F);
+
+    // Literals out of the range of the value never or always compare true
+    assert(run_i32("(x & 0xff) > 300", true, v, 8) == 0x00);
+    assert(run_i32("x > 3000000000", true, v, 8) == 0x00);
+    assert(run_i32("x >> 40 == 0", true, v, 8) == 0xFF);
+    printf("OK\n");
+}
+
+void test_chunks(void) {
+    printf("Running test: %s\n", __func__);
+    // Longer than a chunk, with a partial last word
+    static uint16_t v[PRED_CHUNK + 77];
+    for (size_t i = 0; i < sizeof(v) / sizeof(v[0]); i++) {
+        v[i] = (uint16_t)i;
+    }
+    static uint32_t hits[PRED_CHUNK + 77];
+    pred_t pred;
+    assert(pred_compile("x >= 4090 && x < 4100 || x > 4170", 2, false,
+                        &pred) == 0);
+    size_t k = pred_run(&pred, (const uint8_t *)v, PRED_CHUNK + 77, hits);
+    pred_free(&pred);
+    assert(k == 10 + 2);
+    assert(hits[0] == 4090 && hits[9] == 4099 && hits[11] == 4172);
+    printf("OK\n");
+}
+
+void test_errors(void) {
+    printf("Running test: %s\n", __func__);
+    pred_t pred;
+    assert(pred_compile("", 4, true, &pred) != 0);
+    assert(pred_compile("y == 1", 4, true, &pred) != 0);
+    assert(pred_compile("x ==", 4, true, &pred) != 0);
+    assert(pred_compile("(x == 1", 4, true, &pred) != 0);
+    assert(pred_compile("x in 1 2", 4, true, &pred) != 0);
+    assert(pred_compile("x == 1 junk", 4, true, &pred) != 0);
+    assert(pred_compile("x == 1", 3, true, &pred) != 0);
+    assert(pred_compile("x == 99999999999999999999", 8, false, &pred) != 0);
+    printf("OK\n");
+}
+
+int main(void) {
+    test_signed();
+    test_logic();
+    test_chunks();
+    test_errors();
+    return 0;
+}
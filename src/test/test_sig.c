@@ -0,0 +1,72 @@
+// src/test/test_sig.c
+#include "../utils/sig.h"
+#include <assert.h>
+#include <stdio.h>
+
+void test_compile(void) {
+    printf("Running test: %s\n", __func__);
+    signature_t sig;
+
+    // Wildcards and half-fixed bytes, with or without spaces
+    assert(sig_compile("48 8B ?? ? 4? ?b", &sig) == 0);
+    assert(sig.len == 6);
+    uint8_t mask[] = {0xFF, 0xFF, 0x00, 0x00, 0xF0, 0x0F};
+    uint8_t bytes[] = {0x48, 0x8B, 0x00, 0x00, 0x40, 0x0B};
+    for (size_t i = 0; i < sig.len; i++) {
+        assert(sig.mask[i] == mask[i] && sig.bytes[i] == bytes[i]);
+    }
+    assert(sig.anchor == 0 && sig.anchor_len == 2);
+    sig_free(&sig);
+
+    assert(sig_compile("488b??", &sig) == 0);
+    assert(sig.len == 3 && sig.bytes[1] == 0x8B);
+    sig_free(&sig);
+
+    // Bad digits, odd lengths and all-wildcard signatures are refused
+    assert(sig_compile("48 8G", &sig) != 0);
+    assert(sig_compile("48 8", &sig) != 0);
+    assert(sig_compile("?? ??", &sig) != 0);
+    assert(sig_compile("", &sig) != 0);
+    printf("OK\n");
+}
+
+void test_anchor(void) {
+    printf("Running test: %s\n", __func__);
+    signature_t sig;
+
+    // A pair of common bytes loses against a pair with rare ones
+    assert(sig_compile("00 00 ?? 5A C3", &sig) == 0);
+    assert(sig.anchor == 3 && sig.anchor_len == 2);
+    sig_free(&sig);
+
+    // No two fixed bytes are adjacent: a single one will do
+    assert(sig_compile("00 ?? 7E ?? 00", &sig) == 0);
+    assert(sig.anchor == 2 && sig.anchor_len == 1);
+    sig_free(&sig);
+    printf("OK\n");
+}
+
+void test_match(void) {
+    printf("Running test: %s\n", __func__);
+    signature_t sig;
+    assert(sig_compile("4B ?? 6? ?7", &sig) == 0);
+    uint8_t hit[] = {0x4B, 0xAA, 0x69, 0x67};
+    uint8_t miss[] = {0x4B, 0xAA, 0x79, 0x67};
+    assert(sig_match(&sig, hit));
+    assert(!sig_match(&sig, miss));
+    sig_free(&sig);
+
+    // A signature from plain bytes has no wildcards
+    assert(sig_from_bytes("Knig", 4, &sig) == 0);
+    assert(sig_match(&sig, (const uint8_t *)"Knight"));
+    assert(!sig_match(&sig, (const uint8_t *)"Knot"));
+    sig_free(&sig);
+    printf("OK\n");
+}
+
+int main(void) {
+    test_compile();
+    test_anchor();
+    test_match();
+    return 0;
+}
@@ -0,0 +1,328 @@
+// src/test/test_simd.c
+#include "../utils/simd.h"
+#include <assert.h>
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_BYTES 8192
+
+static const size_t type_sizes[] = {1, 2, 4, 8};
+
+/**
+ * Fill a buffer with values drawn from a small pool, so that equal, smaller
+ * and greater elements are all common. Some values have the top bit set to
+ * catch signed compares.
+ */
+static void fill_random(uint8_t *buf, size_t len, uint64_t *pool,
+                        size_t pool_len, size_t type_size) {
+    for (size_t off = 0; off + type_size <= len; off += type_size) {
+        uint64_t v = pool[(size_t)rand() % pool_len];
+        memcpy(buf + off, &v, type_size);
+    }
+}
+
+void test_kernels_match_scalar(void) {
+    printf("Running test: %s\n", __func__);
+    static uint8_t buf[MAX_BYTES + 64];
+    static uint32_t want[MAX_BYTES], got[MAX_BYTES];
+    srand(12345);
+
+    for (int level = SIMD_SCALAR + 1; level < SIMD_LEVELS; level++) {
+        if (!cmp_kernel((simd_level_t)level, SCAN_TYPE_BYTE, CMP_EQ)) {
+            printf("  %s: not supported, skipped\n",
+                   simd_level_name((simd_level_t)level));
+            continue;
+        }
+        for (int type = SCAN_TYPE_BYTE; type <= SCAN_TYPE_QWORD; type++) {
+            size_t size = type_sizes[type];
+            for (int cmp = CMP_EQ; cmp <= CMP_LT; cmp++) {
+                cmp_kernel_t scalar =
+                    cmp_kernel(SIMD_SCALAR, (scan_type_t)type, (cmp_op_t)cmp);
+                cmp_kernel_t vec = cmp_kernel(
+                    (simd_level_t)level, (scan_type_t)type, (cmp_op_t)cmp);
+                assert(scalar && vec);
+
+                for (int round = 0; round < 200; round++) {
+                    uint64_t pool[4];
+                    for (int i = 0; i < 4; i++) {
+                        pool[i] = ((uint64_t)rand() << 33) ^
+                                  ((uint64_t)rand() << 2) ^ (uint64_t)rand();
+                    }
+                    pool[3] |= 1ULL << (size * 8 - 1); // top bit set
+                    size_t n = (size_t)rand() % (MAX_BYTES / size + 1);
+                    size_t skew = (size_t)rand() % 8; // unaligned starts
+                    fill_random(buf + skew, n * size, pool, 4, size);
+                    uint64_t target = pool[(size_t)rand() % 4];
+                    if (size < 8) {
+                        target &= (1ULL << (size * 8)) - 1;
+                    }
+
+                    size_t nw = scalar(buf + skew, n, target, want);
+                    size_t ng = vec(buf + skew, n, target, got);
+                    assert(nw == ng);
+                    assert(memcmp(want, got, nw * sizeof(*want)) == 0);
+                }
+            }
+        }
+        printf("  %s: OK\n", simd_level_name((simd_level_t)level));
+    }
+    printf("OK\n");
+}
+
+void test_rel_kernels_match_scalar(void) {
+    printf("Running test: %s\n", __func__);
+    static uint8_t old[MAX_BYTES + 64], cur[MAX_BYTES + 64];
+    static uint32_t want[MAX_BYTES], got[MAX_BYTES];
+    srand(54321);
+
+    for (int level = SIMD_SCALAR + 1; level < SIMD_LEVELS; level++) {
+        if (!rel_kernel((simd_level_t)level, SCAN_TYPE_BYTE, REL_CHANGED)) {
+            continue;
+        }
+        for (int type = SCAN_TYPE_BYTE; type <= SCAN_TYPE_QWORD; type++) {
+            size_t size = type_sizes[type];
+            for (int op = REL_CHANGED; op <= REL_DELTA; op++) {
+                rel_kernel_t scalar =
+                    rel_kernel(SIMD_SCALAR, (scan_type_t)type, (rel_op_t)op);
+                rel_kernel_t vec = rel_kernel(
+                    (simd_level_t)level, (scan_type_t)type, (rel_op_t)op);
+                assert(scalar && vec);
+
+                for (int round = 0; round < 100; round++) {
+                    // New values are the old ones plus a small delta
+                    uint64_t pool[4] = {0, 1, 0x7F, (uint64_t)-3};
+                    size_t n = (size_t)rand() % (MAX_BYTES / size + 1);
+                    fill_random(old, n * size, pool, 4, size);
+                    for (size_t i = 0; i < n; i++) {
+                        uint64_t o = 0, v;
+                        memcpy(&o, old + i * size, size);
+                        v = o + (uint64_t)(rand() % 5) - 2;
+                        memcpy(cur + i * size, &v, size);
+                    }
+                    uint64_t lo = (uint64_t)(rand() % 3) - 1;
+                    uint64_t end = (uint64_t)(rand() % 3) + 1;
+
+                    size_t nw = scalar(old, cur, n, lo, end, want);
+                    size_t ng = vec(old, cur, n, lo, end, got);
+                    assert(nw == ng);
+                    assert(memcmp(want, got, nw * sizeof(*want)) == 0);
+                }
+            }
+        }
+        printf("  %s: OK\n", simd_level_name((simd_level_t)level));
+    }
+    printf("OK\n");
+}
+
+/**
+ * Fill a buffer with floats (or doubles) from a pool of special values:
+ * zeros of both signs, denormals, NaN, infinities and ordinary numbers.
+ */
+static void fill_floats(uint8_t *buf, size_t n, size_t size) {
+    static const double pool[] = {0.0,  -0.0, 1.0,      -1.0,   1.5,
+                                  2.25, 1e-310, -1e-310, 1e300, -1e300};
+    for (size_t i = 0; i < n; i++) {
+        double d = pool[(size_t)rand() % (sizeof(pool) / sizeof(pool[0]))];
+        int r = rand() % 16;
+        if (r == 0) {
+            d = 0.0 / 0.0; // NaN
+        } else if (r == 1) {
+            d = 1.0 / 0.0; // +inf
+        }
+        if (size == sizeof(float)) {
+            float f = r == 2 ? 1e-40f : (float)d; // float denormal
+            memcpy(buf + i * size, &f, size);
+        } else {
+            memcpy(buf + i * size, &d, size);
+        }
+    }
+}
+
+void test_float_kernels_match_scalar(void) {
+    printf("Running test: %s\n", __func__);
+    static uint8_t old[MAX_BYTES + 64], cur[MAX_BYTES + 64];
+    static uint32_t want[MAX_BYTES], got[MAX_BYTES];
+    static const double bounds[][2] = {
+        {0.0, 0.0}, {1.0, 1.5}, {-1.0, 1.0}, {1e-320, 1e-300}, {-2.0, 0.5}};
+    srand(2468);
+
+    for (int level = SIMD_SCALAR + 1; level < SIMD_LEVELS; level++) {
+        if (!fcmp_kernel((simd_level_t)level, SCAN_TYPE_FLOAT, FCMP_RANGE)) {
+            continue;
+        }
+        for (int type = SCAN_TYPE_FLOAT; type <= SCAN_TYPE_DOUBLE; type++) {
+            size_t size = type == SCAN_TYPE_FLOAT ? 4 : 8;
+            for (int round = 0; round < 100; round++) {
+                size_t n = (size_t)rand() % (MAX_BYTES / size + 1);
+                fill_floats(old, n, size);
+                fill_floats(cur, n, size);
+                const double *b = bounds[(size_t)rand() % 5];
+
+                for (int op = FCMP_RANGE; op <= FCMP_NAN; op++) {
+                    fcmp_kernel_t scalar = fcmp_kernel(
+                        SIMD_SCALAR, (scan_type_t)type, (fcmp_op_t)op);
+                    fcmp_kernel_t vec = fcmp_kernel(
+                        (simd_level_t)level, (scan_type_t)type, (fcmp_op_t)op);
+                    size_t nw = scalar(cur, n, b[0], b[1], want);
+                    size_t ng = vec(cur, n, b[0], b[1], got);
+                    assert(nw == ng);
+                    assert(memcmp(want, got, nw * sizeof(*want)) == 0);
+                }
+                for (int op = REL_CHANGED; op <= REL_DELTA; op++) {
+                    frel_kernel_t scalar = frel_kernel(
+                        SIMD_SCALAR, (scan_type_t)type, (rel_op_t)op);
+                    frel_kernel_t vec = frel_kernel(
+                        (simd_level_t)level, (scan_type_t)type, (rel_op_t)op);
+                    size_t nw = scalar(old, cur, n, b[0], b[1], want);
+                    size_t ng = vec(old, cur, n, b[0], b[1], got);
+                    assert(nw == ng);
+                    assert(memcmp(want, got, nw * sizeof(*want)) == 0);
+                }
+            }
+        }
+        printf("  %s: OK\n", simd_level_name((simd_level_t)level));
+    }
+    printf("OK\n");
+}
+
+void test_pair_kernels_match_scalar(void) {
+    printf("Running test: %s\n", __func__);
+    static uint8_t buf[MAX_BYTES + 64];
+    static uint32_t want[MAX_BYTES], got[MAX_BYTES];
+    srand(2468);
+
+    pair_kernel_t scalar = pair_kernel(SIMD_SCALAR);
+    for (int level = SIMD_SCALAR + 1; level < SIMD_LEVELS; level++) {
+        pair_kernel_t vec = pair_kernel((simd_level_t)level);
+        if (!vec) {
+            continue;
+        }
+        for (int round = 0; round < 500; round++) {
+            // Three byte values, so pairs and near misses are common
+            uint8_t pool[3] = {(uint8_t)rand(), (uint8_t)rand(),
+                               (uint8_t)rand()};
+            size_t n = (size_t)rand() % MAX_BYTES;
+            size_t skew = (size_t)rand() % 8;
+            for (size_t i = 0; i <= n; i++) {
+                buf[skew + i] = pool[(size_t)rand() % 3];
+            }
+            static const uint8_t masks[] = {0xFF, 0xDF, 0xF0, 0x00};
+            uint8_t m0 = masks[(size_t)rand() % 4];
+            uint8_t m1 = masks[(size_t)rand() % 4];
+            uint8_t b0 = pool[(size_t)rand() % 3] & m0;
+            uint8_t b1 = pool[(size_t)rand() % 3] & m1;
+
+            size_t nw = scalar(buf + skew, n, b0, m0, b1, m1, want);
+            size_t ng = vec(buf + skew, n, b0, m0, b1, m1, got);
+            assert(nw == ng);
+            assert(memcmp(want, got, nw * sizeof(*want)) == 0);
+        }
+        printf("  %s: OK\n", simd_level_name((simd_level_t)level));
+    }
+    printf("OK\n");
+}
+
+void test_diff_kernels_match_scalar(void) {
+    printf("Running test: %s\n", __func__);
+    static uint8_t old[MAX_BYTES + 64], cur[MAX_BYTES + 64];
+    static uint64_t want[MAX_BYTES / 64 + 1], got[MAX_BYTES / 64 + 1];
+    srand(1357);
+
+    diff_kernel_t scalar = diff_kernel(SIMD_SCALAR);
+    for (int level = SIMD_SCALAR + 1; level < SIMD_LEVELS; level++) {
+        diff_kernel_t vec = diff_kernel((simd_level_t)level);
+        if (!vec) {
+            continue;
+        }
+        for (int round = 0; round < 500; round++) {
+            // Runs of changed bytes of any length, some across vectors
+            size_t n = (size_t)rand() % MAX_BYTES;
+            size_t skew = (size_t)rand() % 8;
+            int odds = 1 + rand() % 64;
+            bool changing = false;
+            for (size_t i = 0; i < n; i++) {
+                if (rand() % odds == 0) {
+                    changing = !changing;
+                }
+                old[skew + i] = (uint8_t)rand();
+                cur[skew + i] = old[skew + i] ^ (uint8_t)(changing << (i % 8));
+            }
+
+            size_t words = (n + 63) / 64;
+            scalar(old + skew, cur + skew, n, want);
+            vec(old + skew, cur + skew, n, got);
+            assert(memcmp(want, got, words * sizeof(*want)) == 0);
+        }
+        printf("  %s: OK\n", simd_level_name((simd_level_t)level));
+    }
+    printf("OK\n");
+}
+
+void test_scalar_semantics(void) {
+    printf("Running test: %s\n", __func__);
+    // Unsigned compares: 0xFF is the largest byte, not -1
+    uint8_t bytes[] = {0x00, 0x7F, 0x80, 0xFF, 0x7F};
+    uint32_t hits[8];
+    cmp_kernel_t gt = cmp_kernel(SIMD_SCALAR, SCAN_TYPE_BYTE, CMP_GT);
+    size_t n = gt(bytes, 5, 0x7F, hits);
+    assert(n == 2 && hits[0] == 2 && hits[1] == 3);
+
+    cmp_kernel_t eq = cmp_kernel(SIMD_SCALAR, SCAN_TYPE_BYTE, CMP_EQ);
+    n = eq(bytes, 5, 0x7F, hits);
+    assert(n == 2 && hits[0] == 1 && hits[1] == 4);
+
+    // Deltas wrap around: 0xFF -> 0x01 went up by 2
+    uint8_t before[] = {0xFF, 0x10, 0x10};
+    uint8_t after[] = {0x01, 0x0E, 0x10};
+    rel_kernel_t delta = rel_kernel(SIMD_SCALAR, SCAN_TYPE_BYTE, REL_DELTA);
+    n = delta(before, after, 3, 2, 1, hits); // delta == 2
+    assert(n == 1 && hits[0] == 0);
+    n = delta(before, after, 3, (uint64_t)-2, 3, hits); // -2 <= delta <= 0
+    assert(n == 2 && hits[0] == 1 && hits[1] == 2);
+
+    // With the sign bit flipped, 0xFF -> 0x01 is -1 -> 1 and went up
+    rel_kernel_t up = rel_kernel(SIMD_SCALAR, SCAN_TYPE_BYTE, REL_INCREASED);
+    n = up(before, after, 3, 0, 0, hits);
+    assert(n == 0);
+    n = up(before, after, 3, 0x80, 0, hits);
+    assert(n == 1 && hits[0] == 0);
+
+    // Denormals are zero, NaN only matches FCMP_NAN
+    float floats[] = {0.0f, 1e-40f, -0.0f, 0.0f / 0.0f, 2.5f};
+    fcmp_kernel_t range = fcmp_kernel(SIMD_SCALAR, SCAN_TYPE_FLOAT, FCMP_RANGE);
+    n = range((const uint8_t *)floats, 5, 0.0, 0.0, hits);
+    assert(n == 3 && hits[0] == 0 && hits[1] == 1 && hits[2] == 2);
+    fcmp_kernel_t outside =
+        fcmp_kernel(SIMD_SCALAR, SCAN_TYPE_FLOAT, FCMP_OUTSIDE);
+    n = outside((const uint8_t *)floats, 5, 0.0, 0.0, hits);
+    assert(n == 1 && hits[0] == 4);
+    fcmp_kernel_t nan = fcmp_kernel(SIMD_SCALAR, SCAN_TYPE_FLOAT, FCMP_NAN);
+    n = nan((const uint8_t *)floats, 5, 0.0, 0.0, hits);
+    assert(n == 1 && hits[0] == 3);
+
+    // A NaN neither changed nor stayed the same
+    double dbefore[] = {1.0, 0.0 / 0.0, 1.0};
+    double dafter[] = {1.25, 0.0 / 0.0, 1.0};
+    frel_kernel_t changed =
+        frel_kernel(SIMD_SCALAR, SCAN_TYPE_DOUBLE, REL_CHANGED);
+    n = changed((const uint8_t *)dbefore, (const uint8_t *)dafter, 3, 0, 0,
+                hits);
+    assert(n == 1 && hits[0] == 0);
+    frel_kernel_t fdelta = frel_kernel(SIMD_SCALAR, SCAN_TYPE_DOUBLE, REL_DELTA);
+    n = fdelta((const uint8_t *)dbefore, (const uint8_t *)dafter, 3, 0.2, 0.3,
+               hits);
+    assert(n == 1 && hits[0] == 0);
+    printf("OK\n");
+}
+
+int main(void) {
+    test_scalar_semantics();
+    test_kernels_match_scalar();
+    test_rel_kernels_match_scalar();
+    test_float_kernels_match_scalar();
+    test_pair_kernels_match_scalar();
+    test_diff_kernels_match_scalar();
+    return 0;
+}
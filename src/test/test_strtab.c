@@ -0,0 +1,65 @@
+// src/test/test_strtab.c
+#include "../datastructure/strtab.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+void test_empty_string(void) {
+    printf("Running test: %s\n", __func__);
+    strtab_t *table = strtab_create();
+    assert(table != NULL);
+    assert(strtab_intern(table, "", 0) == 0);
+    assert(strcmp(strtab_get(table, 0), "") == 0);
+    strtab_destroy(table);
+    printf("OK\n");
+}
+
+void test_intern(void) {
+    printf("Running test: %s\n", __func__);
+    strtab_t *table = strtab_create();
+
+    // Equal strings share one offset, also when not NUL-terminated
+    uint32_t libc = strtab_intern(table, "/usr/lib/libc.so.6", 18);
+    uint32_t heap = strtab_intern(table, "[heap]", 6);
+    assert(libc != heap);
+    assert(strtab_intern(table, "/usr/lib/libc.so.6 extra", 18) == libc);
+    assert(strtab_intern(table, "[heap]", 6) == heap);
+    assert(strcmp(strtab_get(table, libc), "/usr/lib/libc.so.6") == 0);
+
+    // A prefix of a stored string is a different string
+    uint32_t prefix = strtab_intern(table, "[he", 3);
+    assert(prefix != heap);
+    assert(strcmp(strtab_get(table, prefix), "[he") == 0);
+
+    strtab_destroy(table);
+    printf("OK\n");
+}
+
+void test_grow(void) {
+    printf("Running test: %s\n", __func__);
+    strtab_t *table = strtab_create();
+    uint32_t offsets[5000];
+    char buf[64];
+
+    // Enough strings to grow both the buffer and the index several times
+    for (int i = 0; i < 5000; i++) {
+        int len = snprintf(buf, sizeof(buf), "/tmp/lib%d.so", i);
+        offsets[i] = strtab_intern(table, buf, (size_t)len);
+        assert(offsets[i] != STRTAB_INVALID);
+    }
+    for (int i = 0; i < 5000; i++) {
+        int len = snprintf(buf, sizeof(buf), "/tmp/lib%d.so", i);
+        assert(strtab_intern(table, buf, (size_t)len) == offsets[i]);
+        assert(strcmp(strtab_get(table, offsets[i]), buf) == 0);
+    }
+
+    strtab_destroy(table);
+    printf("OK\n");
+}
+
+int main(void) {
+    test_empty_string();
+    test_intern();
+    test_grow();
+    return 0;
+}
@@ -0,0 +1,74 @@
+// src/test/test_text.c
+#include "../utils/text.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+// Length of the match of a regex at the start of a string, 0 if none
+static size_t match(const char *pattern, bool icase, const char *s) {
+    text_regex_t re;
+    assert(text_regex_compile(pattern, TEXT_UTF8, icase, &re) == 0);
+    size_t len = text_regex_match(&re, (const uint8_t *)s, strlen(s) + 1);
+    text_regex_free(&re);
+    return len;
+}
+
+void test_literal(void) {
+    printf("Running test: %s\n", __func__);
+    signature_t sig;
+
+    // UTF-16LE: every ASCII character is followed by a zero byte
+    assert(text_literal("Hi", TEXT_UTF16LE, false, &sig) == 0);
+    assert(sig.len == 4 && memcmp(sig.bytes, "H\0i\0", 4) == 0);
+    sig_free(&sig);
+
+    // Ignoring the case masks out bit 5 of letters only
+    assert(text_literal("a1", TEXT_UTF8, true, &sig) == 0);
+    assert(sig.mask[0] == 0xDF && sig.mask[1] == 0xFF);
+    assert(sig_match(&sig, (const uint8_t *)"A1"));
+    assert(!sig_match(&sig, (const uint8_t *)"!1"));
+    sig_free(&sig);
+
+    // U+263A is three bytes of UTF-8, one unit of UTF-16
+    assert(text_literal("\xe2\x98\xba", TEXT_UTF16LE, false, &sig) == 0);
+    assert(sig.len == 2 && sig.bytes[0] == 0x3A && sig.bytes[1] == 0x26);
+    sig_free(&sig);
+    assert(text_literal("", TEXT_UTF8, false, &sig) != 0);
+    printf("OK\n");
+}
+
+void test_regex(void) {
+    printf("Running test: %s\n", __func__);
+    // The shortest match is enough to tell that one starts here
+    assert(match("ab+", false, "abbb") == 2);
+    assert(match("a(b|cd)e", false, "acde") == 4);
+    assert(match("[0-9]{3}", false, "12a") == 0);
+    assert(match("\\d{2,}x", false, "1234x") == 5);
+    assert(match("player_\\w+", true, "PLAYER_one") == 8);
+    assert(match("[^a-c]", false, "d") == 1);
+
+    // '.' and negated classes stop at the end of a C string
+    assert(match("a.", false, "a") == 0);
+    assert(match("a[^x]", false, "a") == 0);
+
+    // The prefilter holds the bits every first and second byte shares
+    text_regex_t re;
+    assert(text_regex_compile("[0-7]z", TEXT_UTF8, false, &re) == 0);
+    assert(re.first[0] == 0x30 && re.first_mask[0] == 0xF8);
+    assert(re.first[1] == 'z' && re.first_mask[1] == 0xFF);
+    assert(re.min_len == 2);
+    text_regex_free(&re);
+
+    // Empty matches, bad syntax and impossible matches are refused
+    assert(text_regex_compile("a*", TEXT_UTF8, false, &re) != 0);
+    assert(text_regex_compile("(ab", TEXT_UTF8, false, &re) != 0);
+    assert(text_regex_compile("a{2,1}", TEXT_UTF8, false, &re) != 0);
+    assert(text_regex_compile("[\\0]", TEXT_UTF8, false, &re) != 0);
+    printf("OK\n");
+}
+
+int main(void) {
+    test_literal();
+    test_regex();
+    return 0;
+}
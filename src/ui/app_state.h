@@ -1,6 +1,8 @@
 // src/ui/app_state.h
 #pragma once
+#include "../utils/history.h"
 #include "../utils/probe.h"
+#include "../utils/scan.h"
 #include <stdbool.h>
 #include <sys/types.h>
 
@@ -9,13 +11,33 @@ typedef struct {
     char proc_name[256];
     bool attached;
 
-    // Full scan history
-    mem_region_t *initial_scan;
-    size_t initial_scan_count;
-    mem_region_t *previous_scan;
-    size_t previous_scan_count;
-    mem_region_t *current_scan;
-    size_t current_scan_count;
+    // Full scan history, the newest generation last
+    history_t history;
+
+    // True if the soft-dirty bits were cleared right when the newest scan was
+    // taken, so the next 'fullscan inc' may build upon it
+    bool soft_dirty_armed;
+
+    // Matches of the last search, kept for narrowing
+    candset_t candidates;
+    scan_type_t cand_type;
+    bool cand_signed; // integers compared (and shown) as signed
+    uint64_t cand_gen; // generation they were found in
+    // Unknown initial value: every aligned slot of cand_gen is a candidate,
+    // and `candidates` stays empty until the first filter
+    bool cand_implicit;
+    // Last known value of every candidate, NULL if all equal cand_value
+    uint8_t *cand_values;
+    uint64_t cand_value;
+    bool has_candidates;
+
+    // Matches of an 'any' search that hit several types, one set per type,
+    // until 'search keep <type>' keeps one of them as the candidates
+    candset_t any_found[SCAN_TYPE_COUNT];
+    scan_value_t any_values[SCAN_TYPE_COUNT];
+    size_t any_count;
+    uint64_t any_gen;
+    bool has_any;
 } app_state_t;
 
 extern app_state_t g_app_state;
@@ -0,0 +1,148 @@
+// src/ui/handler/aob.c
+#include "../../utils/peek.h"
+#include "../../utils/scan.h"
+#include "../../utils/threadpool.h"
+#include "../app_state.h"
+#include "../logger.h"
+#include "../pager.h"
+#include "handler.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Signatures one 'aob' command may look for at once
+#define AOB_MAX_SIGS 16
+// Matches listed per signature unless 'page' or 'head <n>' is given
+#define AOB_LIST_MAX 10
+
+/**
+ * Handle the 'aob' command.
+ * This command looks for byte signatures with wildcards, like
+ * "48 8B ?? ?? 89 05", in the newest generation. Several signatures
+ * separated by '|' are searched in one pass. Leading 'page' and
+ * 'head <n>' options list the matches like 'list' does, 'head <n>' per
+ * signature.
+ *
+ * @param sigs_str The options and the signatures, or NULL.
+ */
+void handle_aob(char *sigs_str) {
+    uint64_t gen = 0;
+    if (!history_newest(&g_app_state.history, &gen)) {
+        log_printf(LOG_RED,
+                   "No scan data available. Please perform a scan first.\n");
+        return;
+    }
+    bool paginate = false;
+    size_t limit = 0;
+    int taken = 1;
+    while (sigs_str && taken > 0) {
+        taken = take_listing_option(&sigs_str, &paginate, &limit);
+    }
+    if (taken < 0) {
+        return;
+    }
+    if (!sigs_str || *sigs_str == '\0') {
+        log_printf(LOG_RED, "Usage: aob [page] [head <n>] <signature> "
+                            "[| <signature> ...]\n");
+        log_printf(LOG_YELLOW, "Signature: hex bytes with ?? for any byte, "
+                               "e.g. 48 8B ?? ?? 89 05\n");
+        return;
+    }
+    if (history_hash_only(&g_app_state.history, gen)) {
+        log_printf(LOG_RED,
+                   "Generation %lu only holds page hashes, it can't be "
+                   "searched.\n",
+                   gen);
+        return;
+    }
+
+    signature_t sigs[AOB_MAX_SIGS];
+    char *texts[AOB_MAX_SIGS];
+    size_t nsigs = 0;
+    bool ok = true;
+    for (char *save = NULL, *text = strtok_r(sigs_str, "|", &save);
+         text && ok; text = strtok_r(NULL, "|", &save)) {
+        text += strspn(text, " ");
+        for (size_t len = strlen(text); len > 0 && text[len - 1] == ' ';) {
+            text[--len] = '\0';
+        }
+        if (nsigs == AOB_MAX_SIGS) {
+            log_printf(LOG_RED, "At most %d signatures at once.\n",
+                       AOB_MAX_SIGS);
+            ok = false;
+        } else if (sig_compile(text, &sigs[nsigs]) != 0) {
+            log_printf(LOG_RED, "Invalid signature: %s\n", text);
+            log_printf(LOG_YELLOW, "Expected hex bytes with ?? for any "
+                                   "byte, and at least one fixed byte.\n");
+            ok = false;
+        } else {
+            texts[nsigs++] = text;
+        }
+    }
+
+    mem_region_t *regions;
+    size_t regions_count;
+    candset_t found[AOB_MAX_SIGS];
+    size_t counts[AOB_MAX_SIGS];
+    uint64_t t0 = peek_now_ns();
+    if (ok && history_get(&g_app_state.history, gen, &regions,
+                          &regions_count) != 0) {
+        log_printf(LOG_RED, "Failed to load generation %lu.\n", gen);
+        ok = false;
+    }
+    if (ok && search_sig_set(regions, regions_count, sigs, nsigs, NULL, found,
+                             counts) != 0) {
+        log_printf(LOG_RED, "Signature search failed.\n");
+        ok = false;
+    }
+    double ms = (double)(peek_now_ns() - t0) / 1e6;
+
+    if (ok) {
+        log_printf(LOG_GREEN,
+                   "Searched %zu signature(s) in generation %lu in %.1f ms "
+                   "(%zu threads).\n",
+                   nsigs, gen, ms, pool_workers());
+    }
+
+    // Paged, all signatures go through one pager, so the per-signature
+    // limit is counted here rather than by the pager
+    bool truncated = !paginate && limit == 0;
+    pager_t pager;
+    if (ok && paginate) {
+        pager_open(&pager, true, 0);
+    }
+    for (size_t s = 0; ok && s < nsigs; s++) {
+        if (paginate) {
+            fprintf(pager.out, "[%zu] %s: %zu matches\n", s + 1, texts[s],
+                    counts[s]);
+        } else {
+            log_printf(LOG_GREEN, "[%zu] %s", s + 1, texts[s]);
+            log_printf(LOG_DEFAULT, ": %zu matches\n", counts[s]);
+            pager_open(&pager, false, truncated ? AOB_LIST_MAX : limit);
+        }
+
+        cand_iter_t it;
+        cand_iter_init(&it, &found[s]);
+        uintptr_t addr;
+        size_t shown = 0;
+        while ((!paginate || limit == 0 || shown < limit) &&
+               pager_wants(&pager) && cand_iter_next(&it, &addr)) {
+            fprintf(pager_entry(&pager), "  -> 0x%lx\n", addr);
+            shown++;
+        }
+        if (!paginate) {
+            pager_close(&pager);
+            if (shown < counts[s]) {
+                log_printf(LOG_YELLOW, "  ... and %zu more%s\n",
+                           counts[s] - shown,
+                           truncated ? ". Use 'aob page ...' to scroll." : "");
+            }
+        }
+        candset_free(&found[s]);
+    }
+    if (ok && paginate) {
+        pager_close(&pager);
+    }
+    for (size_t s = 0; s < nsigs; s++) {
+        sig_free(&sigs[s]);
+    }
+}
@@ -1,10 +1,12 @@
 // src/ui/handler/attach.h
 #include "../../utils/pid.h"
 #include "../../utils/probe.h"
+#include "../../utils/threadpool.h"
 #include "../app_state.h"
 #include "../logger.h"
 #include "handler.h"
 #include <stdio.h>
+#include <string.h>
 
 /**
  * Handle the 'attach' command.
@@ -36,29 +38,42 @@ void handle_attach(char *arg) {
     get_proc_name(pid, g_app_state.proc_name, sizeof(g_app_state.proc_name));
     g_app_state.attached = true;
 
+    // Start the worker pool shared by scan, search and detect
+    if (pool_start(0) != 0) {
+        log_printf(LOG_YELLOW, "Failed to start the worker pool, running "
+                               "single-threaded.\n");
+    }
+
     // Perform the initial scan of the process's memory
     log_printf(LOG_DEFAULT,
                "Attaching to %s (PID: %d). Performing initial scan...\n",
                g_app_state.proc_name, g_app_state.pid);
     mem_region_t *init_buf = NULL;
     size_t init_count = 0;
-    if (full_scan(pid, &init_buf, &init_count) != 0) {
+    peek_stats_t stats = {0};
+    if (full_scan(pid, &init_buf, &init_count, &stats) != 0) {
         log_printf(LOG_RED, "Failed to perform initial scan for PID %d.\n",
                    pid);
         cleanup_app_state();
         return;
     }
 
-    // Store into the initial scan, and reset the previous scan and current scan
-    g_app_state.initial_scan = init_buf;
-    g_app_state.initial_scan_count = init_count;
-    g_app_state.previous_scan = NULL;
-    g_app_state.previous_scan_count = 0;
-    g_app_state.current_scan = NULL;
-    g_app_state.current_scan_count = 0;
+    // Store it as the first generation of a fresh history
+    int rc = history_init(&g_app_state.history, HISTORY_DEFAULT_LIMIT);
+    if (rc == 0) {
+        rc = history_push(&g_app_state.history, init_buf, init_count);
+    }
+    if (rc != 0) {
+        log_printf(LOG_RED, "Failed to store the initial scan: %s\n",
+                   strerror(rc));
+        free_mem_regions(init_buf, init_count);
+        cleanup_app_state();
+        return;
+    }
     log_printf(LOG_GREEN,
                "Initial scan complete. Found %zu readable/writable regions.\n",
                init_count);
+    print_scan_stats(&stats);
     log_printf(
         LOG_YELLOW,
         "You can now run 'search' or perform a 'fullscan' for comparison.\n");
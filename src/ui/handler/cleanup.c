@@ -1,7 +1,10 @@
 // src/ui/handler/cleanup.c
+#include "../../utils/arena.h"
+#include "../../utils/threadpool.h"
 #include "../app_state.h"
 #include "handler.h"
 #include <memory.h>
+#include <stdlib.h>
 
 /**
  * Cleanup the application state and free allocated memory.
@@ -9,21 +12,15 @@
  * a new process is attached.
  */
 void cleanup_app_state(void) {
-    if (g_app_state.current_scan) {
-        free_mem_regions(g_app_state.current_scan,
-                         g_app_state.current_scan_count);
-    }
-    if (g_app_state.previous_scan &&
-        g_app_state.previous_scan != g_app_state.initial_scan) {
-        // WARNING: If the previous scan is not the same as the initial scan,
-        // free it separately.
-        free_mem_regions(g_app_state.previous_scan,
-                         g_app_state.previous_scan_count);
-    }
-
-    if (g_app_state.initial_scan) {
-        free_mem_regions(g_app_state.initial_scan,
-                         g_app_state.initial_scan_count);
-    }
+    // Frees every generation, full or compressed
+    history_free(&g_app_state.history);
+    candset_free(&g_app_state.candidates);
+    free(g_app_state.cand_values);
+    drop_any_matches();
     memset(&g_app_state, 0, sizeof(g_app_state));
+
+    // The worker pool and the recycled snapshot buffers live as long as the
+    // attachment
+    pool_stop();
+    arena_trim();
 }
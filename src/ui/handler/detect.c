@@ -2,82 +2,277 @@
 #include "../../utils/scan.h"
 #include "../app_state.h"
 #include "../logger.h"
+#include "../pager.h"
 #include "handler.h"
-#include <signal.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Bytes of a modified range shown on its line
+#define CHANGE_SHOW_BYTES 8
+// Changes listed when neither 'page' nor 'head' is given
+#define DETECT_LIST_MAX 20
+// Words of a 'detect' command at most
+#define DETECT_MAX_TOKENS 8
+
+/**
+ * Print the pages that changed between two generations, at least one of
+ * which holds page hashes only.
+ *
+ * @param count_only Only count the pages.
+ * @param paginate If true, the output is piped into "less -R".
+ * @param limit Pages to show at most (0: the default of the listing).
+ */
+static void print_page_changes(bool count_only, bool paginate, size_t limit,
+                               mem_region_t *old_scan, size_t old_count,
+                               mem_region_t *new_scan, size_t new_count) {
+    uintptr_t *pages = NULL;
+    size_t count = 0;
+    if (detect_page_changes(old_scan, old_count, new_scan, new_count, &pages,
+                            &count) != 0) {
+        log_printf(LOG_RED, "Failed to compare the generations.\n");
+        return;
+    }
+    if (count_only) {
+        log_printf(LOG_DEFAULT, "  pages : %zu changed\n", count);
+        free(pages);
+        return;
+    }
+
+    bool truncated = !paginate && limit == 0;
+    pager_t pager;
+    pager_open(&pager, paginate, truncated ? DETECT_LIST_MAX : limit);
+    for (size_t i = 0; i < count && pager_wants(&pager); i++) {
+        fprintf(pager_entry(&pager), "  -> Page 0x%lx changed\n", pages[i]);
+    }
+    size_t shown = pager.shown;
+    pager_close(&pager);
+
+    if (!paginate && count > shown) {
+        log_printf(LOG_YELLOW, "%zu out of %zu changed pages shown.%s\n",
+                   shown, count,
+                   truncated ? " Use 'detect page' to scroll." : "");
+    } else if (!paginate) {
+        log_printf(LOG_GREEN, "All %zu changed pages shown.\n", count);
+    }
+    free(pages);
+}
+
+/**
+ * Print one change range: the first bytes of a modified range (or all of
+ * them, one per line), or the extent of new or vanished memory.
+ *
+ * @param out Where to print.
+ * @param change The range.
+ * @param every_byte If true, a modified range lists all of its bytes.
+ */
+static void print_change(FILE *out, const mem_change_t *change,
+                         bool every_byte) {
+    if (change->kind != CHANGE_MODIFIED) {
+        fprintf(out, "  -> %s memory at 0x%lx (%zu bytes)\n",
+                change->kind == CHANGE_NEW ? "New" : "Vanished", change->addr,
+                change->len);
+        return;
+    }
+
+    // The bytes of the range, derived from both scans
+    change_iter_t it;
+    uintptr_t addr;
+    uint8_t old_value, new_value;
+    change_iter_init(&it, change, 1);
+    if (change->len == 1 && change_iter_next(&it, &addr, &old_value,
+                                             &new_value)) {
+        fprintf(out, "  -> Change at 0x%lx: 0x%02x → 0x%02x\n", addr,
+                old_value, new_value);
+        return;
+    }
+
+    uint8_t old_bytes[CHANGE_SHOW_BYTES], new_bytes[CHANGE_SHOW_BYTES];
+    size_t n = 0;
+    while (n < CHANGE_SHOW_BYTES &&
+           change_iter_next(&it, &addr, &old_bytes[n], &new_bytes[n])) {
+        n++;
+    }
+    fprintf(out, "  -> Change at 0x%lx (%zu bytes):", change->addr,
+            change->len);
+    for (size_t i = 0; i < n; i++) {
+        fprintf(out, " %02x", old_bytes[i]);
+    }
+    fprintf(out, "%s →", change->len > n ? " ..." : "");
+    for (size_t i = 0; i < n; i++) {
+        fprintf(out, " %02x", new_bytes[i]);
+    }
+    fprintf(out, "%s\n", change->len > n ? " ..." : "");
+
+    if (every_byte && change->len > n) {
+        change_iter_init(&it, change, 1);
+        while (change_iter_next(&it, &addr, &old_value, &new_value)) {
+            fprintf(out, "       0x%lx: 0x%02x → 0x%02x\n", addr, old_value,
+                    new_value);
+        }
+    }
+}
+
+/**
+ * Count the change ranges of two generations, diffing them with every
+ * worker thread.
+ */
+static void print_change_counts(mem_region_t *old_scan, size_t old_count,
+                                mem_region_t *new_scan, size_t new_count,
+                                unsigned kinds) {
+    mem_change_t *changes = NULL;
+    size_t count = 0;
+    if (detect_memory_changes(old_scan, old_count, new_scan, new_count,
+                              &changes, &count) != 0) {
+        log_printf(LOG_RED, "Failed to compare the generations.\n");
+        return;
+    }
+
+    size_t ranges[3] = {0}, bytes[3] = {0};
+    for (size_t i = 0; i < count; i++) {
+        ranges[changes[i].kind]++;
+        bytes[changes[i].kind] += changes[i].len;
+    }
+    static const char *names[] = {"modified", "new", "vanished"};
+    for (int kind = CHANGE_MODIFIED; kind <= CHANGE_GONE; kind++) {
+        if (kinds & CHANGE_MASK(kind)) {
+            log_printf(LOG_DEFAULT, "  %-8s : %zu ranges, %zu bytes\n",
+                       names[kind], ranges[kind], bytes[kind]);
+        }
+    }
+    free_mem_changes(changes);
+}
 
 /**
  * Handle the 'detect' command.
  * This command compares two memory scans and detects changes between them.
  * It requires two scans to be performed first (attach and fullscan).
+ * By default the two newest generations of the history are compared.
  *
- * @param page If true, the output will be paginated.
+ * The changes are diffed as they are listed, so the first ones show up at
+ * once, and 'head <n>' or quitting the pager stops the diff right there.
+ *
+ * @param args "[page|head <n>|count] [new|gone|modified] [<old> <new>]",
+ * or NULL.
  */
-void handle_detect(bool paginate) {
-    if (!g_app_state.previous_scan || !g_app_state.current_scan) {
+void handle_detect(char *args) {
+    char *tokens[DETECT_MAX_TOKENS];
+    size_t count = 0;
+    for (char *save = NULL, *tok = args ? strtok_r(args, " ", &save) : NULL;
+         tok; tok = strtok_r(NULL, " ", &save)) {
+        if (count == DETECT_MAX_TOKENS) {
+            log_printf(LOG_RED, "Too many arguments.\n");
+            return;
+        }
+        tokens[count++] = tok;
+    }
+    bool paginate;
+    size_t limit = 0;
+    if (!parse_listing(tokens, &count, &paginate, &limit)) {
+        return;
+    }
+
+    // What is left: 'count', kinds of changes and two generations
+    bool count_only = false;
+    unsigned kinds = 0;
+    char *gens[2];
+    size_t ngens = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (strcmp(tokens[i], "count") == 0) {
+            count_only = true;
+        } else if (strcmp(tokens[i], "modified") == 0) {
+            kinds |= CHANGE_MASK(CHANGE_MODIFIED);
+        } else if (strcmp(tokens[i], "new") == 0) {
+            kinds |= CHANGE_MASK(CHANGE_NEW);
+        } else if (strcmp(tokens[i], "gone") == 0) {
+            kinds |= CHANGE_MASK(CHANGE_GONE);
+        } else if (ngens < 2) {
+            gens[ngens++] = tokens[i];
+        } else {
+            ngens = 3;
+        }
+    }
+    if (ngens == 1 || ngens > 2) {
+        log_printf(LOG_RED, "Usage: detect [page|head <n>|count] "
+                            "[modified|new|gone] [<old> <new>]\n");
+        return;
+    }
+    if (kinds == 0) {
+        kinds = CHANGE_ALL;
+    }
+
+    history_t *h = &g_app_state.history;
+    uint64_t old_id = 0, new_id = 0;
+    if (ngens == 2) {
+        if (!parse_generation(gens[0], &old_id) ||
+            !parse_generation(gens[1], &new_id)) {
+            return;
+        }
+    } else if (!history_previous(h, &old_id) || !history_newest(h, &new_id)) {
         log_printf(
             LOG_RED,
             "Error: Two scans are required. Use 'attach' then 'fullscan'.\n");
         return;
     }
 
-    // 1) Detect alll changes into a flat buffer
-    mem_change_t *changes = NULL;
-    size_t count = 0;
-    detect_memory_changes(g_app_state.previous_scan,
-                          g_app_state.previous_scan_count,
-                          g_app_state.current_scan,
-                          g_app_state.current_scan_count, &changes, &count);
+    mem_region_t *old_scan = NULL, *new_scan = NULL;
+    size_t old_count = 0, new_count = 0;
+    if (history_get(h, old_id, &old_scan, &old_count) != 0 ||
+        history_get(h, new_id, &new_scan, &new_count) != 0) {
+        log_printf(LOG_RED, "Failed to load generations %lu and %lu.\n",
+                   old_id, new_id);
+        return;
+    }
 
-    if (!paginate) {
-        // Truncate to first 20
-        size_t shown = count < 20 ? count : 20;
-        for (size_t i = 0; i < shown; i++) {
-            printf("  -> Change at 0x%lx: 0x%02x → 0x%02x\n", changes[i].addr,
-                   changes[i].old_value, changes[i].new_value);
+    // Hash-only generations can only tell which pages changed
+    if (history_hash_only(h, old_id) || history_hash_only(h, new_id)) {
+        if (kinds != CHANGE_ALL) {
+            log_printf(LOG_RED, "Generations holding page hashes only can't "
+                                "tell modified, new and gone memory apart.\n");
+            return;
         }
+        print_page_changes(count_only, paginate, limit, old_scan, old_count,
+                           new_scan, new_count);
+        return;
+    }
+    if (count_only) {
+        print_change_counts(old_scan, old_count, new_scan, new_count, kinds);
+        return;
+    }
 
-        if (count > shown) {
-            log_printf(
-                LOG_YELLOW,
-                "%zu out of %zu results shown. Use 'detect page' to scroll.\n",
-                shown, count);
-        } else {
-            log_printf(LOG_GREEN, "All %zu changes shown.\n", count);
-        }
-    } else {
-        // Ignore SIGPIPE so writes to a closed pipe don't kill the original
-        // program (llce)
-        struct sigaction sa_ignore, sa_old;
-        sa_ignore.sa_handler = SIG_IGN;
-        sigemptyset(&sa_ignore.sa_mask);
-        sa_ignore.sa_flags = 0;
-        sigaction(SIGPIPE, &sa_ignore, &sa_old);
-
-        // Pipe *all* lines (including color codes) into "less
-        // -R" commands
-        FILE *pager = popen("less -R", "w");
-        if (!pager) {
-            perror("Failed to launch pager (less -R)");
-            // Fallback: dump everything to stdout
-            for (size_t i = 0; i < count; i++) {
-                fprintf(stdout, "  -> Change at 0x%lx: 0x%02x → 0x%02x\n",
-                        changes[i].addr, changes[i].old_value,
-                        changes[i].new_value);
-            }
+    // 1) Pull the changes from a cursor until the listing has enough
+    change_cursor_t *cursor =
+        change_cursor_create(old_scan, old_count, new_scan, new_count, kinds);
+    if (!cursor) {
+        log_printf(LOG_RED, "Failed to compare the generations.\n");
+        return;
+    }
+    bool truncated = !paginate && limit == 0;
+    pager_t pager;
+    pager_open(&pager, paginate, truncated ? DETECT_LIST_MAX : limit);
+    mem_change_t change;
+    bool more = true;
+    while (pager_wants(&pager) &&
+           (more = change_cursor_next(cursor, &change))) {
+        print_change(pager_entry(&pager), &change, pager.piped);
+    }
+    size_t shown = pager.shown;
+    pager_close(&pager);
+
+    // 2) Tell whether there is more, which takes one change past the last
+    if (!paginate) {
+        more = more && change_cursor_next(cursor, &change);
+        if (more && truncated) {
+            log_printf(LOG_YELLOW,
+                       "First %zu changed ranges shown. Use 'detect page' "
+                       "to scroll, or 'detect count'.\n",
+                       shown);
+        } else if (more) {
+            log_printf(LOG_YELLOW, "First %zu changed ranges shown.\n",
+                       shown);
         } else {
-            // Write all changes to the pager
-            for (size_t i = 0; i < count; i++) {
-                fprintf(pager, "  -> Change at 0x%lx: 0x%02x → 0x%02x\n",
-                        changes[i].addr, changes[i].old_value,
-                        changes[i].new_value);
-            }
-            pclose(pager);
+            log_printf(LOG_GREEN, "All %zu changed ranges shown.\n", shown);
         }
-
-        // Restore previous SIGPIPE handler
-        sigaction(SIGPIPE, &sa_old, NULL);
     }
-
-    free_mem_changes(changes);
+    change_cursor_destroy(cursor);
 }
@@ -0,0 +1,196 @@
+// src/ui/handler/filter.c
+#include "../../utils/peek.h"
+#include "../../utils/scan.h"
+#include "../../utils/threadpool.h"
+#include "../app_state.h"
+#include "../logger.h"
+#include "handler.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Parse the relation of the 'filter' command.
+ *
+ * @param op_str changed, unchanged, increased, decreased, delta or range.
+ * @param operand N for delta, LO:HI for range.
+ * @param floating Parse the bounds as floating-point numbers.
+ * @param rel Pointer to store the relation.
+ * @return true on success, false (with a message) otherwise.
+ */
+static bool parse_relation(const char *op_str, const char *operand,
+                           bool floating, relation_t *rel) {
+    static const struct {
+        const char *name;
+        rel_op_t op;
+    } ops[] = {
+        {"changed", REL_CHANGED},     {"unchanged", REL_UNCHANGED},
+        {"increased", REL_INCREASED}, {"decreased", REL_DECREASED},
+        {"delta", REL_DELTA},         {"range", REL_DELTA},
+    };
+    size_t i = 0;
+    while (i < sizeof(ops) / sizeof(ops[0]) && strcmp(op_str, ops[i].name)) {
+        i++;
+    }
+    if (i == sizeof(ops) / sizeof(ops[0])) {
+        log_printf(LOG_RED, "Unknown relation: %s\n", op_str);
+        return false;
+    }
+    *rel = (relation_t){.op = ops[i].op};
+    if (rel->op != REL_DELTA) {
+        return true;
+    }
+
+    bool ok = operand != NULL;
+    char *end = NULL;
+    if (ok) {
+        rel->lo = floating ? 0 : strtoll(operand, &end, 0);
+        rel->flo = floating ? strtod(operand, &end) : 0;
+        rel->hi = rel->lo;
+        rel->fhi = rel->flo;
+        ok = end != operand;
+    }
+    if (ok && strcmp(op_str, "range") == 0) {
+        // LO:HI
+        ok = *end == ':';
+        const char *hi_str = end + 1;
+        if (ok) {
+            rel->hi = floating ? 0 : strtoll(hi_str, &end, 0);
+            rel->fhi = floating ? strtod(hi_str, &end) : 0;
+            ok = end != hi_str && rel->lo <= rel->hi && rel->flo <= rel->fhi;
+        }
+    }
+    if (!ok || *end != '\0') {
+        log_printf(LOG_RED, "Usage: filter <type> delta <n> | filter <type> "
+                            "range <lo>:<hi> (lo <= hi)\n");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Handle the 'filter' command.
+ * This command keeps the elements whose value relates to their value in an
+ * older generation as given: changed, unchanged, increased, decreased,
+ * changed by exactly N (delta) or by LO to HI (range). With 'cand' in place
+ * of a type, only the candidates of the last search are checked.
+ *
+ * @param type_str The type of the elements, or "cand".
+ * @param op_str The relation.
+ * @param operand N for delta, LO:HI for range, NULL otherwise.
+ * @param old_str Generation to compare from, or NULL for the previous one.
+ * @param new_str Generation to compare to, or NULL for the newest one.
+ */
+void handle_filter(char *type_str, char *op_str, char *operand, char *old_str,
+                   char *new_str) {
+    if (!type_str || !op_str) {
+        log_printf(LOG_RED,
+                   "Usage: filter <type|cand> <relation> [n|lo:hi] "
+                   "[<old> <new>]\n");
+        log_printf(LOG_YELLOW, "Relations: changed, unchanged, increased, "
+                               "decreased, delta <n>, range <lo>:<hi>\n");
+        return;
+    }
+
+    const candset_t *within = NULL;
+    scan_type_t type;
+    if (strcmp(type_str, "cand") == 0) {
+        if (!g_app_state.has_candidates) {
+            log_printf(LOG_RED, "No candidates. Please run 'search' first.\n");
+            return;
+        }
+        // Unknown-value candidates are every slot: a full pass does it
+        within = g_app_state.cand_implicit ? NULL : &g_app_state.candidates;
+        type = g_app_state.cand_type;
+    } else if (!parse_scan_type(type_str, &type)) {
+        return;
+    }
+    relation_t rel;
+    bool floating = type == SCAN_TYPE_FLOAT || type == SCAN_TYPE_DOUBLE;
+    if (!parse_relation(op_str, operand, floating, &rel)) {
+        return;
+    }
+    bool is_signed = g_app_state.cand_signed && strcmp(type_str, "cand") == 0;
+    rel.is_signed = is_signed;
+
+    history_t *h = &g_app_state.history;
+    uint64_t old_id = 0, new_id = 0;
+    if (old_str && new_str) {
+        if (!parse_generation(old_str, &old_id) ||
+            !parse_generation(new_str, &new_id)) {
+            return;
+        }
+    } else if (within == NULL && strcmp(type_str, "cand") == 0) {
+        // Compare with the generation the unknown value was taken from
+        old_id = g_app_state.cand_gen;
+        if (!history_newest(h, &new_id) || new_id == old_id) {
+            log_printf(LOG_RED, "Take a 'fullscan' first.\n");
+            return;
+        }
+    } else if (!history_previous(h, &old_id) || !history_newest(h, &new_id)) {
+        log_printf(LOG_RED, "Error: Two scans are required. Use 'fullscan' "
+                            "twice first.\n");
+        return;
+    }
+    if (history_hash_only(h, old_id) || history_hash_only(h, new_id)) {
+        log_printf(LOG_RED, "Hash-only generations can't be filtered.\n");
+        return;
+    }
+    mem_region_t *old_scan = NULL, *new_scan = NULL;
+    size_t old_count = 0, new_count = 0;
+    if (history_get(h, old_id, &old_scan, &old_count) != 0 ||
+        history_get(h, new_id, &new_scan, &new_count) != 0) {
+        log_printf(LOG_RED, "Failed to load generations %lu and %lu.\n",
+                   old_id, new_id);
+        return;
+    }
+
+    candset_t found;
+    size_t count = 0;
+    uint64_t t0 = peek_now_ns();
+    if (search_relation_set(old_scan, old_count, new_scan, new_count, type,
+                            &rel, within, NULL, &found, &count) != 0) {
+        log_printf(LOG_RED, "Filter failed.\n");
+        return;
+    }
+    double ms = (double)(peek_now_ns() - t0) / 1e6;
+
+    // The values in the new generation are what the next 'next' compares to
+    uint8_t *values = NULL;
+    if (candidate_values(&found, new_scan, new_count, &values) != 0) {
+        log_printf(LOG_RED, "Filter failed.\n");
+        candset_free(&found);
+        return;
+    }
+
+    bool implicit = g_app_state.cand_implicit && strcmp(type_str, "cand") == 0;
+    size_t before = within ? candset_count(within) : 0;
+    drop_any_matches();
+    candset_free(&g_app_state.candidates);
+    free(g_app_state.cand_values);
+    g_app_state.candidates = found;
+    g_app_state.cand_signed = is_signed;
+    g_app_state.cand_type = type;
+    g_app_state.cand_gen = new_id;
+    g_app_state.cand_values = values;
+    g_app_state.has_candidates = true;
+    g_app_state.cand_implicit = false;
+
+    if (within) {
+        log_printf(LOG_GREEN,
+                   "%zu of %zu candidates left between generations %lu and "
+                   "%lu in %.1f ms.\n",
+                   count, before, old_id, new_id, ms);
+    } else if (implicit) {
+        log_printf(LOG_GREEN,
+                   "%zu slots left of the unknown value between generations "
+                   "%lu and %lu in %.1f ms.\n",
+                   count, old_id, new_id, ms);
+    } else {
+        log_printf(LOG_GREEN,
+                   "Found %zu matches between generations %lu and %lu in "
+                   "%.1f ms (%zu threads).\n",
+                   count, old_id, new_id, ms, pool_workers());
+    }
+    log_printf(LOG_DEFAULT, "Kept %zu candidates in %.1f KiB.\n", count,
+               (double)candset_bytes(&g_app_state.candidates) / 1024.0);
+}
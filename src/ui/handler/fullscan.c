@@ -4,52 +4,103 @@
 #include "../logger.h"
 #include "handler.h"
 #include <stdio.h>
+#include <string.h>
 
 /**
  * Handle the 'fullscan' command.
  * This command performs a second memory scan on the attached process.
  * It requires the user to have already attached to a process using 'attach'.
  * The second scan is used to compare against the initial scan.
+ *
+ * @param mode NULL for a full read, "inc" for an incremental scan that
+ *             only re-reads pages written since the last incremental scan,
+ *             or "hash" for a generation that keeps page hashes only.
  */
-void handle_fullscan(void) {
+void handle_fullscan(char *mode) {
     if (!g_app_state.attached) {
         log_printf(LOG_RED,
                    "You must attach to a process first using 'attach'.\n");
         return;
     }
 
+    bool incremental = false, hash_only = false;
+    if (mode && strcmp(mode, "inc") == 0) {
+        incremental = true;
+    } else if (mode && strcmp(mode, "hash") == 0) {
+        hash_only = true;
+    } else if (mode) {
+        log_printf(LOG_RED, "Usage: fullscan [inc|hash]\n");
+        return;
+    }
+
+    // The newest generation is the base of an incremental scan
+    uint64_t newest_id = 0;
+    mem_region_t *newest = NULL;
+    size_t newest_count = 0;
+    if (history_newest(&g_app_state.history, &newest_id)) {
+        history_get(&g_app_state.history, newest_id, &newest, &newest_count);
+    }
+
     // Run new scan
     mem_region_t *new_buf = NULL;
     size_t new_count = 0;
+    peek_stats_t stats = {0};
     log_printf(LOG_DEFAULT, "Performing next scan on %s... (PID: %d)\n",
                g_app_state.proc_name, g_app_state.pid);
-    if (full_scan(g_app_state.pid, &new_buf, &new_count) != 0) {
+    if (incremental) {
+        // Without a clear right after the newest scan we cannot know which
+        // pages changed since, so the first 'fullscan inc' reads everything.
+        int rc = full_scan_incremental(
+            g_app_state.pid, g_app_state.soft_dirty_armed ? newest : NULL,
+            newest_count, &new_buf, &new_count, &stats);
+        if (rc != 0) {
+            log_printf(LOG_YELLOW,
+                       "Incremental scan unavailable (%s), doing a full "
+                       "read instead.\n",
+                       strerror(rc));
+            incremental = false;
+        }
+    }
+    if (hash_only) {
+        if (full_scan_hashes(g_app_state.pid, &new_buf, &new_count,
+                             &stats) != 0) {
+            log_printf(LOG_RED, "Failed to perform the fullscan.\n");
+            return;
+        }
+    } else if (!incremental &&
+               full_scan(g_app_state.pid, &new_buf, &new_count, &stats) !=
+                   0) {
         log_printf(LOG_RED, "Failed to perform the fullscan.\n");
         return;
     }
+    g_app_state.soft_dirty_armed = incremental;
 
-    // Shift history
-    if (g_app_state.current_scan) {
-        // free old previous scan result, unless it's the initial scan
-        if (g_app_state.previous_scan &&
-            g_app_state.previous_scan != g_app_state.initial_scan) {
-            free_mem_regions(g_app_state.previous_scan,
-                             g_app_state.previous_scan_count);
-        }
-        g_app_state.previous_scan = g_app_state.current_scan;
-        g_app_state.previous_scan_count = g_app_state.current_scan_count;
-    } else {
-        // This is the firrst full scan, so, previous = initial
-        g_app_state.previous_scan = g_app_state.initial_scan;
-        g_app_state.previous_scan_count = g_app_state.initial_scan_count;
+    // Install new as the newest generation, older ones get compressed
+    int rc = history_push(&g_app_state.history, new_buf, new_count);
+    if (rc != 0) {
+        log_printf(LOG_RED, "Failed to store the scan: %s\n", strerror(rc));
+        free_mem_regions(new_buf, new_count);
+        return;
     }
-
-    // Install new as current
-    g_app_state.current_scan = new_buf;
-    g_app_state.current_scan_count = new_count;
+    uint64_t id = 0;
+    history_newest(&g_app_state.history, &id);
     log_printf(LOG_GREEN,
-               "Full scan completed successfully. %zu regions found.\n",
-               g_app_state.current_scan_count);
+               "Full scan completed successfully. %zu regions found "
+               "(generation %lu).\n",
+               new_count, id);
+    print_scan_stats(&stats);
+    if (incremental) {
+        size_t dirty_pages = 0, total_pages = 0;
+        for (size_t i = 0; i < new_count; i++) {
+            size_t pages = (new_buf[i].len + page_size() - 1) / page_size();
+            for (size_t p = 0; p < pages; p++) {
+                dirty_pages += region_page_dirty(&new_buf[i], p);
+            }
+            total_pages += pages;
+        }
+        log_printf(LOG_GREEN, "Re-read %zu of %zu pages from the target.\n",
+                   dirty_pages, total_pages);
+    }
 
     log_printf(LOG_YELLOW, "You can now run 'detect' to see changes.\n");
 }
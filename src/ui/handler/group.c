@@ -0,0 +1,177 @@
+// src/ui/handler/group.c
+#include "../../utils/narrow.h"
+#include "../../utils/peek.h"
+#include "../../utils/scan.h"
+#include "../../utils/threadpool.h"
+#include "../app_state.h"
+#include "../logger.h"
+#include "handler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Groups listed at most
+#define GROUP_LIST_MAX 10
+
+/**
+ * Parse one field of a group: "<offset> <type>[/<align>] <predicate>",
+ * where a bare number as the predicate means x == number. Only the first
+ * field may give an alignment, that of the start of the groups.
+ *
+ * @param text The field.
+ * @param field Pointer to store the field (free its predicate).
+ * @param type Pointer to store the type of the field.
+ * @param align Pointer to store the alignment, or NULL if none is allowed.
+ * @return true on success, false (with a message) otherwise.
+ */
+static bool parse_field(char *text, group_field_t *field, scan_type_t *type,
+                        size_t *align) {
+    char *save = NULL;
+    char *off_str = strtok_r(text, " ", &save);
+    char *type_str = strtok_r(NULL, " ", &save);
+    char *expr = type_str ? save + strspn(save, " ") : NULL;
+    if (!off_str || !type_str || !expr || *expr == '\0') {
+        log_printf(LOG_RED, "Invalid field: a field is <offset> <type> "
+                            "<value|predicate>\n");
+        return false;
+    }
+
+    char *end;
+    unsigned long long offset = strtoull(off_str + (*off_str == '+'), &end, 0);
+    if (*end != '\0' || *off_str == '-') {
+        log_printf(LOG_RED, "Invalid field offset: %s\n", off_str);
+        return false;
+    }
+    if (!align && strchr(type_str, '/')) {
+        log_printf(LOG_RED, "Only the first field may give an alignment.\n");
+        return false;
+    }
+    bool is_signed;
+    if ((align && !parse_align(type_str, align)) ||
+        !parse_int_type(type_str, type, &is_signed)) {
+        return false;
+    }
+
+    // A bare number is compared for equality
+    char eq[64];
+    strtoll(expr, &end, 0);
+    if (end != expr && *end == '\0' && strlen(expr) < sizeof(eq) - 6) {
+        snprintf(eq, sizeof(eq), "x == %s", expr);
+        expr = eq;
+    }
+    field->offset = offset;
+    return pred_compile(expr, scan_type_size(*type), is_signed,
+                        &field->pred) == 0;
+}
+
+/**
+ * Handle the 'group' command.
+ * This command searches the newest generation for groups of values at
+ * fixed offsets from each other, like the fields of a struct, in a single
+ * pass: "0 u32 100; 4 u32 100; 16 u32 7". The most selective field is
+ * searched and the others are checked at its hits. The addresses of the
+ * first field are kept as the candidates. Groups start at multiples of the
+ * size of the first field, or of the alignment its type gives ("0 u32/1").
+ *
+ * @param fields_str The fields separated by ';', or NULL.
+ */
+void handle_group(char *fields_str) {
+    uint64_t gen = 0;
+    if (!history_newest(&g_app_state.history, &gen)) {
+        log_printf(LOG_RED,
+                   "No scan data available. Please perform a scan first.\n");
+        return;
+    }
+    if (!fields_str) {
+        log_printf(LOG_RED, "Usage: group <offset> <type>[/<align>] "
+                            "<value|predicate> [; <offset> <type> "
+                            "<value|predicate> ...]\n");
+        log_printf(LOG_YELLOW, "e.g. group 0 u32 100; 4 u32 100; 16 u32 x "
+                               "in 1..99\n");
+        return;
+    }
+    if (history_hash_only(&g_app_state.history, gen)) {
+        log_printf(LOG_RED,
+                   "Generation %lu only holds page hashes, it can't be "
+                   "searched.\n",
+                   gen);
+        return;
+    }
+
+    group_field_t fields[GROUP_MAX_FIELDS];
+    scan_type_t types[GROUP_MAX_FIELDS];
+    size_t nfields = 0;
+    search_opts_t opts = {0};
+    bool ok = true;
+    for (char *save = NULL, *text = strtok_r(fields_str, ";", &save);
+         text && ok; text = strtok_r(NULL, ";", &save)) {
+        if (nfields == GROUP_MAX_FIELDS) {
+            log_printf(LOG_RED, "At most %d fields at once.\n",
+                       GROUP_MAX_FIELDS);
+            ok = false;
+        } else if (parse_field(text, &fields[nfields], &types[nfields],
+                               nfields == 0 ? &opts.align : NULL)) {
+            nfields++;
+        } else {
+            ok = false;
+        }
+    }
+
+    mem_region_t *regions;
+    size_t regions_count;
+    candset_t found;
+    size_t count = 0;
+    uint64_t t0 = peek_now_ns();
+    if (ok && history_get(&g_app_state.history, gen, &regions,
+                          &regions_count) != 0) {
+        log_printf(LOG_RED, "Failed to load generation %lu.\n", gen);
+        ok = false;
+    }
+    if (ok && search_group_set(regions, regions_count, fields, nfields, &opts,
+                               &found, &count) != 0) {
+        log_printf(LOG_RED, "Group search failed.\n");
+        ok = false;
+    }
+    double ms = (double)(peek_now_ns() - t0) / 1e6;
+
+    uint8_t *values = NULL;
+    if (ok && candidate_values(&found, regions, regions_count, &values) != 0) {
+        log_printf(LOG_RED, "Group search failed.\n");
+        candset_free(&found);
+        ok = false;
+    }
+
+    if (ok) {
+        log_printf(LOG_GREEN,
+                   "Found %zu groups of %zu fields in %.1f ms (%zu "
+                   "threads).\n",
+                   count, nfields, ms, pool_workers());
+
+        // The first groups, with the value of their first field
+        cand_iter_t it;
+        cand_iter_init(&it, &found);
+        uintptr_t addr;
+        for (size_t k = 0; k < GROUP_LIST_MAX && cand_iter_next(&it, &addr);
+             k++) {
+            size_t size = fields[0].pred.type_size;
+            uint64_t value = narrow_load(values + k * size, size);
+            if (fields[0].pred.is_signed) {
+                log_printf(LOG_DEFAULT, "  -> 0x%lx (+%zu = %ld)\n",
+                           addr - fields[0].offset, fields[0].offset,
+                           narrow_signed(value, size));
+            } else {
+                log_printf(LOG_DEFAULT, "  -> 0x%lx (+%zu = %lu)\n",
+                           addr - fields[0].offset, fields[0].offset, value);
+            }
+        }
+        if (count > GROUP_LIST_MAX) {
+            log_printf(LOG_YELLOW, "  ... and %zu more\n",
+                       count - GROUP_LIST_MAX);
+        }
+        keep_candidates(&found, types[0], fields[0].pred.is_signed, gen,
+                        values, 0);
+    }
+    for (size_t i = 0; i < nfields; i++) {
+        pred_free(&fields[i].pred);
+    }
+}
@@ -1,17 +1,59 @@
 // src/ui/handler/handler.h
 #pragma once
+#include "../../utils/peek.h"
+#include "../../utils/scan.h"
+#include "../pager.h"
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 
 // core UI handlers
 void handle_help(void);
 void handle_attach(char *arg);
-void handle_fullscan(void);
-void handle_detect(bool paginate);
-void handle_search(char *type_str, char *value_str);
+void handle_fullscan(char *mode);
+void handle_detect(char *args);
+void handle_search(bool count_only, char *limit_str, char *type_str,
+                   char *value_str, char *gen_str);
+void handle_search_unknown(char *type_str, char *gen_str);
+void handle_search_where(char *type_str, char *expr);
+void handle_search_keep(char *type_str);
+void handle_aob(char *sigs_str);
+void handle_text(char *args);
+void handle_group(char *fields_str);
+void handle_history(char *limit_str);
+void handle_save(char *path_str, char *gen_str);
+void handle_load(char *path_str, char *mode);
+void handle_next(char *op_str, char *value_str);
+void handle_list(char *opt1, char *opt2);
+void handle_filter(char *type_str, char *op_str, char *operand, char *old_str,
+                   char *new_str);
 void handle_poke(char *addr_str, char *type_str, char *value_str);
 
 // utility function to print the command prompt
 void print_prompt(void);
+// utility function to print the read counters of a scan
+void print_scan_stats(const peek_stats_t *stats);
+// utility function to parse a generation id of the scan history
+bool parse_generation(const char *str, uint64_t *id);
+// utility function to parse the name of a scan type
+bool parse_scan_type(const char *str, scan_type_t *type);
+// utility function to parse the name of an integer type of a predicate
+bool parse_int_type(const char *str, scan_type_t *type, bool *is_signed);
+// utility function to split a /<align> suffix off a type name
+bool parse_align(char *type_str, size_t *align);
+// utility function to parse an integer that must fit in size bytes
+bool parse_operand(const char *str, size_t size, uint64_t *value);
+// utility function to keep the matches of a search as the candidates
+void keep_candidates(candset_t *found, scan_type_t type, bool is_signed,
+                     uint64_t gen, uint8_t *values, uint64_t value);
+// utility function to drop the matches of an 'any' search
+void drop_any_matches(void);
+// utility function to list the matches of an 'any' search with their types
+size_t print_any_matches(pager_t *pager, const candset_t *sets,
+                         const scan_value_t *values, size_t count);
+// utility function to print a candidate with its value
+void print_candidate(FILE *out, scan_type_t type, bool is_signed,
+                     uintptr_t addr, const uint8_t *p);
 
 // cleanup function to free resources and reset state
 void cleanup_app_state(void);
@@ -11,18 +11,90 @@ void handle_help(void) {
     log_printf(LOG_YELLOW, "Available commands:\n");
     log_printf(LOG_GREEN, "  attach <pid>              ");
     log_printf(LOG_DEFAULT, ": Attach to a process and run initial scan.\n");
-    log_printf(LOG_GREEN, "  fullscan                  ");
+    log_printf(LOG_GREEN, "  fullscan [inc|hash]       ");
     log_printf(LOG_DEFAULT, ": Perform a second scan to compare against.\n");
-    log_printf(LOG_GREEN, "  detect                    ");
+    log_printf(LOG_DEFAULT, "                            ");
+    log_printf(LOG_YELLOW,
+               "  'inc' re-reads only pages written since the last one.\n");
+    log_printf(LOG_DEFAULT, "                            ");
+    log_printf(LOG_YELLOW,
+               "  'hash' keeps page hashes only (which pages changed).\n");
+    log_printf(LOG_GREEN, "  detect [page|head <n>|count] [<old> <new>]");
+    log_printf(LOG_DEFAULT,
+               ": Show changes between two generations (default: the two "
+               "newest).\n");
+    log_printf(LOG_DEFAULT, "                            ");
+    log_printf(LOG_YELLOW, "  Add modified, new or gone to show only those "
+                           "changes\n");
+    log_printf(LOG_GREEN, "  history [limit]           ");
+    log_printf(LOG_DEFAULT,
+               ": List the kept generations, or set how many to keep.\n");
+    log_printf(LOG_GREEN, "  save <file> [gen]         ");
     log_printf(LOG_DEFAULT,
-               ": Show changes between the first and second scan.\n");
+               ": Save the newest (or given) generation to a file.\n");
+    log_printf(LOG_GREEN, "  load <file> [verify]      ");
+    log_printf(LOG_DEFAULT,
+               ": Load a saved generation, no attach needed.\n");
     log_printf(LOG_GREEN, "  poke <addr> <type> <value> ");
     log_printf(LOG_DEFAULT, ": Write a value into target memory. Types: byte, "
-                            "word, dword, qword\n");
-    log_printf(LOG_GREEN, "  search <type> <value>     ");
-    log_printf(LOG_DEFAULT, ": Search for a value in the first scan.\n");
+                            "word, dword, qword, float, double\n");
+    log_printf(LOG_GREEN, "  search <type> <value> [gen]");
+    log_printf(LOG_DEFAULT,
+               ": Search for a value in the newest (or given) generation.\n");
+    log_printf(LOG_DEFAULT, "                            ");
+    log_printf(LOG_YELLOW,
+               "  Types: byte, word, dword, qword, float, double\n");
+    log_printf(LOG_DEFAULT, "                            ");
+    log_printf(LOG_YELLOW, "  any searches every type the value fits in at "
+                           "once\n");
+    log_printf(LOG_DEFAULT, "                            ");
+    log_printf(LOG_YELLOW, "  Float values: V, V~EPS, LO:HI, ~V (rounded), "
+                           "nan\n");
+    log_printf(LOG_DEFAULT, "                            ");
+    log_printf(LOG_YELLOW, "  <type>/<1|2|4|8> searches at that alignment, "
+                           "e.g. qword/1 for packed structs\n");
+    log_printf(LOG_GREEN, "  search count <type> <value> [gen]");
+    log_printf(LOG_DEFAULT, ": Only count the matches.\n");
+    log_printf(LOG_GREEN, "  search first <n> <type> <value> [gen]");
+    log_printf(LOG_DEFAULT, ": Stop after the first n matches.\n");
+    log_printf(LOG_GREEN, "  search keep <type>");
+    log_printf(LOG_DEFAULT, ": Keep the 'any' matches of one type as the "
+                            "candidates.\n");
+    log_printf(LOG_GREEN, "  search unknown <type> [gen]");
+    log_printf(LOG_DEFAULT,
+               ": Start from an unknown value (every slot is a candidate).\n");
+    log_printf(LOG_GREEN, "  search where <type> <predicate>");
+    log_printf(LOG_DEFAULT,
+               ": Search for the values that pass a predicate, e.g.\n");
+    log_printf(LOG_DEFAULT, "                            ");
+    log_printf(LOG_YELLOW, "  i32 x >= -50 && x <= 50 && (x & 0xff) != 0, "
+                           "x in 100..200, x >> 8 == 0x12\n");
+    log_printf(LOG_GREEN,
+               "  aob [page|head <n>] <signature> [| <signature> ...]");
+    log_printf(LOG_DEFAULT,
+               ": Search for byte signatures, e.g. 48 8B ?? ?? 89 05.\n");
+    log_printf(LOG_GREEN, "  group <off> <type> <pred> [; ...]");
+    log_printf(LOG_DEFAULT, ": Search for values at fixed offsets (a "
+                            "struct), e.g. 0 u32 100; 16 u32 7.\n");
+    log_printf(LOG_GREEN,
+               "  text [utf16] [nocase] [regex] [page|head <n>] <text>");
+    log_printf(LOG_DEFAULT, ": Search for a string, exactly, in any case "
+                            "or as a regex.\n");
+    log_printf(LOG_GREEN, "  list [page|head <n>]      ");
+    log_printf(LOG_DEFAULT,
+               ": List the candidates with their last known values.\n");
+    log_printf(LOG_GREEN, "  next [op] <value> | next <change>");
+    log_printf(LOG_DEFAULT,
+               ": Re-read only the candidates and keep the matching ones.\n");
+    log_printf(LOG_DEFAULT, "                            ");
+    log_printf(LOG_YELLOW, "  Ops: eq, ne, gt, lt. Changes: changed, "
+                           "unchanged, increased, decreased\n");
+    log_printf(LOG_GREEN, "  filter <type|cand> <relation> [<old> <new>]");
+    log_printf(LOG_DEFAULT,
+               ": Keep the values that changed in a given way.\n");
     log_printf(LOG_DEFAULT, "                            ");
-    log_printf(LOG_YELLOW, "  Types: byte, word, dword, qword\n");
+    log_printf(LOG_YELLOW, "  Relations: changed, unchanged, increased, "
+                           "decreased, delta <n>, range <lo>:<hi>\n");
     log_printf(LOG_GREEN, "  help                      ");
     log_printf(LOG_DEFAULT, ": Show this help message.\n");
     log_printf(LOG_GREEN, "  exit                      ");
@@ -0,0 +1,72 @@
+// src/ui/handler/history.c
+#include "../app_state.h"
+#include "../logger.h"
+#include "handler.h"
+#include <stdlib.h>
+
+/**
+ * Parse a generation id typed by the user and check that it exists.
+ *
+ * @param str The string to parse.
+ * @param id Pointer to store the generation id.
+ * @return true if `str` names a generation of the current history.
+ */
+bool parse_generation(const char *str, uint64_t *id) {
+    char *end;
+    unsigned long long v = strtoull(str, &end, 10);
+    if (*str == '\0' || *end != '\0') {
+        log_printf(LOG_RED, "Invalid generation: %s\n", str);
+        return false;
+    }
+
+    history_t *h = &g_app_state.history;
+    for (size_t i = 0; i < h->count; i++) {
+        if (h->gens[i]->id == v) {
+            *id = v;
+            return true;
+        }
+    }
+    log_printf(LOG_RED, "No generation %llu in the history. Use 'history'.\n",
+               v);
+    return false;
+}
+
+/**
+ * Handle the 'history' command.
+ * Lists the generations kept in the scan history and how much memory each
+ * of them uses, or changes the number of generations kept.
+ *
+ * @param limit_str New maximum number of generations, or NULL to list.
+ */
+void handle_history(char *limit_str) {
+    history_t *h = &g_app_state.history;
+    if (h->count == 0) {
+        log_printf(LOG_RED,
+                   "No scan data available. Please perform a scan first.\n");
+        return;
+    }
+
+    if (limit_str) {
+        char *end;
+        unsigned long limit = strtoul(limit_str, &end, 10);
+        if (*end != '\0' || limit < 2) {
+            log_printf(LOG_RED, "Usage: history [limit >= 2]\n");
+            return;
+        }
+        history_set_limit(h, limit);
+        log_printf(LOG_GREEN, "Keeping up to %zu generations.\n", h->limit);
+        return;
+    }
+
+    log_printf(LOG_YELLOW, "%zu of up to %zu generations kept:\n", h->count,
+               h->limit);
+    for (size_t i = 0; i < h->count; i++) {
+        bool compressed = false;
+        size_t bytes = history_gen_bytes(h, i, &compressed);
+        log_printf(LOG_DEFAULT, "  gen %-4lu %12.1f KiB  %s\n",
+                   h->gens[i]->id, (double)bytes / 1024.0,
+                   h->gens[i]->hash_only ? "hashes"
+                   : compressed           ? "delta"
+                                          : "full");
+    }
+}
@@ -0,0 +1,119 @@
+// src/ui/handler/list.c
+#include "../../utils/narrow.h"
+#include "../app_state.h"
+#include "../logger.h"
+#include "../pager.h"
+#include "handler.h"
+#include <stdio.h>
+#include <string.h>
+
+// Candidates listed when neither 'page' nor 'head' is given
+#define LIST_MAX 20
+
+/**
+ * Print a candidate with its value.
+ *
+ * @param out Where to print.
+ * @param type Type of the candidate.
+ * @param is_signed Whether it is a signed integer.
+ * @param addr Address of the candidate.
+ * @param p Its value (scan_type_size(type) bytes).
+ */
+void print_candidate(FILE *out, scan_type_t type, bool is_signed,
+                     uintptr_t addr, const uint8_t *p) {
+    if (type == SCAN_TYPE_FLOAT) {
+        float f;
+        memcpy(&f, p, sizeof(f));
+        fprintf(out, "  -> 0x%lx = %g\n", addr, f);
+    } else if (type == SCAN_TYPE_DOUBLE) {
+        double d;
+        memcpy(&d, p, sizeof(d));
+        fprintf(out, "  -> 0x%lx = %.17g\n", addr, d);
+    } else {
+        size_t size = scan_type_size(type);
+        uint64_t value = narrow_load(p, size);
+        if (is_signed) {
+            fprintf(out, "  -> 0x%lx = %ld (0x%lx)\n", addr,
+                    narrow_signed(value, size), value);
+        } else {
+            fprintf(out, "  -> 0x%lx = %lu (0x%lx)\n", addr, value, value);
+        }
+    }
+}
+
+/**
+ * Handle the 'list' command.
+ * This command lists the candidates of the last search with their last
+ * known values, or the matches of an 'any' search with their types while
+ * none of them is kept. The candidates are walked as they are listed, so
+ * 'head <n>' and quitting the pager stop the walk right there.
+ *
+ * @param opt1 "page" or "head", or NULL.
+ * @param opt2 n of "head <n>", or NULL.
+ */
+void handle_list(char *opt1, char *opt2) {
+    char *tokens[2];
+    size_t count = 0;
+    if (opt1) {
+        tokens[count++] = opt1;
+    }
+    if (opt2) {
+        tokens[count++] = opt2;
+    }
+    bool paginate;
+    size_t limit = 0;
+    if (!parse_listing(tokens, &count, &paginate, &limit)) {
+        return;
+    }
+    if (count > 0) {
+        log_printf(LOG_RED, "Usage: list [page|head <n>]\n");
+        return;
+    }
+    if (!g_app_state.has_candidates && !g_app_state.has_any) {
+        log_printf(LOG_RED, "No candidates. Please run 'search' first.\n");
+        return;
+    }
+    if (g_app_state.has_candidates && g_app_state.cand_implicit) {
+        log_printf(LOG_RED, "The candidates are every slot of generation "
+                            "%lu. Narrow them down with 'filter' first.\n",
+                   g_app_state.cand_gen);
+        return;
+    }
+
+    const candset_t *set = &g_app_state.candidates;
+    scan_type_t type = g_app_state.cand_type;
+    size_t total = candset_count(set);
+    bool truncated = !paginate && limit == 0;
+    pager_t pager;
+    pager_open(&pager, paginate, truncated ? LIST_MAX : limit);
+
+    if (g_app_state.has_any) {
+        total = print_any_matches(&pager, g_app_state.any_found,
+                                  g_app_state.any_values,
+                                  g_app_state.any_count);
+    }
+    cand_iter_t it;
+    cand_iter_init(&it, set);
+    uintptr_t addr;
+    for (size_t k = 0; !g_app_state.has_any && pager_wants(&pager) &&
+                       cand_iter_next(&it, &addr);
+         k++) {
+        uint64_t value = g_app_state.cand_value;
+        const uint8_t *p =
+            g_app_state.cand_values
+                ? g_app_state.cand_values + k * set->elem_size
+                : (const uint8_t *)&value;
+        print_candidate(pager_entry(&pager), type, g_app_state.cand_signed,
+                        addr, p);
+    }
+    size_t shown = pager.shown;
+    pager_close(&pager);
+
+    const char *what = g_app_state.has_any ? "matches" : "candidates";
+    if (!paginate && shown < total) {
+        log_printf(LOG_YELLOW, "%zu out of %zu %s shown.%s\n", shown, total,
+                   what, truncated ? " Use 'list page' to scroll." : "");
+    } else if (!paginate) {
+        log_printf(LOG_GREEN, "All %zu %s shown.\n", total, what);
+    }
+}
@@ -0,0 +1,65 @@
+// src/ui/handler/load.c
+#include "../../utils/snapfile.h"
+#include "../../utils/threadpool.h"
+#include "../app_state.h"
+#include "../logger.h"
+#include "handler.h"
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Handle the 'load' command.
+ * Maps a snapshot file written by 'save' and appends it to the scan history
+ * as the newest generation, so 'search' and 'detect' work on it whether or
+ * not a process is attached.
+ *
+ * @param path_str The file to load.
+ * @param mode NULL, or "verify" to check the page checksums while loading.
+ */
+void handle_load(char *path_str, char *mode) {
+    if (!path_str || (mode && strcmp(mode, "verify") != 0)) {
+        log_printf(LOG_RED, "Usage: load <file> [verify]\n");
+        return;
+    }
+
+    mem_region_t *regions = NULL;
+    size_t count = 0;
+    char proc_name[256];
+    int rc = snapshot_load(path_str, mode != NULL, &regions, &count,
+                           proc_name, sizeof(proc_name));
+    if (rc != 0) {
+        log_printf(LOG_RED, "Failed to load %s: %s\n", path_str,
+                   strerror(rc));
+        return;
+    }
+
+    // Without an attachment the loaded captures form a history of their own
+    if (!g_app_state.attached && g_app_state.history.limit == 0) {
+        rc = history_init(&g_app_state.history, HISTORY_DEFAULT_LIMIT);
+        if (rc == 0 && pool_start(0) != 0) {
+            log_printf(
+                LOG_YELLOW,
+                "Failed to start the worker pool, running single-threaded.\n");
+        }
+        snprintf(g_app_state.proc_name, sizeof(g_app_state.proc_name), "%s",
+                 proc_name);
+    }
+    if (rc == 0) {
+        rc = history_push(&g_app_state.history, regions, count);
+    }
+    if (rc != 0) {
+        log_printf(LOG_RED, "Failed to store the snapshot: %s\n",
+                   strerror(rc));
+        free_mem_regions(regions, count);
+        return;
+    }
+
+    // The newest generation no longer follows a soft-dirty clear
+    g_app_state.soft_dirty_armed = false;
+
+    uint64_t id = 0;
+    history_newest(&g_app_state.history, &id);
+    log_printf(LOG_GREEN,
+               "Loaded %zu regions of %s from %s (generation %lu).\n", count,
+               proc_name[0] ? proc_name : "?", path_str, id);
+}
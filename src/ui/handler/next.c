@@ -0,0 +1,155 @@
+// src/ui/handler/next.c
+#include "../../utils/narrow.h"
+#include "../../utils/peek.h"
+#include "../app_state.h"
+#include "../logger.h"
+#include "handler.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Candidates left at most this many are listed with their values
+#define NEXT_LIST_MAX 20
+
+/**
+ * Parse an integer operand for values of `size` bytes (the operand of a
+ * filter, or the value of a 'poke'), negative values as two's complement.
+ *
+ * @param str The operand.
+ * @param size Size of the values.
+ * @param value Pointer to store the operand, truncated to `size` bytes.
+ * @return true on success, false if it is no number or doesn't fit.
+ */
+bool parse_operand(const char *str, size_t size, uint64_t *value) {
+    unsigned bits = (unsigned)size * 8;
+    uint64_t mask = bits == 64 ? ~0ULL : (1ULL << bits) - 1;
+    char *end;
+    errno = 0;
+    bool fits;
+    if (str[strspn(str, " ")] == '-') {
+        long long s = strtoll(str, &end, 0);
+        fits = bits == 64 || s >= -(1LL << (bits - 1));
+        *value = (uint64_t)s & mask;
+    } else {
+        *value = strtoull(str, &end, 0);
+        fits = (*value & ~mask) == 0;
+    }
+    return end != str && *end == '\0' && errno != ERANGE && fits;
+}
+
+/**
+ * Handle the 'next' command.
+ * This command narrows the candidates of the last search down by re-reading
+ * only them from the attached process.
+ *
+ * @param op_str The filter (eq, ne, gt, lt, changed, unchanged, increased,
+ *               decreased), or the value to compare for equality.
+ * @param value_str The operand of eq, ne, gt and lt.
+ */
+void handle_next(char *op_str, char *value_str) {
+    if (!g_app_state.attached) {
+        log_printf(LOG_RED, "Error: attach to a process first.\n");
+        return;
+    }
+    if (g_app_state.has_any) {
+        log_printf(LOG_RED, "The last search matched as several types. Keep "
+                            "one with 'search keep <type>' first.\n");
+        return;
+    }
+    if (!g_app_state.has_candidates) {
+        log_printf(LOG_RED, "No candidates. Please run 'search' first.\n");
+        return;
+    }
+    if (g_app_state.cand_implicit) {
+        log_printf(LOG_RED, "The value is unknown, so every slot is still a "
+                            "candidate. Take a 'fullscan' and use 'filter "
+                            "cand <relation>' first.\n");
+        return;
+    }
+    if (!op_str) {
+        log_printf(LOG_RED, "Usage: next <value> | next <eq|ne|gt|lt> <value> "
+                            "| next <changed|unchanged|increased|decreased>\n");
+        return;
+    }
+
+    static const struct {
+        const char *name;
+        narrow_op_t op;
+        bool operand;
+    } ops[] = {
+        {"eq", NARROW_EQ, true},
+        {"ne", NARROW_NE, true},
+        {"gt", NARROW_GT, true},
+        {"lt", NARROW_LT, true},
+        {"changed", NARROW_CHANGED, false},
+        {"unchanged", NARROW_UNCHANGED, false},
+        {"increased", NARROW_INCREASED, false},
+        {"decreased", NARROW_DECREASED, false},
+    };
+    scan_type_t type = g_app_state.cand_type;
+    narrow_filter_t filter = {
+        .op = NARROW_EQ,
+        .is_signed = g_app_state.cand_signed,
+        .floating = type == SCAN_TYPE_FLOAT || type == SCAN_TYPE_DOUBLE};
+    char *operand = op_str; // a bare value means eq
+    for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+        if (strcmp(op_str, ops[i].name) == 0) {
+            filter.op = ops[i].op;
+            operand = ops[i].operand ? value_str : NULL;
+            if (!operand && ops[i].operand) {
+                log_printf(LOG_RED, "Usage: next %s <value>\n", ops[i].name);
+                return;
+            }
+            break;
+        }
+    }
+    if (operand) {
+        bool ok;
+        if (filter.floating) {
+            char *end;
+            filter.fvalue = strtod(operand, &end);
+            ok = end != operand && *end == '\0';
+        } else {
+            ok = parse_operand(operand, g_app_state.candidates.elem_size,
+                               &filter.value);
+        }
+        if (!ok) {
+            log_printf(LOG_RED, "Invalid value: %s\n", operand);
+            return;
+        }
+    }
+
+    candset_t *set = &g_app_state.candidates;
+    size_t before = candset_count(set);
+    candset_t narrowed;
+    uint8_t *values;
+    peek_stats_t stats = {0};
+    uint64_t t0 = peek_now_ns();
+    if (narrow_candidates(g_app_state.pid, set, g_app_state.cand_values,
+                          g_app_state.cand_value, &filter, &narrowed, &values,
+                          &stats) != 0) {
+        log_printf(LOG_RED, "Failed to narrow the candidates.\n");
+        return;
+    }
+    stats.nsec = peek_now_ns() - t0;
+
+    candset_free(set);
+    free(g_app_state.cand_values);
+    *set = narrowed;
+    g_app_state.cand_values = values;
+
+    size_t after = candset_count(set);
+    log_printf(LOG_GREEN, "%zu of %zu candidates left (%.1f KiB).\n", after,
+               before, (double)candset_bytes(set) / 1024.0);
+    print_scan_stats(&stats);
+
+    if (after > 0 && after <= NEXT_LIST_MAX) {
+        cand_iter_t it;
+        cand_iter_init(&it, set);
+        uintptr_t addr;
+        for (size_t k = 0; cand_iter_next(&it, &addr); k++) {
+            print_candidate(stdout, type, g_app_state.cand_signed, addr,
+                            values + k * set->elem_size);
+        }
+    }
+}
@@ -3,6 +3,9 @@
 #include "../app_state.h"
 #include "../logger.h"
 #include "handler.h"
+#include <errno.h>
+#include <float.h>
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -12,8 +15,10 @@
  * of the attached process.
  *
  * @param addr_str The address to write to, as a string.
- * @param type_str The type of value to write (byte, word, dword, qword).
- * @param value_str The value to write, as a string.
+ * @param type_str The type of value to write (byte, word, dword, qword,
+ *                 float, double).
+ * @param value_str The value to write, as a string. Integers must fit the
+ *                  type, negative ones are written as two's complement.
  */
 void handle_poke(char *addr_str, char *type_str, char *value_str) {
     if (!g_app_state.attached) {
@@ -26,8 +31,33 @@ void handle_poke(char *addr_str, char *type_str, char *value_str) {
     }
 
     // Convert address and value strings to appropriate types
-    uintptr_t addr = strtoull(addr_str, NULL, 0);
-    uint64_t val = strtoull(value_str, NULL, 0);
+    char *end;
+    uintptr_t addr = strtoull(addr_str, &end, 0);
+    if (end == addr_str || *end != '\0') {
+        log_printf(LOG_RED, "Invalid address: %s\n", addr_str);
+        return;
+    }
+    scan_type_t type;
+    if (!parse_scan_type(type_str, &type)) {
+        return;
+    }
+    uint64_t val = 0;
+    double fval = 0;
+    bool ok;
+    if (type == SCAN_TYPE_FLOAT || type == SCAN_TYPE_DOUBLE) {
+        errno = 0;
+        fval = strtod(value_str, &end);
+        ok = end != value_str && *end == '\0' && errno != ERANGE &&
+             (type == SCAN_TYPE_DOUBLE || !isfinite(fval) ||
+              (fval >= -FLT_MAX && fval <= FLT_MAX));
+    } else {
+        // Values that don't fit the type are refused, not truncated
+        ok = parse_operand(value_str, scan_type_size(type), &val);
+    }
+    if (!ok) {
+        log_printf(LOG_RED, "Invalid %s value: %s\n", type_str, value_str);
+        return;
+    }
     int rc;
 
     if (strcmp(type_str, "byte") == 0) {
@@ -62,7 +92,21 @@ void handle_poke(char *addr_str, char *type_str, char *value_str) {
         } else {
             log_printf(LOG_RED, "poke failed: %s\n", strerror(rc));
         }
-    } else {
-        log_printf(LOG_RED, "Unknown type: %s\n", type_str);
+    } else if (strcmp(type_str, "float") == 0) {
+        float f = (float)fval;
+        rc = poke_mem(g_app_state.pid, addr, &f, sizeof(f));
+        if (rc == 0) {
+            log_printf(LOG_GREEN, "Wrote float %g -> 0x%lx\n", f, addr);
+        } else {
+            log_printf(LOG_RED, "poke failed: %s\n", strerror(rc));
+        }
+    } else if (strcmp(type_str, "double") == 0) {
+        double d = fval;
+        rc = poke_mem(g_app_state.pid, addr, &d, sizeof(d));
+        if (rc == 0) {
+            log_printf(LOG_GREEN, "Wrote double %.17g -> 0x%lx\n", d, addr);
+        } else {
+            log_printf(LOG_RED, "poke failed: %s\n", strerror(rc));
+        }
     }
 }
@@ -0,0 +1,26 @@
+// src/ui/handler/print_stats.c
+#include "../../utils/peek.h"
+#include "../logger.h"
+#include "handler.h"
+
+/**
+ * Print the read counters of a scan: how many bytes were copied from the
+ * target, in how many process_vm_readv calls, and at what rate.
+ *
+ * @param stats The counters returned by full_scan().
+ */
+void print_scan_stats(const peek_stats_t *stats) {
+    double mib = (double)stats->bytes / (1024.0 * 1024.0);
+    double secs = (double)stats->nsec / 1e9;
+    peek_tuning_t tuning = peek_tuning();
+    log_printf(LOG_DEFAULT,
+               "Read %.1f MiB in %zu syscalls, %.3f s (%.1f MiB/s, "
+               "%zu KiB x %zu iovecs per call).\n",
+               mib, stats->syscalls, secs, secs > 0 ? mib / secs : 0.0,
+               tuning.chunk_size / 1024, tuning.batch);
+    if (stats->skipped > 0) {
+        log_printf(LOG_DEFAULT,
+                   "Skipped %.1f MiB of untouched or swapped-out pages.\n",
+                   (double)stats->skipped / (1024.0 * 1024.0));
+    }
+}
@@ -0,0 +1,54 @@
+// src/ui/handler/save.c
+#include "../../utils/snapfile.h"
+#include "../app_state.h"
+#include "../logger.h"
+#include "handler.h"
+#include <string.h>
+
+/**
+ * Handle the 'save' command.
+ * Writes a generation of the scan history to a snapshot file that can be
+ * loaded back later with 'load', even without attaching to the process.
+ *
+ * @param path_str The file to write.
+ * @param gen_str The generation to save, or NULL for the newest one.
+ */
+void handle_save(char *path_str, char *gen_str) {
+    uint64_t gen = 0;
+    if (!history_newest(&g_app_state.history, &gen)) {
+        log_printf(LOG_RED,
+                   "No scan data available. Please perform a scan first.\n");
+        return;
+    }
+    if (!path_str) {
+        log_printf(LOG_RED, "Usage: save <file> [gen]\n");
+        return;
+    }
+    if (gen_str && !parse_generation(gen_str, &gen)) {
+        return;
+    }
+    if (history_hash_only(&g_app_state.history, gen)) {
+        log_printf(LOG_RED,
+                   "Generation %lu only holds page hashes, it can't be "
+                   "saved.\n",
+                   gen);
+        return;
+    }
+
+    mem_region_t *regions;
+    size_t count;
+    if (history_get(&g_app_state.history, gen, &regions, &count) != 0) {
+        log_printf(LOG_RED, "Failed to read generation %lu.\n", gen);
+        return;
+    }
+
+    int rc = snapshot_save(path_str, regions, count, g_app_state.proc_name,
+                           true);
+    if (rc != 0) {
+        log_printf(LOG_RED, "Failed to save %s: %s\n", path_str,
+                   strerror(rc));
+        return;
+    }
+    log_printf(LOG_GREEN, "Saved generation %lu (%zu regions) to %s.\n", gen,
+               count, path_str);
+}
@@ -1,76 +1,721 @@
 // src/ui/handler/search.c
+#include "../../utils/peek.h"
 #include "../../utils/scan.h"
+#include "../../utils/threadpool.h"
 #include "../app_state.h"
 #include "../logger.h"
 #include "handler.h"
+#include <errno.h>
+#include <float.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+// Matches of an 'any' search listed right away
+#define SEARCH_LIST_MAX 20
+
+static const char *g_type_names[] = {"byte",  "word",  "dword",
+                                     "qword", "float", "double"};
+
+/**
+ * Parse the name of a scan type (byte, word, dword, qword, float, double).
+ * Prints an error message if it is unknown.
+ *
+ * @param str The name.
+ * @param type Pointer to store the type.
+ * @return true on success, false if the name is unknown.
+ */
+bool parse_scan_type(const char *str, scan_type_t *type) {
+    for (int t = SCAN_TYPE_BYTE; t <= SCAN_TYPE_DOUBLE; t++) {
+        if (strcmp(str, g_type_names[t]) == 0) {
+            *type = (scan_type_t)t;
+            return true;
+        }
+    }
+    log_printf(LOG_RED, "Unknown type: %s\n", str);
+    return false;
+}
+
+/**
+ * Parse the name of an integer type of a predicate: byte, word, dword,
+ * qword or u8 ... u64 (unsigned), i8 ... i64 (signed). Prints an error
+ * message if it is unknown.
+ *
+ * @param str The name.
+ * @param type Pointer to store the type.
+ * @param is_signed Pointer to store whether it is signed.
+ * @return true on success, false if the name is unknown.
+ */
+bool parse_int_type(const char *str, scan_type_t *type, bool *is_signed) {
+    static const struct {
+        const char *name;
+        scan_type_t type;
+        bool is_signed;
+    } types[] = {
+        {"byte", SCAN_TYPE_BYTE, false},   {"word", SCAN_TYPE_WORD, false},
+        {"dword", SCAN_TYPE_DWORD, false}, {"qword", SCAN_TYPE_QWORD, false},
+        {"u8", SCAN_TYPE_BYTE, false},     {"u16", SCAN_TYPE_WORD, false},
+        {"u32", SCAN_TYPE_DWORD, false},   {"u64", SCAN_TYPE_QWORD, false},
+        {"i8", SCAN_TYPE_BYTE, true},      {"i16", SCAN_TYPE_WORD, true},
+        {"i32", SCAN_TYPE_DWORD, true},    {"i64", SCAN_TYPE_QWORD, true},
+    };
+    for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+        if (strcmp(str, types[t].name) == 0) {
+            *type = types[t].type;
+            *is_signed = types[t].is_signed;
+            return true;
+        }
+    }
+    log_printf(LOG_RED, "Unknown integer type: %s\n", str);
+    return false;
+}
+
+/**
+ * Split a /<align> suffix off a type name and parse it: 1, 2, 4 or 8 bytes,
+ * or natural (0). Prints an error message if it is invalid.
+ *
+ * @param type_str The type name, cut at the '/' if it has one.
+ * @param align Pointer to store the alignment (left alone without suffix).
+ * @return true on success, false if the alignment is invalid.
+ */
+bool parse_align(char *type_str, size_t *align) {
+    // <type>/<align> asks for another alignment than the natural one
+    char *align_str = strchr(type_str, '/');
+    if (!align_str) {
+        return true;
+    }
+    *align_str++ = '\0';
+    char *end;
+    unsigned long value = strtoul(align_str, &end, 0);
+    bool natural = strcmp(align_str, "natural") == 0;
+    if (!natural && (*end != '\0' || value == 0 || value > 8 ||
+                     (value & (value - 1)) != 0)) {
+        log_printf(LOG_RED, "Invalid alignment: %s (1, 2, 4, 8 or natural)\n",
+                   align_str);
+        return false;
+    }
+    *align = natural ? 0 : value;
+    return true;
+}
+
+/**
+ * Parse the value of a float or double search:
+ *   V       exactly V
+ *   V~E     within V - E and V + E
+ *   LO:HI   within LO and HI
+ *   ~V      rounds to V at as many decimals as V is written with
+ *   nan     any NaN
+ *
+ * @param str The value.
+ * @param fcmp Pointer to store the comparison.
+ * @return true on success, false (with a message) otherwise.
+ */
+static bool parse_fcmp(const char *str, fcmp_t *fcmp) {
+    if (strcmp(str, "nan") == 0) {
+        *fcmp = (fcmp_t){.op = FCMP_NAN};
+        return true;
+    }
+    bool rounded = str[0] == '~';
+    const char *num = rounded ? str + 1 : str;
+    char *end;
+    double v = strtod(num, &end);
+    bool ok = end != num;
+    *fcmp = (fcmp_t){.op = FCMP_RANGE, .lo = v, .hi = v};
+
+    if (ok && rounded) {
+        // Half a unit of the last written decimal on either side
+        const char *dot = strchr(num, '.');
+        const char *d = dot ? dot + 1 : end;
+        double half = 0.5;
+        for (; d < end && *d >= '0' && *d <= '9'; d++) {
+            half /= 10;
+        }
+        fcmp->lo = v - half;
+        fcmp->hi = v + half;
+    } else if (ok && (*end == '~' || *end == ':')) {
+        bool range = *end == ':';
+        const char *second = end + 1;
+        double w = strtod(second, &end);
+        ok = end != second && (range ? v <= w : w >= 0);
+        fcmp->lo = range ? v : v - w;
+        fcmp->hi = range ? w : v + w;
+    }
+    if (!ok || *end != '\0' || v != v) {
+        log_printf(LOG_RED, "Invalid float value: %s\n", str);
+        log_printf(LOG_YELLOW,
+                   "Values: V, V~EPS, LO:HI, ~V (rounded) or nan\n");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Keep the matches of a search as the candidates that later searches narrow
+ * down, in place of the previous ones.
+ *
+ * @param found The matches (taken over).
+ * @param type Their type.
+ * @param is_signed Whether they are signed integers.
+ * @param gen The generation they were found in.
+ * @param values Their values, or NULL if all equal `value`.
+ * @param value Their value.
+ */
+void keep_candidates(candset_t *found, scan_type_t type, bool is_signed,
+                     uint64_t gen, uint8_t *values, uint64_t value) {
+    drop_any_matches();
+    candset_free(&g_app_state.candidates);
+    g_app_state.candidates = *found;
+    g_app_state.cand_type = type;
+    g_app_state.cand_signed = is_signed;
+    g_app_state.cand_gen = gen;
+    g_app_state.cand_implicit = false;
+    free(g_app_state.cand_values);
+    g_app_state.cand_values = values;
+    g_app_state.cand_value = value;
+    g_app_state.has_candidates = true;
+    log_printf(LOG_DEFAULT, "Kept %zu candidates in %.1f KiB.\n",
+               candset_count(found), (double)candset_bytes(found) / 1024.0);
+}
+
+/**
+ * Get the interpretations of a value for an 'any' search: an integer in
+ * every integer type it fits in (negative ones as two's complement), and
+ * any number as a double, and as a float within its range.
+ *
+ * @param str The value.
+ * @param values Array of SCAN_TYPE_COUNT to store them in.
+ * @return The number of interpretations, 0 if it is no number.
+ */
+static size_t any_values(const char *str, scan_value_t *values) {
+    size_t n = 0;
+    char *end;
+    errno = 0;
+    bool neg = str[strspn(str, " ")] == '-';
+    long long s = neg ? strtoll(str, &end, 0) : 0;
+    uint64_t u = neg ? (uint64_t)s : strtoull(str, &end, 0);
+    bool is_int = end != str && *end == '\0' && errno != ERANGE;
+    for (int t = SCAN_TYPE_BYTE; is_int && t <= SCAN_TYPE_QWORD; t++) {
+        unsigned bits = (unsigned)scan_type_size((scan_type_t)t) * 8;
+        uint64_t mask = bits == 64 ? ~0ULL : (1ULL << bits) - 1;
+        bool fits = bits == 64 || (neg ? s >= -(1LL << (bits - 1))
+                                       : (u & ~mask) == 0);
+        if (fits) {
+            values[n++] = (scan_value_t){.type = (scan_type_t)t,
+                                         .value = u & mask};
+        }
+    }
+
+    double d = strtod(str, &end);
+    if (end != str && *end == '\0' && d == d) {
+        if (d >= -FLT_MAX && d <= FLT_MAX) {
+            values[n++] = (scan_value_t){.type = SCAN_TYPE_FLOAT, .fvalue = d};
+        }
+        values[n++] = (scan_value_t){.type = SCAN_TYPE_DOUBLE, .fvalue = d};
+    }
+    return n;
+}
+
+/**
+ * Drop the matches of the last 'any' search, if they weren't kept.
+ */
+void drop_any_matches(void) {
+    for (size_t i = 0; i < g_app_state.any_count; i++) {
+        candset_free(&g_app_state.any_found[i]);
+    }
+    g_app_state.any_count = 0;
+    g_app_state.has_any = false;
+}
+
+/**
+ * List the matches of an 'any' search in address order, each with the type
+ * it matched as, until the pager wants no more.
+ *
+ * @param pager Where to list them.
+ * @param sets The matches of every type.
+ * @param values The value searched as every type.
+ * @param count Number of types.
+ * @return The number of matches, listed or not.
+ */
+size_t print_any_matches(pager_t *pager, const candset_t *sets,
+                         const scan_value_t *values, size_t count) {
+    cand_iter_t its[SCAN_TYPE_COUNT];
+    uintptr_t addrs[SCAN_TYPE_COUNT];
+    bool more[SCAN_TYPE_COUNT];
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        cand_iter_init(&its[i], &sets[i]);
+        more[i] = cand_iter_next(&its[i], &addrs[i]);
+        total += candset_count(&sets[i]);
+    }
+    while (pager_wants(pager)) {
+        size_t best = count;
+        for (size_t i = 0; i < count; i++) {
+            if (more[i] && (best == count || addrs[i] < addrs[best])) {
+                best = i;
+            }
+        }
+        if (best == count) {
+            break;
+        }
+        fprintf(pager_entry(pager), "  -> 0x%lx (%s)\n", addrs[best],
+                g_type_names[values[best].type]);
+        more[best] = cand_iter_next(&its[best], &addrs[best]);
+    }
+    return total;
+}
+
+/**
+ * Keep the matches of one type of an 'any' search as the candidates.
+ *
+ * @param found The matches (taken over).
+ * @param value The value searched, as their type.
+ * @param regions The generation searched.
+ * @param regions_count Number of its regions.
+ * @param gen The generation.
+ * @return 0 on success, -1 (with a message) on failure.
+ */
+static int keep_any_type(candset_t *found, const scan_value_t *value,
+                         mem_region_t *regions, size_t regions_count,
+                         uint64_t gen) {
+    scan_type_t type = value->type;
+    uint8_t *cand_values = NULL;
+    if ((type == SCAN_TYPE_FLOAT || type == SCAN_TYPE_DOUBLE) &&
+        candidate_values(found, regions, regions_count, &cand_values) != 0) {
+        log_printf(LOG_RED, "Failed to keep the candidates.\n");
+        candset_free(found);
+        return -1;
+    }
+    keep_candidates(found, type, false, gen, cand_values, value->value);
+    return 0;
+}
+
+/**
+ * Search for a value in every type it can be stored as, in one pass, and
+ * list the matches tagged with their type. When a single type has matches
+ * they are kept as the candidates; otherwise the matches of every type are
+ * held until 'search keep <type>' picks one, and 'list' shows them all.
+ *
+ * @param count_only Only count the matches.
+ * @param opts Search options.
+ * @param regions The generation to search.
+ * @param regions_count Number of its regions.
+ * @param gen The generation.
+ * @param value_str The value.
+ */
+static void search_any(bool count_only, const search_opts_t *opts,
+                       mem_region_t *regions, size_t regions_count,
+                       uint64_t gen, const char *value_str) {
+    scan_value_t values[SCAN_TYPE_COUNT];
+    size_t nvalues = any_values(value_str, values);
+    if (nvalues == 0) {
+        log_printf(LOG_RED, "Invalid value: %s\n", value_str);
+        return;
+    }
+
+    candset_t found[SCAN_TYPE_COUNT];
+    size_t counts[SCAN_TYPE_COUNT];
+    uint64_t t0 = peek_now_ns();
+    int rc = search_any_set(regions, regions_count, values, nvalues, opts,
+                            count_only ? NULL : found, counts);
+    double ms = (double)(peek_now_ns() - t0) / 1e6;
+    if (rc != 0) {
+        log_printf(LOG_RED, "Search failed.\n");
+        return;
+    }
+
+    size_t total = 0, hit_types = 0, last = 0;
+    for (size_t i = 0; i < nvalues; i++) {
+        total += counts[i];
+        if (counts[i] > 0) {
+            hit_types++;
+            last = i;
+        }
+    }
+    log_printf(LOG_GREEN,
+               "Found %zu matches for %s in %zu types in %.1f ms (%zu "
+               "threads).\n",
+               total, value_str, nvalues, ms, pool_workers());
+    for (size_t i = 0; i < nvalues; i++) {
+        log_printf(counts[i] ? LOG_DEFAULT : LOG_YELLOW, "  %-6s : %zu\n",
+                   g_type_names[values[i].type], counts[i]);
+    }
+    if (count_only) {
+        return;
+    }
+    if (hit_types == 0) {
+        for (size_t i = 0; i < nvalues; i++) {
+            candset_free(&found[i]);
+        }
+        return;
+    }
+
+    // List the first matches in address order, each with its type
+    pager_t pager;
+    pager_open(&pager, false, SEARCH_LIST_MAX);
+    print_any_matches(&pager, found, values, nvalues);
+    size_t shown = pager.shown;
+    pager_close(&pager);
+
+    // Candidates have one type, so the matches of several types are held
+    // until one of them is picked
+    if (hit_types == 1) {
+        for (size_t i = 0; i < nvalues; i++) {
+            if (i != last) {
+                candset_free(&found[i]);
+            }
+        }
+        keep_any_type(&found[last], &values[last], regions, regions_count,
+                      gen);
+    } else {
+        drop_any_matches();
+        candset_free(&g_app_state.candidates);
+        free(g_app_state.cand_values);
+        g_app_state.cand_values = NULL;
+        g_app_state.cand_implicit = false;
+        g_app_state.has_candidates = false;
+        memcpy(g_app_state.any_found, found, nvalues * sizeof(found[0]));
+        memcpy(g_app_state.any_values, values, nvalues * sizeof(values[0]));
+        g_app_state.any_count = nvalues;
+        g_app_state.any_gen = gen;
+        g_app_state.has_any = true;
+        log_printf(LOG_YELLOW, "The value matched as several types, keep one "
+                               "with 'search keep <type>'.\n");
+    }
+    if (shown < total) {
+        log_printf(LOG_YELLOW, "%zu out of %zu matches shown. Use 'list page' "
+                               "to scroll.\n",
+                   shown, total);
+    }
+}
+
+/**
+ * Handle the 'search keep' command.
+ * This command keeps the matches of one type of the last 'any' search as
+ * the candidates, once it matched as several types.
+ *
+ * @param type_str The type to keep.
+ */
+void handle_search_keep(char *type_str) {
+    if (!g_app_state.has_any) {
+        log_printf(LOG_RED, "No 'search any' matches of several types to "
+                            "keep from.\n");
+        return;
+    }
+    if (!type_str) {
+        log_printf(LOG_RED, "Usage: search keep <type>\n");
+        return;
+    }
+    scan_type_t type;
+    if (!parse_scan_type(type_str, &type)) {
+        return;
+    }
+    size_t i = 0;
+    while (i < g_app_state.any_count &&
+           g_app_state.any_values[i].type != type) {
+        i++;
+    }
+    if (i == g_app_state.any_count ||
+        candset_count(&g_app_state.any_found[i]) == 0) {
+        log_printf(LOG_RED, "The value didn't match as %s.\n", type_str);
+        return;
+    }
+
+    mem_region_t *regions = NULL;
+    size_t regions_count = 0;
+    bool floating = type == SCAN_TYPE_FLOAT || type == SCAN_TYPE_DOUBLE;
+    if (floating && history_get(&g_app_state.history, g_app_state.any_gen,
+                                &regions, &regions_count) != 0) {
+        log_printf(LOG_RED, "Failed to load generation %lu.\n",
+                   g_app_state.any_gen);
+        return;
+    }
+    candset_t found = g_app_state.any_found[i];
+    scan_value_t value = g_app_state.any_values[i];
+    memset(&g_app_state.any_found[i], 0, sizeof(found));
+    keep_any_type(&found, &value, regions, regions_count, g_app_state.any_gen);
+}
+
 /**
  * Handle the 'search' command.
  * This command allows the user to search for a specific value in the scan data.
+ * The matches are kept as the candidates that later searches narrow down.
  *
- * @param type_str The type of value to search for (byte, word, dword, qword).
- * @param value_str The value to search for, as a string.
+ * @param count_only Only count the matches, keep the current candidates.
+ * @param limit_str Stop after this many matches, or NULL for no limit.
+ * @param type_str The type of value to search for (byte, word, dword, qword,
+ *                 float, double, or any for all of them at once),
+ *                 optionally followed by /<align> to look at every 1, 2, 4
+ *                 or 8 bytes instead of the natural alignment.
+ * @param value_str The value to search for, as a string (see parse_fcmp()
+ *                  for floats and doubles).
+ * @param gen_str The generation to search, or NULL for the newest one.
  */
-void handle_search(char *type_str, char *value_str) {
+void handle_search(bool count_only, char *limit_str, char *type_str,
+                   char *value_str, char *gen_str) {
     // Decide which memory-snapshot to search.
     // If no scan is available, we can't search.
-    // If any exist, use the most recent one.
-    mem_region_t *regions;
-    size_t regions_count;
-    if (g_app_state.current_scan) {
-        regions = g_app_state.current_scan;
-        regions_count = g_app_state.current_scan_count;
-    } else if (g_app_state.previous_scan) {
-        regions = g_app_state.previous_scan;
-        regions_count = g_app_state.previous_scan_count;
-    } else if (g_app_state.initial_scan) {
-        regions = g_app_state.initial_scan;
-        regions_count = g_app_state.initial_scan_count;
-    } else {
+    // If any exist, use the most recent one unless told otherwise.
+    uint64_t gen = 0;
+    if (!history_newest(&g_app_state.history, &gen)) {
         log_printf(LOG_RED,
                    "No scan data available. Please perform a scan first.\n");
         return;
     }
 
     if (!type_str || !value_str) {
-        log_printf(LOG_RED, "Usage: search <type> <value>\n");
-        log_printf(LOG_YELLOW, "Types: byte, word, dword, qword\n");
+        log_printf(LOG_RED,
+                   "Usage: search [count | first <n>] <type>[/align] <value> "
+                   "[gen]\n");
+        log_printf(LOG_YELLOW,
+                   "Types: byte, word, dword, qword, float, double, any\n");
+        return;
+    }
+    search_opts_t opts = {.count_only = count_only};
+    if (limit_str) {
+        char *end;
+        unsigned long long limit = strtoull(limit_str, &end, 0);
+        if (*end != '\0' || limit == 0) {
+            log_printf(LOG_RED, "Invalid match limit: %s\n", limit_str);
+            return;
+        }
+        opts.limit = limit;
+    }
+    if (gen_str && !parse_generation(gen_str, &gen)) {
+        return;
+    }
+    if (history_hash_only(&g_app_state.history, gen)) {
+        log_printf(LOG_RED,
+                   "Generation %lu only holds page hashes, it can't be "
+                   "searched.\n",
+                   gen);
+        return;
+    }
+
+    mem_region_t *regions;
+    size_t regions_count;
+    if (history_get(&g_app_state.history, gen, &regions, &regions_count) !=
+        0) {
+        log_printf(LOG_RED, "Failed to load generation %lu.\n", gen);
         return;
     }
 
+    if (!parse_align(type_str, &opts.align)) {
+        return;
+    }
+    if (strcmp(type_str, "any") == 0) {
+        search_any(count_only, &opts, regions, regions_count, gen, value_str);
+        return;
+    }
     scan_type_t type;
-    if (strcmp(type_str, "byte") == 0) {
-        type = SCAN_TYPE_BYTE;
-    } else if (strcmp(type_str, "word") == 0) {
-        type = SCAN_TYPE_WORD;
-    } else if (strcmp(type_str, "dword") == 0) {
-        type = SCAN_TYPE_DWORD;
-    } else if (strcmp(type_str, "qword") == 0) {
-        type = SCAN_TYPE_QWORD;
-    } else {
-        log_printf(LOG_RED, "Unknown search type: %s\n", type_str);
+    if (!parse_scan_type(type_str, &type)) {
         return;
     }
 
+    bool floating = type == SCAN_TYPE_FLOAT || type == SCAN_TYPE_DOUBLE;
+    fcmp_t fcmp;
+    if (floating && !parse_fcmp(value_str, &fcmp)) {
+        return;
+    }
     uint64_t value = strtoull(value_str, NULL, 0); // Base 0 auto-detects 0x hex
 
-    scan_result_t *results = NULL;
+    candset_t found;
+    candset_t *out = count_only ? NULL : &found;
+    size_t count = 0;
+    uint64_t t0 = peek_now_ns();
+    int rc;
+    if (floating) {
+        rc = search_float_set(regions, regions_count, type, &fcmp, &opts, out,
+                              &count);
+    } else {
+        rc = search_compare_set(regions,       // Memory regions to search
+                                regions_count, // Number of regions
+                                type,          // Type of value (e.g. byte)
+                                CMP_EQ,        // Comparison type (equal)
+                                &value,        // The value to search for
+                                &opts,         // Count only / limit
+                                out,           // Output: matches (or NULL)
+                                &count         // Output: number of matches
+        );
+    }
+    double ms = (double)(peek_now_ns() - t0) / 1e6;
+    if (rc != 0) {
+        log_printf(LOG_RED, "Search failed.\n");
+        return;
+    }
+
+    if (floating) {
+        log_printf(LOG_GREEN,
+                   "Found %zu matches for %s %s in %.1f ms (%zu threads).\n",
+                   count, type_str, value_str, ms, pool_workers());
+    } else {
+        log_printf(LOG_GREEN,
+                   "Found %zu matches for value %lu (0x%lx) in %.1f ms "
+                   "(%zu threads).\n",
+                   count, value, value, ms, pool_workers());
+    }
+    if (count_only) {
+        return;
+    }
+
+    // Matches of a float search differ from each other, so their values are
+    // looked up for 'next' to compare to
+    uint8_t *values = NULL;
+    if (floating &&
+        candidate_values(&found, regions, regions_count, &values) != 0) {
+        log_printf(LOG_RED, "Search failed.\n");
+        candset_free(&found);
+        return;
+    }
+
+    // Keep the matches for narrowing, in place of the previous ones
+    keep_candidates(&found, type, false, gen, values, value);
+}
+
+/**
+ * Handle the 'search unknown' command.
+ * When the value is unknown, every aligned slot of the given type in a
+ * generation is a candidate. Nothing is materialized: the generation itself
+ * stands for the candidates until a 'filter cand' turns the ones that pass
+ * into an explicit candidate set.
+ *
+ * NOTE: The first filter makes the set explicit however many slots pass.
+ * Its survivors are no longer "every slot", and staying implicit past it
+ * would mean replaying every earlier relation (between generations the
+ * history may have dropped by then) on each later filter. An explicit set
+ * costs at most one bit per slot anyway, as dense blocks turn into bitmaps.
+ *
+ * @param type_str The type of the value (byte, word, ..., double).
+ * @param gen_str The generation to start from, or NULL for the newest one.
+ */
+void handle_search_unknown(char *type_str, char *gen_str) {
+    uint64_t gen = 0;
+    if (!history_newest(&g_app_state.history, &gen)) {
+        log_printf(LOG_RED,
+                   "No scan data available. Please perform a scan first.\n");
+        return;
+    }
+    if (!type_str) {
+        log_printf(LOG_RED, "Usage: search unknown <type> [gen]\n");
+        return;
+    }
+    scan_type_t type;
+    if (!parse_scan_type(type_str, &type) ||
+        (gen_str && !parse_generation(gen_str, &gen))) {
+        return;
+    }
+    if (history_hash_only(&g_app_state.history, gen)) {
+        log_printf(LOG_RED,
+                   "Generation %lu only holds page hashes, it can't be "
+                   "searched.\n",
+                   gen);
+        return;
+    }
+    mem_region_t *regions;
+    size_t regions_count;
+    if (history_get(&g_app_state.history, gen, &regions, &regions_count) !=
+        0) {
+        log_printf(LOG_RED, "Failed to load generation %lu.\n", gen);
+        return;
+    }
+
+    const size_t type_size = scan_type_size(type);
+    size_t slots = 0;
+    for (size_t i = 0; i < regions_count; i++) {
+        if (regions[i].data) {
+            slots += regions[i].len / type_size;
+        }
+    }
+
+    drop_any_matches();
+    candset_free(&g_app_state.candidates);
+    candset_init(&g_app_state.candidates, type_size, type_size);
+    free(g_app_state.cand_values);
+    g_app_state.cand_values = NULL;
+    g_app_state.cand_type = type;
+    g_app_state.cand_signed = false;
+    g_app_state.cand_gen = gen;
+    g_app_state.cand_implicit = true;
+    g_app_state.has_candidates = true;
+    log_printf(LOG_GREEN,
+               "Every %s of generation %lu is a candidate (%zu slots).\n",
+               type_str, gen, slots);
+    log_printf(LOG_DEFAULT, "Take another 'fullscan', then narrow them down "
+                            "with 'filter cand <relation>'.\n");
+}
+
+/**
+ * Handle the 'search where' command.
+ * This command searches the newest generation for the integers that pass a
+ * predicate, such as "x >= -50 && x <= 50 && (x & 0xff) == 0x7f", in a
+ * single pass. The matches are kept as candidates along with their values.
+ *
+ * @param type_str The integer type: byte, word, dword, qword or u8 ... u64
+ *                 (unsigned), i8 ... i64 (signed), optionally followed by
+ *                 /<align>.
+ * @param expr The predicate (the rest of the line, see pred_compile()).
+ */
+void handle_search_where(char *type_str, char *expr) {
+    uint64_t gen = 0;
+    if (!history_newest(&g_app_state.history, &gen)) {
+        log_printf(LOG_RED,
+                   "No scan data available. Please perform a scan first.\n");
+        return;
+    }
+    if (!type_str || !expr) {
+        log_printf(LOG_RED, "Usage: search where <type>[/align] <predicate>\n");
+        log_printf(LOG_YELLOW, "Types: byte, word, dword, qword, u8 ... u64, "
+                               "i8 ... i64 (signed)\n");
+        return;
+    }
+
+    search_opts_t opts = {0};
+    scan_type_t type;
+    bool is_signed;
+    if (!parse_align(type_str, &opts.align) ||
+        !parse_int_type(type_str, &type, &is_signed)) {
+        return;
+    }
+    if (history_hash_only(&g_app_state.history, gen)) {
+        log_printf(LOG_RED,
+                   "Generation %lu only holds page hashes, it can't be "
+                   "searched.\n",
+                   gen);
+        return;
+    }
+    mem_region_t *regions;
+    size_t regions_count;
+    if (history_get(&g_app_state.history, gen, &regions, &regions_count) !=
+        0) {
+        log_printf(LOG_RED, "Failed to load generation %lu.\n", gen);
+        return;
+    }
+
+    pred_t pred;
+    if (pred_compile(expr, scan_type_size(type), is_signed, &pred) != 0) {
+        return;
+    }
+    candset_t found;
     size_t count = 0;
-    search_compare(regions,       // Memory regions to search
-                   regions_count, // Number of regions
-                   type,          // Type of value to search for (e.g. byte)
-                   CMP_EQ,        // Comparison type (equal)
-                   &value,        // Pointer to the value to search for
-                   &results,      // Output: array of results
-                   &count         // Output: number of matches found
-    );
-
-    log_printf(LOG_GREEN, "Found %zu matches for value %lu (0x%lx).\n", count,
-               value, value);
-
-    // TODO: store results in g_app_state.last_results for narrowing
-    free(results);
+    uint64_t t0 = peek_now_ns();
+    int rc = search_pred_set(regions, regions_count, &pred, &opts, &found,
+                             &count);
+    double ms = (double)(peek_now_ns() - t0) / 1e6;
+    pred_free(&pred);
+    if (rc != 0) {
+        log_printf(LOG_RED, "Search failed.\n");
+        return;
+    }
+    log_printf(LOG_GREEN,
+               "Found %zu %s values where %s in %.1f ms (%zu threads).\n",
+               count, type_str, expr, ms, pool_workers());
+
+    // The matches differ from each other, so their values are looked up for
+    // 'next' to compare to, as with float searches
+    uint8_t *values = NULL;
+    if (candidate_values(&found, regions, regions_count, &values) != 0) {
+        log_printf(LOG_RED, "Search failed.\n");
+        candset_free(&found);
+        return;
+    }
+    keep_candidates(&found, type, is_signed, gen, values, 0);
 }
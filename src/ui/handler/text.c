@@ -0,0 +1,176 @@
+// src/ui/handler/text.c
+#include "../../utils/peek.h"
+#include "../../utils/scan.h"
+#include "../../utils/threadpool.h"
+#include "../app_state.h"
+#include "../logger.h"
+#include "../pager.h"
+#include "handler.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Matches listed unless 'page' or 'head <n>' is given
+#define TEXT_LIST_MAX 20
+// Characters of every match shown
+#define TEXT_PREVIEW 40
+
+/**
+ * Print the text at an address of a generation, up to its NUL (or the
+ * preview length), with the characters that aren't printable ASCII as '.'.
+ *
+ * @param out The stream to print to.
+ * @param regions The regions of the generation.
+ * @param count Number of regions.
+ * @param addr Address of the text.
+ * @param enc Encoding of the text.
+ */
+static void print_preview(FILE *out, const mem_region_t *regions,
+                          size_t count, uintptr_t addr, text_enc_t enc) {
+    size_t r = 0;
+    while (r < count && addr >= regions[r].start + regions[r].len) {
+        r++;
+    }
+    if (r == count || addr < regions[r].start) {
+        return;
+    }
+    const uint8_t *p = regions[r].data + (addr - regions[r].start);
+    size_t avail = regions[r].start + regions[r].len - addr;
+    size_t unit = enc == TEXT_UTF16LE ? 2 : 1;
+    char text[TEXT_PREVIEW + 4];
+    size_t n = 0;
+    for (size_t i = 0; i + unit <= avail && n < TEXT_PREVIEW; i += unit) {
+        unsigned c = unit == 2 ? p[i] | p[i + 1] << 8 : p[i];
+        if (c == 0) {
+            break;
+        }
+        text[n++] = c < 0x80 && isprint((int)c) ? (char)c : '.';
+    }
+    if (n == TEXT_PREVIEW) {
+        memcpy(text + n, "...", 3);
+        n += 3;
+    }
+    text[n] = '\0';
+    fprintf(out, "  \"%s\"", text);
+}
+
+/**
+ * Handle the 'text' command.
+ * This command searches the newest generation for a string, as UTF-8 or
+ * UTF-16LE, exactly, ignoring the case of ASCII letters, or as a regex.
+ * The matches are listed like 'list' does, with 'page' and 'head <n>'.
+ *
+ * @param args The options and the text, or NULL.
+ */
+void handle_text(char *args) {
+    if (!args) {
+        log_printf(LOG_RED, "Usage: text [utf16] [nocase] [regex] [page] "
+                            "[head <n>] <text>\n");
+        return;
+    }
+    text_enc_t enc = TEXT_UTF8;
+    bool icase = false, regex = false, paginate = false;
+    size_t limit = 0;
+    for (;;) {
+        int taken = take_listing_option(&args, &paginate, &limit);
+        if (taken < 0) {
+            return;
+        } else if (taken > 0) {
+            continue;
+        }
+        size_t word = strcspn(args, " ");
+        if (word == 5 && strncmp(args, "utf16", 5) == 0) {
+            enc = TEXT_UTF16LE;
+        } else if (word == 4 && strncmp(args, "utf8", 4) == 0) {
+            enc = TEXT_UTF8;
+        } else if (word == 6 && strncmp(args, "nocase", 6) == 0) {
+            icase = true;
+        } else if (word == 5 && strncmp(args, "regex", 5) == 0) {
+            regex = true;
+        } else {
+            break;
+        }
+        args += word;
+        args += strspn(args, " ");
+    }
+    if (*args == '\0') {
+        log_printf(LOG_RED, "Usage: text [utf16] [nocase] [regex] [page] "
+                            "[head <n>] <text>\n");
+        return;
+    }
+
+    uint64_t gen = 0;
+    if (!history_newest(&g_app_state.history, &gen)) {
+        log_printf(LOG_RED,
+                   "No scan data available. Please perform a scan first.\n");
+        return;
+    }
+    if (history_hash_only(&g_app_state.history, gen)) {
+        log_printf(LOG_RED,
+                   "Generation %lu only holds page hashes, it can't be "
+                   "searched.\n",
+                   gen);
+        return;
+    }
+    mem_region_t *regions;
+    size_t regions_count;
+    if (history_get(&g_app_state.history, gen, &regions, &regions_count) !=
+        0) {
+        log_printf(LOG_RED, "Failed to load generation %lu.\n", gen);
+        return;
+    }
+
+    signature_t sig;
+    text_regex_t re;
+    if (regex ? text_regex_compile(args, enc, icase, &re) != 0
+              : text_literal(args, enc, icase, &sig) != 0) {
+        log_printf(LOG_RED, "Invalid %s: %s\n", regex ? "regex" : "text", args);
+        return;
+    }
+
+    // UTF-16 strings sit at even addresses, which also keeps a regex from
+    // matching across the halves of two characters
+    search_opts_t opts = {.align = enc == TEXT_UTF16LE ? 2 : 1};
+    candset_t found;
+    size_t count = 0;
+    uint64_t t0 = peek_now_ns();
+    int rc = regex ? search_regex_set(regions, regions_count, &re, &opts,
+                                      &found, &count)
+                   : search_sig_set(regions, regions_count, &sig, 1, &opts,
+                                    &found, &count);
+    double ms = (double)(peek_now_ns() - t0) / 1e6;
+    if (regex) {
+        text_regex_free(&re);
+    } else {
+        sig_free(&sig);
+    }
+    if (rc != 0) {
+        log_printf(LOG_RED, "Text search failed.\n");
+        return;
+    }
+
+    log_printf(LOG_GREEN,
+               "Found %zu matches in generation %lu in %.1f ms (%zu "
+               "threads).\n",
+               count, gen, ms, pool_workers());
+    bool truncated = !paginate && limit == 0;
+    pager_t pager;
+    pager_open(&pager, paginate, truncated ? TEXT_LIST_MAX : limit);
+    cand_iter_t it;
+    cand_iter_init(&it, &found);
+    uintptr_t addr;
+    while (pager_wants(&pager) && cand_iter_next(&it, &addr)) {
+        FILE *out = pager_entry(&pager);
+        fprintf(out, "  -> 0x%lx", addr);
+        print_preview(out, regions, regions_count, addr, enc);
+        fprintf(out, "\n");
+    }
+    size_t shown = pager.shown;
+    pager_close(&pager);
+    candset_free(&found);
+
+    if (!paginate && shown < count) {
+        log_printf(LOG_YELLOW, "%zu out of %zu matches shown.%s\n", shown,
+                   count, truncated ? " Use 'text page ...' to scroll." : "");
+    }
+}
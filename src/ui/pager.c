@@ -0,0 +1,156 @@
+// src/ui/pager.c
+#include "pager.h"
+#include "logger.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Open the output of a listing.
+ *
+ * @param pager The pager.
+ * @param paginate If true, the output is piped into "less -R" (stdout if it
+ * can't be launched).
+ * @param limit Entries to show at most (0: no limit).
+ */
+void pager_open(pager_t *pager, // [out]
+                bool paginate,  // [in]
+                size_t limit    // [in]
+) {
+    *pager = (pager_t){.out = stdout, .limit = limit};
+    if (!paginate) {
+        return;
+    }
+
+    // Ignore SIGPIPE so writes to a closed pager don't kill the original
+    // program (llce), they fail instead
+    struct sigaction sa_ignore;
+    sa_ignore.sa_handler = SIG_IGN;
+    sigemptyset(&sa_ignore.sa_mask);
+    sa_ignore.sa_flags = 0;
+    sigaction(SIGPIPE, &sa_ignore, &pager->sa_old);
+
+    // Pipe *all* lines (including color codes) into "less -R"
+    FILE *less = popen("less -R", "w");
+    if (!less) {
+        perror("Failed to launch pager (less -R)");
+        sigaction(SIGPIPE, &pager->sa_old, NULL);
+        return; // fallback: dump everything to stdout
+    }
+    pager->out = less;
+    pager->piped = true;
+}
+
+/**
+ * Check whether a listing should produce another entry: neither the limit
+ * is reached nor the pager closed (which fails the writes).
+ *
+ * @param pager The pager.
+ * @return true if another entry is wanted.
+ */
+bool pager_wants(const pager_t *pager) {
+    return (pager->limit == 0 || pager->shown < pager->limit) &&
+           !ferror(pager->out);
+}
+
+/**
+ * Count one more entry of a listing.
+ *
+ * @param pager The pager.
+ * @return The stream to write the entry to.
+ */
+FILE *pager_entry(pager_t *pager) {
+    pager->shown++;
+    return pager->out;
+}
+
+/**
+ * Close the output of a listing, waiting for the pager to be quit.
+ *
+ * @param pager The pager.
+ */
+void pager_close(pager_t *pager) {
+    if (pager->piped) {
+        pclose(pager->out);
+        sigaction(SIGPIPE, &pager->sa_old, NULL);
+    } else {
+        fflush(stdout);
+    }
+    pager->out = NULL;
+}
+
+/**
+ * Take the listing options, "page" and "head <n>", out of a list of
+ * command tokens. The other tokens are kept, in order.
+ *
+ * @param tokens The tokens.
+ * @param count Pointer to the number of tokens, updated.
+ * @param paginate Pointer to store whether "page" was given.
+ * @param limit Pointer to store n of "head <n>" (unchanged if not given).
+ * @return true on success, false (with a message) otherwise.
+ */
+bool parse_listing(char **tokens,  // [in/out]
+                   size_t *count,  // [in/out]
+                   bool *paginate, // [out]
+                   size_t *limit   // [in/out]
+) {
+    size_t kept = 0;
+    *paginate = false;
+    for (size_t i = 0; i < *count; i++) {
+        if (strcmp(tokens[i], "page") == 0) {
+            *paginate = true;
+        } else if (strcmp(tokens[i], "head") == 0) {
+            char *end = NULL;
+            unsigned long long n =
+                i + 1 < *count ? strtoull(tokens[i + 1], &end, 0) : 0;
+            if (!end || *end != '\0' || n == 0 || *tokens[i + 1] == '-') {
+                log_printf(LOG_RED, "Invalid head: expected 'head <n>' with "
+                                    "n > 0\n");
+                return false;
+            }
+            *limit = n;
+            i++;
+        } else {
+            tokens[kept++] = tokens[i];
+        }
+    }
+    *count = kept;
+    return true;
+}
+
+/**
+ * Take one listing option, "page" or "head <n>", off the front of a
+ * free-form argument such as the text of 'text', with the spaces after it.
+ *
+ * @param args Pointer to the argument, advanced past the option.
+ * @param paginate Pointer to set to true if "page" is taken.
+ * @param limit Pointer to store n of "head <n>".
+ * @return 1 if an option was taken, 0 if the argument doesn't start with
+ * one, -1 (with a message) if "head" has no valid n.
+ */
+int take_listing_option(char **args,    // [in/out]
+                        bool *paginate, // [out]
+                        size_t *limit   // [out]
+) {
+    char *p = *args;
+    size_t word = strcspn(p, " ");
+    if (word == 4 && strncmp(p, "page", 4) == 0) {
+        *paginate = true;
+    } else if (word == 4 && strncmp(p, "head", 4) == 0) {
+        p += word + strspn(p + word, " ");
+        char *end = NULL;
+        unsigned long long n = strtoull(p, &end, 0);
+        if (end == p || (*end != ' ' && *end != '\0') || n == 0 ||
+            *p == '-') {
+            log_printf(LOG_RED, "Invalid head: expected 'head <n>' with "
+                                "n > 0\n");
+            return -1;
+        }
+        *limit = n;
+        word = (size_t)(end - p);
+    } else {
+        return 0;
+    }
+    p += word;
+    *args = p + strspn(p, " ");
+    return 1;
+}
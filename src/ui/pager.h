@@ -0,0 +1,28 @@
+// src/ui/pager.h
+#pragma once
+#include <signal.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * Output of a listing: stdout, or "less -R" when paginated. The listing
+ * asks pager_wants() before producing each entry, so its producer stops as
+ * soon as the entry limit is reached or the pager is closed, and a pager
+ * that isn't scrolled holds the producer up (its pipe fills).
+ */
+typedef struct {
+    FILE *out;
+    bool piped;   // out is the pager
+    size_t limit; // entries wanted at most (0: no limit)
+    size_t shown; // entries written so far
+    struct sigaction sa_old;
+} pager_t;
+
+void pager_open(pager_t *pager, bool paginate, size_t limit);
+bool pager_wants(const pager_t *pager);
+FILE *pager_entry(pager_t *pager);
+void pager_close(pager_t *pager);
+bool parse_listing(char **tokens, size_t *count, bool *paginate,
+                   size_t *limit);
+int take_listing_option(char **args, bool *paginate, size_t *limit);
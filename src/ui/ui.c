@@ -14,6 +14,7 @@ app_state_t g_app_state;
  */
 void run_ui(void) {
     char line[256];
+    char raw[256]; // the line before tokenizing, for free-form arguments
     memset(&g_app_state, 0, sizeof(g_app_state));
 
     log_printf(LOG_GREEN,
@@ -25,11 +26,14 @@ void run_ui(void) {
         if (!fgets(line, sizeof(line), stdin))
             break;
         line[strcspn(line, "\n")] = 0;
+        memcpy(raw, line, sizeof(raw));
 
         char *command = strtok(line, " ");
         char *arg1 = strtok(NULL, " ");
         char *arg2 = strtok(NULL, " ");
         char *arg3 = strtok(NULL, " ");
+        char *arg4 = strtok(NULL, " ");
+        char *arg5 = strtok(NULL, " ");
 
         if (!command) {
             continue;
@@ -43,21 +47,57 @@ void run_ui(void) {
             handle_attach(arg1);
         } else if (strcmp(command, "fullscan") == 0) {
             // Perform a full scan of the process memory
-            handle_fullscan();
+            handle_fullscan(arg1);
         } else if (strcmp(command, "detect") == 0) {
             // Detect the changs of process and its memory layout
-            bool paginate = false;
-            if (arg1 && strcmp(arg1, "page") == 0) {
-                paginate = true;
-            } else if (arg1) {
-                log_printf(LOG_RED,
-                           "Invalid argument for 'detect'. Use 'detect page' "
-                           "for page scan.\n");
-            }
-            handle_detect(paginate);
+            handle_detect(arg1 ? raw + (arg1 - line) : NULL);
         } else if (strcmp(command, "search") == 0) {
             // Search for a value in the process memory
-            handle_search(arg1, arg2);
+            if (arg1 && strcmp(arg1, "count") == 0) {
+                handle_search(true, NULL, arg2, arg3, arg4);
+            } else if (arg1 && strcmp(arg1, "unknown") == 0) {
+                handle_search_unknown(arg2, arg3);
+            } else if (arg1 && strcmp(arg1, "keep") == 0) {
+                handle_search_keep(arg2);
+            } else if (arg1 && strcmp(arg1, "where") == 0) {
+                handle_search_where(arg2, arg3 ? raw + (arg3 - line) : NULL);
+            } else if (arg1 && strcmp(arg1, "first") == 0) {
+                handle_search(false, arg2, arg3, arg4, arg5);
+            } else {
+                handle_search(false, NULL, arg1, arg2, arg3);
+            }
+        } else if (strcmp(command, "aob") == 0) {
+            // Search for byte signatures (the rest of the line)
+            handle_aob(arg1 ? raw + (arg1 - line) : NULL);
+        } else if (strcmp(command, "group") == 0) {
+            // Search for values at fixed offsets (the rest of the line)
+            handle_group(arg1 ? raw + (arg1 - line) : NULL);
+        } else if (strcmp(command, "text") == 0) {
+            // Search for a string (the rest of the line)
+            handle_text(arg1 ? raw + (arg1 - line) : NULL);
+        } else if (strcmp(command, "next") == 0) {
+            // Narrow the candidates of the last search down
+            handle_next(arg1, arg2);
+        } else if (strcmp(command, "list") == 0) {
+            // List the candidates with their values
+            handle_list(arg1, arg2);
+        } else if (strcmp(command, "filter") == 0) {
+            // Keep the elements that changed in a given way between scans
+            if (arg2 &&
+                (strcmp(arg2, "delta") == 0 || strcmp(arg2, "range") == 0)) {
+                handle_filter(arg1, arg2, arg3, arg4, arg5);
+            } else {
+                handle_filter(arg1, arg2, NULL, arg3, arg4);
+            }
+        } else if (strcmp(command, "history") == 0) {
+            // List (or limit) the generations of the scan history
+            handle_history(arg1);
+        } else if (strcmp(command, "save") == 0) {
+            // Save a generation to a snapshot file
+            handle_save(arg1, arg2);
+        } else if (strcmp(command, "load") == 0) {
+            // Load a snapshot file as the newest generation
+            handle_load(arg1, arg2);
         } else if (strcmp(command, "poke") == 0) {
             // Poke (memory write) a value in the process memory
             handle_poke(arg1, arg2, arg3);
@@ -0,0 +1,177 @@
+// src/utils/arena.c
+#include "arena.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/**
+ * NOTE:
+ * Blocks of 2 MiB and larger are rounded up to a multiple of 2 MiB and
+ * advised as MADV_HUGEPAGE, so THP can back them and the TLB reach grows.
+ * Setting LLCE_HUGETLB=1 in the environment makes the arena try explicit
+ * MAP_HUGETLB pages first (they must be reserved via vm.nr_hugepages);
+ * if that fails it silently falls back to normal pages.
+ */
+#define HUGE_PAGE_SIZE ((size_t)2 << 20) // 2 MiB
+
+// A retired block waiting to be reused
+typedef struct {
+    void *ptr;
+    size_t cap;
+} arena_block_t;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static arena_block_t *g_free = NULL; // free list, unordered
+static size_t g_free_count = 0;
+static size_t g_free_capacity = 0;
+static size_t g_retained = 0; // bytes held on the free list
+static size_t g_live = 0;     // bytes handed out and not yet released
+static size_t g_peak = 0;     // high-water mark of g_live
+
+/**
+ * Round the requested length up to the block size we actually map.
+ */
+static size_t block_size(size_t len) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t unit = len >= HUGE_PAGE_SIZE ? HUGE_PAGE_SIZE : page;
+    return (len + unit - 1) / unit * unit;
+}
+
+/**
+ * Map a fresh block of `cap` bytes.
+ */
+static void *map_block(size_t cap) {
+    static int use_hugetlb = -1;
+    if (use_hugetlb < 0) {
+        const char *env = getenv("LLCE_HUGETLB");
+        use_hugetlb = env && strcmp(env, "1") == 0;
+    }
+
+    void *ptr = MAP_FAILED;
+    if (use_hugetlb && cap % HUGE_PAGE_SIZE == 0) {
+        ptr = mmap(NULL, cap, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+    if (ptr == MAP_FAILED) {
+        ptr = mmap(NULL, cap, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED) {
+            return NULL;
+        }
+        if (cap >= HUGE_PAGE_SIZE) {
+            madvise(ptr, cap, MADV_HUGEPAGE); // best effort
+        }
+    }
+    return ptr;
+}
+
+/**
+ * Allocate a snapshot buffer of at least `len` bytes. A retired block is
+ * reused if one fits without wasting more than half of it, otherwise a new
+ * block is mapped. The contents are undefined.
+ *
+ * @param len Number of bytes needed.
+ * @param cap Pointer to store the real capacity (pass it to arena_release).
+ * @return The buffer, or NULL on failure.
+ */
+void *arena_alloc(size_t len, // [in]
+                  size_t *cap // [out]
+) {
+    if (len == 0) {
+        return NULL;
+    }
+    size_t want = block_size(len);
+
+    pthread_mutex_lock(&g_lock);
+    size_t best = SIZE_MAX;
+    for (size_t i = 0; i < g_free_count; i++) {
+        if (g_free[i].cap >= want && g_free[i].cap / 2 <= want &&
+            (best == SIZE_MAX || g_free[i].cap < g_free[best].cap)) {
+            best = i;
+        }
+    }
+
+    void *ptr = NULL;
+    if (best != SIZE_MAX) {
+        ptr = g_free[best].ptr;
+        *cap = g_free[best].cap;
+        g_retained -= *cap;
+        g_free[best] = g_free[--g_free_count];
+    }
+    pthread_mutex_unlock(&g_lock);
+
+    if (!ptr) {
+        ptr = map_block(want);
+        if (!ptr) {
+            return NULL;
+        }
+        *cap = want;
+    }
+
+    pthread_mutex_lock(&g_lock);
+    g_live += *cap;
+    if (g_live > g_peak) {
+        g_peak = g_live;
+    }
+    pthread_mutex_unlock(&g_lock);
+    return ptr;
+}
+
+/**
+ * Release a buffer obtained from arena_alloc(). It is kept for reuse as long
+ * as the arena doesn't retain more than the peak of live snapshot memory,
+ * and unmapped otherwise.
+ *
+ * @param ptr The buffer (NULL is ignored).
+ * @param cap The capacity reported by arena_alloc().
+ */
+void arena_release(void *ptr, size_t cap) {
+    if (!ptr) {
+        return;
+    }
+
+    pthread_mutex_lock(&g_lock);
+    g_live -= cap;
+    bool keep = g_retained + cap <= g_peak;
+    if (keep && g_free_count == g_free_capacity) {
+        size_t new_capacity = g_free_capacity ? g_free_capacity * 2 : 64;
+        arena_block_t *tmp =
+            realloc(g_free, new_capacity * sizeof(arena_block_t));
+        if (tmp) {
+            g_free = tmp;
+            g_free_capacity = new_capacity;
+        } else {
+            keep = false;
+        }
+    }
+    if (keep) {
+        g_free[g_free_count++] = (arena_block_t){.ptr = ptr, .cap = cap};
+        g_retained += cap;
+    }
+    pthread_mutex_unlock(&g_lock);
+
+    if (!keep) {
+        munmap(ptr, cap);
+    }
+}
+
+/**
+ * Unmap every retired block, e.g. when detaching from a process.
+ */
+void arena_trim(void) {
+    pthread_mutex_lock(&g_lock);
+    for (size_t i = 0; i < g_free_count; i++) {
+        munmap(g_free[i].ptr, g_free[i].cap);
+    }
+    free(g_free);
+    g_free = NULL;
+    g_free_count = 0;
+    g_free_capacity = 0;
+    g_retained = 0;
+    g_peak = g_live;
+    pthread_mutex_unlock(&g_lock);
+}
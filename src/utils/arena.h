@@ -0,0 +1,13 @@
+// src/utils/arena.h
+#pragma once
+#include <stddef.h>
+
+/**
+ * Snapshot arena: page-aligned, mmap-backed buffers for region snapshots.
+ * Buffers are NOT zero-initialized. Released buffers are kept on a free list
+ * and handed out again to the next scan, so a steady-state fullscan neither
+ * faults in nor zeroes fresh memory.
+ */
+void *arena_alloc(size_t len, size_t *cap);
+void arena_release(void *ptr, size_t cap);
+void arena_trim(void);
@@ -0,0 +1,6 @@
+// src/utils/hash.h
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+uint64_t hash64(const void *data, size_t len, uint64_t seed);
@@ -0,0 +1,760 @@
+// src/utils/history.c
+#include "history.h"
+#include "../datastructure/hashmap.h"
+#include "arena.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * NOTE:
+ * Deltas go backwards in time: generation k is stored as (k XOR k+1), so the
+ * newest generation stays full and dropping the oldest one never breaks the
+ * chain. Unchanged bytes XOR to zero, so the payload is a run-length list of
+ * (zero run, literal run) pairs where only the changed bytes are stored.
+ */
+
+/**
+ * Append a LEB128 varint to a growable buffer.
+ *
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int put_varint(uint8_t **buf, size_t *len, size_t *cap, size_t v) {
+    if (*len + 10 > *cap) {
+        size_t new_cap = *cap ? *cap * 2 : 256;
+        uint8_t *tmp = realloc(*buf, new_cap);
+        if (!tmp) {
+            return -1;
+        }
+        *buf = tmp;
+        *cap = new_cap;
+    }
+    do {
+        uint8_t byte = v & 0x7f;
+        v >>= 7;
+        (*buf)[(*len)++] = byte | (v ? 0x80 : 0);
+    } while (v);
+    return 0;
+}
+
+/**
+ * Read a LEB128 varint, advancing *p.
+ */
+static size_t get_varint(const uint8_t **p) {
+    size_t v = 0;
+    unsigned shift = 0;
+    uint8_t byte;
+    do {
+        byte = *(*p)++;
+        v |= (size_t)(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return v;
+}
+
+/**
+ * Byte of the reference region, or zero if there is none.
+ */
+static inline uint8_t ref_byte(const uint8_t *ref, size_t i) {
+    return ref ? ref[i] : 0;
+}
+
+/**
+ * Encode one region as an XOR/RLE delta against its successor.
+ *
+ * @param r The region to encode.
+ * @param ref The same region in the successor, or NULL.
+ * @param out Delta to fill in.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int encode_region(const mem_region_t *r,   // [in]
+                         const mem_region_t *ref, // [in]
+                         region_delta_t *out      // [out]
+) {
+    const uint8_t *d = r->data;
+    const uint8_t *rd = ref ? ref->data : NULL;
+    size_t len = r->len;
+    uint8_t *buf = NULL;
+    size_t blen = 0, bcap = 0;
+
+    size_t i = 0;
+    while (i < len) {
+        // Run of unchanged bytes, compared a word at a time where possible
+        size_t z = i;
+        while (z + 8 <= len) {
+            uint64_t a, b = 0;
+            memcpy(&a, d + z, 8);
+            if (rd) {
+                memcpy(&b, rd + z, 8);
+            }
+            if (a != b) {
+                break;
+            }
+            z += 8;
+        }
+        while (z < len && d[z] == ref_byte(rd, z)) {
+            z++;
+        }
+        if (put_varint(&buf, &blen, &bcap, z - i) != 0) {
+            goto fail;
+        }
+        if (z == len) {
+            if (put_varint(&buf, &blen, &bcap, 0) != 0) {
+                goto fail;
+            }
+            break;
+        }
+
+        // Literal run, ended by 8 unchanged bytes in a row
+        size_t l = z, eq = 0, lit_end = 0;
+        bool closed = false;
+        while (l < len) {
+            if (d[l] == ref_byte(rd, l)) {
+                if (++eq == 8) {
+                    lit_end = l + 1 - 8;
+                    closed = true;
+                    break;
+                }
+            } else {
+                eq = 0;
+            }
+            l++;
+        }
+        if (!closed) {
+            lit_end = len - eq;
+        }
+
+        size_t lit = lit_end - z;
+        if (put_varint(&buf, &blen, &bcap, lit) != 0) {
+            goto fail;
+        }
+        if (blen + lit > bcap) {
+            size_t new_cap = (blen + lit) * 2;
+            uint8_t *tmp = realloc(buf, new_cap);
+            if (!tmp) {
+                goto fail;
+            }
+            buf = tmp;
+            bcap = new_cap;
+        }
+        for (size_t k = 0; k < lit; k++) {
+            buf[blen++] = d[z + k] ^ ref_byte(rd, z + k);
+        }
+        i = lit_end;
+    }
+
+    // Shrink the payload to its final size
+    if (blen > 0 && blen < bcap) {
+        uint8_t *tmp = realloc(buf, blen);
+        if (tmp) {
+            buf = tmp;
+        }
+    }
+
+    size_t pages = (len + page_size() - 1) / page_size();
+    out->pages = NULL;
+    out->hashes = NULL;
+    if (r->pages) {
+        out->pages = malloc(pages);
+        if (!out->pages) {
+            goto fail;
+        }
+        memcpy(out->pages, r->pages, pages);
+    }
+    if (r->hashes) {
+        out->hashes = malloc(pages * sizeof(uint64_t));
+        if (!out->hashes) {
+            free(out->pages);
+            goto fail;
+        }
+        memcpy(out->hashes, r->hashes, pages * sizeof(uint64_t));
+    }
+    out->start = r->start;
+    out->len = len;
+    out->gen = r->gen;
+    out->has_ref = ref != NULL;
+    out->payload = buf;
+    out->payload_len = blen;
+    return 0;
+
+fail:
+    free(buf);
+    return -1;
+}
+
+/**
+ * Decode a region delta on top of its reference region.
+ *
+ * @param delta The delta to decode.
+ * @param ref The reference region (NULL if the delta has none).
+ * @param out Region to fill in (buffer from the arena).
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int decode_region(const region_delta_t *delta, // [in]
+                         const mem_region_t *ref,     // [in]
+                         mem_region_t *out            // [out]
+) {
+    memset(out, 0, sizeof(*out));
+    uint8_t *dst = arena_alloc(delta->len, &out->cap);
+    if (!dst) {
+        return -1;
+    }
+    if (ref) {
+        memcpy(dst, ref->data, delta->len);
+    } else {
+        memset(dst, 0, delta->len);
+    }
+
+    const uint8_t *p = delta->payload;
+    const uint8_t *end = p + delta->payload_len;
+    size_t pos = 0;
+    while (p < end) {
+        pos += get_varint(&p);
+        size_t lit = get_varint(&p);
+        for (size_t k = 0; k < lit; k++) {
+            dst[pos + k] ^= p[k];
+        }
+        p += lit;
+        pos += lit;
+    }
+
+    if (delta->pages) {
+        size_t pages = (delta->len + page_size() - 1) / page_size();
+        out->pages = malloc(pages);
+        if (!out->pages) {
+            arena_release(dst, out->cap);
+            return -1;
+        }
+        memcpy(out->pages, delta->pages, pages);
+    }
+    if (delta->hashes) {
+        size_t pages = (delta->len + page_size() - 1) / page_size();
+        out->hashes = malloc(pages * sizeof(uint64_t));
+        if (!out->hashes) {
+            free(out->pages);
+            arena_release(dst, out->cap);
+            return -1;
+        }
+        memcpy(out->hashes, delta->hashes, pages * sizeof(uint64_t));
+    }
+    out->start = delta->start;
+    out->len = delta->len;
+    out->data = dst;
+    out->gen = delta->gen;
+    return 0;
+}
+
+/**
+ * Free the deltas of a generation.
+ */
+static void free_deltas(region_delta_t *deltas, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        free(deltas[i].payload);
+        free(deltas[i].pages);
+        free(deltas[i].hashes);
+    }
+    free(deltas);
+}
+
+/**
+ * Build a lookup table of the regions of a generation by start address.
+ */
+static hash_map_t *map_regions(mem_region_t *regions, size_t count) {
+    hash_map_t *map = hash_map_create(count > 0 ? count * 2 - 1 : 16);
+    if (!map) {
+        return NULL;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (regions[i].data) {
+            hash_map_put(map, regions[i].start, &regions[i]);
+        }
+    }
+    return map;
+}
+
+/**
+ * Encode every region of a generation against its successor.
+ *
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int encode_gen(const history_gen_t *gen,  // [in]
+                      const history_gen_t *next, // [in]
+                      region_delta_t **deltas,   // [out]
+                      size_t *delta_count        // [out]
+) {
+    hash_map_t *next_map = map_regions(next->regions, next->count);
+    region_delta_t *out = calloc(gen->count ? gen->count : 1, sizeof(*out));
+    if (!next_map || !out) {
+        hash_map_destroy(next_map);
+        free(out);
+        return -1;
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < gen->count; i++) {
+        const mem_region_t *r = &gen->regions[i];
+        if (!r->data) {
+            continue;
+        }
+        const mem_region_t *ref = hash_map_get(next_map, r->start);
+        if (ref && ref->len != r->len) {
+            ref = NULL;
+        }
+        if (encode_region(r, ref, &out[n]) != 0) {
+            hash_map_destroy(next_map);
+            free_deltas(out, n);
+            return -1;
+        }
+        n++;
+    }
+    hash_map_destroy(next_map);
+
+    *deltas = out;
+    *delta_count = n;
+    return 0;
+}
+
+/**
+ * Decode a whole generation on top of the regions of its successor.
+ *
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int decode_gen(const history_gen_t *gen, // [in]
+                      mem_region_t *next,       // [in]
+                      size_t next_count,        // [in]
+                      mem_region_t **regions,   // [out]
+                      size_t *count             // [out]
+) {
+    hash_map_t *next_map = map_regions(next, next_count);
+    mem_region_t *out =
+        calloc(gen->delta_count ? gen->delta_count : 1, sizeof(*out));
+    if (!next_map || !out) {
+        hash_map_destroy(next_map);
+        free(out);
+        return -1;
+    }
+
+    for (size_t i = 0; i < gen->delta_count; i++) {
+        const region_delta_t *delta = &gen->deltas[i];
+        const mem_region_t *ref =
+            delta->has_ref ? hash_map_get(next_map, delta->start) : NULL;
+        if (decode_region(delta, ref, &out[i]) != 0) {
+            hash_map_destroy(next_map);
+            free_mem_regions(out, i);
+            return -1;
+        }
+    }
+    hash_map_destroy(next_map);
+
+    *regions = out;
+    *count = gen->delta_count;
+    return 0;
+}
+
+/**
+ * Background thread encoding queued generations, oldest first.
+ */
+static void *compressor_fn(void *arg) {
+    history_t *h = arg;
+
+    pthread_mutex_lock(&h->lock);
+    while (!h->stop) {
+        // The oldest queued generation (its successor is always still full,
+        // because it is queued after it and generations are encoded in order)
+        history_gen_t *gen = NULL, *next = NULL;
+        for (size_t i = 0; i + 1 < h->count; i++) {
+            if (h->gens[i]->queued) {
+                gen = h->gens[i];
+                next = h->gens[i + 1];
+                break;
+            }
+        }
+        if (!gen) {
+            pthread_cond_wait(&h->cv, &h->lock);
+            continue;
+        }
+        h->busy = gen;
+        pthread_mutex_unlock(&h->lock);
+
+        region_delta_t *deltas = NULL;
+        size_t delta_count = 0;
+        int rc = encode_gen(gen, next, &deltas, &delta_count);
+
+        pthread_mutex_lock(&h->lock);
+        if (rc == 0) {
+            gen->deltas = deltas;
+            gen->delta_count = delta_count;
+        }
+        // On failure the generation simply stays uncompressed
+        gen->queued = false;
+        h->busy = NULL;
+        pthread_cond_broadcast(&h->cv);
+    }
+    pthread_mutex_unlock(&h->lock);
+    return NULL;
+}
+
+/**
+ * Initialize an empty history and start its compressor thread.
+ *
+ * @param h The history to initialize.
+ * @param limit Maximum number of generations to keep (at least 2).
+ * @return 0 on success, or an error code on failure.
+ */
+int history_init(history_t *h, size_t limit) {
+    memset(h, 0, sizeof(*h));
+    h->limit = limit < 2 ? 2 : limit;
+    pthread_mutex_init(&h->lock, NULL);
+    pthread_cond_init(&h->cv, NULL);
+    int rc = pthread_create(&h->thread, NULL, compressor_fn, h);
+    if (rc != 0) {
+        pthread_mutex_destroy(&h->lock);
+        pthread_cond_destroy(&h->cv);
+        return rc;
+    }
+    h->running = true;
+    return 0;
+}
+
+/**
+ * Release a generation and its cached materialization (if any).
+ * The compressor must not be working on it.
+ */
+static void drop_gen(history_t *h, history_gen_t *gen) {
+    for (size_t c = 0; c < HISTORY_CACHE_SLOTS; c++) {
+        if (h->cache[c].regions && h->cache[c].id == gen->id) {
+            free_mem_regions(h->cache[c].regions, h->cache[c].count);
+            memset(&h->cache[c], 0, sizeof(h->cache[c]));
+            if (h->last == &h->cache[c]) {
+                h->last = NULL;
+            }
+        }
+    }
+    free_mem_regions(gen->regions, gen->count);
+    free_deltas(gen->deltas, gen->delta_count);
+    free(gen);
+}
+
+/**
+ * Stop the compressor and free every generation.
+ *
+ * @param h The history to free.
+ */
+void history_free(history_t *h) {
+    if (!h->running) {
+        return;
+    }
+    pthread_mutex_lock(&h->lock);
+    h->stop = true;
+    pthread_cond_broadcast(&h->cv);
+    pthread_mutex_unlock(&h->lock);
+    pthread_join(h->thread, NULL);
+
+    for (size_t i = 0; i < h->count; i++) {
+        drop_gen(h, h->gens[i]);
+    }
+    free(h->gens);
+    pthread_mutex_destroy(&h->lock);
+    pthread_cond_destroy(&h->cv);
+    memset(h, 0, sizeof(*h));
+}
+
+/**
+ * Drop the oldest generations until at most `limit` are left, waiting for
+ * the compressor if it is working on one of them. Called with the lock held.
+ */
+static void enforce_limit(history_t *h) {
+    while (h->count > h->limit) {
+        history_gen_t *victim = h->gens[0];
+        while (h->busy == victim) {
+            pthread_cond_wait(&h->cv, &h->lock);
+        }
+        memmove(h->gens, h->gens + 1, (h->count - 1) * sizeof(*h->gens));
+        h->count--;
+        drop_gen(h, victim);
+    }
+}
+
+/**
+ * Add a new (newest) generation. The history takes ownership of the regions.
+ * The previous newest generation is queued for compression, and the full
+ * buffers of generations whose delta is ready are released.
+ *
+ * NOTE: Region pointers returned by history_get() stay valid until the next
+ * history_push(), history_set_limit() or history_free(), or until two more
+ * history_get() calls. The generation returned last is never evicted from
+ * the cache, so the results of two calls in a row can be used together.
+ *
+ * @param h The history.
+ * @param regions Regions of the new generation.
+ * @param count Number of regions.
+ * @return 0 on success, or an error code on failure.
+ */
+int history_push(history_t *h, mem_region_t *regions, size_t count) {
+    history_gen_t *gen = calloc(1, sizeof(*gen));
+    if (!gen) {
+        return ENOMEM;
+    }
+    gen->regions = regions;
+    gen->count = count;
+    gen->hash_only = count > 0;
+    for (size_t i = 0; i < count; i++) {
+        gen->hash_only &= !regions[i].data;
+    }
+
+    pthread_mutex_lock(&h->lock);
+    if (h->count == h->capacity) {
+        size_t new_capacity = h->capacity ? h->capacity * 2 : 8;
+        history_gen_t **tmp =
+            realloc(h->gens, new_capacity * sizeof(*h->gens));
+        if (!tmp) {
+            pthread_mutex_unlock(&h->lock);
+            free(gen);
+            return ENOMEM;
+        }
+        h->gens = tmp;
+        h->capacity = new_capacity;
+    }
+    gen->id = h->next_id++;
+    h->gens[h->count++] = gen;
+
+    // Release full buffers that are no longer needed
+    for (size_t i = 0; i + 2 < h->count; i++) {
+        history_gen_t *g = h->gens[i];
+        if (g->regions && g->deltas && g != h->busy) {
+            free_mem_regions(g->regions, g->count);
+            g->regions = NULL;
+            g->count = 0;
+        }
+    }
+
+    // The former newest generation now has a successor to encode against
+    if (h->count >= 2 && !h->gens[h->count - 2]->hash_only) {
+        h->gens[h->count - 2]->queued = true;
+        pthread_cond_broadcast(&h->cv);
+    }
+    enforce_limit(h);
+    pthread_mutex_unlock(&h->lock);
+    return 0;
+}
+
+/**
+ * Change the number of generations kept, dropping the oldest if needed.
+ */
+void history_set_limit(history_t *h, size_t limit) {
+    pthread_mutex_lock(&h->lock);
+    h->limit = limit < 2 ? 2 : limit;
+    enforce_limit(h);
+    pthread_mutex_unlock(&h->lock);
+}
+
+/**
+ * Find the index of a generation by id, or h->count if it isn't there.
+ */
+static size_t find_gen(const history_t *h, uint64_t id) {
+    for (size_t i = 0; i < h->count; i++) {
+        if (h->gens[i]->id == id) {
+            return i;
+        }
+    }
+    return h->count;
+}
+
+/**
+ * Look up a materialized generation in the cache.
+ */
+static history_cache_t *cache_lookup(history_t *h, uint64_t id) {
+    for (size_t c = 0; c < HISTORY_CACHE_SLOTS; c++) {
+        if (h->cache[c].regions && h->cache[c].id == id) {
+            h->cache[c].last_use = ++h->use_clock;
+            return &h->cache[c];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Store a materialized generation in the least recently used cache slot,
+ * other than the one history_get() returned last (its caller may still be
+ * using it).
+ *
+ * @return The slot used.
+ */
+static history_cache_t *cache_store(history_t *h, uint64_t id,
+                                    mem_region_t *regions, size_t count) {
+    history_cache_t *slot = NULL;
+    for (size_t c = 0; c < HISTORY_CACHE_SLOTS; c++) {
+        if (&h->cache[c] != h->last &&
+            (!slot || h->cache[c].last_use < slot->last_use)) {
+            slot = &h->cache[c];
+        }
+    }
+    free_mem_regions(slot->regions, slot->count);
+    *slot = (history_cache_t){.id = id,
+                              .regions = regions,
+                              .count = count,
+                              .last_use = ++h->use_clock};
+    return slot;
+}
+
+/**
+ * history_get() with the lock held.
+ */
+static int get_gen(history_t *h, uint64_t id, mem_region_t **regions,
+                   size_t *count) {
+    size_t idx = find_gen(h, id);
+    if (idx == h->count) {
+        return ENOENT;
+    }
+    if (h->gens[idx]->regions) {
+        h->last = NULL;
+        *regions = h->gens[idx]->regions;
+        *count = h->gens[idx]->count;
+        return 0;
+    }
+    history_cache_t *hit = cache_lookup(h, id);
+    if (hit) {
+        h->last = hit;
+        *regions = hit->regions;
+        *count = hit->count;
+        return 0;
+    }
+
+    // Find the nearest successor we have in full, then walk back down
+    size_t j = idx + 1;
+    mem_region_t *ref = NULL;
+    size_t ref_count = 0;
+    for (; j < h->count; j++) {
+        if (h->gens[j]->regions) {
+            ref = h->gens[j]->regions;
+            ref_count = h->gens[j]->count;
+            break;
+        }
+        history_cache_t *c = cache_lookup(h, h->gens[j]->id);
+        if (c) {
+            ref = c->regions;
+            ref_count = c->count;
+            break;
+        }
+    }
+    if (!ref) {
+        return ENOENT; // can't happen, the newest is always full
+    }
+
+    bool ref_owned = false; // ref is a temporary of this walk
+    for (size_t m = j; m-- > idx;) {
+        mem_region_t *out = NULL;
+        size_t out_count = 0;
+        int rc = decode_gen(h->gens[m], ref, ref_count, &out, &out_count);
+        if (ref_owned) {
+            free_mem_regions(ref, ref_count);
+        }
+        if (rc != 0) {
+            return ENOMEM;
+        }
+        ref = out;
+        ref_count = out_count;
+        ref_owned = true;
+    }
+
+    h->last = cache_store(h, id, ref, ref_count);
+    *regions = ref;
+    *count = ref_count;
+    return 0;
+}
+
+/**
+ * Get the regions of any generation. Full generations are returned as-is,
+ * compressed ones are decoded from the nearest full or cached successor and
+ * cached. See history_push() for how long the regions stay valid.
+ *
+ * @param h The history.
+ * @param id Generation id.
+ * @param regions Pointer to store the regions (owned by the history).
+ * @param count Pointer to store the number of regions.
+ * @return 0 on success, ENOENT if there is no such generation, or another
+ * error code on failure.
+ */
+int history_get(history_t *h,           // [in]
+                uint64_t id,            // [in]
+                mem_region_t **regions, // [out]
+                size_t *count           // [out]
+) {
+    pthread_mutex_lock(&h->lock);
+    int rc = get_gen(h, id, regions, count);
+    pthread_mutex_unlock(&h->lock);
+    return rc;
+}
+
+/**
+ * Get the id of the newest generation.
+ *
+ * @return false if the history is empty.
+ */
+bool history_newest(const history_t *h, uint64_t *id) {
+    if (h->count == 0) {
+        return false;
+    }
+    *id = h->gens[h->count - 1]->id;
+    return true;
+}
+
+/**
+ * Get the id of the generation before the newest one.
+ *
+ * @return false if there are fewer than two generations.
+ */
+bool history_previous(const history_t *h, uint64_t *id) {
+    if (h->count < 2) {
+        return false;
+    }
+    *id = h->gens[h->count - 2]->id;
+    return true;
+}
+
+/**
+ * Memory used by the n-th oldest generation, for display.
+ *
+ * @param h The history.
+ * @param index Position of the generation, 0 being the oldest.
+ * @param compressed Pointer to store whether it is held as a delta only.
+ * @return Number of bytes used.
+ */
+size_t history_gen_bytes(history_t *h, size_t index, bool *compressed) {
+    pthread_mutex_lock(&h->lock);
+    history_gen_t *gen = h->gens[index];
+    size_t bytes = 0;
+    *compressed = gen->regions == NULL;
+    if (gen->regions) {
+        for (size_t i = 0; i < gen->count; i++) {
+            const mem_region_t *r = &gen->regions[i];
+            bytes += r->data ? r->len : 0;
+            bytes += r->hashes ? (r->len + page_size() - 1) / page_size() *
+                                     sizeof(uint64_t)
+                               : 0;
+        }
+    } else {
+        for (size_t i = 0; i < gen->delta_count; i++) {
+            const region_delta_t *d = &gen->deltas[i];
+            bytes += d->payload_len;
+            bytes += d->hashes ? (d->len + page_size() - 1) / page_size() *
+                                     sizeof(uint64_t)
+                               : 0;
+        }
+    }
+    pthread_mutex_unlock(&h->lock);
+    return bytes;
+}
+
+/**
+ * Check whether a generation holds page hashes only.
+ *
+ * @return true if the generation exists and has no data.
+ */
+bool history_hash_only(history_t *h, uint64_t id) {
+    pthread_mutex_lock(&h->lock);
+    size_t idx = find_gen(h, id);
+    bool hash_only = idx < h->count && h->gens[idx]->hash_only;
+    pthread_mutex_unlock(&h->lock);
+    return hash_only;
+}
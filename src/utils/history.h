@@ -0,0 +1,83 @@
+// src/utils/history.h
+#pragma once
+#include "probe.h" // mem_region_t
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * N-generation snapshot history.
+ * The newest generation is always kept as full region buffers. Once a newer
+ * one arrives, a background thread encodes the older one as an XOR/RLE delta
+ * against its successor and its full buffers are released on the next push.
+ * Any generation can be materialized back on demand by applying the deltas
+ * from the nearest full (or cached) successor downwards.
+ * Hash-only generations are small already and stay as they are; the
+ * generation before one is encoded against zeros.
+ */
+
+// XOR/RLE delta of one region against the same region of the successor
+typedef struct {
+    uintptr_t start;
+    size_t len;
+    uint64_t gen;
+    uint8_t *pages;    // copy of the page states, NULL if all PAGE_DATA
+    uint64_t *hashes;  // copy of the page hashes, NULL if none
+    bool has_ref;      // false: encoded against zeros (no such successor)
+    uint8_t *payload;  // (varint zero run, varint literal len, literal)*
+    size_t payload_len;
+} region_delta_t;
+
+// A single generation of the history
+typedef struct {
+    uint64_t id;            // user-visible generation number
+    mem_region_t *regions;  // full buffers, NULL once compressed and reaped
+    size_t count;
+    region_delta_t *deltas; // set by the compressor
+    size_t delta_count;
+    bool queued;            // waiting for or under compression
+    bool hash_only;         // page hashes only, never compressed
+} history_gen_t;
+
+// A materialized copy of a compressed generation
+typedef struct {
+    uint64_t id;
+    mem_region_t *regions;
+    size_t count;
+    uint64_t last_use;
+} history_cache_t;
+
+#define HISTORY_CACHE_SLOTS 2
+#define HISTORY_DEFAULT_LIMIT 8
+
+typedef struct {
+    history_gen_t **gens; // oldest first
+    size_t count;
+    size_t capacity;
+    size_t limit; // maximum number of generations kept
+    uint64_t next_id;
+
+    history_cache_t cache[HISTORY_CACHE_SLOTS];
+    history_cache_t *last; // returned by the last history_get(), or NULL
+    uint64_t use_clock;
+
+    // Background compressor
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cv;
+    bool running;
+    bool stop;
+    history_gen_t *busy; // generation being encoded right now
+} history_t;
+
+int history_init(history_t *h, size_t limit);
+void history_free(history_t *h);
+int history_push(history_t *h, mem_region_t *regions, size_t count);
+int history_get(history_t *h, uint64_t id, mem_region_t **regions,
+                size_t *count);
+bool history_newest(const history_t *h, uint64_t *id);
+bool history_previous(const history_t *h, uint64_t *id);
+void history_set_limit(history_t *h, size_t limit);
+size_t history_gen_bytes(history_t *h, size_t index, bool *compressed);
+bool history_hash_only(history_t *h, uint64_t id);
@@ -0,0 +1,372 @@
+// src/utils/narrow.c
+#include "narrow.h"
+#include "threadpool.h"
+#include <float.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * NOTE:
+ * Every block of the candidate set is one pool task. A task walks its
+ * candidates in address order and coalesces those close to each other into
+ * one remote range, so a dense block costs a handful of large ranges and a
+ * sparse one a range per candidate. All ranges of the block are then read
+ * with peek_vec() (up to IOV_MAX per syscall) into one local buffer, and a
+ * second walk over the candidates filters them into a new block. A range
+ * that couldn't be read completely has its candidates re-read one at a
+ * time, so an unreadable page only drops the candidates on it.
+ */
+
+// Candidates at most this far apart share one remote range
+#define NARROW_GAP 256
+
+/**
+ * Load a little-endian unsigned value of 1, 2, 4 or 8 bytes.
+ *
+ * @param p Pointer to the value.
+ * @param size Size of the value.
+ * @return The value, zero-extended.
+ */
+uint64_t narrow_load(const uint8_t *p, size_t size) {
+    uint64_t value = 0;
+    memcpy(&value, p, size < sizeof(value) ? size : sizeof(value));
+    return value;
+}
+
+/**
+ * Sign-extend an integer of 1, 2, 4 or 8 bytes.
+ *
+ * @param value The value, zero-extended.
+ * @param size Size of the value.
+ * @return The value as a signed integer.
+ */
+int64_t narrow_signed(uint64_t value, size_t size) {
+    unsigned shift = 64 - (unsigned)size * 8;
+    return (int64_t)(value << shift) >> shift;
+}
+
+/**
+ * Convert the bits of a float (4 bytes) or double (8 bytes) to a double,
+ * with denormals flushed to zero like the search kernels do.
+ */
+static double narrow_float(uint64_t bits, size_t size) {
+    if (size == sizeof(float)) {
+        float f;
+        uint32_t b = (uint32_t)bits;
+        memcpy(&f, &b, sizeof(f));
+        return f > -FLT_MIN && f < FLT_MIN ? 0.0 : f;
+    }
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d > -DBL_MIN && d < DBL_MIN ? 0.0 : d;
+}
+
+/**
+ * Check whether a floating-point candidate passes a filter. Ordered
+ * compares only, so a NaN passes none of them.
+ */
+static bool filter_match_float(const narrow_filter_t *filter, size_t size,
+                               uint64_t before_bits, uint64_t now_bits) {
+    double before = narrow_float(before_bits, size);
+    double now = narrow_float(now_bits, size);
+    double value = size == sizeof(float) ? (float)filter->fvalue
+                                         : filter->fvalue;
+    switch (filter->op) {
+    case NARROW_EQ:
+        return now == value;
+    case NARROW_NE:
+        return now < value || now > value;
+    case NARROW_GT:
+        return now > value;
+    case NARROW_LT:
+        return now < value;
+    case NARROW_CHANGED:
+        return now < before || now > before;
+    case NARROW_UNCHANGED:
+        return now == before;
+    case NARROW_INCREASED:
+        return now > before;
+    case NARROW_DECREASED:
+        return now < before;
+    }
+    return false;
+}
+
+/**
+ * Check whether a signed integer candidate passes a filter.
+ */
+static bool filter_match_signed(const narrow_filter_t *filter, size_t size,
+                                uint64_t before_bits, uint64_t now_bits) {
+    int64_t before = narrow_signed(before_bits, size);
+    int64_t now = narrow_signed(now_bits, size);
+    int64_t value = narrow_signed(filter->value, size);
+    switch (filter->op) {
+    case NARROW_EQ:
+        return now == value;
+    case NARROW_NE:
+        return now != value;
+    case NARROW_GT:
+        return now > value;
+    case NARROW_LT:
+        return now < value;
+    case NARROW_CHANGED:
+        return now != before;
+    case NARROW_UNCHANGED:
+        return now == before;
+    case NARROW_INCREASED:
+        return now > before;
+    case NARROW_DECREASED:
+        return now < before;
+    }
+    return false;
+}
+
+/**
+ * Check whether a candidate passes a filter.
+ *
+ * @param filter The filter.
+ * @param size Size of the candidate.
+ * @param before Previous value of the candidate.
+ * @param now Current value of the candidate.
+ * @return true if it passes.
+ */
+static bool filter_match(const narrow_filter_t *filter, size_t size,
+                         uint64_t before, uint64_t now) {
+    if (filter->floating) {
+        return filter_match_float(filter, size, before, now);
+    }
+    if (filter->is_signed) {
+        return filter_match_signed(filter, size, before, now);
+    }
+    switch (filter->op) {
+    case NARROW_EQ:
+        return now == filter->value;
+    case NARROW_NE:
+        return now != filter->value;
+    case NARROW_GT:
+        return now > filter->value;
+    case NARROW_LT:
+        return now < filter->value;
+    case NARROW_CHANGED:
+        return now != before;
+    case NARROW_UNCHANGED:
+        return now == before;
+    case NARROW_INCREASED:
+        return now > before;
+    case NARROW_DECREASED:
+        return now < before;
+    }
+    return false;
+}
+
+// Shared context of the narrow_candidates() tasks
+typedef struct {
+    pid_t pid;
+    const candset_t *set;
+    const size_t *first; // index of the first candidate of every block
+    const uint8_t *old_values;
+    uint64_t old_const;
+    const narrow_filter_t *filter;
+    cand_block_t *blocks; // narrowed block of every task
+    uint8_t **values;     // values of the narrowed block of every task
+    bool *failed;         // allocation failure of every task
+    peek_stats_t *stats;  // read counters of every worker
+} narrow_ctx_t;
+
+/**
+ * Task function of narrow_candidates(): re-read and filter one block.
+ */
+static void narrow_task_fn(void *arg, size_t task, size_t worker) {
+    narrow_ctx_t *c = arg;
+    const candset_t *set = c->set;
+    const cand_block_t *block = &set->blocks[task];
+    const size_t es = set->elem_size;
+    const size_t max_span = peek_tuning().chunk_size;
+    cand_block_t *out = &c->blocks[task];
+    cand_block_init(out, block->start, block->len);
+
+    // Coalesce the candidates into remote ranges
+    struct iovec *spans = malloc(block->count * sizeof(*spans));
+    bool *ok = malloc(block->count * sizeof(*ok));
+    uint8_t *values = malloc(block->count * es);
+    if (!spans || !ok || !values) {
+        goto fail;
+    }
+    size_t nspans = 0, total = 0;
+    uintptr_t span_start = 0, span_end = 0, addr;
+    cand_iter_t it;
+    cand_iter_init_block(&it, set, task);
+    while (cand_iter_next(&it, &addr)) {
+        if (nspans > 0 && addr <= span_end + NARROW_GAP &&
+            addr + es - span_start <= max_span) {
+            span_end = addr + es;
+            spans[nspans - 1].iov_len = span_end - span_start;
+            continue;
+        }
+        if (nspans > 0) {
+            total += spans[nspans - 1].iov_len;
+        }
+        span_start = addr;
+        span_end = addr + es;
+        spans[nspans++] = (struct iovec){.iov_base = (void *)span_start,
+                                         .iov_len = es};
+    }
+    total += spans[nspans - 1].iov_len;
+
+    uint8_t *buf = malloc(total);
+    if (!buf) {
+        goto fail;
+    }
+    peek_vec(c->pid, spans, nspans, buf, ok, &c->stats[worker]);
+
+    // Walk the candidates again, along with the ranges holding them
+    size_t s = 0, local = 0, k = c->first[task], kept = 0;
+    cand_iter_init_block(&it, set, task);
+    while (cand_iter_next(&it, &addr)) {
+        uintptr_t base = (uintptr_t)spans[s].iov_base;
+        while (addr + es > base + spans[s].iov_len) {
+            local += spans[s++].iov_len;
+            base = (uintptr_t)spans[s].iov_base;
+        }
+        uint64_t before = c->old_values
+                              ? narrow_load(c->old_values + k * es, es)
+                              : c->old_const;
+        k++;
+        const uint8_t *p = buf + local + (addr - base);
+        uint8_t single[8];
+        if (!ok[s]) {
+            if (peek_mem(c->pid, addr, single, es, &c->stats[worker]) != es) {
+                continue; // not readable anymore
+            }
+            p = single;
+        }
+        if (!filter_match(c->filter, es, before, narrow_load(p, es))) {
+            continue;
+        }
+        if (cand_block_push(out, set->align, addr) != 0) {
+            free(buf);
+            goto fail;
+        }
+        memcpy(values + kept++ * es, p, es);
+    }
+
+    free(buf);
+    free(spans);
+    free(ok);
+    c->values[task] = values;
+    return;
+
+fail:
+    c->failed[task] = true;
+    free(spans);
+    free(ok);
+    free(values);
+}
+
+/**
+ * Re-read the candidates of a set from the live process and keep those that
+ * pass a filter. Candidates that can't be read anymore are dropped.
+ *
+ * @param pid Target process ID.
+ * @param set The candidates to narrow down.
+ * @param old_values Previous value of every candidate (elem_size bytes
+ *                   each, in set order), or NULL if all were old_const.
+ * @param old_const Previous value of every candidate if old_values is NULL.
+ * @param filter The filter to apply.
+ * @param out Candidate set to store the survivors in.
+ * @param out_values Pointer to store the current values of the survivors
+ *                   (NULL if there are none).
+ * @param stats Counters to update (syscalls and bytes read).
+ * @return 0 on success, -1 on allocation failure.
+ */
+int narrow_candidates(pid_t pid,                     // [in]
+                      const candset_t *set,          // [in]
+                      const uint8_t *old_values,     // [in]
+                      uint64_t old_const,            // [in]
+                      const narrow_filter_t *filter, // [in]
+                      candset_t *out,                // [out]
+                      uint8_t **out_values,          // [out]
+                      peek_stats_t *stats            // [out]
+) {
+    const size_t es = set->elem_size;
+    const size_t nblocks = set->block_count;
+    candset_init(out, es, set->align);
+    *out_values = NULL;
+    if (nblocks == 0) {
+        return 0;
+    }
+
+    size_t *first = malloc(nblocks * sizeof(*first));
+    cand_block_t *blocks = calloc(nblocks, sizeof(*blocks));
+    uint8_t **values = calloc(nblocks, sizeof(*values));
+    bool *failed = calloc(nblocks, sizeof(*failed));
+    peek_stats_t *worker_stats = calloc(pool_workers(), sizeof(*worker_stats));
+    int rc = 0;
+    if (!first || !blocks || !values || !failed || !worker_stats) {
+        rc = -1;
+        goto out;
+    }
+    for (size_t b = 0, k = 0; b < nblocks; b++) {
+        first[b] = k;
+        k += set->blocks[b].count;
+    }
+
+    narrow_ctx_t ctx = {.pid = pid,
+                        .set = set,
+                        .first = first,
+                        .old_values = old_values,
+                        .old_const = old_const,
+                        .filter = filter,
+                        .blocks = blocks,
+                        .values = values,
+                        .failed = failed,
+                        .stats = worker_stats};
+    pool_run(nblocks, narrow_task_fn, &ctx);
+    for (size_t w = 0; w < pool_workers(); w++) {
+        peek_stats_add(stats, &worker_stats[w]);
+    }
+
+    // Gather the survivors of every block, in block order
+    size_t kept = 0;
+    for (size_t b = 0; b < nblocks; b++) {
+        if (failed[b]) {
+            rc = -1;
+        }
+        kept += blocks[b].count;
+    }
+    if (rc == 0 && kept > 0) {
+        *out_values = malloc(kept * es);
+        if (!*out_values) {
+            rc = -1;
+        }
+    }
+    for (size_t b = 0, k = 0; b < nblocks; b++) {
+        if (rc == 0) {
+            if (blocks[b].count > 0) {
+                memcpy(*out_values + k * es, values[b], blocks[b].count * es);
+                k += blocks[b].count;
+            }
+            if (candset_append(out, &blocks[b]) != 0) {
+                rc = -1;
+            }
+        }
+        cand_block_free(&blocks[b]);
+        free(values[b]);
+    }
+    if (rc != 0) {
+        perror("Failed to narrow the candidates");
+        candset_free(out);
+        free(*out_values);
+        *out_values = NULL;
+    }
+
+out:
+    free(first);
+    free(blocks);
+    free(values);
+    free(failed);
+    free(worker_stats);
+    return rc;
+}
@@ -0,0 +1,39 @@
+// src/utils/narrow.h
+#pragma once
+#include "../datastructure/candset.h"
+#include "peek.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/**
+ * Narrowing ("next scan"): re-read only the candidates of a previous search
+ * from the live process and keep those whose value passes a filter. The
+ * cost of a step depends on the number of candidates, not on the size of
+ * the process.
+ */
+typedef enum {
+    NARROW_EQ,        // now == value
+    NARROW_NE,        // now != value
+    NARROW_GT,        // now > value
+    NARROW_LT,        // now < value
+    NARROW_CHANGED,   // now != before
+    NARROW_UNCHANGED, // now == before
+    NARROW_INCREASED, // now > before
+    NARROW_DECREASED, // now < before
+} narrow_op_t;
+
+typedef struct {
+    narrow_op_t op;
+    uint64_t value;  // operand of NARROW_EQ .. NARROW_LT
+    bool is_signed;  // candidates are signed integers
+    bool floating;   // candidates are floats (4 bytes) or doubles (8 bytes)
+    double fvalue;   // operand of NARROW_EQ .. NARROW_LT if floating
+} narrow_filter_t;
+
+int narrow_candidates(pid_t pid, const candset_t *set,
+                      const uint8_t *old_values, uint64_t old_const,
+                      const narrow_filter_t *filter, candset_t *out,
+                      uint8_t **out_values, peek_stats_t *stats);
+uint64_t narrow_load(const uint8_t *p, size_t size);
+int64_t narrow_signed(uint64_t value, size_t size);
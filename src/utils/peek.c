@@ -0,0 +1,301 @@
+// src/utils/peek.c
+#include "peek.h"
+#include "probe.h"
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+/**
+ * NOTE:
+ * PEEK is the reading counterpart of POKE (see poke.c). Reading a large
+ * range one small process_vm_readv() at a time costs one syscall per chunk,
+ * so we instead hand the kernel up to IOV_MAX remote iovecs per call. The
+ * kernel stops at the first page it can't read and returns what it copied
+ * so far; only the range around that page is then narrowed down by
+ * bisection, and the rest of the batch continues normally.
+ */
+
+// Defaults until peek_autotune() has been run
+static peek_tuning_t g_tuning = {.chunk_size = 65536, .batch = 64};
+
+/**
+ *  Returns a monotonic timestamp in nanoseconds.
+ */
+uint64_t peek_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ *  Adds the counters of `src` to `dst`.
+ */
+void peek_stats_add(peek_stats_t *dst, const peek_stats_t *src) {
+    dst->syscalls += src->syscalls;
+    dst->bytes += src->bytes;
+    dst->skipped += src->skipped;
+    dst->nsec += src->nsec;
+}
+
+/**
+ *  Issues a single process_vm_readv() for one contiguous range.
+ *
+ *  @return Bytes read, or 0 if nothing could be read.
+ */
+static size_t read_once(pid_t pid, uintptr_t addr, uint8_t *buf, size_t len,
+                        peek_stats_t *stats) {
+    struct iovec local = {.iov_base = buf, .iov_len = len};
+    struct iovec remote = {.iov_base = (void *)addr, .iov_len = len};
+    ssize_t n = process_vm_readv(pid, &local, 1, &remote, 1, 0);
+    stats->syscalls++;
+    return n > 0 ? (size_t)n : 0;
+}
+
+/**
+ *  Reads a range that is known to contain an unreadable page. The readable
+ *  prefix is taken as-is, and the rest is split in half at a page boundary
+ *  until the unreadable pages are isolated. Those are zero-filled.
+ *
+ *  @return Bytes actually read.
+ */
+static size_t read_bisect(pid_t pid, uintptr_t addr, uint8_t *buf, size_t len,
+                          peek_stats_t *stats) {
+    const size_t PAGE = page_size();
+    size_t total = 0;
+
+    while (len > 0) {
+        size_t n = read_once(pid, addr, buf, len, stats);
+        total += n;
+        if (n == len) {
+            break;
+        }
+        addr += n;
+        buf += n;
+        len -= n;
+
+        // The first byte of what's left can't be read
+        size_t to_page_end = PAGE - (addr % PAGE);
+        if (len <= to_page_end) {
+            memset(buf, 0, len);
+            break;
+        }
+        if (n == 0 && len > 2 * PAGE) {
+            // Nothing came back: probe both halves separately
+            size_t half = ((len / 2) + PAGE - 1) / PAGE * PAGE;
+            total += read_bisect(pid, addr, buf, half, stats);
+            addr += half;
+            buf += half;
+            len -= half;
+            continue;
+        }
+
+        // Skip the faulting page and retry the remainder
+        memset(buf, 0, to_page_end);
+        addr += to_page_end;
+        buf += to_page_end;
+        len -= to_page_end;
+    }
+    return total;
+}
+
+/**
+ *  Reads `len` bytes at `addr` of the target into `buf` using batched
+ *  multi-iovec process_vm_readv() calls. Pages that can't be read are
+ *  zero-filled in `buf`.
+ *
+ *  @param pid Target process ID.
+ *  @param addr Remote address to start reading from.
+ *  @param buf Local buffer of at least `len` bytes.
+ *  @param len Number of bytes to read.
+ *  @param stats Counters to update (syscalls and bytes).
+ *  @return The number of bytes actually read.
+ */
+size_t peek_mem(pid_t pid,           // [in]
+                uintptr_t addr,      // [in]
+                void *buf,           // [out]
+                size_t len,          // [in]
+                peek_stats_t *stats) // [out]
+{
+    const size_t CHUNK = g_tuning.chunk_size;
+    const size_t BATCH = g_tuning.batch;
+    struct iovec remote[IOV_MAX];
+    uint8_t *out = buf;
+    size_t total = 0;
+
+    size_t offset = 0;
+    while (offset < len) {
+        // Pack up to BATCH chunks into one call
+        size_t iovcnt = 0, span = 0;
+        while (iovcnt < BATCH && offset + span < len) {
+            size_t chunk = len - offset - span;
+            if (chunk > CHUNK) {
+                chunk = CHUNK;
+            }
+            remote[iovcnt].iov_base = (void *)(addr + offset + span);
+            remote[iovcnt].iov_len = chunk;
+            span += chunk;
+            iovcnt++;
+        }
+
+        // The local side is contiguous, so a single iovec covers it
+        struct iovec local = {.iov_base = out + offset, .iov_len = span};
+        ssize_t n = process_vm_readv(pid, &local, 1, remote, iovcnt, 0);
+        stats->syscalls++;
+        if (n < 0 && errno != EFAULT) {
+            // The process is gone or we lost permission, don't bisect
+            memset(out + offset, 0, len - offset);
+            break;
+        }
+
+        size_t got = n > 0 ? (size_t)n : 0;
+        total += got;
+        if (got < span) {
+            // Narrow down the failing chunk only, then resume after it
+            size_t fail_off = offset + got;
+            size_t chunk_end = offset + (got / CHUNK + 1) * CHUNK;
+            if (chunk_end > offset + span) {
+                chunk_end = offset + span;
+            }
+            total += read_bisect(pid, addr + fail_off, out + fail_off,
+                                 chunk_end - fail_off, stats);
+            span = chunk_end - offset;
+        }
+        offset += span;
+    }
+
+    stats->bytes += total;
+    return total;
+}
+
+/**
+ *  Reads many small remote ranges into one contiguous local buffer, packing
+ *  up to IOV_MAX of them into each process_vm_readv() call. A range the
+ *  kernel stops at is retried on its own (unreadable pages zero-filled) and
+ *  marked as not read, the rest of the batch continues normally.
+ *
+ *  @param pid Target process ID.
+ *  @param remote Remote ranges, back to back in `buf`.
+ *  @param n Number of remote ranges.
+ *  @param buf Local buffer of at least the summed length of the ranges.
+ *  @param ok Set for every range that was read completely.
+ *  @param stats Counters to update (syscalls and bytes).
+ *  @return The number of bytes actually read.
+ */
+size_t peek_vec(pid_t pid,                  // [in]
+                const struct iovec *remote, // [in]
+                size_t n,                   // [in]
+                void *buf,                  // [out]
+                bool *ok,                   // [out]
+                peek_stats_t *stats)        // [out]
+{
+    uint8_t *out = buf;
+    size_t total = 0, offset = 0;
+
+    for (size_t i = 0; i < n;) {
+        size_t iovcnt = n - i < IOV_MAX ? n - i : IOV_MAX;
+        size_t span = 0;
+        for (size_t k = i; k < i + iovcnt; k++) {
+            span += remote[k].iov_len;
+        }
+
+        struct iovec local = {.iov_base = out + offset, .iov_len = span};
+        ssize_t got = process_vm_readv(pid, &local, 1, &remote[i], iovcnt, 0);
+        stats->syscalls++;
+        if (got < 0 && errno != EFAULT) {
+            // The process is gone or we lost permission
+            for (size_t k = i; k < n; k++) {
+                ok[k] = false;
+            }
+            break;
+        }
+
+        // Every range before the one the kernel stopped at is complete
+        // (EFAULT on the very first page means none of them is)
+        size_t read_n = got > 0 ? (size_t)got : 0;
+        size_t done = 0, k = i;
+        while (k < i + iovcnt && done + remote[k].iov_len <= read_n) {
+            ok[k] = true;
+            done += remote[k++].iov_len;
+        }
+        total += done;
+        if (k < i + iovcnt) {
+            size_t len = remote[k].iov_len;
+            size_t read = read_bisect(pid, (uintptr_t)remote[k].iov_base,
+                                      out + offset + done, len, stats);
+            ok[k] = read == len;
+            total += read;
+            done += len;
+            k++;
+        }
+        offset += done;
+        i = k;
+    }
+
+    stats->bytes += total;
+    return total;
+}
+
+/**
+ *  Picks the chunk size and batch size for peek_mem() by timing a short
+ *  calibration read of (at most 4 MiB of) the given range.
+ *
+ *  @param pid Target process ID.
+ *  @param addr Start of a readable range in the target.
+ *  @param len Length of that range.
+ */
+void peek_autotune(pid_t pid, uintptr_t addr, size_t len) {
+    static const size_t chunks[] = {16384, 65536, 262144, 1048576};
+    static const size_t batches[] = {1, 16, 64, IOV_MAX};
+    const size_t SAMPLE = 4 << 20;
+
+    if (len > SAMPLE) {
+        len = SAMPLE;
+    }
+    if (len == 0) {
+        return;
+    }
+    uint8_t *scratch = malloc(len);
+    if (!scratch) {
+        return;
+    }
+
+    // Warm up the target's page tables and our scratch buffer
+    peek_stats_t stats = {0};
+    peek_mem(pid, addr, scratch, len, &stats);
+
+    peek_tuning_t best = g_tuning;
+    uint64_t best_ns = UINT64_MAX;
+    for (size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+        for (size_t b = 0; b < sizeof(batches) / sizeof(batches[0]); b++) {
+            if (chunks[c] * batches[b] / 2 > len && b > 0) {
+                continue; // larger batches can't be told apart
+            }
+            g_tuning = (peek_tuning_t){.chunk_size = chunks[c],
+                                       .batch = batches[b]};
+            uint64_t t0 = peek_now_ns();
+            peek_mem(pid, addr, scratch, len, &stats);
+            uint64_t elapsed = peek_now_ns() - t0;
+            if (elapsed < best_ns) {
+                best_ns = elapsed;
+                best = g_tuning;
+            }
+        }
+    }
+
+    g_tuning = best;
+    free(scratch);
+}
+
+/**
+ *  Returns the chunk/batch shape currently used by peek_mem().
+ */
+peek_tuning_t peek_tuning(void) { return g_tuning; }
@@ -0,0 +1,30 @@
+// src/utils/peek.h
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+// Counters of a (batched) read from a target process
+typedef struct {
+    size_t syscalls; // number of process_vm_readv calls issued
+    size_t bytes;    // bytes successfully copied
+    size_t skipped;  // bytes not read because pagemap showed them as holes
+    uint64_t nsec;   // wall-clock time spent, filled in by the caller
+} peek_stats_t;
+
+// Shape of a batched read, picked by peek_autotune()
+typedef struct {
+    size_t chunk_size; // bytes per remote iovec
+    size_t batch;      // remote iovecs per process_vm_readv call
+} peek_tuning_t;
+
+size_t peek_mem(pid_t pid, uintptr_t addr, void *buf, size_t len,
+                peek_stats_t *stats);
+size_t peek_vec(pid_t pid, const struct iovec *remote, size_t n, void *buf,
+                bool *ok, peek_stats_t *stats);
+void peek_autotune(pid_t pid, uintptr_t addr, size_t len);
+peek_tuning_t peek_tuning(void);
+void peek_stats_add(peek_stats_t *dst, const peek_stats_t *src);
+uint64_t peek_now_ns(void);
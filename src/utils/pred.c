@@ -0,0 +1,538 @@
+// src/utils/pred.c
+#include "pred.h"
+#include "simd.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Where a literal lies in the order of the keys of a condition
+typedef enum {
+    LIT_BELOW, // below every key
+    LIT_IN,    // at a key
+    LIT_ABOVE, // above every key
+} lit_pos_t;
+
+// The key of a condition, see pred_insn_t
+typedef struct {
+    uint8_t shift;
+    uint64_t flip, mask;
+    bool is_signed; // x itself, compared as signed
+} pred_key_t;
+
+typedef struct {
+    const char *p; // parse position
+    size_t width;  // bits of the elements
+    bool is_signed;
+    pred_insn_t *code;
+    size_t len, cap;
+    const char *err; // first error, NULL if none
+} pred_parser_t;
+
+static void skip_spaces(pred_parser_t *ps) {
+    while (*ps->p == ' ' || *ps->p == '\t') {
+        ps->p++;
+    }
+}
+
+/**
+ * Consume a token if it comes next.
+ *
+ * @return true if it did.
+ */
+static bool accept(pred_parser_t *ps, const char *tok) {
+    skip_spaces(ps);
+    size_t len = strlen(tok);
+    if (strncmp(ps->p, tok, len) != 0) {
+        return false;
+    }
+    // Words end at a non-identifier character
+    char next = ps->p[len];
+    if (tok[0] >= 'a' && tok[0] <= 'z' &&
+        ((next >= 'a' && next <= 'z') || (next >= '0' && next <= '9') ||
+         next == '_')) {
+        return false;
+    }
+    ps->p += len;
+    return true;
+}
+
+static bool emit(pred_parser_t *ps, pred_insn_t insn) {
+    if (ps->len == ps->cap) {
+        size_t cap = ps->cap ? ps->cap * 2 : 16;
+        pred_insn_t *code = realloc(ps->code, cap * sizeof(*code));
+        if (!code) {
+            ps->err = "out of memory";
+            return false;
+        }
+        ps->code = code;
+        ps->cap = cap;
+    }
+    ps->code[ps->len++] = insn;
+    return true;
+}
+
+/**
+ * Parse a literal: decimal, 0x hex or 0 octal, with an optional minus.
+ *
+ * @param neg Pointer to store whether it is negative.
+ * @param mag Pointer to store its magnitude.
+ * @return true on success.
+ */
+static bool parse_literal(pred_parser_t *ps, bool *neg, uint64_t *mag) {
+    skip_spaces(ps);
+    *neg = *ps->p == '-';
+    const char *start = ps->p + *neg;
+    char *end;
+    errno = 0;
+    *mag = strtoull(start, &end, 0);
+    if (end == start || *start == '-' || *start == '+') {
+        ps->err = "expected a number";
+        return false;
+    }
+    if (errno == ERANGE) {
+        ps->err = "number out of range";
+        return false;
+    }
+    ps->p = end;
+    return true;
+}
+
+/**
+ * Parse the value a condition looks at: x, optionally masked with & and
+ * shifted with >> (in any order, from left to right), in parentheses or
+ * not.
+ */
+static bool parse_value(pred_parser_t *ps, pred_key_t *key) {
+    const uint64_t type_mask =
+        ps->width == 64 ? ~0ULL : (1ULL << ps->width) - 1;
+    if (accept(ps, "(")) {
+        if (!parse_value(ps, key)) {
+            return false;
+        }
+        if (!accept(ps, ")")) {
+            ps->err = "missing )";
+            return false;
+        }
+    } else if (accept(ps, "x")) {
+        *key = (pred_key_t){.mask = type_mask, .is_signed = ps->is_signed};
+        if (ps->is_signed) {
+            key->flip = 1ULL << (ps->width - 1);
+        }
+    } else {
+        ps->err = "expected x";
+        return false;
+    }
+    for (;;) {
+        skip_spaces(ps);
+        bool neg;
+        uint64_t v;
+        if (ps->p[0] == '&' && ps->p[1] != '&') {
+            ps->p++;
+            if (!parse_literal(ps, &neg, &v)) {
+                return false;
+            }
+            key->mask &= neg ? 0 - v : v;
+        } else if (accept(ps, ">>")) {
+            if (!parse_literal(ps, &neg, &v)) {
+                return false;
+            }
+            if (neg) {
+                ps->err = "negative shift";
+                return false;
+            }
+            bool gone = v >= ps->width || key->shift + v >= ps->width;
+            key->mask = gone ? 0 : key->mask >> v;
+            key->shift = (uint8_t)(gone ? 0 : key->shift + v);
+        } else {
+            break;
+        }
+        // A masked or shifted x is a plain unsigned number
+        if (key->is_signed) {
+            key->is_signed = false;
+            key->flip = 0;
+        }
+    }
+    return true;
+}
+
+/**
+ * Place a literal in the order of the keys (0 to key->mask, or every value
+ * of x if it is signed).
+ *
+ * @param ord Pointer to store the key it is at, for LIT_IN.
+ */
+static lit_pos_t literal_pos(const pred_key_t *key, bool neg, uint64_t mag,
+                             uint64_t *ord) {
+    if (!key->is_signed) {
+        if (neg && mag > 0) {
+            return LIT_BELOW;
+        }
+        if (mag > key->mask) {
+            return LIT_ABOVE;
+        }
+        *ord = mag;
+        return LIT_IN;
+    }
+    uint64_t max = key->mask >> 1; // the largest signed value
+    if (neg ? mag > max + 1 : mag > max) {
+        return neg ? LIT_BELOW : LIT_ABOVE;
+    }
+    *ord = ((neg ? 0 - mag : mag) ^ key->flip) & key->mask;
+    return LIT_IN;
+}
+
+/**
+ * Narrow the keys [*lo, *hi] a condition passes with one comparison.
+ *
+ * @return false if no key passes anymore.
+ */
+static bool narrow(const char *op, lit_pos_t pos, uint64_t v, uint64_t max,
+                   uint64_t *lo, uint64_t *hi) {
+    uint64_t l = 0, h = max;
+    if (strcmp(op, "==") == 0) {
+        if (pos != LIT_IN) {
+            return false;
+        }
+        l = h = v;
+    } else if (op[0] == '<') {
+        bool strict = op[1] == '\0';
+        if (pos == LIT_BELOW || (pos == LIT_IN && strict && v == 0)) {
+            return false;
+        }
+        h = pos == LIT_ABOVE ? max : v - strict;
+    } else {
+        bool strict = op[1] == '\0';
+        if (pos == LIT_ABOVE || (pos == LIT_IN && strict && v == max)) {
+            return false;
+        }
+        l = pos == LIT_BELOW ? 0 : v + strict;
+    }
+    *lo = l > *lo ? l : *lo;
+    *hi = h < *hi ? h : *hi;
+    return *lo <= *hi;
+}
+
+// Parse a condition into register `reg`
+static bool parse_cond(pred_parser_t *ps, uint8_t reg) {
+    pred_key_t key;
+    if (!parse_value(ps, &key)) {
+        return false;
+    }
+    uint64_t lo = 0, hi = key.mask, v = 0;
+    bool any = true, negate = false, neg;
+    uint64_t mag;
+    static const char *ops[] = {"==", "!=", "<=", ">=", "<", ">"};
+    const char *op = NULL;
+    for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]) && !op; i++) {
+        op = accept(ps, ops[i]) ? ops[i] : NULL;
+    }
+
+    if (op) {
+        negate = strcmp(op, "!=") == 0;
+        if (!parse_literal(ps, &neg, &mag)) {
+            return false;
+        }
+        lit_pos_t pos = literal_pos(&key, neg, mag, &v);
+        any = narrow(negate ? "==" : op, pos, v, key.mask, &lo, &hi);
+    } else if (accept(ps, "in")) {
+        // x in LO..HI, both included
+        if (!parse_literal(ps, &neg, &mag)) {
+            return false;
+        }
+        lit_pos_t pos = literal_pos(&key, neg, mag, &v);
+        any = narrow(">=", pos, v, key.mask, &lo, &hi);
+        if (!accept(ps, "..")) {
+            ps->err = "expected .. in a range";
+            return false;
+        }
+        if (!parse_literal(ps, &neg, &mag)) {
+            return false;
+        }
+        pos = literal_pos(&key, neg, mag, &v);
+        any = narrow("<=", pos, v, key.mask, &lo, &hi) && any;
+    } else {
+        // A bare value tests for any bit set
+        negate = true;
+        lo = hi = key.is_signed ? key.flip : 0;
+    }
+
+    // The key stays where its bits are in x, so the shift goes away
+    const uint64_t type_mask =
+        ps->width == 64 ? ~0ULL : (1ULL << ps->width) - 1;
+    pred_insn_t insn = {.op = PRED_RANGE,
+                        .dst = reg,
+                        .flip = key.flip,
+                        .mask = key.mask << key.shift,
+                        .lo = lo << key.shift,
+                        .end = ((hi - lo) << key.shift) + 1};
+    if (!any) {
+        // Nothing passes: no key is below 0
+        insn = (pred_insn_t){.op = PRED_RANGE, .dst = reg};
+    } else if ((hi - lo) << key.shift == type_mask) {
+        // Everything passes, but end would wrap: key 0 is in [0, 1)
+        insn = (pred_insn_t){.op = PRED_RANGE, .dst = reg, .end = 1};
+    }
+    return emit(ps, insn) &&
+           (!negate ||
+            emit(ps, (pred_insn_t){.op = PRED_NOT, .dst = reg, .a = reg}));
+}
+
+static bool parse_or(pred_parser_t *ps, uint8_t reg);
+
+/**
+ * Check whether a '(' opens a value like "(x & 0xff)" rather than a group.
+ * A value in parentheses alone is also its own bit test, so whatever
+ * parses as a value is one.
+ */
+static bool paren_value(const pred_parser_t *ps) {
+    pred_parser_t probe = *ps;
+    pred_key_t key;
+    return parse_value(&probe, &key);
+}
+
+// Parse a negation, group or condition into register `reg`
+static bool parse_unary(pred_parser_t *ps, uint8_t reg) {
+    if (reg >= PRED_REGS) {
+        ps->err = "expression nested too deep";
+        return false;
+    }
+    if (accept(ps, "!") || accept(ps, "not")) {
+        return parse_unary(ps, reg) &&
+               emit(ps, (pred_insn_t){.op = PRED_NOT, .dst = reg, .a = reg});
+    }
+    skip_spaces(ps);
+    if (*ps->p == '(' && !paren_value(ps)) {
+        ps->p++;
+        if (!parse_or(ps, reg)) {
+            return false;
+        }
+        if (!accept(ps, ")")) {
+            ps->err = "missing )";
+            return false;
+        }
+        return true;
+    }
+    return parse_cond(ps, reg);
+}
+
+/**
+ * Fold the last two instructions into one when they are range tests of the
+ * same key into `reg` and `reg + 1`, the two sides of an and: the keys
+ * that pass both are the intersection, e.g. "x >= -50 && x <= 50" is one
+ * range test.
+ *
+ * @return true if they were folded.
+ */
+static bool merge_ranges(pred_parser_t *ps, uint8_t reg) {
+    if (ps->len < 2) {
+        return false;
+    }
+    pred_insn_t *a = &ps->code[ps->len - 2], *b = &ps->code[ps->len - 1];
+    if (a->op != PRED_RANGE || b->op != PRED_RANGE || a->dst != reg ||
+        b->dst != reg + 1 || a->flip != b->flip || a->mask != b->mask ||
+        a->end == 0 || b->end == 0) {
+        return false;
+    }
+    // Ranges from a comparison never wrap, so [lo, hi] is plain
+    uint64_t lo = a->lo > b->lo ? a->lo : b->lo;
+    uint64_t hi_a = a->lo + (a->end - 1), hi_b = b->lo + (b->end - 1);
+    uint64_t hi = hi_a < hi_b ? hi_a : hi_b;
+    if (lo > hi) {
+        *a = (pred_insn_t){.op = PRED_RANGE, .dst = reg};
+    } else {
+        a->lo = lo;
+        a->end = hi - lo + 1;
+    }
+    ps->len--;
+    return true;
+}
+
+static bool parse_and(pred_parser_t *ps, uint8_t reg) {
+    if (!parse_unary(ps, reg)) {
+        return false;
+    }
+    while (accept(ps, "&&") || accept(ps, "and")) {
+        if (!parse_unary(ps, reg + 1)) {
+            return false;
+        }
+        pred_insn_t insn = {
+            .op = PRED_AND, .dst = reg, .a = reg, .b = reg + 1};
+        if (!merge_ranges(ps, reg) && !emit(ps, insn)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool parse_or(pred_parser_t *ps, uint8_t reg) {
+    if (!parse_and(ps, reg)) {
+        return false;
+    }
+    while (accept(ps, "||") || accept(ps, "or")) {
+        if (!parse_and(ps, reg + 1) ||
+            !emit(ps, (pred_insn_t){
+                          .op = PRED_OR, .dst = reg, .a = reg, .b = reg + 1})) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Compile a predicate. The syntax, loosest binding first:
+ *   a || b, a or b     either
+ *   a && b, a and b    both
+ *   !a, not a, (a)     negation and grouping
+ *   V == N  (!= < <= > >=)   comparison with a literal
+ *   V in LO..HI        LO <= V <= HI
+ *   V                  V != 0 (a bit test)
+ * where V is x, the value of the element, optionally followed by & MASK
+ * and >> SHIFT, e.g. "x & 0xff", "(x >> 4) & 0xf". x compares as signed
+ * for a signed type; once masked or shifted it is unsigned. Literals may
+ * be negative, decimal or 0x hex; a literal out of the range of V makes
+ * its comparison always or never true.
+ *
+ * @param expr The expression.
+ * @param type_size Size of the elements (1, 2, 4 or 8).
+ * @param is_signed The elements are signed.
+ * @param pred Pointer to store the predicate (free it with pred_free()).
+ * @return 0 on success, -1 (with a message) on failure.
+ */
+int pred_compile(const char *expr,  // [in]
+                 size_t type_size,  // [in]
+                 bool is_signed,    // [in]
+                 pred_t *pred       // [out]
+) {
+    memset(pred, 0, sizeof(*pred));
+    if (type_size != 1 && type_size != 2 && type_size != 4 &&
+        type_size != 8) {
+        fprintf(stderr, "ERR: Invalid predicate type size %zu\n", type_size);
+        return -1;
+    }
+    pred_parser_t ps = {
+        .p = expr, .width = type_size * 8, .is_signed = is_signed};
+    if (parse_or(&ps, 0)) {
+        skip_spaces(&ps);
+        if (*ps.p != '\0') {
+            ps.err = "unexpected text";
+        }
+    }
+    if (ps.err) {
+        fprintf(stderr, "ERR: Invalid predicate at \"%s\": %s\n", ps.p,
+                ps.err);
+        free(ps.code);
+        return -1;
+    }
+    pred->type_size = type_size;
+    pred->is_signed = is_signed;
+    pred->code = ps.code;
+    pred->len = ps.len;
+    return 0;
+}
+
+/**
+ * Free the memory of a predicate.
+ */
+void pred_free(pred_t *pred) {
+    free(pred->code);
+    pred->code = NULL;
+    pred->len = 0;
+}
+
+/**
+ * Run a predicate over n consecutive elements, and write the index of
+ * every element that passes to `hits` (room for n entries), in ascending
+ * order, like a cmp_kernel_t.
+ *
+ * @param pred The predicate.
+ * @param data The elements.
+ * @param n Number of elements.
+ * @param hits Pointer to store the indices of the hits.
+ * @return The number of hits.
+ */
+size_t pred_run(const pred_t *pred, const uint8_t *data, size_t n,
+                uint32_t *hits) {
+    uint64_t regs[PRED_REGS][PRED_CHUNK / 64];
+    const size_t es = pred->type_size;
+    const scan_type_t type = es == 1   ? SCAN_TYPE_BYTE
+                             : es == 2 ? SCAN_TYPE_WORD
+                             : es == 4 ? SCAN_TYPE_DWORD
+                                       : SCAN_TYPE_QWORD;
+    range_kernel_t range = range_kernel(simd_level(), type);
+    size_t k = 0;
+    for (size_t base = 0; base < n; base += PRED_CHUNK) {
+        size_t count = n - base < PRED_CHUNK ? n - base : PRED_CHUNK;
+        size_t words = (count + 63) / 64;
+        const uint8_t *chunk = data + base * es;
+        for (size_t i = 0; i < pred->len; i++) {
+            const pred_insn_t *in = &pred->code[i];
+            uint64_t *dst = regs[in->dst];
+            const uint64_t *a = regs[in->a], *b = regs[in->b];
+            switch (in->op) {
+            case PRED_RANGE:
+                range(chunk, count, in->flip, in->mask, in->lo, in->end, dst);
+                break;
+            case PRED_AND:
+                for (size_t w = 0; w < words; w++) {
+                    dst[w] = a[w] & b[w];
+                }
+                break;
+            case PRED_OR:
+                for (size_t w = 0; w < words; w++) {
+                    dst[w] = a[w] | b[w];
+                }
+                break;
+            case PRED_NOT:
+                for (size_t w = 0; w < words; w++) {
+                    dst[w] = ~a[w];
+                }
+                break;
+            }
+        }
+        if (count % 64) {
+            regs[0][words - 1] &= (1ULL << (count % 64)) - 1;
+        }
+        for (size_t w = 0; w < words; w++) {
+            for (uint64_t m = regs[0][w]; m; m &= m - 1) {
+                hits[k++] = (uint32_t)(base + w * 64 + __builtin_ctzll(m));
+            }
+        }
+    }
+    return k;
+}
+
+/**
+ * Test a single element against a predicate, for checking a few elements
+ * where pred_run() would not pay off.
+ *
+ * @param pred The predicate.
+ * @param elem The element (pred->type_size bytes).
+ * @return true if it passes.
+ */
+bool pred_test(const pred_t *pred, const uint8_t *elem) {
+    const size_t width = pred->type_size * 8;
+    const uint64_t type_mask = width == 64 ? ~0ULL : (1ULL << width) - 1;
+    bool regs[PRED_REGS];
+    uint64_t x = 0;
+    memcpy(&x, elem, pred->type_size); // little-endian
+    for (size_t i = 0; i < pred->len; i++) {
+        const pred_insn_t *in = &pred->code[i];
+        switch (in->op) {
+        case PRED_RANGE:
+            regs[in->dst] =
+                ((((x ^ in->flip) & in->mask) - in->lo) & type_mask) < in->end;
+            break;
+        case PRED_AND:
+            regs[in->dst] = regs[in->a] && regs[in->b];
+            break;
+        case PRED_OR:
+            regs[in->dst] = regs[in->a] || regs[in->b];
+            break;
+        case PRED_NOT:
+            regs[in->dst] = !regs[in->a];
+            break;
+        }
+    }
+    return pred->len > 0 && regs[0];
+}
@@ -0,0 +1,56 @@
+// src/utils/pred.h
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Predicates: filter expressions on the value x of every element, such as
+ * "x >= -50 && x <= 50 && (x & 0xff) == 0x7f", compiled once and evaluated
+ * in a single pass. See pred_compile() for the syntax.
+ *
+ * Every condition compiles into a range test on a key of the element,
+ * key = (x ^ flip) & mask, which passes when key - lo < end (unsigned and
+ * wrapped, so one compare covers both bounds). flip is the sign bit for
+ * signed compares, which maps signed onto unsigned order. A shift needs no
+ * instruction of its own: (x >> s) & m compiles to x & (m << s), with the
+ * bounds shifted along. Conditions are combined by and, or and not
+ * instructions on registers.
+ *
+ * The bytecode runs column-wise: every instruction goes over a whole chunk
+ * of elements into a bitmap register, so it is dispatched once per chunk
+ * rather than once per element, and a range test is one vector range
+ * kernel (see range_kernel_t).
+ */
+typedef enum {
+    PRED_RANGE, // dst = key in [lo, lo + end)
+    PRED_AND,   // dst = a & b
+    PRED_OR,    // dst = a | b
+    PRED_NOT,   // dst = ~a
+} pred_opcode_t;
+
+typedef struct {
+    pred_opcode_t op;
+    uint8_t dst, a, b; // registers
+    uint64_t flip, mask;
+    uint64_t lo, end;
+} pred_insn_t;
+
+// Elements a predicate takes at once (the size of a register)
+#define PRED_CHUNK 4096
+// Registers of a predicate, the depth of its expression
+#define PRED_REGS 16
+
+typedef struct {
+    size_t type_size; // 1, 2, 4 or 8
+    bool is_signed;
+    pred_insn_t *code;
+    size_t len;
+} pred_t;
+
+int pred_compile(const char *expr, size_t type_size, bool is_signed,
+                 pred_t *pred);
+void pred_free(pred_t *pred);
+size_t pred_run(const pred_t *pred, const uint8_t *data, size_t n,
+                uint32_t *hits);
+bool pred_test(const pred_t *pred, const uint8_t *elem);
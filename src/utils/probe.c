@@ -1,16 +1,275 @@
 // src/utils/probe.c
 #include "probe.h"
+#include "../datastructure/hashmap.h"
+#include "../datastructure/strtab.h"
+#include "arena.h"
+#include "hash.h"
+#include "peek.h"
+#include "threadpool.h"
 #include <asm-generic/errno-base.h>
-#include <pthread.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <linux/limits.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/uio.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <unistd.h>
 
+/**
+ * NOTE:
+ * Linux 6.11+ answers "which VMA covers (or follows) this address" through
+ * the PROCMAP_QUERY ioctl on /proc/<pid>/maps, which skips formatting and
+ * re-parsing the text of every mapping. The definitions below mirror
+ * <linux/fs.h> for building against older headers.
+ */
+#ifndef PROCMAP_QUERY
+struct procmap_query {
+    uint64_t size;
+    uint64_t query_flags;   // in
+    uint64_t query_addr;    // in
+    uint64_t vma_start;     // out
+    uint64_t vma_end;       // out
+    uint64_t vma_flags;     // out
+    uint64_t vma_page_size; // out
+    uint64_t vma_offset;    // out
+    uint64_t inode;         // out
+    uint32_t dev_major;     // out
+    uint32_t dev_minor;     // out
+    uint32_t vma_name_size; // in/out
+    uint32_t build_id_size; // in/out
+    uint64_t vma_name_addr; // in
+    uint64_t build_id_addr; // in
+};
+#define PROCMAP_QUERY _IOWR('f', 17, struct procmap_query)
+#define PROCMAP_QUERY_VMA_READABLE 0x01
+#define PROCMAP_QUERY_VMA_WRITABLE 0x02
+#define PROCMAP_QUERY_VMA_EXECUTABLE 0x04
+#define PROCMAP_QUERY_VMA_SHARED 0x08
+#define PROCMAP_QUERY_COVERING_OR_NEXT_VMA 0x10
+#endif
+
+// Paths of every VMA seen so far, shared by all VMA lists. Only the thread
+// calling get_vma_list() adds to it.
+static strtab_t *g_vma_paths = NULL;
+
+// Growable list of VMAs under construction
+typedef struct {
+    vma_t *list;
+    size_t count;
+    size_t capacity;
+} vma_vec_t;
+
+/**
+ *  Appends a VMA to a list under construction, interning its path.
+ *
+ *  @param vec      The list to append to.
+ *  @param start    Start address of the VMA.
+ *  @param end      End address of the VMA.
+ *  @param perms    The four permission characters (e.g., "r--p").
+ *  @param path     Path of the VMA (not NUL-terminated).
+ *  @param path_len Length of the path, 0 if none.
+ *  @return 0 on success, or ENOMEM on failure.
+ */
+static int vma_push(vma_vec_t *vec,       // [in/out]
+                    uintptr_t start,      // [in]
+                    uintptr_t end,        // [in]
+                    const char *perms,    // [in]
+                    const char *path,     // [in]
+                    size_t path_len       // [in]
+) {
+    // Resize the list if it's full
+    if (vec->count == vec->capacity) {
+        size_t new_capacity = vec->capacity ? vec->capacity * 2 : 64;
+        vma_t *tmp = realloc(vec->list, new_capacity * sizeof(vma_t));
+        if (!tmp) {
+            return ENOMEM;
+        }
+        vec->list = tmp;
+        vec->capacity = new_capacity;
+    }
+
+    uint32_t offset = strtab_intern(g_vma_paths, path, path_len);
+    if (offset == STRTAB_INVALID) {
+        return ENOMEM;
+    }
+
+    vma_t *vma = &vec->list[vec->count++];
+    vma->start = start;
+    vma->end = end;
+    vma->path = offset;
+    memcpy(vma->perms, perms, 4);
+    vma->perms[4] = '\0';
+    return 0;
+}
+
+/**
+ *  Enumerates the VMAs of a process with the PROCMAP_QUERY ioctl.
+ *
+ *  @param fd  Opened /proc/<pid>/maps file descriptor.
+ *  @param vec The list to fill.
+ *  @return 0 on success, ENOTTY if the kernel lacks the ioctl, or an error
+ *          code on failure.
+ */
+static int query_vmas(int fd, vma_vec_t *vec) {
+    char name[PATH_MAX];
+    uint64_t addr = 0;
+    while (true) {
+        struct procmap_query query;
+        memset(&query, 0, sizeof(query));
+        query.size = sizeof(query);
+        query.query_flags = PROCMAP_QUERY_COVERING_OR_NEXT_VMA;
+        query.query_addr = addr;
+        query.vma_name_addr = (uintptr_t)name;
+        query.vma_name_size = sizeof(name);
+        if (ioctl(fd, PROCMAP_QUERY, &query) != 0) {
+            // ENOENT: no VMA at or above addr, we are done
+            return errno == ENOENT ? 0 : errno;
+        }
+
+        char perms[4] = {
+            query.vma_flags & PROCMAP_QUERY_VMA_READABLE ? 'r' : '-',
+            query.vma_flags & PROCMAP_QUERY_VMA_WRITABLE ? 'w' : '-',
+            query.vma_flags & PROCMAP_QUERY_VMA_EXECUTABLE ? 'x' : '-',
+            query.vma_flags & PROCMAP_QUERY_VMA_SHARED ? 's' : 'p',
+        };
+        // vma_name_size includes the terminator, 0 means no name
+        size_t name_len = query.vma_name_size ? query.vma_name_size - 1 : 0;
+        int rc = vma_push(vec, (uintptr_t)query.vma_start,
+                          (uintptr_t)query.vma_end, perms, name, name_len);
+        if (rc != 0) {
+            return rc;
+        }
+        addr = query.vma_end;
+    }
+}
+
+/**
+ *  Parses a hexadecimal number.
+ *
+ *  @return The first character after the number, or NULL if there is none.
+ */
+static const char *parse_hex(const char *p, const char *end, uint64_t *out) {
+    uint64_t value = 0;
+    const char *first = p;
+    for (; p < end; p++) {
+        unsigned digit;
+        if (*p >= '0' && *p <= '9') {
+            digit = (unsigned)(*p - '0');
+        } else if (*p >= 'a' && *p <= 'f') {
+            digit = (unsigned)(*p - 'a' + 10);
+        } else {
+            break;
+        }
+        value = value << 4 | digit;
+    }
+    *out = value;
+    return p == first ? NULL : p;
+}
+
+/**
+ *  Parses one line of /proc/<pid>/maps.
+ *
+ *  @param line Start of the line.
+ *  @param end  End of the line (the newline, not included).
+ *  @param vec  The list to append the VMA to.
+ *  @return 0 on success (malformed lines are skipped), or ENOMEM.
+ */
+static int parse_maps_line(const char *line, const char *end, vma_vec_t *vec) {
+    /**
+     * NOTE:
+     * /proc/<pid>/maps lines look like:
+     * start-end perms offset dev inode pathname
+     * e.g.: 55aa9f3f5000-55aa9f417000 r--p 00000000 08:02 131219
+     * /usr/bin/cat
+     * The path is missing for anonymous mappings, and is the rest of the
+     * line (it may contain spaces) otherwise.
+     */
+    uint64_t s, e;
+    const char *p = parse_hex(line, end, &s);
+    if (!p || p == end || *p != '-') {
+        return 0;
+    }
+    p = parse_hex(p + 1, end, &e);
+    if (!p || end - p < 5 || *p != ' ') {
+        return 0;
+    }
+    const char *perms = p + 1;
+    p += 5;
+
+    // Skip offset, dev and inode
+    for (int field = 0; field < 3; field++) {
+        while (p < end && *p == ' ') {
+            p++;
+        }
+        while (p < end && *p != ' ') {
+            p++;
+        }
+    }
+    while (p < end && *p == ' ') {
+        p++;
+    }
+    return vma_push(vec, (uintptr_t)s, (uintptr_t)e, perms, p,
+                    (size_t)(end - p));
+}
+
+/**
+ *  Enumerates the VMAs of a process by parsing the text of /proc/<pid>/maps.
+ *
+ *  @param fd  Opened /proc/<pid>/maps file descriptor.
+ *  @param vec The list to fill.
+ *  @return 0 on success, or an error code on failure.
+ */
+static int parse_maps(int fd, vma_vec_t *vec) {
+    size_t cap = 64 * 1024, have = 0;
+    char *buf = malloc(cap);
+    if (!buf) {
+        return ENOMEM;
+    }
+
+    int rc = 0;
+    while (rc == 0) {
+        ssize_t n = read(fd, buf + have, cap - have);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            rc = errno;
+            break;
+        }
+        have += (size_t)n;
+
+        // Parse every complete line, keep the partial one for the next read
+        const char *p = buf, *end = buf + have, *nl;
+        while (rc == 0 && (nl = memchr(p, '\n', (size_t)(end - p)))) {
+            rc = parse_maps_line(p, nl, vec);
+            p = nl + 1;
+        }
+        if (n == 0) {
+            if (rc == 0 && p < end) {
+                rc = parse_maps_line(p, end, vec);
+            }
+            break;
+        }
+        have = (size_t)(end - p);
+        if (have == cap) {
+            // A line longer than the buffer can't be a valid entry, drop it
+            have = 0;
+        }
+        memmove(buf, p, have);
+    }
+    free(buf);
+    return rc;
+}
+
 /**
  *  Reads the memory map of a process from /proc/<pid>/maps.
+ *  Uses the PROCMAP_QUERY ioctl where the kernel supports it and parses the
+ *  text otherwise. Paths are interned into a table shared by all VMA lists,
+ *  see vma_path().
  *
  *  @param pid The process ID to read the memory map from.
  *  @param count Pointer to store the number of VMAs read.
@@ -20,70 +279,49 @@
 vma_t *get_vma_list(pid_t pid,     // [in]
                     size_t *count) // [out]
 {
+    if (!g_vma_paths && !(g_vma_paths = strtab_create())) {
+        return NULL;
+    }
+
     char path[64];
     snprintf(path, sizeof(path), "/proc/%d/maps", pid);
-    FILE *fp = fopen(path, "r");
-    if (!fp) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
         perror("Failed to open maps file");
         return NULL;
     }
 
-    size_t capacity = 16, index = 0;
-    vma_t *list = calloc(capacity, sizeof(vma_t));
-    if (!list) {
-        fclose(fp);
-        return NULL;
+    static bool query_unsupported = false;
+    vma_vec_t vec = {0};
+    int rc = ENOTTY;
+    if (!query_unsupported) {
+        rc = query_vmas(fd, &vec);
+        if (rc == ENOTTY || rc == EINVAL) {
+            // Older kernel, fall back to the text for good
+            query_unsupported = true;
+            vec.count = 0;
+        }
     }
+    if (query_unsupported) {
+        rc = parse_maps(fd, &vec);
+    }
+    close(fd);
 
-    char line[PATH_MAX + 100];
-    while (fgets(line, sizeof(line), fp)) {
-        /**
-         * NOTE:
-         * Parse each line of the maps file.
-         * /proc/<pid>/maps lines look like:
-         * start-end perms offset dev inode pathname
-         * e.g.: 55aa9f3f5000-55aa9f417000 r--p 00000000 08:02 131219
-         * /usr/bin/cat
-         */
-
-        unsigned long s, e; // Start and end addresses
-        char perms[5];
-        char path_buffer[PATH_MAX] = {0}; // temp buffer
-
-        // NOTE: If we only get 3 items, the path was likely missing such as
-        // "[heap]", which can be considered valid.
-        int items_scanned = sscanf(line, "%lx-%lx %4s %*s %*s %*s %4095s", &s,
-                                   &e, perms, path_buffer);
-        if (items_scanned < 3) {
-            // truly malformed line, skip it
-            continue;
-        }
-
-        // Resize the list if it's full
-        if (index == capacity) {
-            size_t newCapacity = capacity * 2;
-            vma_t *tmp = realloc(list, newCapacity * sizeof(vma_t));
-            if (!tmp) {
-                free_vma_list(list);
-                fclose(fp);
-                return NULL; // Memory allocation failed
-            }
-            list = tmp;
-            capacity = newCapacity;
+    if (rc != 0) {
+        errno = rc;
+        perror("Failed to read maps file");
+        free_vma_list(vec.list);
+        return NULL;
+    }
+    if (!vec.list) {
+        // Keep NULL for errors only
+        vec.list = malloc(sizeof(vma_t));
+        if (!vec.list) {
+            return NULL;
         }
-
-        // Populate the struct with the parsed data
-        list[index].start = (uintptr_t)s;
-        list[index].end = (uintptr_t)e;
-        memcpy(list[index].perms, perms, 5);
-        strncpy(list[index].path, path_buffer, PATH_MAX - 1);
-        list[index].path[PATH_MAX - 1] = '\0'; // Ensure null-termination
-
-        index++;
     }
-    fclose(fp);
-    *count = index;
-    return list;
+    *count = vec.count;
+    return vec.list;
 }
 
 /**
@@ -93,6 +331,17 @@ vma_t *get_vma_list(pid_t pid,     // [in]
  */
 void free_vma_list(vma_t *list) { free(list); }
 
+/**
+ *  Gets the path of a VMA.
+ *  NOTE: The pointer is invalidated by the next get_vma_list() call.
+ *
+ *  @param vma The VMA.
+ *  @return The path of the mapped file, or "" for anonymous mappings.
+ */
+const char *vma_path(const vma_t *vma) {
+    return g_vma_paths ? strtab_get(g_vma_paths, vma->path) : "";
+}
+
 /**
  *  Checks if a VMA is readable.
  *
@@ -120,111 +369,442 @@ bool is_vma_writeable(const vma_t *vma) {
 }
 
 /**
- * Arguments for a thread scanning a range of VMAs in a target process.
+ * NOTE:
+ * /proc/<pid>/pagemap holds one 64-bit entry per virtual page.
+ * - bit 63: page present in RAM (bits 0-54 then hold the PFN, which reads
+ *           as 0 without CAP_SYS_ADMIN)
+ * - bit 62: page swapped out
+ * - bit 55: soft-dirty, set whenever the page is written after the last "4"
+ *           was written to /proc/<pid>/clear_refs
+ * (See Documentation/admin-guide/mm/pagemap.rst and soft-dirty.rst in the
+ * kernel tree.)
+ */
+#define PAGEMAP_PRESENT (1ULL << 63)
+#define PAGEMAP_SWAPPED (1ULL << 62)
+#define PAGEMAP_SOFT_DIRTY (1ULL << 55)
+#define PAGEMAP_PFN_MASK ((1ULL << 55) - 1)
+
+// Monotonic id handed out to every scan generation
+static uint64_t g_scan_gen = 0;
+
+/**
+ *  Hands out a fresh scan generation id.
+ *  Regions that did not come from a scan (e.g. loaded from a snapshot file)
+ *  take their id from here too, so they can never be mistaken for the base
+ *  of an incremental scan.
+ *
+ *  @return The new generation id (never 0).
+ */
+uint64_t scan_gen_next(void) {
+    return __atomic_add_fetch(&g_scan_gen, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ *  Returns the page size of the system (cached after the first call).
+ *
+ *  @return The page size in bytes.
+ */
+size_t page_size(void) {
+    static size_t cached = 0;
+    if (!cached) {
+        long ps = sysconf(_SC_PAGESIZE);
+        cached = ps > 0 ? (size_t)ps : 4096;
+    }
+    return cached;
+}
+
+/**
+ *  Clears the soft-dirty bits of every page of a target process.
  *
- * @typedef scan_thread_arg_t
- * @struct scan_thread_arg_t
+ *  @param pid The process ID whose soft-dirty bits are cleared.
+ *  @return 0 on success, or an error code on failure.
+ */
+int clear_soft_dirty(pid_t pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/clear_refs", pid);
+    int fd = open(path, O_WRONLY);
+    if (fd < 0) {
+        return errno;
+    }
+
+    int rc = 0;
+    if (write(fd, "4", 1) != 1) {
+        rc = errno;
+    }
+    close(fd);
+    return rc;
+}
+
+/**
+ *  Reads the soft-dirty bit of a single page of the calling process.
+ *
+ *  @param pm_fd Opened /proc/self/pagemap file descriptor.
+ *  @param addr Address inside the page to check.
+ *  @return 1 if dirty, 0 if clean, -1 on failure.
+ */
+static int self_page_soft_dirty(int pm_fd, uintptr_t addr) {
+    uint64_t entry = 0;
+    off_t off = (off_t)(addr / page_size()) * sizeof(entry);
+    if (pread(pm_fd, &entry, sizeof(entry), off) != sizeof(entry)) {
+        return -1;
+    }
+    return (entry & PAGEMAP_SOFT_DIRTY) ? 1 : 0;
+}
+
+/**
+ *  Checks (once) whether the running kernel tracks soft-dirty bits.
+ *  Kernels built without CONFIG_MEM_SOFT_DIRTY accept writes to clear_refs
+ *  but never set the bit again, which would make every page look clean. So we
+ *  verify it on a scratch page of our own before trusting it for a target.
+ *
+ *  @return true if soft-dirty tracking works, false otherwise.
+ */
+bool soft_dirty_supported(void) {
+    static int cached = -1;
+    if (cached >= 0) {
+        return cached;
+    }
+    cached = 0;
+
+    volatile uint8_t *page = mmap(NULL, page_size(), PROT_READ | PROT_WRITE,
+                                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (page == MAP_FAILED) {
+        return false;
+    }
+    int pm_fd = open("/proc/self/pagemap", O_RDONLY);
+    if (pm_fd >= 0) {
+        page[0] = 1;
+        if (clear_soft_dirty(getpid()) == 0 &&
+            self_page_soft_dirty(pm_fd, (uintptr_t)page) == 0) {
+            page[0] = 2; // must flip the bit back on
+            cached = self_page_soft_dirty(pm_fd, (uintptr_t)page) == 1;
+        }
+        close(pm_fd);
+    }
+    munmap((void *)page, page_size());
+    return cached;
+}
+
+/**
+ *  Finds (once) the PFN of the kernel's shared zero page, by faulting in an
+ *  untouched anonymous page of our own with a read.
+ *
+ *  @return The zero page PFN, or 0 if PFNs are hidden from us.
+ */
+static uint64_t zero_page_pfn(void) {
+    static int probed = 0;
+    static uint64_t pfn = 0;
+    if (probed) {
+        return pfn;
+    }
+    probed = 1;
+
+    volatile uint8_t *page = mmap(NULL, page_size(), PROT_READ | PROT_WRITE,
+                                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (page == MAP_FAILED) {
+        return 0;
+    }
+    (void)page[0]; // read fault maps the zero page
+    int pm_fd = open("/proc/self/pagemap", O_RDONLY);
+    if (pm_fd >= 0) {
+        uint64_t entry = 0;
+        off_t off = (off_t)((uintptr_t)page / page_size()) * sizeof(entry);
+        if (pread(pm_fd, &entry, sizeof(entry), off) == sizeof(entry) &&
+            (entry & PAGEMAP_PRESENT)) {
+            pfn = entry & PAGEMAP_PFN_MASK;
+        }
+        close(pm_fd);
+    }
+    munmap((void *)page, page_size());
+    return pfn;
+}
+
+/**
+ *  Checks whether a VMA is private anonymous memory, whose pages read as
+ *  zero until they are first written.
+ *
+ *  @param vma The VMA to check.
+ *  @return true if untouched pages of the VMA are known to be zero.
+ */
+static bool is_vma_private_anon(const vma_t *vma) {
+    // File mappings and shared memory (including memfd and /dev/zero shared
+    // mappings) keep their content outside of the page tables
+    return vma->perms[3] == 'p' && vma_path(vma)[0] != '/';
+}
+
+/**
+ *  Reads the pagemap entries of a VMA and fills in the per-page state of its
+ *  region, and, if `prev` is given, the soft-dirty bitmap relative to it.
+ *  Clean pages inherit their state from `prev`.
+ *
+ *  @param pm_fd Opened pagemap file descriptor of the target process.
+ *  @param vma The VMA being scanned.
+ *  @param prev Previous generation of the same VMA, or NULL.
+ *  @param region Region to store the page states (and dirty bitmap) in.
+ *  @return 0 on success, or an error code on failure.
+ */
+static int read_page_info(int pm_fd,                // [in]
+                          const vma_t *vma,         // [in]
+                          const mem_region_t *prev, // [in]
+                          mem_region_t *region      // [out]
+) {
+    const size_t PAGE = page_size();
+    size_t pages = (vma->end - vma->start + PAGE - 1) / PAGE;
+    bool anon = is_vma_private_anon(vma);
+    uint64_t zero_pfn = zero_page_pfn();
+
+    uint8_t *states = malloc(pages);
+    uint64_t *dirty = prev ? calloc((pages + 63) / 64, sizeof(uint64_t)) : NULL;
+    if (!states || (prev && !dirty)) {
+        free(states);
+        free(dirty);
+        return ENOMEM;
+    }
+
+    // Read the pagemap entries in batches, 512 entries (4 KiB) at a time
+    uint64_t entries[512];
+    size_t first = vma->start / PAGE;
+    bool any_hole = false;
+    for (size_t done = 0; done < pages;) {
+        size_t batch = pages - done;
+        if (batch > 512) {
+            batch = 512;
+        }
+        ssize_t n = pread(pm_fd, entries, batch * sizeof(uint64_t),
+                          (off_t)((first + done) * sizeof(uint64_t)));
+        if (n <= 0) {
+            int rc = n < 0 ? errno : EIO;
+            free(states);
+            free(dirty);
+            return rc;
+        }
+        size_t got = (size_t)n / sizeof(uint64_t);
+        for (size_t i = 0; i < got; i++) {
+            size_t page = done + i;
+            uint64_t e = entries[i];
+
+            if (prev && !(e & PAGEMAP_SOFT_DIRTY)) {
+                // Unchanged since prev, so is its state
+                states[page] = region_page_state(prev, page);
+            } else if (e & PAGEMAP_PRESENT) {
+                bool zero = zero_pfn && (e & PAGEMAP_PFN_MASK) == zero_pfn;
+                states[page] = zero ? PAGE_ZERO : PAGE_DATA;
+            } else if (e & PAGEMAP_SWAPPED) {
+                // Reading it would force a swap-in
+                states[page] = PAGE_UNKNOWN;
+            } else {
+                // Never touched: zero for anonymous memory. File pages that
+                // aren't mapped yet come from the page cache, read them.
+                states[page] = anon ? PAGE_ZERO : PAGE_DATA;
+            }
+            if (prev && (e & PAGEMAP_SOFT_DIRTY)) {
+                dirty[page / 64] |= 1ULL << (page % 64);
+            }
+            any_hole |= states[page] != PAGE_DATA;
+        }
+        done += got;
+    }
+
+    if (!any_hole) {
+        free(states);
+        states = NULL; // every page holds data
+    }
+    region->pages = states;
+    region->dirty = dirty;
+    return 0;
+}
+
+// Bytes per scan task. Large VMAs are cut into slices of this size so that
+// the pool can spread a single huge [heap] over every worker.
+#define SCAN_SLICE_BYTES ((size_t)4 << 20) // 4 MiB
+
+/**
+ * Shared context of the tasks reading the VMAs of a target process.
+ *
+ * @typedef scan_ctx_t
+ * @struct scan_ctx_t
  * @param pid         Target process ID.
  * @param vmas        Array of VMAs to scan.
+ * @param bases       Previous-generation region of each VMA (NULL if none).
  * @param regions     Array to store memory region data.
- * @param start_index Start index in the VMA array (inclusive).
- * @param end_index   End index in the VMA array (exclusive).
+ * @param slices      Byte slices of the VMAs, one per task.
+ * @param bytes_read  Bytes read per region, summed up by the tasks.
+ * @param stats       Read counters of every pool worker.
+ * @param hash_only   Keep the page hashes only, the data is read into a
+ *                    scratch buffer per task and dropped.
+ * @param zero_hash   hash64() of an all-zero page, the hash of every hole.
  */
 typedef struct {
     pid_t pid;
     vma_t *vmas;
+    const mem_region_t **bases;
     mem_region_t *regions;
-    size_t start_index;
-    size_t end_index;
-} scan_thread_arg_t;
+    pool_slice_t *slices;
+    size_t *bytes_read;
+    peek_stats_t *stats;
+    bool hash_only;
+    uint64_t zero_hash;
+} scan_ctx_t;
+
+// What a scan task does with a page
+typedef enum {
+    PAGE_ACTION_READ, // read from the target
+    PAGE_ACTION_COPY, // copy from the previous generation
+    PAGE_ACTION_HOLE, // zero-fill locally, the target isn't touched
+} page_action_t;
+
+/**
+ * Decide how to obtain one page of a region.
+ */
+static page_action_t page_action(const mem_region_t *region,
+                                 const mem_region_t *prev, size_t page) {
+    if (prev && !region_page_dirty(region, page)) {
+        return PAGE_ACTION_COPY;
+    }
+    return region_page_state(region, page) == PAGE_DATA ? PAGE_ACTION_READ
+                                                        : PAGE_ACTION_HOLE;
+}
+
+/**
+ * Get (once) the hash of an all-zero page, which is the hash of every hole.
+ */
+static uint64_t zero_page_hash(void) {
+    static uint64_t cached = 0;
+    static bool done = false;
+    if (!done) {
+        // A private anonymous page is all zeros until written
+        void *zero = mmap(NULL, page_size(), PROT_READ,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (zero != MAP_FAILED) {
+            cached = hash64(zero, page_size(), 0);
+            munmap(zero, page_size());
+            done = true;
+        }
+    }
+    return cached;
+}
 
 /**
- * Thread function to scan a range of VMAs in a target process.
+ * Task function reading one slice of a VMA into its region buffer.
+ * Pages are handled in runs of the same action: present pages are read from
+ * the target, holes (zero or unknown pages) are zero-filled without touching
+ * the target, and if the VMA has a previous-generation base, clean pages are
+ * copied from it. The hash of every page is computed while it is still hot
+ * in the cache.
  *
- * @param arg Pointer to a scan_thread_arg_t structure containing:
- *            - pid: Target process ID.
- *            - vmas: Array of VMAs to scan.
- *            - regions: Array to store memory region data.
- *            - start_index: Start index in the VMA array.
- *            - end_index: End index (exclusive) in the VMA array.
- * @return NULL Always returns NULL.
+ * @param arg Pointer to the shared scan_ctx_t.
+ * @param task Index of the slice to read.
+ * @param worker Index of the pool worker running the task.
  */
-static void *scan_thread_fn(void *arg) {
-    scan_thread_arg_t *a = arg;
-
-    // NOTE: The chunk size is set to 64 KiB, which is a reasonable size for
-    // reading memory in chunks.
-    const size_t CHUNK_SIZE = 65536; // 64 KiB
-
-    for (size_t i = a->start_index; i < a->end_index; i++) {
-        uintptr_t base = a->vmas[i].start;
-        uintptr_t end = a->vmas[i].end;
-        size_t total_len = end - base;
-        uint8_t *buf = calloc(total_len, sizeof(uint8_t));
-        if (!buf) {
-            a->regions[i].data = NULL;
-            perror("Failed to allocate memory for scan buffer");
-            continue;
-        }
-
-        ssize_t total_bytes_read = 0;
-        for (size_t offset = 0; offset < total_len; offset += CHUNK_SIZE) {
-            // Calculate the size of the current chunk, handling the final
-            // partial chunk
-            size_t current_chunk_size = (offset + CHUNK_SIZE > total_len)
-                                            ? (total_len - offset)
-                                            : CHUNK_SIZE;
-
-            struct iovec local = {.iov_base = buf + offset,
-                                  .iov_len = current_chunk_size};
-            struct iovec remote = {.iov_base = (void *)(base + offset),
-                                   .iov_len = current_chunk_size};
-
-            ssize_t bytes_read =
-                process_vm_readv(a->pid, &local, 1, &remote, 1, 0);
-
-            if (bytes_read > 0) {
-                total_bytes_read += bytes_read;
-                if ((size_t)bytes_read < current_chunk_size) {
-                    // If we read less than the chunk size, it means we reached
-                    // the end of the VMA, okay to stop reading
-                    break;
-                }
-            } else {
-                // NOTE: It means we failed to read the memory.
-                // We can simply proceed to the next chunk, preserving the gap.
-                continue;
+static void scan_task_fn(void *arg, size_t task, size_t worker) {
+    scan_ctx_t *c = arg;
+    const size_t PAGE = page_size();
+    const pool_slice_t *slice = &c->slices[task];
+    mem_region_t *region = &c->regions[slice->index];
+    const mem_region_t *prev = c->bases[slice->index];
+    peek_stats_t *stats = &c->stats[worker];
+    uintptr_t base = c->vmas[slice->index].start;
+
+    // buf holds the slice from byte `buf_base` of the region on
+    uint8_t *buf = region->data;
+    size_t buf_base = 0, scratch_cap = 0;
+    if (c->hash_only) {
+        buf = arena_alloc(slice->len, &scratch_cap);
+        buf_base = slice->offset;
+    }
+    if (!buf || (c->hash_only && !region->hashes)) {
+        arena_release(c->hash_only ? buf : NULL, scratch_cap);
+        return; // allocation failed
+    }
+
+    size_t total_bytes_read = 0;
+    size_t slice_end = slice->offset + slice->len;
+    size_t page = slice->offset / PAGE;
+    size_t pages = (slice_end + PAGE - 1) / PAGE;
+    while (page < pages) {
+        page_action_t action = page_action(region, prev, page);
+        size_t run = page + 1;
+        while (run < pages && page_action(region, prev, run) == action) {
+            run++;
+        }
+
+        size_t offset = page * PAGE;
+        size_t len =
+            (run * PAGE > slice_end ? slice_end : run * PAGE) - offset;
+        uint8_t *dst = buf + (offset - buf_base);
+        switch (action) {
+        case PAGE_ACTION_READ:
+            total_bytes_read +=
+                peek_mem(c->pid, base + offset, dst, len, stats);
+            break;
+        case PAGE_ACTION_COPY:
+            memcpy(dst, prev->data + offset, len);
+            total_bytes_read += len;
+            break;
+        case PAGE_ACTION_HOLE:
+            // NOTE: Arena buffers may be recycled and hold stale data. Large
+            // holes are dropped instead of cleared, so they read back as
+            // zero without using any memory. That fails on hugetlb buffers,
+            // which are cleared instead.
+            if (len < 16 * PAGE || madvise(dst, len, MADV_DONTNEED) != 0) {
+                memset(dst, 0, len);
             }
+            stats->skipped += len;
+            total_bytes_read += len; // known content, counts as read
+            break;
         }
 
-        // After attempting all chunks, check if we successfully read anything
-        if (total_bytes_read > 0) {
-            a->regions[i].start = base;
-            a->regions[i].data = buf;
-            a->regions[i].len = total_len;
-        } else {
-            free(buf);
-            a->regions[i].data = NULL;
+        // Hash the run; clean pages keep the hash of their base
+        for (size_t p = page; region->hashes && p < run; p++) {
+            size_t plen = (p + 1) * PAGE > slice_end ? slice_end - p * PAGE
+                                                     : PAGE;
+            if (action == PAGE_ACTION_COPY && prev->hashes) {
+                region->hashes[p] = prev->hashes[p];
+            } else if (action == PAGE_ACTION_HOLE && plen == PAGE &&
+                       c->zero_hash) {
+                region->hashes[p] = c->zero_hash;
+            } else {
+                region->hashes[p] =
+                    hash64(buf + (p * PAGE - buf_base), plen, 0);
+            }
         }
+        page = run;
+    }
+    if (c->hash_only) {
+        arena_release(buf, scratch_cap);
     }
 
-    return NULL;
+    __atomic_add_fetch(&c->bytes_read[slice->index], total_bytes_read,
+                       __ATOMIC_RELAXED);
 }
 
 /**
- *  Performs a full scan of the memory of a target process.
- *  It uses multiple threads to read all readable VMAs in the process's
- * memory.
+ *  Scans the readable and writable VMAs of a target process.
+ *  The VMAs are read in slices on the shared thread pool. If `prev` is
+ *  given, only soft-dirty pages of VMAs that also exist (same start and
+ *  length) in `prev` are read from the target.
  *
  *  @param pid The process ID to scan.
+ *  @param prev Previous generation to build upon, or NULL for a full read.
+ *  @param prev_count Number of regions in `prev`.
+ *  @param clear Whether to clear the soft-dirty bits for the next scan.
+ *  @param hash_only Whether to keep the page hashes only (no data).
  *  @param regions_out Pointer to store the array of memory regions found.
  *  @param count_out Pointer to store the number of memory regions found.
+ *  @param stats_out Optional pointer to store the read counters.
  *  @return 0 on success, or an error code on failure.
  */
-int full_scan(pid_t pid,                  // [in]
-              mem_region_t **regions_out, // [out]
-              size_t *count_out           // [out]
+static int scan_vmas(pid_t pid,                  // [in]
+                     const mem_region_t *prev,   // [in]
+                     size_t prev_count,          // [in]
+                     bool clear,                 // [in]
+                     bool hash_only,             // [in]
+                     mem_region_t **regions_out, // [out]
+                     size_t *count_out,          // [out]
+                     peek_stats_t *stats_out     // [out]
 ) {
+    uint64_t t0 = peek_now_ns();
+
     // Get the list of VMAs for the target process
     size_t vma_count = 0;
     vma_t *vmas = get_vma_list(pid, &vma_count);
@@ -244,10 +824,12 @@ int full_scan(pid_t pid,                  // [in]
     // Prepare the arrays to do the full scan
     mem_region_t *regions = calloc(region_count, sizeof(*regions));
     vma_t *filters = calloc(region_count, sizeof(*filters));
-    if (!regions || !filters) {
+    const mem_region_t **bases = calloc(region_count, sizeof(*bases));
+    if (!regions || !filters || !bases) {
         free(vmas);
         free(regions);
         free(filters);
+        free(bases);
         return ENOMEM;
     }
 
@@ -261,50 +843,163 @@ int full_scan(pid_t pid,                  // [in]
     }
     free(vmas);
 
-    // Spawn thrads across cores
-    long procs = sysconf(_SC_NPROCESSORS_ONLN);
-    size_t num_threads = (procs > 0 ? (size_t)procs : 1);
-    if (num_threads > region_count) {
-        num_threads = region_count;
+    uint64_t gen = scan_gen_next();
+    for (size_t i = 0; i < region_count; i++) {
+        regions[i].gen = gen;
     }
 
-    pthread_t *threads = calloc(num_threads, sizeof(*threads));
-    scan_thread_arg_t *args = calloc(num_threads, sizeof(*args));
-    if (!threads || !args) {
+    // Match VMAs against the previous generation by start address
+    hash_map_t *prev_map = NULL;
+    if (prev) {
+        prev_map = hash_map_create(prev_count > 0 ? prev_count * 2 - 1 : 16);
+        if (!prev_map) {
+            free(regions);
+            free(filters);
+            free(bases);
+            return ENOMEM;
+        }
+        for (size_t i = 0; i < prev_count; i++) {
+            if (prev[i].data) {
+                hash_map_put(prev_map, prev[i].start, (void *)&prev[i]);
+            }
+        }
+    }
+
+    // Consult the pagemap so that holes are never read from the target. If
+    // it can't be opened we simply read every page, like a plain scan.
+    // NOTE: All pagemap reads must happen before clear_refs is written.
+    // A page written between reading its entry and the clear is missed,
+    // so we keep this window as short as possible by collecting every
+    // entry first and only then doing the (slow) copying.
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/pagemap", pid);
+    int pm_fd = open(path, O_RDONLY);
+    for (size_t i = 0; pm_fd >= 0 && i < region_count; i++) {
+        const mem_region_t *p =
+            prev_map ? hash_map_get(prev_map, filters[i].start) : NULL;
+        size_t len = filters[i].end - filters[i].start;
+        if (p && p->len != len) {
+            p = NULL; // resized VMA, read it entirely
+        }
+        if (read_page_info(pm_fd, &filters[i], p, &regions[i]) == 0 && p) {
+            regions[i].base_gen = p->gen;
+            bases[i] = p;
+        }
+    }
+    if (pm_fd >= 0) {
+        close(pm_fd);
+    }
+    hash_map_destroy(prev_map);
+
+    if (clear) {
+        int rc = clear_soft_dirty(pid);
+        if (rc != 0) {
+            free_mem_regions(regions, region_count);
+            free(filters);
+            free(bases);
+            return rc;
+        }
+    }
+
+    // Calibrate the batched reader once, on the longest run of present pages
+    // (reading holes would fault them in on the target side)
+    static bool tuned = false;
+    if (!tuned && region_count > 0) {
+        const size_t PAGE = page_size();
+        uintptr_t best_addr = 0;
+        size_t best_len = 0;
+        for (size_t i = 0; i < region_count; i++) {
+            size_t pages = (filters[i].end - filters[i].start) / PAGE;
+            for (size_t p = 0; p < pages;) {
+                size_t q = p;
+                while (q < pages &&
+                       region_page_state(&regions[i], q) == PAGE_DATA) {
+                    q++;
+                }
+                if ((q - p) * PAGE > best_len) {
+                    best_len = (q - p) * PAGE;
+                    best_addr = filters[i].start + p * PAGE;
+                }
+                p = q + 1;
+            }
+        }
+        peek_autotune(pid, best_addr, best_len);
+        tuned = true;
+        t0 = peek_now_ns(); // don't count the calibration
+    }
+
+    // Allocate every region buffer up front, then cut the VMAs into
+    // byte-balanced slices for the shared pool
+    size_t *lens = calloc(region_count, sizeof(*lens));
+    size_t *bytes_read = calloc(region_count, sizeof(*bytes_read));
+    peek_stats_t *worker_stats = calloc(pool_workers(), sizeof(*worker_stats));
+    size_t slice_count = 0;
+    pool_slice_t *slices = NULL;
+    if (lens && bytes_read && worker_stats) {
+        for (size_t i = 0; i < region_count; i++) {
+            lens[i] = filters[i].end - filters[i].start;
+            size_t pages = (lens[i] + page_size() - 1) / page_size();
+            regions[i].hashes = malloc(pages * sizeof(uint64_t));
+            if (!hash_only) {
+                regions[i].data = arena_alloc(lens[i], &regions[i].cap);
+            }
+            if (hash_only ? !regions[i].hashes : !regions[i].data) {
+                perror("Failed to allocate memory for scan buffer");
+            }
+        }
+        slices = pool_slice(lens, region_count, SCAN_SLICE_BYTES, &slice_count);
+    }
+    if (!lens || !bytes_read || !worker_stats ||
+        (!slices && region_count > 0)) {
+        free_mem_regions(regions, region_count);
         free(filters);
-        free(regions);
-        free(threads);
-        free(args);
+        free(bases);
+        free(lens);
+        free(bytes_read);
+        free(worker_stats);
         return ENOMEM;
     }
 
-    // Create the thread and wait for them to finish
-    for (size_t t = 0; t < num_threads; t++) {
-        size_t start = t * (region_count / num_threads);
-        size_t end = (t == num_threads - 1)
-                         ? region_count
-                         : (t + 1) * (region_count /
-                                      num_threads); // The last thread handles
-                                                    // the remaining regions
+    scan_ctx_t ctx = {.pid = pid,
+                      .vmas = filters,
+                      .bases = bases,
+                      .regions = regions,
+                      .slices = slices,
+                      .bytes_read = bytes_read,
+                      .stats = worker_stats,
+                      .hash_only = hash_only,
+                      .zero_hash = zero_page_hash()};
+    pool_run(slice_count, scan_task_fn, &ctx);
 
-        // NOTE: all threads share the same region array, but each thread will
-        // only read non-overlapping regions.
-        args[t] = (scan_thread_arg_t){.pid = pid,
-                                      .vmas = filters,
-                                      .regions = regions,
-                                      .start_index = start,
-                                      .end_index = end};
-        pthread_create(&threads[t], NULL, scan_thread_fn, &args[t]);
+    // Drop the regions we couldn't read anything from
+    for (size_t i = 0; i < region_count; i++) {
+        if (bytes_read[i] > 0) {
+            regions[i].start = filters[i].start;
+            regions[i].len = lens[i];
+        } else {
+            arena_release(regions[i].data, regions[i].cap);
+            regions[i].data = NULL;
+            free(regions[i].hashes);
+            regions[i].hashes = NULL;
+        }
     }
 
-    for (size_t t = 0; t < num_threads; t++) {
-        pthread_join(threads[t], NULL);
+    peek_stats_t stats = {0};
+    for (size_t w = 0; w < pool_workers(); w++) {
+        peek_stats_add(&stats, &worker_stats[w]);
+    }
+    stats.nsec = peek_now_ns() - t0;
+    if (stats_out) {
+        *stats_out = stats;
     }
 
     // Clean up
-    free(threads);
-    free(args);
+    free(slices);
+    free(lens);
+    free(bytes_read);
+    free(worker_stats);
     free(filters);
+    free(bases);
 
     // Set output parameters
     *regions_out = regions;
@@ -313,6 +1008,81 @@ int full_scan(pid_t pid,                  // [in]
     return 0; // Success
 }
 
+/**
+ *  Performs a full scan of the memory of a target process.
+ *  It uses the shared thread pool to read all readable VMAs in the process's
+ * memory.
+ *
+ *  @param pid The process ID to scan.
+ *  @param regions_out Pointer to store the array of memory regions found.
+ *  @param count_out Pointer to store the number of memory regions found.
+ *  @param stats_out Optional pointer to store the read counters.
+ *  @return 0 on success, or an error code on failure.
+ */
+int full_scan(pid_t pid,                  // [in]
+              mem_region_t **regions_out, // [out]
+              size_t *count_out,          // [out]
+              peek_stats_t *stats_out     // [out]
+) {
+    return scan_vmas(pid, NULL, 0, false, false, regions_out, count_out,
+                     stats_out);
+}
+
+/**
+ *  Performs a hash-only scan of the memory of a target process.
+ *  Every page is read and hashed like in full_scan(), but only the page
+ *  hashes are kept (8 bytes per page, about 0.2% of the memory). Such a
+ *  generation can tell which pages changed, not how.
+ *
+ *  @param pid The process ID to scan.
+ *  @param regions_out Pointer to store the array of hash-only regions.
+ *  @param count_out Pointer to store the number of memory regions found.
+ *  @param stats_out Optional pointer to store the read counters.
+ *  @return 0 on success, or an error code on failure.
+ */
+int full_scan_hashes(pid_t pid,                  // [in]
+                     mem_region_t **regions_out, // [out]
+                     size_t *count_out,          // [out]
+                     peek_stats_t *stats_out     // [out]
+) {
+    return scan_vmas(pid, NULL, 0, false, true, regions_out, count_out,
+                     stats_out);
+}
+
+/**
+ *  Performs an incremental scan of the memory of a target process.
+ *  Only pages written since the soft-dirty bits were last cleared are read
+ *  from the target; every other page is carried over from `prev`. The
+ *  soft-dirty bits are cleared again so the result can serve as the `prev`
+ *  of the next incremental scan.
+ *
+ *  NOTE: `prev` must be the generation captured right after the last clear,
+ *  i.e. the previous result of this function. Pass NULL to do a full read
+ *  that only arms the tracking.
+ *
+ *  @param pid The process ID to scan.
+ *  @param prev Previous generation, or NULL.
+ *  @param prev_count Number of regions in `prev`.
+ *  @param regions_out Pointer to store the array of memory regions found.
+ *  @param count_out Pointer to store the number of memory regions found.
+ *  @param stats_out Optional pointer to store the read counters.
+ *  @return 0 on success, ENOTSUP if soft-dirty tracking is unavailable, or
+ * another error code on failure.
+ */
+int full_scan_incremental(pid_t pid,                  // [in]
+                          const mem_region_t *prev,   // [in]
+                          size_t prev_count,          // [in]
+                          mem_region_t **regions_out, // [out]
+                          size_t *count_out,          // [out]
+                          peek_stats_t *stats_out     // [out]
+) {
+    if (!soft_dirty_supported()) {
+        return ENOTSUP;
+    }
+    return scan_vmas(pid, prev, prev_count, true, false, regions_out,
+                     count_out, stats_out);
+}
+
 /**
  *  Frees the memory allocated for an array of memory regions.
  *
@@ -324,8 +1094,16 @@ void free_mem_regions(mem_region_t *regions, size_t count) {
         return;
     }
     for (size_t i = 0; i < count; i++) {
-        // Free each region's data buffer
-        free(regions[i].data);
+        // Return each region's data buffer to the arena, or unmap it if it
+        // is a view of a snapshot file
+        if (regions[i].mapped) {
+            munmap(regions[i].data, regions[i].cap);
+        } else {
+            arena_release(regions[i].data, regions[i].cap);
+        }
+        free(regions[i].dirty);
+        free(regions[i].pages);
+        free(regions[i].hashes);
     }
 
     // Finally, free the regions array itself
@@ -1,29 +1,75 @@
 // src/utils/probe.h
 #pragma once
-#include <linux/limits.h>
+#include "peek.h"
 #include <stdbool.h>
 #include <stdint.h>
 #include <sys/types.h>
 
 // Single VMA entry from /proc/<pid>/maps
 typedef struct {
-    uintptr_t start;     // region base address
-    uintptr_t end;       // region end address
-    char perms[5];       // permissions (e.g., "r--p")
-    char path[PATH_MAX]; // path to the mapped file (if any)
+    uintptr_t start; // region base address
+    uintptr_t end;   // region end address
+    uint32_t path;   // path to the mapped file (if any), as an offset into
+                     // the VMA path table (see vma_path())
+    char perms[5];   // permissions (e.g., "r--p")
 } vma_t;
 
 vma_t *get_vma_list(pid_t pid, size_t *count);
 void free_vma_list(vma_t *list);
+const char *vma_path(const vma_t *vma);
 bool is_vma_readable(const vma_t *vma);
 bool is_vma_writeable(const vma_t *vma);
 
+// Per-page state of a region snapshot
+typedef enum {
+    PAGE_DATA = 0,    // read from the target
+    PAGE_ZERO = 1,    // hole: untouched anonymous (or zero) page, reads as 0
+    PAGE_UNKNOWN = 2, // hole: swapped out, content not known
+} page_state_t;
+
 // Memory-blob structure for the full scan
 typedef struct {
-    uintptr_t start; // region base
-    size_t len;      // bytes actually read
-    uint8_t *data;   // malloc'd buffer
+    uintptr_t start;   // region base
+    size_t len;        // bytes actually read
+    uint8_t *data;     // arena buffer (see arena.h)
+    size_t cap;        // capacity of the arena block behind data
+    bool mapped;       // data is a read-only mapping of a snapshot file
+                       // (see snapfile.h) of cap bytes, not an arena block
+    uint64_t gen;      // scan generation that produced this region
+    uint64_t base_gen; // generation the dirty bitmap is relative to (0: none)
+    uint64_t *dirty;   // bitmap of pages re-read from the target, NULL if
+                       // every page of the region was read
+    uint8_t *pages;    // page_state_t of every page, NULL if all PAGE_DATA.
+                       // Hole pages read as zero in data.
+    uint64_t *hashes;  // hash64() of every page (seed 0), NULL if unknown.
+                       // Hash-only regions have hashes but no data.
 } mem_region_t;
 
-int full_scan(pid_t pid, mem_region_t **regions, size_t *count);
+int full_scan(pid_t pid, mem_region_t **regions, size_t *count,
+              peek_stats_t *stats);
+int full_scan_hashes(pid_t pid, mem_region_t **regions, size_t *count,
+                     peek_stats_t *stats);
+int full_scan_incremental(pid_t pid, const mem_region_t *prev,
+                          size_t prev_count, mem_region_t **regions,
+                          size_t *count, peek_stats_t *stats);
 void free_mem_regions(mem_region_t *regions, size_t count);
+uint64_t scan_gen_next(void);
+
+// Soft-dirty page tracking (see /proc/<pid>/clear_refs)
+bool soft_dirty_supported(void);
+int clear_soft_dirty(pid_t pid);
+size_t page_size(void);
+
+static inline page_state_t region_page_state(const mem_region_t *region,
+                                            size_t page) {
+    return region->pages ? (page_state_t)region->pages[page] : PAGE_DATA;
+}
+
+static inline bool region_hash_only(const mem_region_t *region) {
+    return !region->data && region->hashes;
+}
+
+static inline bool region_page_dirty(const mem_region_t *region,
+                                     size_t page) {
+    return !region->dirty || (region->dirty[page / 64] >> (page % 64)) & 1;
+}
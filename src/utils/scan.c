@@ -1,230 +1,2347 @@
 // src/utils/scan.c
 #include "scan.h"
 #include "../datastructure/hashmap.h"
+#include "hash.h"
+#include "simd.h"
+#include "threadpool.h"
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+// Bytes per search/detect task
+#define SCAN_SLICE_BYTES ((size_t)1 << 20) // 1 MiB
+
+// Elements handed to a comparison kernel at once
+#define COMPARE_CHUNK 4096
+// Data pages a group search samples to pick the field to run the kernel on
+#define GROUP_SAMPLE_PAGES 64
+// Bytes handed to the diff kernel at once
+#define DIFF_CHUNK 4096
+
+/**
+ * NOTE:
+ * Hits are collected per pool worker rather than per task: every task
+ * appends to the buffer of the worker running it and records where its own
+ * hits start (task_run_t). Since tasks are slices of the regions in address
+ * order, copying the runs out in task order yields address order without a
+ * sort. Each buffer sits on its own cache line, so workers never share one.
+ */
+typedef struct {
+    _Alignas(64) uint8_t *items; // elements of elem_size bytes
+    size_t n;
+    size_t capacity;
+    bool failed; // an allocation failed, the hits are incomplete
+} worker_vec_t;
+
+// The hits of one task inside its worker's buffer
+typedef struct {
+    size_t worker;
+    size_t first;
+    size_t count;
+} task_run_t;
+
+/**
+ * Allocate one zeroed, cache-line aligned hit buffer per pool worker.
+ *
+ * @return The buffers, or NULL on allocation failure.
+ */
+static worker_vec_t *worker_vecs_create(void) {
+    size_t bytes = pool_workers() * sizeof(worker_vec_t);
+    worker_vec_t *vecs = aligned_alloc(_Alignof(worker_vec_t), bytes);
+    if (vecs) {
+        memset(vecs, 0, bytes);
+    }
+    return vecs;
+}
+
+/**
+ * Free the hit buffers of every pool worker.
+ */
+static void worker_vecs_destroy(worker_vec_t *vecs) {
+    for (size_t w = 0; vecs && w < pool_workers(); w++) {
+        free(vecs[w].items);
+    }
+    free(vecs);
+}
+
+/**
+ * Make room for one more element at the end of a hit buffer.
+ * If the buffer is full, its capacity is doubled.
+ *
+ * @param vec The buffer.
+ * @param elem_size Size of an element.
+ * @return Pointer to the new element, or NULL on allocation failure.
+ */
+static inline void *vec_push(worker_vec_t *vec, // [in/out]
+                             size_t elem_size   // [in]
+) {
+    if (vec->n == vec->capacity) {
+        size_t new_capacity = vec->capacity ? vec->capacity * 2 : 256;
+        uint8_t *tmp = realloc(vec->items, new_capacity * elem_size);
+        if (!tmp) {
+            vec->failed = true;
+            return NULL;
+        }
+        vec->items = tmp;
+        vec->capacity = new_capacity;
+    }
+    return vec->items + elem_size * vec->n++;
+}
+
+/**
+ * Append a new scan result to a hit buffer.
+ *
+ * @param vec The buffer of the calling worker.
+ * @param addr Address of the found match.
+ * @param len Length of the found match.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static inline int append_result(worker_vec_t *vec, // [in/out]
+                                uintptr_t addr,    // [in]
+                                size_t len         // [in]
+) {
+    scan_result_t *slot = vec_push(vec, sizeof(scan_result_t));
+    if (!slot) {
+        return -1;
+    }
+    *slot = (scan_result_t){
+        .addr = addr,
+        .len = len,
+    };
+    return 0;
+}
+
+/**
+ * Check whether a change range continues another one, so that both can be
+ * one range.
+ */
+static inline bool changes_adjoin(const mem_change_t *a,
+                                  const mem_change_t *b) {
+    return a->kind == b->kind && a->old_region == b->old_region &&
+           a->new_region == b->new_region && a->addr + a->len == b->addr;
+}
+
+/**
+ * Append a change range to a hit buffer, or grow the last range of the
+ * calling task if the new one continues it.
+ *
+ * @param vec The buffer of the calling worker.
+ * @param first Index of the first range of the calling task in the buffer.
+ * @param change The range.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static inline int append_change(worker_vec_t *vec,         // [in/out]
+                                size_t first,              // [in]
+                                const mem_change_t *change // [in]
+) {
+    if (vec->n > first) {
+        mem_change_t *last = (mem_change_t *)vec->items + vec->n - 1;
+        if (changes_adjoin(last, change)) {
+            last->len += change->len;
+            return 0;
+        }
+    }
+    mem_change_t *slot = vec_push(vec, sizeof(mem_change_t));
+    if (!slot) {
+        return -1;
+    }
+    *slot = *change;
+    return 0;
+}
+
+/**
+ * Copy the hits of every task out of the worker buffers, in task order
+ * (which is address order), and free the buffers.
+ *
+ * @param vecs Per-worker hit buffers (freed by this function).
+ * @param runs Where the hits of every task are.
+ * @param ntasks Number of tasks.
+ * @param elem_size Size of an element.
+ * @param out Pointer to the output array (NULL if there are no hits).
+ * @param out_count Pointer to the number of elements.
+ * @return 0 on success, -1 on allocation failure (here or in a task).
+ */
+static int merge_runs(worker_vec_t *vecs,     // [in]
+                      const task_run_t *runs, // [in]
+                      size_t ntasks,          // [in]
+                      size_t elem_size,       // [in]
+                      void **out,             // [out]
+                      size_t *out_count       // [out]
+) {
+    *out = NULL;
+    *out_count = 0;
+
+    size_t total = 0;
+    int rc = 0;
+    for (size_t w = 0; w < pool_workers(); w++) {
+        total += vecs[w].n;
+        if (vecs[w].failed) {
+            rc = -1;
+        }
+    }
+
+    if (rc == 0 && total > 0) {
+        uint8_t *dst = malloc(total * elem_size);
+        if (dst) {
+            size_t k = 0;
+            for (size_t t = 0; t < ntasks; t++) {
+                const worker_vec_t *vec = &vecs[runs[t].worker];
+                memcpy(dst + k * elem_size,
+                       vec->items + runs[t].first * elem_size,
+                       runs[t].count * elem_size);
+                k += runs[t].count;
+            }
+            *out = dst;
+            *out_count = total;
+        } else {
+            perror("Failed to allocate memory for scan results");
+            rc = -1;
+        }
+    }
+    worker_vecs_destroy(vecs);
+    return rc;
+}
+
+/**
+ * Cut the regions into byte-balanced slices for the thread pool.
+ *
+ * @param regions Array of memory regions.
+ * @param rcount Number of memory regions.
+ * @param count Pointer to store the number of slices.
+ * @return A malloc'd array of slices, or NULL if there is nothing to do.
+ */
+static pool_slice_t *slice_regions(const mem_region_t *regions, // [in]
+                                   size_t rcount,               // [in]
+                                   size_t *count                // [out]
+) {
+    *count = 0;
+    size_t *lens = calloc(rcount ? rcount : 1, sizeof(*lens));
+    if (!lens) {
+        return NULL;
+    }
+    for (size_t i = 0; i < rcount; i++) {
+        lens[i] = regions[i].data ? regions[i].len : 0;
+    }
+    pool_slice_t *slices = pool_slice(lens, rcount, SCAN_SLICE_BYTES, count);
+    free(lens);
+    return slices;
+}
+
+/**
+ * NOTE:
+ * Every search task encodes its hits into a candidate block of its own,
+ * covering its slice, so the merge only hands the blocks over to the set in
+ * task (= address) order. With a limit, a task stops once it has found
+ * `limit` hits, and the tasks past the first ones that together found
+ * `limit` hits are not run at all.
+ */
+typedef struct {
+    cand_block_t *blocks; // one per task, NULL when only counting
+    size_t *counts;       // hits of every task, SIZE_MAX until it's done
+    size_t ntasks;
+    size_t align;  // spacing of the candidates
+    size_t limit;  // stop after this many hits (SIZE_MAX: never)
+    bool failed;   // a task ran out of memory
+    size_t done;   // tasks [0, done) are finished
+    size_t done_hits;             // hits of tasks [0, done)
+    atomic_size_t stop_from;      // tasks from here on may stop
+    pthread_mutex_t lock;
+} search_sink_t;
+
+/**
+ * Prepare the sink of a search of `ntasks` tasks.
+ *
+ * @param sink The sink to initialize.
+ * @param ntasks Number of tasks.
+ * @param align Spacing of the candidates.
+ * @param opts Search options, or NULL for a full search.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int sink_init(search_sink_t *sink,        // [out]
+                     size_t ntasks,              // [in]
+                     size_t align,               // [in]
+                     const search_opts_t *opts   // [in]
+) {
+    memset(sink, 0, sizeof(*sink));
+    sink->ntasks = ntasks;
+    sink->align = align;
+    sink->limit = opts && opts->limit ? opts->limit : SIZE_MAX;
+    atomic_init(&sink->stop_from, SIZE_MAX);
+    sink->counts = malloc(ntasks * sizeof(size_t));
+    if (!opts || !opts->count_only) {
+        sink->blocks = calloc(ntasks, sizeof(cand_block_t));
+    }
+    if (!sink->counts || (!sink->blocks && !(opts && opts->count_only))) {
+        free(sink->counts);
+        free(sink->blocks);
+        return -1;
+    }
+    for (size_t t = 0; t < ntasks; t++) {
+        sink->counts[t] = SIZE_MAX;
+    }
+    pthread_mutex_init(&sink->lock, NULL);
+    return 0;
+}
+
+/**
+ * Check whether a task may stop, as enough hits were found before it.
+ */
+static inline bool sink_stopped(search_sink_t *sink, size_t task) {
+    return task >= atomic_load_explicit(&sink->stop_from,
+                                        memory_order_relaxed);
+}
+
+/**
+ * Record a hit of a task.
+ *
+ * @param sink The sink.
+ * @param task The task.
+ * @param n Number of hits of the task so far, incremented.
+ * @param addr Address of the hit.
+ * @return true to go on, false if the task should stop.
+ */
+static inline bool sink_hit(search_sink_t *sink, // [in/out]
+                            size_t task,         // [in]
+                            size_t *n,           // [in/out]
+                            uintptr_t addr       // [in]
+) {
+    ++*n;
+    if (sink->blocks &&
+        cand_block_push(&sink->blocks[task], sink->align, addr) != 0) {
+        return false; // the block misses a hit, sink_done() notices
+    }
+    return *n < sink->limit;
+}
+
+/**
+ * Record that a task is finished, and stop the tasks that are no longer
+ * needed if the finished prefix of tasks found enough hits.
+ *
+ * @param sink The sink.
+ * @param task The task.
+ * @param n Number of hits of the task.
+ */
+static void sink_done(search_sink_t *sink, size_t task, size_t n) {
+    pthread_mutex_lock(&sink->lock);
+    if (sink->blocks && sink->blocks[task].count != n) {
+        sink->failed = true;
+    }
+    sink->counts[task] = n;
+    while (sink->done < sink->ntasks && sink->counts[sink->done] != SIZE_MAX) {
+        sink->done_hits += sink->counts[sink->done++];
+    }
+    if (sink->done_hits >= sink->limit) {
+        atomic_store(&sink->stop_from, sink->done);
+    }
+    pthread_mutex_unlock(&sink->lock);
+}
+
+/**
+ * Hand the blocks of every task over to a candidate set, in task order, and
+ * free the sink.
+ *
+ * @param sink The sink.
+ * @param out The candidate set to fill (may be NULL when only counting).
+ * @param out_count Pointer to store the number of hits.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int sink_merge(search_sink_t *sink, // [in]
+                      candset_t *out,      // [in/out]
+                      size_t *out_count    // [out]
+) {
+    int rc = sink->failed ? -1 : 0;
+    size_t total = 0;
+    for (size_t t = 0; t < sink->ntasks; t++) {
+        if (sink->counts[t] != SIZE_MAX && total < sink->limit) {
+            total += sink->counts[t];
+        }
+        if (!sink->blocks) {
+            continue;
+        }
+        if (rc == 0 && out && candset_append(out, &sink->blocks[t]) != 0) {
+            rc = -1;
+        }
+        cand_block_free(&sink->blocks[t]);
+    }
+    if (total > sink->limit) {
+        total = sink->limit;
+    }
+    if (rc == 0 && out && candset_truncate(out, total) != 0) {
+        rc = -1;
+    }
+    if (rc != 0 && out) {
+        candset_free(out);
+    }
+    *out_count = rc == 0 ? total : 0;
+
+    pthread_mutex_destroy(&sink->lock);
+    free(sink->blocks);
+    free(sink->counts);
+    return rc;
+}
+
+/**
+ * Turn a candidate set into an array of scan results.
+ *
+ * @param set The candidate set (freed by this function).
+ * @param out Pointer to the output array of scan results.
+ * @param out_count Pointer to the number of results.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int candset_to_results(candset_t *set,      // [in]
+                              scan_result_t **out, // [out]
+                              size_t *out_count    // [out]
+) {
+    *out = NULL;
+    *out_count = 0;
+    size_t count = candset_count(set);
+    if (count == 0) {
+        candset_free(set);
+        return 0;
+    }
+
+    *out = malloc(count * sizeof(scan_result_t));
+    if (!*out) {
+        perror("Failed to allocate memory for scan results");
+        candset_free(set);
+        return -1;
+    }
+    cand_iter_t it;
+    cand_iter_init(&it, set);
+    uintptr_t addr;
+    while (cand_iter_next(&it, &addr)) {
+        (*out)[(*out_count)++] = (scan_result_t){
+            .addr = addr,
+            .len = set->elem_size,
+        };
+    }
+    candset_free(set);
+    return 0;
+}
+
+/**
+ * NOTE:
+ * Signatures and regexes are scanned the same way, as a matcher: a pair of
+ * masked bytes at a fixed offset of every match (the anchor), found with
+ * the vector pair kernel, and a verification at every anchor hit that
+ * gives the length of the match there. The second byte of the pair may be
+ * any byte (mask 0), which is how a single byte anchor is scanned; such a
+ * pair may reach one byte past the region, so the last position of a
+ * region is checked on its own.
+ */
+typedef struct {
+    size_t anchor; // offset of the pair in a match
+    uint8_t b0, m0, b1, m1;
+    size_t min_len;         // a match has at least this many bytes
+    const signature_t *sig; // verified with sig_match(), or
+    const text_regex_t *re; // with text_regex_match()
+} matcher_t;
+
+/**
+ * Build the matcher of a signature, with its anchor as the pair (or a
+ * single anchor byte and its neighbor inside the signature).
+ */
+static matcher_t sig_matcher(const signature_t *sig) {
+    size_t a = sig->anchor;
+    if (sig->anchor_len == 1 && a + 1 == sig->len && a > 0) {
+        a--;
+    }
+    matcher_t m = {.anchor = a,
+                   .b0 = sig->bytes[a],
+                   .m0 = sig->mask[a],
+                   .min_len = sig->len,
+                   .sig = sig};
+    if (a + 1 < sig->len) {
+        m.b1 = sig->bytes[a + 1];
+        m.m1 = sig->mask[a + 1];
+    }
+    return m;
+}
+
+/**
+ * Build the matcher of a regex, anchored on its first two bytes.
+ */
+static matcher_t regex_matcher(const text_regex_t *re) {
+    return (matcher_t){.b0 = re->first[0],
+                       .m0 = re->first_mask[0],
+                       .b1 = re->first[1],
+                       .m1 = re->first_mask[1],
+                       .min_len = re->min_len,
+                       .re = re};
+}
+
+// Shared context of the search_matchers() tasks
+typedef struct {
+    const mem_region_t *regions;
+    const pool_slice_t *slices;
+    const matcher_t *matchers;
+    size_t nmatchers;
+    size_t align; // only keep matches at a multiple of this
+    pair_kernel_t pair;
+    search_sink_t *sinks; // one per matcher
+} match_ctx_t;
+
+/**
+ * Check that no page under [offset, offset + len) of a region is unknown.
+ */
+static inline bool span_known(const mem_region_t *region, size_t offset,
+                              size_t len) {
+    if (!region->pages) {
+        return true;
+    }
+    const size_t page = page_size();
+    for (size_t p = offset / page; p <= (offset + len - 1) / page; p++) {
+        if (region_page_state(region, p) == PAGE_UNKNOWN) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Verify a matcher at a position of a region whose anchor passed.
+ *
+ * @return The length of the match there, 0 if there is none.
+ */
+static inline size_t matcher_verify(const matcher_t *m,
+                                    const mem_region_t *region,
+                                    size_t start) {
+    size_t len = 0;
+    if (m->sig) {
+        len = sig_match(m->sig, region->data + start) ? m->sig->len : 0;
+    } else {
+        len = text_regex_match(m->re, region->data + start,
+                               region->len - start);
+    }
+    return len && span_known(region, start, len) ? len : 0;
+}
+
+/**
+ * Run one matcher over one slice: find its anchor with the vector
+ * prefilter, then verify the match at every anchor hit. Matches start in
+ * the slice, but may end past it (not past the region).
+ */
+static void match_scan_slice(match_ctx_t *c, size_t task, size_t s) {
+    const pool_slice_t *slice = &c->slices[task];
+    const mem_region_t *region = &c->regions[slice->index];
+    const matcher_t *m = &c->matchers[s];
+    search_sink_t *sink = &c->sinks[s];
+    const size_t page = page_size();
+    uint32_t hits[COMPARE_CHUNK];
+    bool go_on = true;
+    size_t n = 0;
+
+    if (sink->blocks) {
+        cand_block_init(&sink->blocks[task], region->start + slice->offset,
+                        slice->len);
+    }
+
+    // Positions of the anchor for the matches starting in the slice
+    size_t from = slice->offset + m->anchor;
+    size_t to = slice->offset + slice->len + m->anchor;
+    if (region->len < m->min_len) {
+        to = from;
+    } else if (to > region->len - m->min_len + m->anchor + 1) {
+        to = region->len - m->min_len + m->anchor + 1;
+    }
+    // The pair kernel reads a byte past every position
+    size_t last = to == region->len ? to - 1 : to;
+
+    for (size_t seg = from; seg < last && go_on && !sink_stopped(sink, task);) {
+        size_t seg_end = (seg / page + 1) * page;
+        if (seg_end > last) {
+            seg_end = last;
+        }
+        size_t pos = seg;
+        switch (region_page_state(region, seg / page)) {
+        case PAGE_UNKNOWN:
+            pos = seg_end;
+            break;
+        case PAGE_ZERO:
+            // Only an anchor passed by zeros is found here, or a pair
+            // reaching into the next page with its first byte
+            if (m->b0 != 0) {
+                pos = seg_end;
+            } else if (m->b1 != 0) {
+                pos = seg_end - 1;
+            }
+            break;
+        default:
+            break;
+        }
+
+        for (; pos < seg_end && go_on; pos += COMPARE_CHUNK) {
+            size_t chunk =
+                seg_end - pos < COMPARE_CHUNK ? seg_end - pos : COMPARE_CHUNK;
+            size_t found = c->pair(region->data + pos, chunk, m->b0, m->m0,
+                                   m->b1, m->m1, hits);
+            for (size_t k = 0; k < found && go_on; k++) {
+                size_t start = pos + hits[k] - m->anchor;
+                if (start % c->align == 0 &&
+                    matcher_verify(m, region, start)) {
+                    go_on = sink_hit(sink, task, &n, region->start + start);
+                }
+            }
+        }
+        seg = seg_end;
+    }
+    if (last < to && go_on && !sink_stopped(sink, task) &&
+        (region->data[last] & m->m0) == m->b0) {
+        size_t start = last - m->anchor;
+        if (start % c->align == 0 && matcher_verify(m, region, start)) {
+            sink_hit(sink, task, &n, region->start + start);
+        }
+    }
+    sink_done(sink, task, n);
+}
+
+/**
+ * Task function of search_matchers(): run every matcher over one slice.
+ */
+static void match_task_fn(void *arg, size_t task, size_t worker) {
+    (void)worker;
+    match_ctx_t *c = arg;
+    for (size_t s = 0; s < c->nmatchers; s++) {
+        match_scan_slice(c, task, s);
+    }
+}
+
+/**
+ * Run matchers over memory regions, all of them in one pass over the
+ * slices, keeping the match starts of every matcher as a candidate set of
+ * its shortest match length.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+static int search_matchers(mem_region_t *regions,      // [in]
+                           size_t rcount,              // [in]
+                           const matcher_t *matchers,  // [in]
+                           size_t nmatchers,           // [in]
+                           const search_opts_t *opts,  // [in]
+                           candset_t *outs,            // [out]
+                           size_t *counts              // [out]
+) {
+    size_t align = opts && opts->align ? opts->align : 1;
+    for (size_t s = 0; s < nmatchers; s++) {
+        counts[s] = 0;
+        if (outs) {
+            candset_init(&outs[s], matchers[s].min_len, align);
+        }
+    }
+    size_t slice_count = 0;
+    pool_slice_t *slices = slice_regions(regions, rcount, &slice_count);
+    search_sink_t *sinks = calloc(nmatchers ? nmatchers : 1, sizeof(*sinks));
+    if (slice_count == 0 || !sinks) {
+        free(slices);
+        free(sinks);
+        return slice_count == 0 ? 0 : -1;
+    }
+    size_t ready = 0;
+    while (ready < nmatchers &&
+           sink_init(&sinks[ready], slice_count, align, opts) == 0) {
+        ready++;
+    }
+    int rc = ready == nmatchers ? 0 : -1;
+
+    if (rc == 0) {
+        match_ctx_t ctx = {.regions = regions,
+                           .slices = slices,
+                           .matchers = matchers,
+                           .nmatchers = nmatchers,
+                           .align = align,
+                           .pair = pair_kernel(simd_level()),
+                           .sinks = sinks};
+        pool_run(slice_count, match_task_fn, &ctx);
+    }
+    for (size_t s = 0; s < ready; s++) {
+        if (rc == 0) {
+            rc = sink_merge(&sinks[s], outs ? &outs[s] : NULL, &counts[s]);
+        } else {
+            sink_merge(&sinks[s], NULL, &counts[s]); // just free it
+        }
+    }
+    for (size_t s = 0; rc != 0 && outs && s < nmatchers; s++) {
+        candset_free(&outs[s]);
+        counts[s] = 0;
+    }
+    free(slices);
+    free(sinks);
+    return rc;
+}
+
+/**
+ * Search for byte signatures with wildcards (see signature_t) in memory
+ * regions, all of them in one pass over the slices, keeping the matches of
+ * every signature as a candidate set.
+ *
+ * @param regions Array of memory regions to search.
+ * @param rcount Number of memory regions.
+ * @param sigs The signatures.
+ * @param nsigs Number of signatures.
+ * @param opts Search options (count only, limit per signature, alignment of
+ *             the matches; natural is 1 here), or NULL for none.
+ * @param outs Candidate set of every signature to store its matches in
+ *             (may be NULL when only counting).
+ * @param counts Number of matches of every signature.
+ * @return 0 on success, -1 on failure.
+ */
+int search_sig_set(mem_region_t *regions,     // [in]
+                   size_t rcount,             // [in]
+                   const signature_t *sigs,   // [in]
+                   size_t nsigs,              // [in]
+                   const search_opts_t *opts, // [in]
+                   candset_t *outs,           // [out]
+                   size_t *counts             // [out]
+) {
+    matcher_t *matchers = malloc((nsigs ? nsigs : 1) * sizeof(*matchers));
+    if (!matchers) {
+        perror("Failed to allocate the matchers");
+        return -1;
+    }
+    for (size_t s = 0; s < nsigs; s++) {
+        matchers[s] = sig_matcher(&sigs[s]);
+    }
+    int rc = search_matchers(regions, rcount, matchers, nsigs, opts, outs,
+                             counts);
+    free(matchers);
+    return rc;
+}
+
+/**
+ * Search for the text a regex matches in memory regions, keeping where
+ * every match starts as a candidate set (of the shortest match length).
+ * A match is at most TEXT_MAX_MATCH bytes long.
+ *
+ * @param regions Array of memory regions to search.
+ * @param rcount Number of memory regions.
+ * @param re The compiled regex.
+ * @param opts Search options (count only, limit, alignment of the matches;
+ *             natural is 1 here), or NULL for none.
+ * @param out Candidate set to store the matches in (may be NULL when only
+ *            counting).
+ * @param out_count Pointer to the number of matches found.
+ * @return 0 on success, -1 on failure.
+ */
+int search_regex_set(mem_region_t *regions,     // [in]
+                     size_t rcount,             // [in]
+                     const text_regex_t *re,    // [in]
+                     const search_opts_t *opts, // [in]
+                     candset_t *out,            // [out]
+                     size_t *out_count          // [out]
+) {
+    matcher_t m = regex_matcher(re);
+    return search_matchers(regions, rcount, &m, 1, opts, out, out_count);
+}
+
+/**
+ * Search for specific byte-pattern (not always with a numerical value) in
+ * memory regions, keeping the matches as a candidate set. The pattern is
+ * searched as a signature without wildcards.
+ *
+ * @param regions Array of memory regions to search.
+ * @param rcount Number of memory regions.
+ * @param pattern Pointer to the value to compare against.
+ * @param pattern_len Size of the value type (e.g., sizeof(int)).
+ * @param opts Search options (count only, limit, alignment; natural is 1
+ *             here), or NULL for none.
+ * @param out Candidate set to store the matches in (may be NULL when only
+ *            counting).
+ * @param out_count Pointer to the number of matches found.
+ * @return 0 on success, -1 on failure.
+ */
+int search_exact_set(mem_region_t *regions,     // [in]
+                     size_t rcount,             // [in]
+                     const void *pattern,       // [in]
+                     size_t pattern_len,        // [in]
+                     const search_opts_t *opts, // [in]
+                     candset_t *out,            // [out]
+                     size_t *out_count          // [out]
+) {
+    *out_count = 0;
+    if (pattern_len == 0) {
+        if (out) {
+            candset_init(out, 0, 1);
+        }
+        return 0;
+    }
+    signature_t sig;
+    if (sig_from_bytes(pattern, pattern_len, &sig) != 0) {
+        return -1;
+    }
+    int rc = search_sig_set(regions, rcount, &sig, 1, opts, out, out_count);
+    sig_free(&sig);
+    return rc;
+}
+
+/**
+ * Search for specific byte-pattern (not always with a numerical value) in
+ * memory regions based on a comparison operation.
+ *
+ * @param regions Array of memory regions to search.
+ * @param rcount Number of memory regions.
+ * @param pattern Pointer to the value to compare against.
+ * @param pattern_len Size of the value type (e.g., sizeof(int)).
+ * @param out Pointer to the output array of scan results.
+ * @param out_count Pointer to the number of results found.
+ */
+int search_exact(mem_region_t *regions, // [in]
+                 size_t rcount,         // [in]
+                 const void *pattern,   // [in]
+                 size_t pattern_len,    // [in]
+                 scan_result_t **out,   // [out]
+                 size_t *out_count      // [out]
+) {
+    *out = NULL;
+    *out_count = 0;
+    candset_t set;
+    size_t count;
+    if (search_exact_set(regions, rcount, pattern, pattern_len, NULL, &set,
+                         &count) != 0) {
+        return -1;
+    }
+    return candset_to_results(&set, out, out_count);
+}
+
+/**
+ * Get the size of the elements of a type.
+ *
+ * @param type The type.
+ * @return Its size in bytes, or 0 if it is invalid.
+ */
+size_t scan_type_size(scan_type_t type) {
+    static const size_t sizes[] = {1, 2, 4, 8, 4, 8};
+    return (unsigned)type < sizeof(sizes) / sizeof(sizes[0]) ? sizes[type] : 0;
+}
+
+/**
+ * Get a page of zeros, standing in for the hole pages that are known to be
+ * zero. The first call must not race with others.
+ *
+ * @return The page, or NULL on allocation failure.
+ */
+static const uint8_t *zero_page(void) {
+    static uint8_t *page = NULL;
+    if (!page) {
+        page = calloc(1, page_size());
+    }
+    return page;
+}
+
+/**
+ * Get the bytes of a page of a region, or NULL if the page is unknown.
+ * Zero pages may be holes without data, so they map to zero_page().
+ */
+static inline const uint8_t *page_bytes(const mem_region_t *region, size_t p) {
+    switch (region_page_state(region, p)) {
+    case PAGE_DATA:
+        return region->data + p * page_size();
+    case PAGE_ZERO:
+        return zero_page();
+    default:
+        return NULL;
+    }
+}
+
+/**
+ * Get the bytes of one element of a region. An unaligned element may
+ * straddle two pages, then its bytes are gathered into `buf`.
+ *
+ * @return Pointer to the element, or NULL if a page of it is unknown.
+ */
+static const uint8_t *element_bytes(const mem_region_t *region,
+                                    size_t offset, size_t size,
+                                    uint8_t buf[8]) {
+    const size_t page = page_size();
+    const uint8_t *first = page_bytes(region, offset / page);
+    if (!first || offset / page == (offset + size - 1) / page) {
+        return first ? first + offset % page : NULL;
+    }
+    const uint8_t *second = page_bytes(region, offset / page + 1);
+    if (!second) {
+        return NULL;
+    }
+    size_t head = page - offset % page;
+    memcpy(buf, first + offset % page, head);
+    memcpy(buf + head, second, size - head);
+    return buf;
+}
+
+// Shared context of the search_compare() tasks
+typedef struct {
+    const mem_region_t *regions;
+    const pool_slice_t *slices;
+    size_t type_size;
+    size_t stride;   // distance between the elements (alignment)
+    uint64_t target; // integer value, zero-extended
+    cmp_kernel_t kernel;
+    double lo; // floating-point bounds
+    double hi;
+    fcmp_kernel_t fkernel; // set for floating-point types instead of kernel
+    const pred_t *pred;    // set for predicate searches instead of kernel
+    // Group search: the kernel runs on fields[anchor], every hit of it is
+    // checked against the other fields and the alignment of the group
+    const group_field_t *fields;
+    size_t nfields;
+    size_t anchor;
+    size_t group_align; // groups start at multiples of this
+    search_sink_t *sink;
+} compare_ctx_t;
+
+/**
+ * Run the comparison kernel of a search over n consecutive elements.
+ */
+static inline size_t compare_run(const compare_ctx_t *c, const uint8_t *data,
+                                 size_t n, uint32_t *hits) {
+    if (c->pred) {
+        return pred_run(c->pred, data, n, hits);
+    }
+    return c->fkernel ? c->fkernel(data, n, c->lo, c->hi, hits)
+                      : c->kernel(data, n, c->target, hits);
+}
+
+/**
+ * Check the other fields of a group search around a hit of its anchor.
+ *
+ * @param off Offset of the hit in the region.
+ * @return true if every field passes.
+ */
+static bool group_verify(const compare_ctx_t *c, const mem_region_t *region,
+                         size_t off) {
+    size_t anchor_off = c->fields[c->anchor].offset;
+    if (off < anchor_off) {
+        return false;
+    }
+    size_t base = off - anchor_off;
+    if ((region->start + base) % c->group_align != 0) {
+        return false;
+    }
+    uint8_t buf[8];
+    for (size_t i = 0; i < c->nfields; i++) {
+        const group_field_t *f = &c->fields[i];
+        size_t size = f->pred.type_size;
+        if (i == c->anchor) {
+            continue;
+        }
+        if (base + f->offset + size > region->len) {
+            return false;
+        }
+        const uint8_t *bytes =
+            element_bytes(region, base + f->offset, size, buf);
+        if (!bytes || !pred_test(&f->pred, bytes)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Hand a hit over to the sink of a search, once it passes the other fields
+ * of a group search.
+ *
+ * @return false once the sink wants no more hits.
+ */
+static inline bool compare_hit(compare_ctx_t *c, size_t task,
+                               const mem_region_t *region, size_t off,
+                               size_t *n) {
+    if (c->fields && !group_verify(c, region, off)) {
+        return true;
+    }
+    return sink_hit(c->sink, task, n, region->start + off);
+}
+
+/**
+ * NOTE:
+ * Elements closer than their size (stride < type_size, e.g. a qword at
+ * every byte) overlap, so no kernel can take them in one run. They are
+ * split into type_size / stride phases instead: phase p holds the elements
+ * at p * stride, p * stride + type_size, ..., which is an ordinary run of
+ * whole elements, just shifted. Every phase goes through the usual vector
+ * kernel (overlapping the other phases' loads), and a bitmap of the chunk
+ * puts their hits back in address order.
+ */
+
+/**
+ * Compare the elements starting in [from, to) of a region at every stride
+ * bytes, stride < type_size, none of them reaching past `reach`.
+ *
+ * @return false once the sink wants no more hits.
+ */
+static bool compare_unaligned(compare_ctx_t *c, size_t task,
+                              const mem_region_t *region, size_t from,
+                              size_t to, size_t reach, size_t *n) {
+    search_sink_t *sink = c->sink;
+    const size_t type_size = c->type_size;
+    const size_t stride = c->stride;
+    const size_t phases = type_size / stride;
+    uint32_t hits[COMPARE_CHUNK];
+    uint64_t bits[COMPARE_CHUNK / 64];
+
+    if (reach < to + type_size - stride) {
+        to = reach >= from + type_size ? reach - type_size + stride : from;
+    }
+    for (size_t a = from; a < to; a += COMPARE_CHUNK * stride) {
+        size_t b = to - a < COMPARE_CHUNK * stride ? to
+                                                   : a + COMPARE_CHUNK * stride;
+        size_t slots = (b - a) / stride;
+        memset(bits, 0, (slots + 63) / 64 * sizeof(bits[0]));
+        size_t total = 0;
+        for (size_t p = 0; p < phases && a + p * stride < b; p++) {
+            size_t first = a + p * stride;
+            size_t count = (b - first + type_size - 1) / type_size;
+            size_t found = compare_run(c, region->data + first, count, hits);
+            for (size_t k = 0; k < found; k++) {
+                size_t slot = p + hits[k] * phases;
+                bits[slot / 64] |= 1ULL << (slot % 64);
+            }
+            total += found;
+        }
+        if (!sink->blocks && !c->fields && *n + total < sink->limit) {
+            *n += total; // only counting
+            continue;
+        }
+        for (size_t w = 0; w < (slots + 63) / 64; w++) {
+            for (uint64_t m = bits[w]; m; m &= m - 1) {
+                size_t slot = w * 64 + (size_t)__builtin_ctzll(m);
+                if (!compare_hit(c, task, region, a + slot * stride, n)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Compare the elements of a search in one page of a region, [seg, seg_end).
+ * Hole pages are never read: unknown pages are skipped, and zero pages
+ * either match entirely or not at all.
+ *
+ * @param zero_hit Whether an element of zeros matches.
+ * @return false once the sink wants no more hits.
+ */
+static bool compare_page(compare_ctx_t *c, size_t task,
+                         const mem_region_t *region, size_t seg,
+                         size_t seg_end, bool zero_hit, size_t *n) {
+    search_sink_t *sink = c->sink;
+    const size_t type_size = c->type_size;
+    const size_t stride = c->stride;
+    const size_t step = stride > type_size ? stride : type_size;
+    const size_t page = page_size();
+    uint32_t hits[COMPARE_CHUNK];
+    page_state_t state = region_page_state(region, seg / page);
+
+    if (stride < type_size) {
+        // Elements may reach into the next page, unless it is unknown
+        size_t next = (seg / page + 1) * page;
+        size_t reach = region->len;
+        bool next_data = false;
+        if (next < region->len) {
+            page_state_t s = region_page_state(region, next / page);
+            reach = s == PAGE_UNKNOWN ? next : region->len;
+            next_data = s == PAGE_DATA;
+        }
+        size_t from = seg;
+        if (state == PAGE_ZERO && !zero_hit) {
+            // Only the elements reaching into the next page may match
+            from = next_data && seg_end == next &&
+                           next - seg > type_size - stride
+                       ? next - (type_size - stride)
+                       : seg_end;
+        }
+        if (state != PAGE_UNKNOWN && from < seg_end) {
+            return compare_unaligned(c, task, region, from, seg_end, reach,
+                                     n);
+        }
+        return true;
+    }
+
+    if (state == PAGE_UNKNOWN || (state == PAGE_ZERO && !zero_hit)) {
+        return true;
+    }
+
+    bool go_on = true;
+    if (state == PAGE_ZERO) {
+        // Every element of a zero page is a hit
+        for (size_t off = (seg + step - 1) / step * step;
+             off < seg_end && go_on; off += step) {
+            go_on = compare_hit(c, task, region, off, n);
+        }
+        return go_on;
+    }
+
+    // Let the vector kernel find the hits, a chunk at a time
+    size_t count = (seg_end - seg) / type_size;
+    for (size_t i = 0; i < count && go_on; i += COMPARE_CHUNK) {
+        size_t chunk = count - i < COMPARE_CHUNK ? count - i : COMPARE_CHUNK;
+        size_t base = seg + i * type_size;
+        size_t found = compare_run(c, region->data + base, chunk, hits);
+        if (stride > type_size) {
+            // Only every (stride / type_size)-th element counts
+            size_t kept = 0;
+            for (size_t k = 0; k < found; k++) {
+                hits[kept] = hits[k];
+                kept += (base + hits[k] * type_size) % stride == 0;
+            }
+            found = kept;
+        }
+        if (!sink->blocks && !c->fields && *n + found < sink->limit) {
+            *n += found; // only counting
+            continue;
+        }
+        for (size_t k = 0; k < found && go_on; k++) {
+            go_on = compare_hit(c, task, region, base + hits[k] * type_size, n);
+        }
+    }
+    return go_on;
+}
+
+// Comparisons searched in one pass, each with its own sink
+typedef struct {
+    compare_ctx_t *ctxs;
+    size_t count;
+} compare_group_t;
+
+/**
+ * Task function of search_compare(): compare every element of one slice.
+ * With several comparisons in the group, all of them run over a page
+ * before the next one, so each page is read from memory once and the
+ * later kernels find it in the cache.
+ */
+static void compare_task_fn(void *arg, size_t task, size_t worker) {
+    (void)worker;
+    compare_group_t *group = arg;
+    const pool_slice_t *slice = &group->ctxs[0].slices[task];
+    const mem_region_t *region = &group->ctxs[0].regions[slice->index];
+    const size_t page = page_size();
+    uint32_t hits[1];
+    static const uint8_t zero[8];
+    bool zero_hit[SCAN_TYPE_COUNT], go_on[SCAN_TYPE_COUNT];
+    size_t n[SCAN_TYPE_COUNT];
+
+    for (size_t i = 0; i < group->count; i++) {
+        compare_ctx_t *c = &group->ctxs[i];
+        zero_hit[i] = compare_run(c, zero, 1, hits) == 1;
+        go_on[i] = true;
+        n[i] = 0;
+        if (c->sink->blocks) {
+            cand_block_init(&c->sink->blocks[task],
+                            region->start + slice->offset, slice->len);
+        }
+    }
+
+    // Walk the slice page by page, since holes are tracked per page
+    size_t end = slice->offset + slice->len;
+    bool live = true;
+    for (size_t seg = slice->offset; seg < end && live;) {
+        size_t seg_end = (seg / page + 1) * page;
+        if (seg_end > end) {
+            seg_end = end;
+        }
+        live = false;
+        for (size_t i = 0; i < group->count; i++) {
+            compare_ctx_t *c = &group->ctxs[i];
+            go_on[i] = go_on[i] && !sink_stopped(c->sink, task) &&
+                       compare_page(c, task, region, seg, seg_end,
+                                    zero_hit[i], &n[i]);
+            live = live || go_on[i];
+        }
+        seg = seg_end;
+    }
+    for (size_t i = 0; i < group->count; i++) {
+        sink_done(group->ctxs[i].sink, task, n[i]);
+    }
+}
+
+/**
+ * Get the stride of a search: the alignment asked for, or the natural one.
+ *
+ * @return The stride, or 0 (with a message) if the alignment is invalid.
+ */
+static size_t search_stride(const search_opts_t *opts, size_t type_size) {
+    size_t align = opts && opts->align ? opts->align : type_size;
+    if (align > 8 || (align & (align - 1)) != 0) {
+        fprintf(stderr, "ERR: Invalid alignment %zu\n", align);
+        return 0;
+    }
+    return align;
+}
+
+/**
+ * Run comparison searches over every slice of the regions, all of them in
+ * one pass.
+ *
+ * @param regions Array of memory regions to search.
+ * @param rcount Number of memory regions.
+ * @param ctxs Kernel and operands of every search (stride, regions, slices
+ *             and sink are filled in here), at most SCAN_TYPE_COUNT.
+ * @param count Number of searches.
+ * @param opts Search options (count only, limit per search, alignment), or
+ *             NULL for none.
+ * @param outs Candidate set of every search to store its matches in, or
+ *             NULL.
+ * @param out_counts Number of matches of every search.
+ * @return 0 on success, -1 on failure.
+ */
+static int compare_search_group(mem_region_t *regions,     // [in]
+                                size_t rcount,             // [in]
+                                compare_ctx_t *ctxs,       // [in]
+                                size_t count,              // [in]
+                                const search_opts_t *opts, // [in]
+                                candset_t *outs,           // [out]
+                                size_t *out_counts         // [out]
+) {
+    search_sink_t sinks[SCAN_TYPE_COUNT];
+    for (size_t i = 0; i < count; i++) {
+        out_counts[i] = 0;
+        ctxs[i].stride = search_stride(opts, ctxs[i].type_size);
+        if (ctxs[i].stride == 0) {
+            return -1;
+        }
+    }
+    for (size_t i = 0; outs && i < count; i++) {
+        candset_init(&outs[i], ctxs[i].type_size, ctxs[i].stride);
+    }
+    size_t slice_count = 0;
+    pool_slice_t *slices = slice_regions(regions, rcount, &slice_count);
+    if (slice_count == 0 || count == 0) {
+        free(slices);
+        return 0;
+    }
+    size_t ready = 0;
+    while (ready < count &&
+           sink_init(&sinks[ready], slice_count, ctxs[ready].stride, opts) ==
+               0) {
+        ctxs[ready].regions = regions;
+        ctxs[ready].slices = slices;
+        ctxs[ready].sink = &sinks[ready];
+        ready++;
+    }
+    int rc = ready == count ? 0 : -1;
+
+    if (rc == 0) {
+        compare_group_t group = {.ctxs = ctxs, .count = count};
+        pool_run(slice_count, compare_task_fn, &group);
+    }
+    for (size_t i = 0; i < ready; i++) {
+        if (rc == 0) {
+            rc = sink_merge(&sinks[i], outs ? &outs[i] : NULL,
+                            &out_counts[i]);
+        } else {
+            sink_merge(&sinks[i], NULL, &out_counts[i]); // just free it
+        }
+    }
+    for (size_t i = 0; rc != 0 && outs && i < count; i++) {
+        candset_free(&outs[i]);
+        out_counts[i] = 0;
+    }
+    free(slices);
+    return rc;
+}
+
+/**
+ * Run a comparison search over every slice of the regions.
+ *
+ * @param regions Array of memory regions to search.
+ * @param rcount Number of memory regions.
+ * @param ctx Kernel and operands of the search (stride, regions, slices and
+ *            sink are filled in here).
+ * @param opts Search options (count only, limit, alignment), or NULL for
+ *             none.
+ * @param out Candidate set to store the matches in, or NULL.
+ * @param out_count Pointer to the number of matches found.
+ * @return 0 on success, -1 on failure.
+ */
+static int compare_search(mem_region_t *regions,     // [in]
+                          size_t rcount,             // [in]
+                          compare_ctx_t *ctx,        // [in]
+                          const search_opts_t *opts, // [in]
+                          candset_t *out,            // [out]
+                          size_t *out_count          // [out]
+) {
+    return compare_search_group(regions, rcount, ctx, 1, opts, out,
+                                out_count);
+}
+
+/**
+ * Search for floating-point values in memory regions, keeping the matches
+ * as a candidate set. See fcmp_op_t for how NaN and denormals compare.
+ *
+ * @param regions Array of memory regions to search.
+ * @param rcount Number of memory regions.
+ * @param type SCAN_TYPE_FLOAT or SCAN_TYPE_DOUBLE.
+ * @param fcmp Comparison and its bounds (exact, epsilon, range, ...).
+ * @param opts Search options (count only, limit, alignment), or NULL for
+ *             none.
+ * @param out Candidate set to store the matches in (may be NULL when only
+ *            counting).
+ * @param out_count Pointer to the number of matches found.
+ * @return 0 on success, -1 on failure.
+ */
+int search_float_set(mem_region_t *regions,     // [in]
+                     size_t rcount,             // [in]
+                     scan_type_t type,          // [in]
+                     const fcmp_t *fcmp,        // [in]
+                     const search_opts_t *opts, // [in]
+                     candset_t *out,            // [out]
+                     size_t *out_count          // [out]
+) {
+    *out_count = 0;
+    fcmp_kernel_t kernel = fcmp_kernel(simd_level(), type, fcmp->op);
+    if (!kernel) {
+        fprintf(stderr, "ERR: Invalid float type %d or comparison %d\n", type,
+                fcmp->op);
+        return -1;
+    }
+    compare_ctx_t ctx = {.type_size = scan_type_size(type),
+                         .lo = fcmp->lo,
+                         .hi = fcmp->hi,
+                         .fkernel = kernel};
+    return compare_search(regions, rcount, &ctx, opts, out, out_count);
+}
+
+/**
+ * Search for a value under several interpretations in memory regions: as
+ * a word and a dword, a float and a double, and so on. All of them run
+ * over a page before the next one, so the regions are read from memory
+ * once rather than once per type.
+ *
+ * @param regions Array of memory regions to search.
+ * @param rcount Number of memory regions.
+ * @param values The value in every type to look for (at most one per
+ *               type), compared for equality.
+ * @param nvalues Number of interpretations.
+ * @param opts Search options (count only, limit per interpretation,
+ *             alignment instead of the natural one of every type), or NULL
+ *             for none.
+ * @param outs Candidate set of every interpretation to store its matches
+ *             in (may be NULL when only counting).
+ * @param counts Number of matches of every interpretation.
+ * @return 0 on success, -1 on failure.
+ */
+int search_any_set(mem_region_t *regions,     // [in]
+                   size_t rcount,             // [in]
+                   const scan_value_t *values, // [in]
+                   size_t nvalues,            // [in]
+                   const search_opts_t *opts, // [in]
+                   candset_t *outs,           // [out]
+                   size_t *counts             // [out]
+) {
+    compare_ctx_t ctxs[SCAN_TYPE_COUNT];
+    if (nvalues > SCAN_TYPE_COUNT) {
+        fprintf(stderr, "ERR: Too many interpretations (%zu)\n", nvalues);
+        return -1;
+    }
+    for (size_t i = 0; i < nvalues; i++) {
+        scan_type_t type = values[i].type;
+        ctxs[i] = (compare_ctx_t){.type_size = scan_type_size(type)};
+        if (type == SCAN_TYPE_FLOAT || type == SCAN_TYPE_DOUBLE) {
+            ctxs[i].lo = ctxs[i].hi = values[i].fvalue;
+            ctxs[i].fkernel = fcmp_kernel(simd_level(), type, FCMP_RANGE);
+        } else {
+            ctxs[i].target = values[i].value;
+            ctxs[i].kernel = cmp_kernel(simd_level(), type, CMP_EQ);
+        }
+        if (!ctxs[i].kernel && !ctxs[i].fkernel) {
+            fprintf(stderr, "ERR: Invalid scan type %d\n", type);
+            return -1;
+        }
+    }
+    return compare_search_group(regions, rcount, ctxs, nvalues, opts, outs,
+                                counts);
+}
+
+/**
+ * Search for the integers that pass a predicate (see pred_compile()) in
+ * memory regions, in one pass whatever the number of its conditions,
+ * keeping the matches as a candidate set.
+ *
+ * @param regions Array of memory regions to search.
+ * @param rcount Number of memory regions.
+ * @param pred The compiled predicate, which holds the element size.
+ * @param opts Search options (count only, limit, alignment), or NULL for
+ *             none.
+ * @param out Candidate set to store the matches in (may be NULL when only
+ *            counting).
+ * @param out_count Pointer to the number of matches found.
+ * @return 0 on success, -1 on failure.
+ */
+int search_pred_set(mem_region_t *regions,     // [in]
+                    size_t rcount,             // [in]
+                    const pred_t *pred,        // [in]
+                    const search_opts_t *opts, // [in]
+                    candset_t *out,            // [out]
+                    size_t *out_count          // [out]
+) {
+    *out_count = 0;
+    compare_ctx_t ctx = {.type_size = pred->type_size, .pred = pred};
+    return compare_search(regions, rcount, &ctx, opts, out, out_count);
+}
+
+/**
+ * Pick the field of a group search to run the kernel on: the one that
+ * passes the fewest elements of a sample of the data pages, as every hit
+ * of it has to be checked against the other fields.
+ *
+ * @return Index of the field.
+ */
+static size_t group_anchor(const mem_region_t *regions, size_t rcount,
+                           const group_field_t *fields, size_t nfields) {
+    const size_t page = page_size();
+    size_t pages = 0;
+    for (size_t r = 0; r < rcount; r++) {
+        for (size_t p = 0; regions[r].data && p * page < regions[r].len;
+             p++) {
+            pages += region_page_state(&regions[r], p) == PAGE_DATA;
+        }
+    }
+    size_t step = pages > GROUP_SAMPLE_PAGES ? pages / GROUP_SAMPLE_PAGES : 1;
+    size_t passed[GROUP_MAX_FIELDS] = {0};
+    uint32_t hits[COMPARE_CHUNK];
+    size_t seen = 0;
+    for (size_t r = 0; r < rcount; r++) {
+        const mem_region_t *region = &regions[r];
+        for (size_t p = 0; region->data && p * page < region->len; p++) {
+            if (region_page_state(region, p) != PAGE_DATA ||
+                seen++ % step != 0) {
+                continue;
+            }
+            size_t bytes =
+                region->len - p * page < page ? region->len - p * page : page;
+            for (size_t i = 0; i < nfields; i++) {
+                size_t count = bytes / fields[i].pred.type_size;
+                count = count < COMPARE_CHUNK ? count : COMPARE_CHUNK;
+                passed[i] += pred_run(&fields[i].pred,
+                                      region->data + p * page, count, hits);
+            }
+        }
+    }
+    size_t best = 0;
+    for (size_t i = 1; i < nfields; i++) {
+        best = passed[i] < passed[best] ? i : best;
+    }
+    return best;
+}
+
+/**
+ * Search for groups of values at fixed offsets from each other, such as
+ * the fields of a struct, in memory regions. The most selective field is
+ * searched with the vector kernel and the others are checked at every hit
+ * of it, in the same pass. The candidates are the addresses of the first
+ * field.
+ *
+ * A group starts at a multiple of the alignment option, or of the size of
+ * the first field without one, whichever field is searched: that field is
+ * scanned at every multiple of the largest power of two dividing both the
+ * alignment and its offset, and hits whose group would start elsewhere are
+ * dropped.
+ *
+ * @param regions Array of memory regions to search.
+ * @param rcount Number of memory regions.
+ * @param fields The fields: an offset from the start of the group and a
+ *               predicate on the value there (see pred_compile()).
+ * @param nfields Number of fields, 1 to GROUP_MAX_FIELDS.
+ * @param opts Search options (count only, limit, alignment of the start of
+ *             the groups), or NULL for none.
+ * @param out Candidate set to store the matches in (may be NULL when only
+ *            counting).
+ * @param out_count Pointer to the number of matches found.
+ * @return 0 on success, -1 on failure.
+ */
+int search_group_set(mem_region_t *regions,       // [in]
+                     size_t rcount,               // [in]
+                     const group_field_t *fields, // [in]
+                     size_t nfields,              // [in]
+                     const search_opts_t *opts,   // [in]
+                     candset_t *out,              // [out]
+                     size_t *out_count            // [out]
+) {
+    *out_count = 0;
+    if (nfields == 0 || nfields > GROUP_MAX_FIELDS) {
+        fprintf(stderr, "ERR: A group needs 1 to %d fields\n",
+                GROUP_MAX_FIELDS);
+        return -1;
+    }
+    if (!zero_page()) {
+        return -1;
+    }
+    size_t align = search_stride(opts, fields[0].pred.type_size);
+    if (align == 0) {
+        return -1;
+    }
+    size_t anchor = group_anchor(regions, rcount, fields, nfields);
+    search_opts_t anchor_opts = opts ? *opts : (search_opts_t){0};
+    anchor_opts.align = align;
+    while (fields[anchor].offset % anchor_opts.align != 0) {
+        anchor_opts.align /= 2;
+    }
+    bool verify = nfields > 1 || anchor_opts.align != align;
+    compare_ctx_t ctx = {.type_size = fields[anchor].pred.type_size,
+                         .pred = &fields[anchor].pred,
+                         .fields = verify ? fields : NULL,
+                         .nfields = nfields,
+                         .anchor = anchor,
+                         .group_align = align};
+    int rc =
+        compare_search(regions, rcount, &ctx, &anchor_opts, out, out_count);
+    if (rc == 0 && out) {
+        candset_shift(out, fields[0].offset - fields[anchor].offset,
+                      fields[0].pred.type_size);
+    }
+    return rc;
+}
+
+/**
+ * Search for numeric values in memory regions based on a comparison
+ * operation, keeping the matches as a candidate set.
+ *
+ * @param regions Array of memory regions to search.
+ * @param rcount Number of memory regions.
+ * @param type Type of the data to compare (SCAN_TYPE_BYTE, SCAN_TYPE_WORD, ...)
+ * @param cmp Comparison operation (CMP_EQ, CMP_NE, CMP_GT, CMP_LT).
+ * @param value Pointer to the value to compare against.
+ * @param opts Search options (count only, limit, alignment), or NULL for
+ *             none.
+ * @param out Candidate set to store the matches in (may be NULL when only
+ *            counting).
+ * @param out_count Pointer to the number of matches found.
+ * @return 0 on success, -1 on failure.
+ */
+int search_compare_set(mem_region_t *regions,     // [in]
+                       size_t rcount,             // [in]
+                       scan_type_t type,          // [in]
+                       cmp_op_t cmp,              // [in]
+                       const void *value,         // [in]
+                       const search_opts_t *opts, // [in]
+                       candset_t *out,            // [out]
+                       size_t *out_count          // [out]
+) {
+    *out_count = 0;
+
+    switch (cmp) {
+    case CMP_EQ:
+    case CMP_NE:
+    case CMP_GT:
+    case CMP_LT:
+        break;
+    default:
+        fprintf(stderr, "ERR: Invalid comparison operation %d\n", cmp);
+        return -1; // Invalid comparison operation
+    }
+
+    uint64_t target;
+    switch (type) {
+    case SCAN_TYPE_BYTE:
+        target = *(const uint8_t *)value;
+        break;
+    case SCAN_TYPE_WORD:
+        target = *(const uint16_t *)value;
+        break;
+    case SCAN_TYPE_DWORD:
+        target = *(const uint32_t *)value;
+        break;
+    case SCAN_TYPE_QWORD:
+        target = *(const uint64_t *)value;
+        break;
+    case SCAN_TYPE_FLOAT:
+    case SCAN_TYPE_DOUBLE: {
+        // An exact comparison is one with equal bounds, NaN one of its own
+        double v = type == SCAN_TYPE_FLOAT ? *(const float *)value
+                                           : *(const double *)value;
+        static const fcmp_op_t ops[] = {FCMP_RANGE, FCMP_OUTSIDE, FCMP_GT,
+                                        FCMP_LT};
+        fcmp_t fcmp = {.op = ops[cmp], .lo = v, .hi = v};
+        if (v != v && cmp == CMP_EQ) {
+            fcmp.op = FCMP_NAN;
+        }
+        return search_float_set(regions, rcount, type, &fcmp, opts, out,
+                                out_count);
+    }
+    default:
+        fprintf(stderr, "ERR: Invalid scan type %d\n", type);
+        return -1; // Invalid type
+    }
+
+    compare_ctx_t ctx = {.type_size = scan_type_size(type),
+                         .target = target,
+                         .kernel = cmp_kernel(simd_level(), type, cmp)};
+    return compare_search(regions, rcount, &ctx, opts, out, out_count);
+}
+
+/**
+ * Search for numeric values in memory regions based on a comparison
+ * operation.
+ *
+ * @param regions Array of memory regions to search.
+ * @param rcount Number of memory regions.
+ * @param type Type of the data to compare (SCAN_TYPE_BYTE, SCAN_TYPE_WORD, ...)
+ * @param cmp Comparison operation (CMP_EQ, CMP_NE, CMP_GT, CMP_LT).
+ * @param value Pointer to the value to compare against.
+ * @param out Pointer to the output array of scan results.
+ * @param out_count Pointer to the number of results found.
+ */
+int search_compare(mem_region_t *regions, // [in]
+                   size_t rcount,         // [in]
+                   scan_type_t type,      // [in]
+                   cmp_op_t cmp,          // [in]
+                   const void *value,     // [in]
+                   scan_result_t **out,   // [out]
+                   size_t *out_count      // [out]
+) {
+    *out = NULL;
+    *out_count = 0;
+    candset_t set;
+    size_t count;
+    if (search_compare_set(regions, rcount, type, cmp, value, NULL, &set,
+                           &count) != 0) {
+        return -1;
+    }
+    return candset_to_results(&set, out, out_count);
+}
+
+/**
+ * Pair every region of a new scan with the region of an old scan that
+ * starts at the same address, via a hashmap of the old scan.
+ *
+ * @param old_scan Array of memory regions from the old scan.
+ * @param old_n Number of regions in the old scan.
+ * @param new_scan Array of memory regions from the new scan.
+ * @param new_n Number of regions in the new scan.
+ * @return A malloc'd array holding the old region of every new one (NULL
+ * for those without data on either side), or NULL on failure.
+ */
+static mem_region_t **pair_regions(mem_region_t *old_scan,       // [in]
+                                   size_t old_n,                 // [in]
+                                   const mem_region_t *new_scan, // [in]
+                                   size_t new_n                  // [in]
+) {
+    // Create a hash map from the old scan for quick lookups
+    hash_map_t *old_map = hash_map_create(old_n > 0 ? old_n * 2 - 1 : 16);
+    if (!old_map) {
+        perror("Failed to create hash map");
+        return NULL;
+    }
+    for (size_t i = 0; i < old_n; i++) {
+        // Only map regions that have valid data buffers
+        if (old_scan[i].data) {
+            hash_map_put(old_map, old_scan[i].start, &old_scan[i]);
+        }
+    }
+
+    mem_region_t **old_of = calloc(new_n ? new_n : 1, sizeof(*old_of));
+    for (size_t i = 0; old_of && i < new_n; i++) {
+        if (new_scan[i].data) {
+            old_of[i] = hash_map_get(old_map, new_scan[i].start);
+        }
+    }
+    hash_map_destroy(old_map);
+    return old_of;
+}
+
+/**
+ * Find the region holding an address.
+ *
+ * @param regions Regions in ascending address order.
+ * @param n Number of regions.
+ * @param addr The address.
+ * @return Index of the region, or n if none holds it.
+ */
+static size_t find_region(const mem_region_t *regions, size_t n,
+                          uintptr_t addr) {
+    size_t lo = 0, hi = n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (regions[mid].start + regions[mid].len <= addr) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo < n && regions[lo].start <= addr ? lo : n;
+}
+
+// Shared context of the search_relation_set() tasks
+typedef struct {
+    const mem_region_t *new_scan;
+    size_t new_n;
+    mem_region_t **old_of;
+    const pool_slice_t *slices; // full pass: slices of the new regions
+    const candset_t *within;    // restricted pass: candidates to check
+    size_t type_size;
+    uint64_t lo;
+    uint64_t end;
+    rel_kernel_t kernel;
+    double flo; // floating-point delta bounds
+    double fhi;
+    frel_kernel_t fkernel; // set for floating-point types instead of kernel
+    search_sink_t *sink;
+} relation_ctx_t;
+
+/**
+ * Run the relation kernel of a search over n consecutive elements.
+ */
+static inline size_t relation_run(const relation_ctx_t *c, const uint8_t *old,
+                                  const uint8_t *cur, size_t n,
+                                  uint32_t *hits) {
+    return c->fkernel ? c->fkernel(old, cur, n, c->flo, c->fhi, hits)
+                      : c->kernel(old, cur, n, c->lo, c->end, hits);
+}
+
+/**
+ * Task function of a full search_relation_set(): compare every element of
+ * one slice of a new region with the same element of its old region, a
+ * page at a time.
+ */
+static void relation_task_fn(void *arg, size_t task, size_t worker) {
+    (void)worker;
+    relation_ctx_t *c = arg;
+    const pool_slice_t *slice = &c->slices[task];
+    const mem_region_t *new_region = &c->new_scan[slice->index];
+    const mem_region_t *old_region = c->old_of[slice->index];
+    search_sink_t *sink = c->sink;
+    const size_t type_size = c->type_size;
+    const size_t page = page_size();
+    uint32_t hits[COMPARE_CHUNK];
+    bool go_on = true;
+    size_t n = 0;
+
+    if (sink->blocks) {
+        cand_block_init(&sink->blocks[task],
+                        new_region->start + slice->offset, slice->len);
+    }
+
+    size_t end = slice->offset + slice->len;
+    for (size_t seg = slice->offset;
+         seg < end && go_on && !sink_stopped(sink, task);) {
+        size_t seg_end = (seg / page + 1) * page;
+        if (seg_end > end) {
+            seg_end = end;
+        }
+        const uint8_t *old_page = page_bytes(old_region, seg / page);
+        const uint8_t *new_page = page_bytes(new_region, seg / page);
+        if (!old_page || !new_page) {
+            seg = seg_end; // unknown on either side
+            continue;
+        }
+
+        size_t in_page = seg % page;
+        size_t count = (seg_end - seg) / type_size;
+        for (size_t i = 0; i < count && go_on; i += COMPARE_CHUNK) {
+            size_t chunk =
+                count - i < COMPARE_CHUNK ? count - i : COMPARE_CHUNK;
+            size_t base = in_page + i * type_size;
+            size_t found =
+                relation_run(c, old_page + base, new_page + base, chunk, hits);
+            if (!sink->blocks && n + found < sink->limit) {
+                n += found; // only counting
+                continue;
+            }
+            for (size_t k = 0; k < found && go_on; k++) {
+                go_on = sink_hit(sink, task, &n,
+                                 new_region->start + seg + i * type_size +
+                                     hits[k] * type_size);
+            }
+        }
+        seg = seg_end;
+    }
+    sink_done(sink, task, n);
+}
+
+/**
+ * Task function of a restricted search_relation_set(): check the relation
+ * of every candidate of one block of the candidate set.
+ */
+static void relation_within_task_fn(void *arg, size_t task, size_t worker) {
+    (void)worker;
+    relation_ctx_t *c = arg;
+    const candset_t *within = c->within;
+    const cand_block_t *block = &within->blocks[task];
+    search_sink_t *sink = c->sink;
+    const size_t type_size = c->type_size;
+    size_t n = 0, r = c->new_n;
+    uint8_t old_buf[8], new_buf[8];
+    uint32_t hit;
+
+    if (sink->blocks) {
+        cand_block_init(&sink->blocks[task], block->start, block->len);
+    }
+
+    cand_iter_t it;
+    cand_iter_init_block(&it, within, task);
+    uintptr_t addr;
+    while (cand_iter_next(&it, &addr)) {
+        // Candidates are sorted, so the region usually stays the same
+        if (r == c->new_n || addr < c->new_scan[r].start ||
+            addr + type_size >
+                c->new_scan[r].start + c->new_scan[r].len) {
+            r = find_region(c->new_scan, c->new_n, addr);
+            if (r == c->new_n) {
+                continue; // vanished
+            }
+        }
+        const mem_region_t *new_region = &c->new_scan[r];
+        const mem_region_t *old_region = c->old_of[r];
+        size_t offset = addr - new_region->start;
+        if (!old_region || offset + type_size > old_region->len ||
+            offset + type_size > new_region->len) {
+            continue;
+        }
+        const uint8_t *old_value =
+            element_bytes(old_region, offset, type_size, old_buf);
+        const uint8_t *new_value =
+            element_bytes(new_region, offset, type_size, new_buf);
+        if (!old_value || !new_value) {
+            continue;
+        }
+        if (relation_run(c, old_value, new_value, 1, &hit) == 1 &&
+            !sink_hit(sink, task, &n, addr)) {
+            break;
+        }
+    }
+    sink_done(sink, task, n);
+}
+
+/**
+ * Search for elements whose value relates to their value in an older scan
+ * in a given way (changed, increased, went up by 10, ...). Regions of the
+ * two scans are paired by their start address.
+ *
+ * @param old_scan Array of memory regions from the old scan.
+ * @param old_n Number of regions in the old scan.
+ * @param new_scan Array of memory regions from the new scan.
+ * @param new_n Number of regions in the new scan.
+ * @param type Type of the elements.
+ * @param rel The relation between the old and the new value.
+ * @param within Only check these candidates (of the same type), or NULL to
+ *               check every element.
+ * @param opts Search options (count only, limit), or NULL for none.
+ * @param out Candidate set to store the matches in (may be NULL when only
+ *            counting).
+ * @param out_count Pointer to the number of matches found.
+ * @return 0 on success, -1 on failure.
+ */
+int search_relation_set(mem_region_t *old_scan,    // [in]
+                        size_t old_n,              // [in]
+                        mem_region_t *new_scan,    // [in]
+                        size_t new_n,              // [in]
+                        scan_type_t type,          // [in]
+                        const relation_t *rel,     // [in]
+                        const candset_t *within,   // [in]
+                        const search_opts_t *opts, // [in]
+                        candset_t *out,            // [out]
+                        size_t *out_count          // [out]
+) {
+    *out_count = 0;
+    rel_kernel_t kernel = rel_kernel(simd_level(), type, rel->op);
+    frel_kernel_t fkernel = frel_kernel(simd_level(), type, rel->op);
+    if (!kernel && !fkernel) {
+        fprintf(stderr, "ERR: Invalid scan type %d or relation %d\n", type,
+                rel->op);
+        return -1;
+    }
+    const size_t type_size = scan_type_size(type);
+    if (within && within->elem_size != type_size) {
+        fprintf(stderr, "ERR: Candidates are of another type\n");
+        return -1;
+    }
+
+    // [lo, hi] as a start and a length, both wrapped to the type
+    uint64_t mask = type_size == 8 ? UINT64_MAX : (1ULL << (type_size * 8)) - 1;
+    uint64_t lo = (uint64_t)rel->lo & mask;
+    uint64_t span = (uint64_t)rel->hi - (uint64_t)rel->lo;
+    if (rel->op == REL_INCREASED || rel->op == REL_DECREASED) {
+        // The kernels flip the sign bit to order signed values
+        lo = rel->is_signed ? 1ULL << (type_size * 8 - 1) : 0;
+    }
+    if (rel->op == REL_DELTA &&
+        (fkernel ? !(rel->flo <= rel->fhi)
+                 : rel->hi < rel->lo || span >= mask)) {
+        fprintf(stderr, "ERR: Invalid delta range\n");
+        return -1;
+    }
+
+    if (out) {
+        candset_init(out, type_size, type_size);
+    }
+    if (!zero_page()) {
+        return -1;
+    }
+    mem_region_t **old_of = pair_regions(old_scan, old_n, new_scan, new_n);
+    if (!old_of) {
+        return -1;
+    }
+
+    // One task per slice of the paired regions, or per candidate block
+    size_t ntasks = 0;
+    pool_slice_t *slices = NULL;
+    if (within) {
+        ntasks = within->block_count;
+    } else {
+        size_t *lens = calloc(new_n ? new_n : 1, sizeof(*lens));
+        if (!lens) {
+            free(old_of);
+            return -1;
+        }
+        for (size_t i = 0; i < new_n; i++) {
+            if (old_of[i]) {
+                lens[i] = new_scan[i].len < old_of[i]->len ? new_scan[i].len
+                                                           : old_of[i]->len;
+            }
+        }
+        slices = pool_slice(lens, new_n, SCAN_SLICE_BYTES, &ntasks);
+        free(lens);
+    }
+    search_sink_t sink;
+    if (ntasks == 0 || sink_init(&sink, ntasks, type_size, opts) != 0) {
+        free(slices);
+        free(old_of);
+        return ntasks == 0 ? 0 : -1;
+    }
+
+    relation_ctx_t ctx = {.new_scan = new_scan,
+                          .new_n = new_n,
+                          .old_of = old_of,
+                          .slices = slices,
+                          .within = within,
+                          .type_size = type_size,
+                          .lo = lo,
+                          .end = (span + 1) & mask,
+                          .kernel = kernel,
+                          .flo = rel->flo,
+                          .fhi = rel->fhi,
+                          .fkernel = fkernel,
+                          .sink = &sink};
+    pool_run(ntasks, within ? relation_within_task_fn : relation_task_fn,
+             &ctx);
+    free(slices);
+    free(old_of);
+
+    return sink_merge(&sink, out, out_count);
+}
+
+/**
+ * Look up the value of every candidate in a scan. Candidates outside of the
+ * scan or on unknown pages get 0.
+ *
+ * @param set The candidates.
+ * @param regions Regions of the scan.
+ * @param n Number of regions.
+ * @param out Pointer to store the values (elem_size bytes each, in set
+ *            order), NULL if the set is empty.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int candidate_values(const candset_t *set,          // [in]
+                     const mem_region_t *regions, // [in]
+                     size_t n,                    // [in]
+                     uint8_t **out                // [out]
+) {
+    const size_t es = set->elem_size;
+    const size_t page = page_size();
+    uint8_t buf[8];
+    *out = NULL;
+    if (candset_count(set) == 0) {
+        return 0;
+    }
+    uint8_t *values = calloc(candset_count(set), es);
+    if (!values || !zero_page()) {
+        free(values);
+        return -1;
+    }
+
+    cand_iter_t it;
+    cand_iter_init(&it, set);
+    uintptr_t addr;
+    for (size_t k = 0; cand_iter_next(&it, &addr); k++) {
+        size_t r = find_region(regions, n, addr);
+        if (r == n) {
+            continue;
+        }
+        size_t offset = addr - regions[r].start;
+        if (offset + es > regions[r].len) {
+            continue;
+        }
+        const uint8_t *p = NULL;
+        if (es <= sizeof(buf)) {
+            p = element_bytes(&regions[r], offset, es, buf);
+        } else if (offset / page == (offset + es - 1) / page) {
+            const uint8_t *first = page_bytes(&regions[r], offset / page);
+            p = first ? first + offset % page : NULL;
+        }
+        if (p) {
+            memcpy(values + k * es, p, es);
+        }
+    }
+    *out = values;
+    return 0;
+}
+
+// A stretch of memory both scans have: where an old and a new region
+// overlap
+typedef struct {
+    const mem_region_t *old_region;
+    const mem_region_t *new_region;
+    uintptr_t addr;
+    size_t len;
+    size_t old_offset; // offset of addr in old_region
+    size_t new_offset; // offset of addr in new_region
+} region_overlap_t;
+
+// How the regions of two scans match: the stretches both have, and as
+// change ranges the ones only one of them has, each in address order
+typedef struct {
+    region_overlap_t *overlaps;
+    size_t overlap_count;
+    mem_change_t *gaps; // CHANGE_NEW and CHANGE_GONE ranges
+    size_t gap_count;
+} region_match_t;
+
 /**
- * Append a new scan result to the results array.
- * If the array is full, it will be resized to accommodate more results.
+ * Order regions by start address, for qsort().
+ */
+static int compare_region_starts(const void *a, const void *b) {
+    const mem_region_t *x = *(const mem_region_t *const *)a;
+    const mem_region_t *y = *(const mem_region_t *const *)b;
+    return x->start < y->start ? -1 : x->start > y->start;
+}
+
+/**
+ * Sort the regions of a scan that have content by start address.
  *
- * @param arr Pointer to the results array.
- * @param n Current number of results in the array.
- * @param capacity Current capacity of the results array.
- * @param addr Address of the found match.
- * @param len Length of the found match.
+ * @return A malloc'd array of pointers to them, or NULL on failure.
  */
-static void append_result(scan_result_t **arr, size_t *n, size_t *capacity,
-                          uintptr_t addr, size_t len) {
-    // Double the capacity if needed
-    if (*n == *capacity) {
-        *capacity = *capacity ? *capacity * 2 : 64;
-        *arr = realloc(*arr, (*capacity) * sizeof(scan_result_t));
-        if (!*arr) {
-            perror("Failed to allocate memory for scan results");
-            exit(EXIT_FAILURE);
+static const mem_region_t **sorted_regions(const mem_region_t *scan,
+                                           size_t n, bool with_hashes,
+                                           size_t *count) {
+    const mem_region_t **sorted = malloc((n ? n : 1) * sizeof(*sorted));
+    if (!sorted) {
+        return NULL;
+    }
+    *count = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (scan[i].data || (with_hashes && scan[i].hashes)) {
+            sorted[(*count)++] = &scan[i];
         }
     }
+    qsort(sorted, *count, sizeof(*sorted), compare_region_starts);
+    return sorted;
+}
 
-    // Append the new result to the array
-    (*arr)[*n] = (scan_result_t){
-        .addr = addr,
-        .len = len,
-    };
-    (*n)++;
+/**
+ * Append the change range of a stretch that only one scan has.
+ *
+ * @param match The match to append to.
+ * @param kind CHANGE_NEW or CHANGE_GONE.
+ * @param region The region holding the stretch.
+ * @param from Start address of the stretch.
+ * @param to End address of the stretch (nothing is appended if <= from).
+ */
+static void append_gap(region_match_t *match, change_kind_t kind,
+                       const mem_region_t *region, uintptr_t from,
+                       uintptr_t to) {
+    if (from >= to) {
+        return;
+    }
+    mem_change_t *gap = &match->gaps[match->gap_count++];
+    *gap = (mem_change_t){.kind = kind, .addr = from, .len = to - from};
+    if (kind == CHANGE_NEW) {
+        gap->new_region = region;
+        gap->new_offset = from - region->start;
+    } else {
+        gap->old_region = region;
+        gap->old_offset = from - region->start;
+    }
 }
 
 /**
- * Append a new memory change to the changes array.
- * If the array is full, it will be resized to accommodate more changes.
+ * Match the regions of two scans by address: a sorted sweep over both
+ * scans cuts them into the stretches where an old and a new region
+ * overlap, and the stretches only one of them has. A region that grew,
+ * shrank, moved its start or was split or merged (by mmap(), mprotect(),
+ * ...) thus only has its truly new and truly gone bytes outside of the
+ * overlaps.
  *
- * @param arr Pointer to the changes array.
- * @param n Current number of changes in the array.
- * @param capacity Current capacity of the changes array.
- * @param addr Address of the changed memory location.
- * @param old_value Old value at that address.
- * @param new_value New value at that address.
+ * @param old_scan Array of memory regions from the old scan.
+ * @param old_n Number of regions in the old scan.
+ * @param new_scan Array of memory regions from the new scan.
+ * @param new_n Number of regions in the new scan.
+ * @param with_hashes If true, hash-only regions take part, too (otherwise
+ * only the regions with data do).
+ * @param match Pointer to store the match (free with region_match_free()).
+ * @return 0 on success, -1 on allocation failure.
  */
-static void append_change(mem_change_t **arr, // [out]
-                          size_t *n,          // [out]
-                          size_t *capacity,   // [out]
-                          uintptr_t addr,     // [in]
-                          uint8_t old_value,  // [in]
-                          uint8_t new_value   // [in]
+static int match_regions(const mem_region_t *old_scan, // [in]
+                         size_t old_n,                 // [in]
+                         const mem_region_t *new_scan, // [in]
+                         size_t new_n,                 // [in]
+                         bool with_hashes,             // [in]
+                         region_match_t *match         // [out]
 ) {
-    if (*n == *capacity) {
-        *capacity = *capacity ? *capacity * 2 : 64;
-        *arr = realloc(*arr, (*capacity) * sizeof(mem_change_t));
-        if (!*arr) {
-            perror("Failed to allocate memory for memory changes");
-            exit(EXIT_FAILURE);
+    *match = (region_match_t){0};
+    size_t on = 0, nn = 0;
+    const mem_region_t **olds = sorted_regions(old_scan, old_n, with_hashes,
+                                               &on);
+    const mem_region_t **news = sorted_regions(new_scan, new_n, with_hashes,
+                                               &nn);
+
+    // Every step of the sweep ends a region, which may start one overlap
+    // and two gaps (one before the overlap on either side)
+    match->overlaps = malloc((on + nn + 1) * sizeof(*match->overlaps));
+    match->gaps = malloc((2 * (on + nn) + 1) * sizeof(*match->gaps));
+    if (!olds || !news || !match->overlaps || !match->gaps) {
+        perror("Failed to match the regions of two scans");
+        free(olds);
+        free(news);
+        free(match->overlaps);
+        free(match->gaps);
+        *match = (region_match_t){0};
+        return -1;
+    }
+
+    // old_pos and new_pos: how far the current regions are accounted for
+    size_t i = 0, j = 0;
+    uintptr_t old_pos = on ? olds[0]->start : 0;
+    uintptr_t new_pos = nn ? news[0]->start : 0;
+    while (i < on || j < nn) {
+        const mem_region_t *o = i < on ? olds[i] : NULL;
+        const mem_region_t *n = j < nn ? news[j] : NULL;
+        uintptr_t o_end = o ? o->start + o->len : 0;
+        uintptr_t n_end = n ? n->start + n->len : 0;
+        bool end_old, end_new;
+        if (o && (!n || o_end <= n->start)) {
+            // The rest of the old region is gone
+            append_gap(match, CHANGE_GONE, o, old_pos, o_end);
+            end_old = true;
+            end_new = false;
+        } else if (!o || n_end <= o->start) {
+            // The rest of the new region is new
+            append_gap(match, CHANGE_NEW, n, new_pos, n_end);
+            end_old = false;
+            end_new = true;
+        } else {
+            uintptr_t lo = o->start > n->start ? o->start : n->start;
+            uintptr_t hi = o_end < n_end ? o_end : n_end;
+            append_gap(match, CHANGE_GONE, o, old_pos, lo);
+            append_gap(match, CHANGE_NEW, n, new_pos, lo);
+            match->overlaps[match->overlap_count++] = (region_overlap_t){
+                .old_region = o,
+                .new_region = n,
+                .addr = lo,
+                .len = hi - lo,
+                .old_offset = lo - o->start,
+                .new_offset = lo - n->start,
+            };
+            old_pos = new_pos = hi;
+            end_old = o_end == hi;
+            end_new = n_end == hi;
+        }
+        if (end_old && ++i < on) {
+            old_pos = olds[i]->start;
+        }
+        if (end_new && ++j < nn) {
+            new_pos = news[j]->start;
         }
     }
+    free(olds);
+    free(news);
+    return 0;
+}
 
-    (*arr)[*n] = (mem_change_t){
-        .addr = addr,
-        .old_value = old_value,
-        .new_value = new_value,
-    };
-    (*n)++;
+/**
+ * Free the memory allocated for a match of regions.
+ */
+static void region_match_free(region_match_t *match) {
+    free(match->overlaps);
+    free(match->gaps);
+    *match = (region_match_t){0};
 }
 
+// A walk over the runs of bytes that differ within an overlap of two
+// regions, a chunk of the diff kernel at a time
+typedef struct {
+    const region_overlap_t *overlap;
+    diff_kernel_t kernel;
+    bool use_dirty;
+    bool use_hash;
+    size_t pos;   // next byte to diff, from the start of the overlap
+    size_t end;   // end of the walk
+    size_t chunk; // offset of the diffed chunk
+    size_t words; // words of its bitmap
+    size_t w;     // current word
+    uint64_t m;   // bits of the current word not walked yet
+    uint64_t bits[DIFF_CHUNK / 64];
+} diff_walk_t;
+
 /**
- * Search for specific byte-pattern (not always with a numerical value) in
- * memory regions based on a comparison operation.
+ * Start walking the differing bytes of [offset, offset + len) of an
+ * overlap of two regions.
+ */
+static void diff_walk_init(diff_walk_t *walk, const region_overlap_t *overlap,
+                           size_t offset, size_t len, diff_kernel_t kernel) {
+    const mem_region_t *old_region = overlap->old_region;
+    const mem_region_t *new_region = overlap->new_region;
+    walk->overlap = overlap;
+    walk->kernel = kernel;
+
+    // If the new region was built incrementally on top of this very old
+    // region, its clean pages are copies and can't differ.
+    walk->use_dirty = new_region->dirty &&
+                      new_region->base_gen == old_region->gen &&
+                      old_region->start == new_region->start &&
+                      old_region->len == new_region->len;
+
+    // Pages with equal hashes are (all but certainly) equal
+    walk->use_hash = old_region->hashes && new_region->hashes;
+
+    walk->pos = offset;
+    walk->end = offset + len;
+    walk->words = 0;
+    walk->w = 0;
+    walk->m = 0;
+}
+
+/**
+ * Diff the next chunk of a walk that can hold differences.
  *
- * @param regions Array of memory regions to search.
- * @param rcount Number of memory regions.
- * @param pattern Pointer to the value to compare against.
- * @param pattern_len Size of the value type (e.g., sizeof(int)).
- * @param out Pointer to the output array of scan results.
- * @param out_count Pointer to the number of results found.
+ * @return true if a chunk was diffed, false at the end of the walk.
  */
-int search_exact(mem_region_t *regions, // [in]
-                 size_t rcount,         // [in]
-                 const void *pattern,   // [in]
-                 size_t pattern_len,    // [in]
-                 scan_result_t **out,   // [out]
-                 size_t *out_count      // [out]
-) {
-    *out = NULL;
-    *out_count = 0;
-    size_t capacity = 0;
+static bool diff_walk_load(diff_walk_t *walk) {
+    const size_t page = page_size();
+    const region_overlap_t *ov = walk->overlap;
+    const mem_region_t *old_region = ov->old_region;
+    const mem_region_t *new_region = ov->new_region;
+    while (walk->pos < walk->end) {
+        // Up to the end of the page on either side (regions start on a
+        // page, so both sides are the same page of theirs anyway)
+        size_t old_at = ov->old_offset + walk->pos;
+        size_t new_at = ov->new_offset + walk->pos;
+        size_t po = old_at / page, pn = new_at / page;
+        size_t n = walk->end - walk->pos;
+        n = page - old_at % page < n ? page - old_at % page : n;
+        n = page - new_at % page < n ? page - new_at % page : n;
+        page_state_t old_state = region_page_state(old_region, po);
+        page_state_t new_state = region_page_state(new_region, pn);
 
-    for (size_t i = 0; i < rcount; i++) {
-        uint8_t *data = regions[i].data;
-        size_t len = regions[i].len;
-        for (size_t offset = 0; offset + pattern_len <= len; offset++) {
-            if (memcmp(data + offset, pattern, pattern_len) == 0) {
-                append_result(out, out_count, &capacity,
-                              regions[i].start + offset, pattern_len);
-            }
+        // Nothing to learn from clean pages, pages we don't know on either
+        // side, or pages that are zero on both sides
+        if ((walk->use_dirty && !region_page_dirty(new_region, pn)) ||
+            old_state == PAGE_UNKNOWN || new_state == PAGE_UNKNOWN ||
+            (old_state == PAGE_ZERO && new_state == PAGE_ZERO) ||
+            (walk->use_hash &&
+             old_region->hashes[po] == new_region->hashes[pn])) {
+            walk->pos += n;
+            continue;
         }
+
+        n = n < DIFF_CHUNK ? n : DIFF_CHUNK;
+        walk->kernel(page_bytes(old_region, po) + old_at % page,
+                     page_bytes(new_region, pn) + new_at % page, n,
+                     walk->bits);
+        walk->chunk = walk->pos;
+        walk->words = (n + 63) / 64;
+        walk->w = 0;
+        walk->m = walk->bits[0];
+        walk->pos += n;
+        return true;
     }
-    return 0;
+    return false;
 }
 
 /**
- * Search for numeric values in memory regions based on a comparison
- * operation.
+ * Get the next run of differing bytes of a walk, as a change range. A run
+ * that crosses a chunk comes in two parts.
  *
- * @param regions Array of memory regions to search.
- * @param rcount Number of memory regions.
- * @param type Type of the data to compare (SCAN_TYPE_BYTE, SCAN_TYPE_WORD, ...)
- * @param cmp Comparison operation (CMP_EQ, CMP_NE, CMP_GT, CMP_LT).
- * @param value Pointer to the value to compare against.
- * @param out Pointer to the output array of scan results.
- * @param out_count Pointer to the number of results found.
+ * @param walk The walk.
+ * @param change Pointer to store the run.
+ * @return true if there was a run, false at the end of the walk.
  */
-int search_compare(mem_region_t *regions, // [in]
-                   size_t rcount,         // [in]
-                   scan_type_t type,      // [in]
-                   cmp_op_t cmp,          // [in]
-                   const void *value,     // [in]
-                   scan_result_t **out,   // [out]
-                   size_t *out_count      // [out]
+static bool diff_walk_next(diff_walk_t *walk,   // [in/out]
+                           mem_change_t *change // [out]
 ) {
-    *out = NULL;
-    *out_count = 0;
-    size_t capacity = 0;
-
-    size_t type_size;
-    switch (type) {
-    case SCAN_TYPE_BYTE:
-        type_size = sizeof(uint8_t); // 1 byte
-        break;
-    case SCAN_TYPE_WORD:
-        type_size = sizeof(uint16_t); // 2 bytes
-        break;
-    case SCAN_TYPE_DWORD:
-        type_size = sizeof(uint32_t); // 4 bytes
-        break;
-    case SCAN_TYPE_QWORD:
-        type_size = sizeof(uint64_t); // 8 bytes
-        break;
-    default:
-        fprintf(stderr, "ERR: Invalid scan type %d\n", type);
-        return -1; // Invalid type
+    while (walk->m == 0) {
+        if (walk->w + 1 < walk->words) {
+            walk->m = walk->bits[++walk->w];
+        } else if (!diff_walk_load(walk)) {
+            return false;
+        }
     }
+    size_t b = (size_t)__builtin_ctzll(walk->m);
+    uint64_t rest = ~(walk->m >> b);
+    size_t run = rest ? (size_t)__builtin_ctzll(rest) : 64;
+    walk->m = b + run < 64 ? walk->m & (~0ULL << (b + run)) : 0;
 
-    for (size_t i = 0; i < rcount; i++) {
-        uint8_t *data = regions[i].data;
-        if (!data) {
-            continue;
-        }
-        size_t len = regions[i].len;
-
-        // Loop through the memory, taking steps equal to the type size
-        for (size_t offset = 0; offset + type_size <= len;
-             offset += type_size) {
-            uint64_t val = 0;
-            uint64_t tgt = 0;
-            bool hit = false;
-
-            // Cast the pointers directly and dereference them,
-            // avoid slow memcmp() calls
-            switch (type) {
-            case SCAN_TYPE_BYTE:
-                val = *(uint8_t *)(data + offset);
-                tgt = *(uint8_t *)value;
-                break;
-            case SCAN_TYPE_WORD:
-                val = *(uint16_t *)(data + offset);
-                tgt = *(uint16_t *)value;
-                break;
-            case SCAN_TYPE_DWORD:
-                val = *(uint32_t *)(data + offset);
-                tgt = *(uint32_t *)value;
-                break;
-            case SCAN_TYPE_QWORD:
-                val = *(uint64_t *)(data + offset);
-                tgt = *(uint64_t *)value;
-                break;
-            }
+    const region_overlap_t *ov = walk->overlap;
+    size_t offset = walk->chunk + walk->w * 64 + b;
+    *change = (mem_change_t){
+        .kind = CHANGE_MODIFIED,
+        .addr = ov->addr + offset,
+        .len = run,
+        .old_region = ov->old_region,
+        .new_region = ov->new_region,
+        .old_offset = ov->old_offset + offset,
+        .new_offset = ov->new_offset + offset,
+    };
+    return true;
+}
 
-            // Perform the actual comparison based on the cmp operation
-            switch (cmp) {
-            case CMP_EQ:
-                hit = (val == tgt);
-                break;
-            case CMP_NE:
-                hit = (val != tgt);
-                break;
-            case CMP_GT:
-                hit = (val > tgt);
-                break;
-            case CMP_LT:
-                hit = (val < tgt);
-                break;
-            default:
-                fprintf(stderr, "ERR: Invalid comparison operation %d\n", cmp);
-                return -1; // Invalid comparison operation
-            }
+// Shared context of the detect_memory_changes() tasks
+typedef struct {
+    const region_overlap_t *overlaps;
+    const pool_slice_t *slices;
+    diff_kernel_t kernel;
+    worker_vec_t *vecs;
+    task_run_t *runs;
+} detect_ctx_t;
 
-            if (hit) {
-                append_result(out, out_count, &capacity,
-                              regions[i].start + offset, type_size);
-            }
-        }
+/**
+ * Task function of detect_memory_changes(): diff one slice of an overlap
+ * of an old and a new region into ranges of differing bytes.
+ */
+static void detect_task_fn(void *arg, size_t task, size_t worker) {
+    detect_ctx_t *c = arg;
+    const pool_slice_t *slice = &c->slices[task];
+    worker_vec_t *vec = &c->vecs[worker];
+    size_t first = vec->n;
+
+    diff_walk_t walk;
+    diff_walk_init(&walk, &c->overlaps[slice->index], slice->offset,
+                   slice->len, c->kernel);
+    mem_change_t change;
+    while (!vec->failed && diff_walk_next(&walk, &change)) {
+        append_change(vec, first, &change);
     }
+    c->runs[task] = (task_run_t){worker, first, vec->n - first};
+}
 
-    return 0;
+/**
+ * Order change ranges by address, for qsort().
+ */
+static int compare_changes(const void *a, const void *b) {
+    const mem_change_t *x = a, *y = b;
+    if (x->addr != y->addr) {
+        return x->addr < y->addr ? -1 : 1;
+    }
+    return (int)x->kind - (int)y->kind;
 }
 
 /**
  * Detect changes in memory regions by comparing two scans.
- * If a region exists in both scans, it checks for byte-by-byte changes.
- * If a region exists only in the new scan, it is considered a change from
- * "nothing" to "something".
+ * The regions of both scans are matched by address (see match_regions()).
+ * Where an old and a new region overlap, they are compared byte by byte
+ * with the diff kernel, and every maximal run of differing bytes becomes
+ * one range. Memory only one scan has is a single CHANGE_NEW or
+ * CHANGE_GONE range per stretch. The ranges point into both scans (see
+ * change_iter_next() for the bytes), so the scans must outlive them.
  *
  * @param old_scan Array of memory regions from the old scan.
  * @param old_n Number of regions in the old scan.
  * @param new_scan Array of memory regions from the new scan.
  * @param new_n Number of regions in the new scan.
- * @param out_changes Pointer to the output array of memory changes.
- * @param out_count Pointer to the number of changes found.
+ * @param out_changes Pointer to the output array of change ranges, in
+ * ascending address order.
+ * @param out_count Pointer to the number of change ranges found.
+ * @return 0 on success, -1 on failure.
  */
 int detect_memory_changes(mem_region_t *old_scan,     // [in]
                           size_t old_n,               // [in]
@@ -235,59 +2352,437 @@ int detect_memory_changes(mem_region_t *old_scan,     // [in]
 ) {
     *out_changes = NULL;
     *out_count = 0;
-    size_t capacity = 0;
+    region_match_t match;
+    if (!zero_page() ||
+        match_regions(old_scan, old_n, new_scan, new_n, false, &match) != 0) {
+        return -1;
+    }
 
-    // Create a hash map from the old scan for quick lookups
-    hash_map_t *old_map = hash_map_create(old_n > 0 ? old_n * 2 - 1 : 16);
-    if (!old_map) {
-        perror("Failed to create hash map");
+    // Slice the overlaps for the thread pool
+    size_t *lens = calloc(match.overlap_count ? match.overlap_count : 1,
+                          sizeof(*lens));
+    if (!lens) {
+        region_match_free(&match);
+        return -1;
+    }
+    for (size_t i = 0; i < match.overlap_count; i++) {
+        lens[i] = match.overlaps[i].len;
+    }
+    size_t slice_count = 0;
+    pool_slice_t *slices = pool_slice(lens, match.overlap_count,
+                                      SCAN_SLICE_BYTES, &slice_count);
+    free(lens);
+    worker_vec_t *vecs = worker_vecs_create();
+    task_run_t *runs = calloc(slice_count ? slice_count : 1, sizeof(*runs));
+    if (!vecs || !runs || (!slices && slice_count > 0)) {
+        region_match_free(&match);
+        free(slices);
+        worker_vecs_destroy(vecs);
+        free(runs);
         return -1;
     }
 
-    for (size_t i = 0; i < old_n; i++) {
-        // Only map regions that have valid data buffers
-        if (old_scan[i].data) {
-            hash_map_put(old_map, old_scan[i].start, &old_scan[i]);
+    detect_ctx_t ctx = {.overlaps = match.overlaps,
+                        .slices = slices,
+                        .kernel = diff_kernel(simd_level()),
+                        .vecs = vecs,
+                        .runs = runs};
+    pool_run(slice_count, detect_task_fn, &ctx);
+    free(slices);
+
+    void *merged = NULL;
+    size_t count = 0;
+    int rc = merge_runs(vecs, runs, slice_count, sizeof(mem_change_t), &merged,
+                        &count);
+    free(runs);
+    mem_change_t *changes = merged;
+
+    // Runs that cross a slice boundary were cut in two
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (kept > 0 && changes_adjoin(&changes[kept - 1], &changes[i])) {
+            changes[kept - 1].len += changes[i].len;
+        } else {
+            changes[kept++] = changes[i];
+        }
+    }
+    count = kept;
+
+    // Then the memory only one scan has
+    if (rc == 0 && match.gap_count > 0) {
+        mem_change_t *tmp =
+            realloc(changes, (count + match.gap_count) * sizeof(*tmp));
+        if (tmp) {
+            changes = tmp;
+            memcpy(changes + count, match.gaps,
+                   match.gap_count * sizeof(*tmp));
+            count += match.gap_count;
+            qsort(changes, count, sizeof(*changes), compare_changes);
+        } else {
+            rc = -1;
+        }
+    }
+    region_match_free(&match);
+    if (rc != 0) {
+        free(changes);
+        return rc;
+    }
+    *out_changes = changes;
+    *out_count = count;
+    return 0;
+}
+
+// A lazy producer of the change ranges of two scans, see
+// change_cursor_create()
+struct change_cursor {
+    region_match_t match;
+    unsigned kinds; // CHANGE_MASK() of the kinds to produce
+    diff_kernel_t kernel;
+    size_t next_gap;
+
+    // Walk over the overlap being diffed
+    size_t index;
+    bool walking;
+    diff_walk_t walk;
+
+    // The next run of differing bytes, already taken from the walk
+    mem_change_t run;
+    bool has_run;
+
+    // The next modified range, not handed out yet
+    mem_change_t modified;
+    bool has_modified;
+};
+
+/**
+ * Create a cursor over the change ranges of two scans. Unlike
+ * detect_memory_changes() it diffs nothing up front: every call of
+ * change_cursor_next() diffs just as far as the next range, so the first
+ * ranges are there at once and none of them is kept. The ranges come in
+ * ascending address order (the same ranges detect_memory_changes() finds),
+ * and the scans must outlive the cursor.
+ *
+ * @param old_scan Array of memory regions from the old scan.
+ * @param old_n Number of regions in the old scan.
+ * @param new_scan Array of memory regions from the new scan.
+ * @param new_n Number of regions in the new scan.
+ * @param kinds CHANGE_MASK() of the kinds of ranges to produce, e.g.
+ * CHANGE_ALL.
+ * @return The cursor, or NULL on failure.
+ */
+change_cursor_t *change_cursor_create(mem_region_t *old_scan, // [in]
+                                      size_t old_n,           // [in]
+                                      mem_region_t *new_scan, // [in]
+                                      size_t new_n,           // [in]
+                                      unsigned kinds          // [in]
+) {
+    if (!zero_page()) {
+        return NULL;
+    }
+    change_cursor_t *cursor = calloc(1, sizeof(*cursor));
+    if (!cursor) {
+        perror("Failed to allocate a change cursor");
+        return NULL;
+    }
+    cursor->kinds = kinds;
+    cursor->kernel = diff_kernel(simd_level());
+    if (match_regions(old_scan, old_n, new_scan, new_n, false,
+                      &cursor->match) != 0) {
+        free(cursor);
+        return NULL;
+    }
+    qsort(cursor->match.gaps, cursor->match.gap_count,
+          sizeof(*cursor->match.gaps), compare_changes);
+    return cursor;
+}
+
+/**
+ * Take the next run of differing bytes of a cursor, from the overlap being
+ * walked or the next one.
+ */
+static bool cursor_take_run(change_cursor_t *c, mem_change_t *run) {
+    while (true) {
+        if (c->walking && diff_walk_next(&c->walk, run)) {
+            return true;
+        }
+        if (c->walking) {
+            c->walking = false;
+            c->index++;
+        }
+        if (c->index == c->match.overlap_count) {
+            return false;
         }
+        const region_overlap_t *overlap = &c->match.overlaps[c->index];
+        diff_walk_init(&c->walk, overlap, 0, overlap->len, c->kernel);
+        c->walking = true;
+    }
+}
+
+/**
+ * Get the next modified range of a cursor: runs of differing bytes that
+ * adjoin are merged, which takes one run past the range.
+ */
+static bool cursor_next_modified(change_cursor_t *c, mem_change_t *change) {
+    if (!c->has_run && !cursor_take_run(c, &c->run)) {
+        return false;
+    }
+    *change = c->run;
+    while ((c->has_run = cursor_take_run(c, &c->run)) &&
+           changes_adjoin(change, &c->run)) {
+        change->len += c->run.len;
+    }
+    return true;
+}
+
+/**
+ * Get the next change range of a cursor.
+ *
+ * @param cursor The cursor.
+ * @param change Pointer to store the range.
+ * @return true if there was a range, false at the end.
+ */
+bool change_cursor_next(change_cursor_t *cursor, // [in/out]
+                        mem_change_t *change     // [out]
+) {
+    // The gaps are known, so the next modified range decides whether one
+    // of them comes first
+    const region_match_t *match = &cursor->match;
+    if (!cursor->has_modified &&
+        (cursor->kinds & CHANGE_MASK(CHANGE_MODIFIED))) {
+        cursor->has_modified = cursor_next_modified(cursor, &cursor->modified);
+    }
+    while (cursor->next_gap < match->gap_count &&
+           !(cursor->kinds &
+             CHANGE_MASK(match->gaps[cursor->next_gap].kind))) {
+        cursor->next_gap++;
+    }
+
+    if (cursor->next_gap < match->gap_count &&
+        (!cursor->has_modified ||
+         match->gaps[cursor->next_gap].addr < cursor->modified.addr)) {
+        *change = match->gaps[cursor->next_gap++];
+        return true;
+    }
+    if (cursor->has_modified) {
+        *change = cursor->modified;
+        cursor->has_modified = false;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Destroy a change cursor.
+ *
+ * @param cursor The cursor, or NULL.
+ */
+void change_cursor_destroy(change_cursor_t *cursor) {
+    if (cursor) {
+        region_match_free(&cursor->match);
+        free(cursor);
     }
+}
+
+/**
+ * Get one byte of a region, a zero page reading as 0.
+ */
+static uint8_t region_byte(const mem_region_t *region, size_t offset) {
+    const uint8_t *p = page_bytes(region, offset / page_size());
+    return p ? p[offset % page_size()] : 0;
+}
 
-    // Iterate through the new scan and compare against the old one via the
-    // hashmap that was just created
-    for (size_t i = 0; i < new_n; i++) {
-        if (!new_scan[i].data) {
-            // Skip regions without data
+/**
+ * Start walking the changed bytes of change ranges.
+ *
+ * @param it The iterator.
+ * @param changes The change ranges (see detect_memory_changes()).
+ * @param count Number of change ranges.
+ */
+void change_iter_init(change_iter_t *it,           // [out]
+                      const mem_change_t *changes, // [in]
+                      size_t count                 // [in]
+) {
+    *it = (change_iter_t){.changes = changes, .count = count};
+}
+
+/**
+ * Get the next changed byte, the per-byte view of the change ranges. A
+ * byte of a new region was 0 before, a byte of a vanished region is 0
+ * after, and only the pages read from the target count.
+ *
+ * @param it The iterator.
+ * @param addr Pointer to store the address of the byte.
+ * @param old_value Pointer to store its old value.
+ * @param new_value Pointer to store its new value.
+ * @return true if there was a byte, false at the end.
+ */
+bool change_iter_next(change_iter_t *it,  // [in/out]
+                      uintptr_t *addr,    // [out]
+                      uint8_t *old_value, // [out]
+                      uint8_t *new_value  // [out]
+) {
+    const size_t page = page_size();
+    while (it->index < it->count) {
+        const mem_change_t *c = &it->changes[it->index];
+        if (it->offset >= c->len) {
+            it->index++;
+            it->offset = 0;
             continue;
         }
+        if (c->kind != CHANGE_MODIFIED) {
+            const mem_region_t *region =
+                c->kind == CHANGE_NEW ? c->new_region : c->old_region;
+            size_t base = c->kind == CHANGE_NEW ? c->new_offset : c->old_offset;
+            size_t p = (base + it->offset) / page;
+            if (region_page_state(region, p) != PAGE_DATA) {
+                it->offset = (p + 1) * page - base; // hole, skip it
+                continue;
+            }
+        }
+        size_t k = it->offset++;
+        *addr = c->addr + k;
+        *old_value =
+            c->old_region ? region_byte(c->old_region, c->old_offset + k) : 0;
+        *new_value =
+            c->new_region ? region_byte(c->new_region, c->new_offset + k) : 0;
+        return true;
+    }
+    return false;
+}
 
-        mem_region_t *old_region =
-            (mem_region_t *)hash_map_get(old_map, new_scan[i].start);
+/**
+ * Check whether one page differs between an old and a new region, using
+ * the page hashes where both have them and the data otherwise. When one
+ * side has only hashes and the other only data, the data is hashed.
+ *
+ * @param old_region The old region.
+ * @param po Index of the page in the old region.
+ * @param new_region The new region.
+ * @param pn Index of the page in the new region.
+ * @return true if the page differs, or if there is nothing to compare it
+ * with.
+ */
+static bool page_differs(const mem_region_t *old_region, size_t po,
+                         const mem_region_t *new_region, size_t pn) {
+    if (old_region->hashes && new_region->hashes) {
+        return old_region->hashes[po] != new_region->hashes[pn];
+    }
+    const size_t page = page_size();
+    size_t old_len = old_region->len - po * page;
+    size_t new_len = new_region->len - pn * page;
+    old_len = old_len < page ? old_len : page;
+    new_len = new_len < page ? new_len : page;
+    if (old_region->data && new_region->data) {
+        return memcmp(old_region->data + po * page,
+                      new_region->data + pn * page,
+                      old_len < new_len ? old_len : new_len) != 0;
+    }
+    if (old_region->hashes && new_region->data) {
+        return old_region->hashes[po] !=
+               hash64(new_region->data + pn * page, new_len, 0);
+    }
+    if (old_region->data && new_region->hashes) {
+        return hash64(old_region->data + po * page, old_len, 0) !=
+               new_region->hashes[pn];
+    }
+    return true; // nothing to compare with, it may have changed
+}
 
-        if (old_region) {
-            // Region exists in both scans, compare byte-by-byte
-            size_t len = old_region->len < new_scan[i].len ? old_region->len
-                                                           : new_scan[i].len;
-            for (size_t offset = 0; offset < len; offset++) {
-                if (old_region->data[offset] != new_scan[i].data[offset]) {
-                    append_change(out_changes, out_count, &capacity,
-                                  old_region->start + offset,
-                                  old_region->data[offset],
-                                  new_scan[i].data[offset]);
-                }
+/**
+ * Append a page address to a growing array.
+ *
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int push_page(uintptr_t **pages, size_t *n, size_t *capacity,
+                     uintptr_t page_addr) {
+    if (*n == *capacity) {
+        size_t new_capacity = *capacity ? *capacity * 2 : 64;
+        uintptr_t *tmp = realloc(*pages, new_capacity * sizeof(**pages));
+        if (!tmp) {
+            return -1;
+        }
+        *pages = tmp;
+        *capacity = new_capacity;
+    }
+    (*pages)[(*n)++] = page_addr;
+    return 0;
+}
+
+/**
+ * Order page addresses, for qsort().
+ */
+static int compare_pages(const void *a, const void *b) {
+    uintptr_t x = *(const uintptr_t *)a, y = *(const uintptr_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * Detect which pages changed between two scans. Unlike
+ * detect_memory_changes() this works on hash-only generations too, as it
+ * only compares page hashes (or the data of regions that have no hashes).
+ * The regions are matched by address the same way (see match_regions()),
+ * and the pages only the new scan has count as changed.
+ *
+ * @param old_scan Array of memory regions from the old scan.
+ * @param old_n Number of regions in the old scan.
+ * @param new_scan Array of memory regions from the new scan.
+ * @param new_n Number of regions in the new scan.
+ * @param out_pages Pointer to the output array of page addresses.
+ * @param out_count Pointer to the number of changed pages found.
+ * @return 0 on success, -1 on failure.
+ */
+int detect_page_changes(mem_region_t *old_scan, // [in]
+                        size_t old_n,           // [in]
+                        mem_region_t *new_scan, // [in]
+                        size_t new_n,           // [in]
+                        uintptr_t **out_pages,  // [out]
+                        size_t *out_count       // [out]
+) {
+    *out_pages = NULL;
+    *out_count = 0;
+
+    region_match_t match;
+    if (match_regions(old_scan, old_n, new_scan, new_n, true, &match) != 0) {
+        return -1;
+    }
+
+    const size_t page = page_size();
+    uintptr_t *pages_out = NULL;
+    size_t n = 0, capacity = 0;
+    int rc = 0;
+    for (size_t i = 0; i < match.overlap_count && rc == 0; i++) {
+        const region_overlap_t *ov = &match.overlaps[i];
+        for (size_t at = 0; at < ov->len && rc == 0; at += page) {
+            size_t po = (ov->old_offset + at) / page;
+            size_t pn = (ov->new_offset + at) / page;
+            if (region_page_state(ov->old_region, po) != PAGE_UNKNOWN &&
+                region_page_state(ov->new_region, pn) != PAGE_UNKNOWN &&
+                page_differs(ov->old_region, po, ov->new_region, pn)) {
+                rc = push_page(&pages_out, &n, &capacity, ov->addr + at);
             }
-        } else {
-            // Region is newly allocated (exits in new_scan but not in old_scan)
-            // This is considered a change from "nothing" to "something"
-            for (size_t offset = 0; offset < new_scan[i].len; offset++) {
-                append_change(out_changes, out_count, &capacity,
-                              new_scan[i].start + offset,
-                              0, // Old value is considered 0 (NULL)
-                              new_scan[i].data[offset]);
+        }
+    }
+    for (size_t i = 0; i < match.gap_count && rc == 0; i++) {
+        const mem_change_t *gap = &match.gaps[i];
+        for (size_t at = 0; gap->kind == CHANGE_NEW && at < gap->len && rc == 0;
+             at += page) {
+            size_t pn = (gap->new_offset + at) / page;
+            if (region_page_state(gap->new_region, pn) == PAGE_DATA) {
+                rc = push_page(&pages_out, &n, &capacity, gap->addr + at);
             }
         }
     }
+    region_match_free(&match);
 
-    hash_map_destroy(old_map);
-
+    if (rc != 0) {
+        free(pages_out);
+        return rc;
+    }
+    if (n > 1) {
+        qsort(pages_out, n, sizeof(*pages_out), compare_pages);
+    }
+    *out_pages = pages_out;
+    *out_count = n;
     return 0;
 }
 
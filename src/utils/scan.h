@@ -1,6 +1,11 @@
 // src/utils/scan.h
 #pragma once
+#include "../datastructure/candset.h"
+#include "pred.h"  // pred_t
 #include "probe.h" // mem_region_t
+#include "sig.h"   // signature_t
+#include "text.h"  // text_regex_t
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -15,23 +20,122 @@ typedef enum {
     SCAN_TYPE_BYTE,  // 1-byte integer (uint8_t)
     SCAN_TYPE_WORD,  // 2-byte integer (uint16_t)
     SCAN_TYPE_DWORD, // 4-byte integer (uint32_t)
-    SCAN_TYPE_QWORD, // 8-byte integer (uint64_t)
-    // NOTE: later, add things like SCAN_TYPE_FLOAT or SCAN_TYPE_DOUBLE :)
+    SCAN_TYPE_QWORD,  // 8-byte integer (uint64_t)
+    SCAN_TYPE_FLOAT,  // 4-byte IEEE 754 float
+    SCAN_TYPE_DOUBLE, // 8-byte IEEE 754 double
 } scan_type_t;
 
+#define SCAN_TYPE_COUNT (SCAN_TYPE_DOUBLE + 1)
+
+// Fields a group search takes at most
+#define GROUP_MAX_FIELDS 16
+
+// A field of a group search: a predicate on the value at an offset from
+// the start of the group
+typedef struct {
+    size_t offset;
+    pred_t pred;
+} group_field_t;
+
+// One interpretation of a value for search_any_set()
+typedef struct {
+    scan_type_t type;
+    uint64_t value; // integer types, zero-extended
+    double fvalue;  // float and double
+} scan_value_t;
+
+/**
+ * NOTE:
+ * Floating-point values are compared against bounds [lo, hi], which covers
+ * exact (lo == hi), epsilon (value +- eps), range and "rounded equals" (the
+ * value shown with N decimals) comparisons alike. Two cases are explicit:
+ * - Denormals compare as zero. Memory that merely looks like a float is
+ *   mostly tiny denormals, and a process built with FTZ/DAZ reads them as
+ *   zero too.
+ * - NaN matches nothing but FCMP_NAN, not even FCMP_OUTSIDE, and is in no
+ *   relation (changed, increased, ...) with anything.
+ */
+typedef enum {
+    FCMP_RANGE,   // lo <= x <= hi
+    FCMP_OUTSIDE, // x < lo || x > hi
+    FCMP_GT,      // x > hi
+    FCMP_LT,      // x < lo
+    FCMP_NAN,     // x is NaN
+} fcmp_op_t;
+
+typedef struct {
+    fcmp_op_t op;
+    double lo;
+    double hi;
+} fcmp_t;
+
+typedef enum {
+    REL_CHANGED,   // new != old
+    REL_UNCHANGED, // new == old
+    REL_INCREASED, // new > old
+    REL_DECREASED, // new < old
+    REL_DELTA,     // lo <= new - old <= hi
+} rel_op_t;
+
+// A relation between the old and the new value of an element
+typedef struct {
+    rel_op_t op;
+    int64_t lo; // REL_DELTA bounds, as a signed difference of the type
+    int64_t hi;
+    double flo; // REL_DELTA bounds of SCAN_TYPE_FLOAT and SCAN_TYPE_DOUBLE
+    double fhi;
+    bool is_signed; // REL_INCREASED/REL_DECREASED order integers as signed
+} relation_t;
+
 // A single match result
 typedef struct {
     uintptr_t addr;
     size_t len;
 } scan_result_t;
 
-// A single memory change event
+// What a change record stands for
+typedef enum {
+    CHANGE_MODIFIED, // bytes that differ between the two scans
+    CHANGE_NEW,      // memory only the new scan has
+    CHANGE_GONE,     // memory only the old scan has
+} change_kind_t;
+
+// A range of changed memory: a maximal run of differing bytes, or a whole
+// stretch of memory that appeared or vanished
 typedef struct {
+    change_kind_t kind;
     uintptr_t addr;
-    uint8_t old_value;
-    uint8_t new_value;
+    size_t len;
+    const mem_region_t *old_region; // NULL for CHANGE_NEW
+    const mem_region_t *new_region; // NULL for CHANGE_GONE
+    size_t old_offset;              // offset of addr in old_region
+    size_t new_offset;              // offset of addr in new_region
 } mem_change_t;
 
+// Mask of a kind of change ranges, and of all of them
+#define CHANGE_MASK(kind) (1u << (kind))
+#define CHANGE_ALL                                                             \
+    (CHANGE_MASK(CHANGE_MODIFIED) | CHANGE_MASK(CHANGE_NEW) |                  \
+     CHANGE_MASK(CHANGE_GONE))
+
+// Lazy producer of change ranges (see change_cursor_create())
+typedef struct change_cursor change_cursor_t;
+
+// Walks the changed bytes of change ranges, one at a time
+typedef struct {
+    const mem_change_t *changes;
+    size_t count;
+    size_t index;  // current range
+    size_t offset; // next byte within it
+} change_iter_t;
+
+// How much of a search to keep
+typedef struct {
+    bool count_only; // only count the matches, keep no candidates
+    size_t limit;    // stop after the first `limit` matches (0: no limit)
+    size_t align;    // element alignment: 1, 2, 4 or 8 (0: natural)
+} search_opts_t;
+
 /**
  * Exact-byte search across all memory regions.
  *
@@ -41,10 +145,39 @@ typedef struct {
 int search_exact(mem_region_t *regions, size_t rcount, const void *pattern,
                  size_t pattern_len, scan_result_t **out, size_t *out_count);
 
+/**
+ * Exact-byte search that keeps the matches as a compact candidate set.
+ * Runs as a signature search without wildcards.
+ */
+int search_exact_set(mem_region_t *regions, size_t rcount,
+                     const void *pattern, size_t pattern_len,
+                     const search_opts_t *opts, candset_t *out,
+                     size_t *out_count);
+
+/**
+ * Byte signature (AOB) search for several signatures at once, keeping the
+ * matches of every signature as a compact candidate set.
+ */
+int search_sig_set(mem_region_t *regions, size_t rcount,
+                   const signature_t *sigs, size_t nsigs,
+                   const search_opts_t *opts, candset_t *outs,
+                   size_t *counts);
+
+/**
+ * Text search with a regex (see text_regex_t), keeping where the matches
+ * start as a compact candidate set.
+ */
+int search_regex_set(mem_region_t *regions, size_t rcount,
+                     const text_regex_t *re, const search_opts_t *opts,
+                     candset_t *out, size_t *out_count);
+
+size_t scan_type_size(scan_type_t type);
+
 /**
  * Numeric comparison search, optimized for different data types.
  *
- * type: The size of the data to compare (1, 2, 4, or 8 bytes).
+ * type: The type of the data to compare (integers of 1, 2, 4 or 8 bytes,
+ *       float or double; those compare exactly, see search_float_set()).
  * value: Pointer to the value to compare against (must match the type).
  * cmp: one of cmp_op_t values (CMP_EQ, CMP_NE, CMP_GT, CMP_LT)
  */
@@ -52,6 +185,71 @@ int search_compare(mem_region_t *regions, size_t rcount, scan_type_t type,
                    cmp_op_t cmp, const void *value, scan_result_t **out,
                    size_t *out_count);
 
+/**
+ * Numeric comparison search that keeps the matches as a compact candidate
+ * set. With opts->count_only nothing is kept, with opts->limit the search
+ * stops after the first `limit` matches (in address order).
+ */
+int search_compare_set(mem_region_t *regions, size_t rcount, scan_type_t type,
+                       cmp_op_t cmp, const void *value,
+                       const search_opts_t *opts, candset_t *out,
+                       size_t *out_count);
+
+/**
+ * Floating-point search (float or double) against the bounds of an
+ * fcmp_t, keeping the matches as a compact candidate set.
+ */
+int search_float_set(mem_region_t *regions, size_t rcount, scan_type_t type,
+                     const fcmp_t *fcmp, const search_opts_t *opts,
+                     candset_t *out, size_t *out_count);
+
+/**
+ * Equality search for a value under several interpretations (types) at
+ * once, in a single pass over the regions, keeping the matches of every
+ * interpretation as its own candidate set.
+ */
+int search_any_set(mem_region_t *regions, size_t rcount,
+                   const scan_value_t *values, size_t nvalues,
+                   const search_opts_t *opts, candset_t *outs,
+                   size_t *counts);
+
+/**
+ * Group (struct) search: keep the groups whose every field passes its
+ * predicate, searching the most selective field and checking the others
+ * at its hits, in a single pass. The candidates are the first field's.
+ * Groups start at multiples of the alignment option, which defaults to the
+ * size of the first field.
+ */
+int search_group_set(mem_region_t *regions, size_t rcount,
+                     const group_field_t *fields, size_t nfields,
+                     const search_opts_t *opts, candset_t *out,
+                     size_t *out_count);
+
+/**
+ * Predicate search: keep the integers that pass a compiled predicate (any
+ * number of ranges, masks and signed compares), in a single pass.
+ */
+int search_pred_set(mem_region_t *regions, size_t rcount, const pred_t *pred,
+                    const search_opts_t *opts, candset_t *out,
+                    size_t *out_count);
+
+/**
+ * Relational search between two scans: keep the elements whose new value
+ * relates to their old one as given (changed, increased, delta in range,
+ * ...), optionally only among existing candidates.
+ */
+int search_relation_set(mem_region_t *old_scan, size_t old_n,
+                        mem_region_t *new_scan, size_t new_n,
+                        scan_type_t type, const relation_t *rel,
+                        const candset_t *within, const search_opts_t *opts,
+                        candset_t *out, size_t *out_count);
+
+/**
+ * Look up the value of every candidate in a scan.
+ */
+int candidate_values(const candset_t *set, const mem_region_t *regions,
+                     size_t n, uint8_t **out);
+
 /**
  * Detect changes in memory regions by comparing two scans.
  */
@@ -59,6 +257,30 @@ int detect_memory_changes(mem_region_t *old_scan, size_t old_n,
                           mem_region_t *new_scan, size_t new_n,
                           mem_change_t **out_changes, size_t *out_count);
 
+/**
+ * Produce the change ranges of two scans on demand, in address order.
+ */
+change_cursor_t *change_cursor_create(mem_region_t *old_scan, size_t old_n,
+                                      mem_region_t *new_scan, size_t new_n,
+                                      unsigned kinds);
+bool change_cursor_next(change_cursor_t *cursor, mem_change_t *change);
+void change_cursor_destroy(change_cursor_t *cursor);
+
+/**
+ * Walk the changed bytes of change ranges (see change_iter_next()).
+ */
+void change_iter_init(change_iter_t *it, const mem_change_t *changes,
+                      size_t count);
+bool change_iter_next(change_iter_t *it, uintptr_t *addr, uint8_t *old_value,
+                      uint8_t *new_value);
+
+/**
+ * Detect which pages changed between two scans (hash-only scans included).
+ */
+int detect_page_changes(mem_region_t *old_scan, size_t old_n,
+                        mem_region_t *new_scan, size_t new_n,
+                        uintptr_t **out_pages, size_t *out_count);
+
 /**
  * Free the memory allocated for memory changes.
  */
@@ -0,0 +1,224 @@
+// src/utils/sig.c
+#include "sig.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * NOTE:
+ * How common a byte is in typical process memory (code, heaps, stacks),
+ * as a rough weight: zero fill, 0xFF, int3 padding, REX prefixes, common
+ * opcodes and ASCII. The anchor is the pair of fixed bytes with the lowest
+ * summed weight, since every anchor hit costs a verification.
+ */
+static uint8_t byte_weight(uint8_t b) {
+    switch (b) {
+    case 0x00:
+        return 64;
+    case 0xFF:
+        return 16;
+    case 0xCC: // int3
+    case 0x48: // REX.W
+    case 0x8B: // mov r, r/m
+        return 8;
+    case 0x89: // mov r/m, r
+    case 0x01:
+    case 0x0F: // two-byte opcodes
+    case 0x20: // ' '
+    case 0x24:
+    case 0x83:
+    case 0xE8: // call
+    case 0x90: // nop
+        return 4;
+    default:
+        return isprint(b) ? 2 : 1;
+    }
+}
+
+/**
+ * Weight of a masked byte: the summed weight of every byte it matches, so
+ * a half-fixed byte or a letter in either case weighs more than a fixed one.
+ */
+static unsigned masked_weight(uint8_t b, uint8_t m) {
+    if (m == 0xFF) {
+        return byte_weight(b);
+    }
+    unsigned w = 0;
+    for (unsigned x = 0; x < 256; x++) {
+        if ((x & m) == b) {
+            w += byte_weight((uint8_t)x);
+        }
+    }
+    return w;
+}
+
+/**
+ * Choose the anchor of a signature, see signature_t.
+ *
+ * @return 0 on success, -1 if the signature is only wildcards.
+ */
+static int choose_anchor(signature_t *sig) {
+    unsigned best = ~0u;
+    for (size_t i = 0; i + 1 < sig->len; i++) {
+        if (sig->mask[i] && sig->mask[i + 1]) {
+            unsigned w = masked_weight(sig->bytes[i], sig->mask[i]) +
+                         masked_weight(sig->bytes[i + 1], sig->mask[i + 1]);
+            if (w < best) {
+                best = w;
+                sig->anchor = i;
+                sig->anchor_len = 2;
+            }
+        }
+    }
+    for (size_t i = 0; sig->anchor_len != 2 && i < sig->len; i++) {
+        unsigned w = masked_weight(sig->bytes[i], sig->mask[i]);
+        if (sig->mask[i] && w < best) {
+            best = w;
+            sig->anchor = i;
+            sig->anchor_len = 1;
+        }
+    }
+    return sig->anchor_len ? 0 : -1;
+}
+
+/**
+ * Parse one hex digit or wildcard of a signature.
+ *
+ * @return The value of the digit, 16 for a wildcard, -1 otherwise.
+ */
+static int parse_nibble(char c) {
+    if (c == '?') {
+        return 16;
+    }
+    if (isxdigit((unsigned char)c)) {
+        return isdigit((unsigned char)c) ? c - '0'
+                                         : tolower((unsigned char)c) - 'a' + 10;
+    }
+    return -1;
+}
+
+/**
+ * Compile a signature from text: bytes as two hex digits each ("48", "8b"),
+ * with "??" or "?" for any byte and "4?" or "?B" for half a byte. Spaces
+ * between the bytes are optional ("488B??05" works too).
+ *
+ * @param text The signature.
+ * @param sig Pointer to store the signature (free it with sig_free()).
+ * @return 0 on success, -1 if the text is invalid or has no fixed byte
+ * (the caller reports it).
+ */
+int sig_compile(const char *text, signature_t *sig) {
+    memset(sig, 0, sizeof(*sig));
+    size_t cap = strlen(text) / 2 + 1;
+    sig->bytes = malloc(cap);
+    sig->mask = malloc(cap);
+    if (!sig->bytes || !sig->mask) {
+        perror("Failed to allocate the signature");
+        sig_free(sig);
+        return -1;
+    }
+
+    const char *p = text;
+    while (*p) {
+        if (isspace((unsigned char)*p)) {
+            p++;
+            continue;
+        }
+        int hi = parse_nibble(p[0]);
+        int lo = hi < 0 ? -1 : parse_nibble(p[1]);
+        if (hi == 16 && (p[1] == '\0' || isspace((unsigned char)p[1]))) {
+            lo = 16; // a lone '?' stands for the whole byte
+            p--;
+        }
+        if (hi < 0 || lo < 0) {
+            sig_free(sig);
+            return -1;
+        }
+        sig->bytes[sig->len] =
+            (uint8_t)((hi == 16 ? 0 : hi << 4) | (lo == 16 ? 0 : lo));
+        sig->mask[sig->len] =
+            (uint8_t)((hi == 16 ? 0 : 0xF0) | (lo == 16 ? 0 : 0x0F));
+        sig->len++;
+        p += 2;
+    }
+
+    if (sig->len == 0 || choose_anchor(sig) != 0) {
+        sig_free(sig);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Build a signature from bytes and their masks.
+ *
+ * @param bytes The bytes.
+ * @param mask The mask of every byte, or NULL for fixed bytes only (an
+ *             exact pattern).
+ * @param len Number of bytes (at least 1).
+ * @param sig Pointer to store the signature (free it with sig_free()).
+ * @return 0 on success, -1 on failure or if it is only wildcards.
+ */
+int sig_from_masked(const uint8_t *bytes, // [in]
+                    const uint8_t *mask,  // [in]
+                    size_t len,           // [in]
+                    signature_t *sig      // [out]
+) {
+    memset(sig, 0, sizeof(*sig));
+    sig->bytes = malloc(len ? len : 1);
+    sig->mask = malloc(len ? len : 1);
+    if (!sig->bytes || !sig->mask || len == 0) {
+        sig_free(sig);
+        return -1;
+    }
+    for (size_t i = 0; i < len; i++) {
+        sig->mask[i] = mask ? mask[i] : 0xFF;
+        sig->bytes[i] = bytes[i] & sig->mask[i];
+    }
+    sig->len = len;
+    if (choose_anchor(sig) != 0) {
+        sig_free(sig);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Build a signature of fixed bytes only (an exact pattern).
+ *
+ * @param bytes The bytes.
+ * @param len Number of bytes (at least 1).
+ * @param sig Pointer to store the signature (free it with sig_free()).
+ * @return 0 on success, -1 on failure.
+ */
+int sig_from_bytes(const void *bytes, size_t len, signature_t *sig) {
+    return sig_from_masked(bytes, NULL, len, sig);
+}
+
+/**
+ * Free the memory of a signature.
+ */
+void sig_free(signature_t *sig) {
+    free(sig->bytes);
+    free(sig->mask);
+    sig->bytes = NULL;
+    sig->mask = NULL;
+    sig->len = 0;
+}
+
+/**
+ * Check whether the data at a position matches a signature.
+ *
+ * @param sig The signature.
+ * @param data Pointer to sig->len bytes of data.
+ * @return true if every byte matches under its mask.
+ */
+bool sig_match(const signature_t *sig, const uint8_t *data) {
+    for (size_t i = 0; i < sig->len; i++) {
+        if ((data[i] & sig->mask[i]) != sig->bytes[i]) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,32 @@
+// src/utils/sig.h
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Byte signatures ("array of bytes", AOB) with wildcards, such as
+ * "48 8B ?? ?? 89 05". Byte i of the data matches byte i of the signature
+ * when (data & mask[i]) == bytes[i]: mask 0xFF is a fixed byte, 0x00 a
+ * wildcard (?? or ?) and 0xF0 or 0x0F a half-fixed one (4? or ?B).
+ *
+ * The scanner doesn't try every offset. It looks for the anchor, the
+ * rarest pair of adjacent non-wildcard bytes of the signature (or its
+ * rarest non-wildcard byte if no two are adjacent), with a vector
+ * prefilter, and only verifies the whole signature where the anchor is
+ * found.
+ */
+typedef struct {
+    uint8_t *bytes;
+    uint8_t *mask;
+    size_t len;
+    size_t anchor;     // offset of the anchor in the signature
+    size_t anchor_len; // 2 for a pair of bytes, 1 for a single one
+} signature_t;
+
+int sig_compile(const char *text, signature_t *sig);
+int sig_from_bytes(const void *bytes, size_t len, signature_t *sig);
+int sig_from_masked(const uint8_t *bytes, const uint8_t *mask, size_t len,
+                    signature_t *sig);
+void sig_free(signature_t *sig);
+bool sig_match(const signature_t *sig, const uint8_t *data);
@@ -0,0 +1,1213 @@
+// src/utils/simd.c
+#include "simd.h"
+#include <float.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMD_X86 1
+#else
+#define SIMD_X86 0
+#endif
+
+// Operation ids, in cmp_op_t order
+#define OP_EQ 0
+#define OP_NE 1
+#define OP_GT 2
+#define OP_LT 3
+
+// Floating-point predicates, all false for NaN but FP_UNORD
+#define FP_LT 0    // a < b
+#define FP_LE 1    // a <= b
+#define FP_EQ 2    // a == b
+#define FP_NE 3    // a != b, both numbers
+#define FP_UNORD 4 // a or b is NaN
+
+#define FLOAT_32 float
+#define FLOAT_64 double
+#define FLOAT_MIN_32 FLT_MIN
+#define FLOAT_MIN_64 DBL_MIN
+
+/**
+ * NOTE:
+ * Scalar kernels, also used for the tail of every vector kernel. The index
+ * is stored unconditionally and only kept on a hit, so there is no branch
+ * to mispredict.
+ */
+#define DEFINE_SCALAR_KERNEL(W, OP, EXPR)                                      \
+    static size_t scalar_u##W##_##OP(const uint8_t *data, size_t n,           \
+                                     uint64_t target, uint32_t *hits) {        \
+        const uint##W##_t t = (uint##W##_t)target;                             \
+        size_t k = 0;                                                          \
+        for (size_t i = 0; i < n; i++) {                                       \
+            uint##W##_t v;                                                     \
+            memcpy(&v, data + i * sizeof(v), sizeof(v));                       \
+            hits[k] = (uint32_t)i;                                             \
+            k += (EXPR);                                                       \
+        }                                                                      \
+        return k;                                                              \
+    }
+
+#define DEFINE_SCALAR_KERNELS(W)                                               \
+    DEFINE_SCALAR_KERNEL(W, eq, v == t)                                        \
+    DEFINE_SCALAR_KERNEL(W, ne, v != t)                                        \
+    DEFINE_SCALAR_KERNEL(W, gt, v > t)                                         \
+    DEFINE_SCALAR_KERNEL(W, lt, v < t)
+
+DEFINE_SCALAR_KERNELS(8)
+DEFINE_SCALAR_KERNELS(16)
+DEFINE_SCALAR_KERNELS(32)
+DEFINE_SCALAR_KERNELS(64)
+
+/**
+ * NOTE:
+ * Relation kernels compare two buffers element by element. REL_DELTA keeps
+ * the elements whose wrapped difference new - old lies in [lo, lo + end),
+ * which a single unsigned compare decides: (new - old - lo) < end.
+ * REL_INCREASED and REL_DECREASED compare the values XOR lo instead, so
+ * lo = the sign bit orders them as signed (like pred.c does).
+ */
+#define DEFINE_SCALAR_REL(W, OP, EXPR)                                         \
+    static size_t scalar_rel_u##W##_##OP(const uint8_t *old,                   \
+                                         const uint8_t *cur, size_t n,         \
+                                         uint64_t lo, uint64_t end,            \
+                                         uint32_t *hits) {                     \
+        const uint##W##_t l = (uint##W##_t)lo, e = (uint##W##_t)end;           \
+        (void)l;                                                               \
+        (void)e;                                                               \
+        size_t k = 0;                                                          \
+        for (size_t i = 0; i < n; i++) {                                       \
+            uint##W##_t o, v;                                                  \
+            memcpy(&o, old + i * sizeof(o), sizeof(o));                        \
+            memcpy(&v, cur + i * sizeof(v), sizeof(v));                        \
+            hits[k] = (uint32_t)i;                                             \
+            k += (EXPR);                                                       \
+        }                                                                      \
+        return k;                                                              \
+    }
+
+// A value XOR lo, inside a scalar relation kernel
+#define REL_FLIP(W, x) (uint##W##_t)((x) ^ l)
+
+#define DEFINE_SCALAR_RELS(W)                                                  \
+    DEFINE_SCALAR_REL(W, changed, v != o)                                      \
+    DEFINE_SCALAR_REL(W, unchanged, v == o)                                    \
+    DEFINE_SCALAR_REL(W, increased, REL_FLIP(W, v) > REL_FLIP(W, o))           \
+    DEFINE_SCALAR_REL(W, decreased, REL_FLIP(W, v) < REL_FLIP(W, o))           \
+    DEFINE_SCALAR_REL(W, delta, (uint##W##_t)(v - o - l) < e)
+
+DEFINE_SCALAR_RELS(8)
+DEFINE_SCALAR_RELS(16)
+DEFINE_SCALAR_RELS(32)
+DEFINE_SCALAR_RELS(64)
+
+/**
+ * NOTE:
+ * The pair kernel is the prefilter of signature scans: it finds the
+ * positions where two given bytes follow each other.
+ */
+static size_t scalar_pair(const uint8_t *data, size_t n, uint8_t b0,
+                          uint8_t m0, uint8_t b1, uint8_t m1,
+                          uint32_t *hits) {
+    size_t k = 0;
+    for (size_t i = 0; i < n; i++) {
+        hits[k] = (uint32_t)i;
+        k += (data[i] & m0) == b0 && (data[i + 1] & m1) == b1;
+    }
+    return k;
+}
+
+/**
+ * NOTE:
+ * Range kernels are the condition test of predicates: bit i of the bitmap
+ * is set when ((x ^ flip) & mask) - lo < end, the same wrapped range test
+ * as REL_DELTA, with one word of the bitmap per 64 elements.
+ */
+#define DEFINE_SCALAR_RANGE(W)                                                 \
+    static void scalar_range_u##W(const uint8_t *data, size_t n,               \
+                                  uint64_t flip, uint64_t mask, uint64_t lo,   \
+                                  uint64_t end, uint64_t *bits) {              \
+        const uint##W##_t f = (uint##W##_t)flip, k = (uint##W##_t)mask;        \
+        const uint##W##_t l = (uint##W##_t)lo, e = (uint##W##_t)end;           \
+        for (size_t i = 0; i < n; i += 64) {                                   \
+            uint64_t word = 0;                                                 \
+            for (size_t j = 0; j < 64 && i + j < n; j++) {                     \
+                uint##W##_t v;                                                 \
+                memcpy(&v, data + (i + j) * sizeof(v), sizeof(v));             \
+                word |= (uint64_t)((uint##W##_t)(((v ^ f) & k) - l) < e) << j; \
+            }                                                                  \
+            bits[i / 64] = word;                                               \
+        }                                                                      \
+    }
+
+DEFINE_SCALAR_RANGE(8)
+DEFINE_SCALAR_RANGE(16)
+DEFINE_SCALAR_RANGE(32)
+DEFINE_SCALAR_RANGE(64)
+
+/**
+ * NOTE:
+ * The diff kernel is the byte compare of detect: bit i of the bitmap is set
+ * when the two buffers differ at byte i.
+ */
+static void scalar_diff(const uint8_t *old, const uint8_t *cur, size_t n,
+                        uint64_t *bits) {
+    for (size_t i = 0; i < n; i += 64) {
+        uint64_t word = 0;
+        for (size_t j = 0; j < 64 && i + j < n; j++) {
+            word |= (uint64_t)(old[i + j] != cur[i + j]) << j;
+        }
+        bits[i / 64] = word;
+    }
+}
+
+/**
+ * NOTE:
+ * Floating-point kernels compare against bounds [lo, hi] (see fcmp_op_t).
+ * Every element is flushed first: a denormal compares as zero. NaN fails
+ * every ordered compare, so it only ever matches FCMP_NAN, and is in no
+ * relation with anything.
+ */
+#define DEFINE_FLUSH(W)                                                        \
+    static inline FLOAT_##W flush_f##W(FLOAT_##W x) {                          \
+        return x > -FLOAT_MIN_##W && x < FLOAT_MIN_##W ? 0 : x;                \
+    }
+
+DEFINE_FLUSH(32)
+DEFINE_FLUSH(64)
+
+#define DEFINE_SCALAR_FKERNEL(W, OP, EXPR)                                     \
+    static size_t scalar_f##W##_##OP(const uint8_t *data, size_t n,            \
+                                     double lo, double hi, uint32_t *hits) {   \
+        const FLOAT_##W l = (FLOAT_##W)lo, h = (FLOAT_##W)hi;                  \
+        (void)l;                                                               \
+        (void)h;                                                               \
+        size_t k = 0;                                                          \
+        for (size_t i = 0; i < n; i++) {                                       \
+            FLOAT_##W x;                                                       \
+            memcpy(&x, data + i * sizeof(x), sizeof(x));                       \
+            x = flush_f##W(x);                                                 \
+            hits[k] = (uint32_t)i;                                             \
+            k += (EXPR);                                                       \
+        }                                                                      \
+        return k;                                                              \
+    }
+
+#define DEFINE_SCALAR_FKERNELS(W)                                              \
+    DEFINE_SCALAR_FKERNEL(W, range, l <= x && x <= h)                          \
+    DEFINE_SCALAR_FKERNEL(W, outside, x < l || x > h)                          \
+    DEFINE_SCALAR_FKERNEL(W, gt, x > h)                                        \
+    DEFINE_SCALAR_FKERNEL(W, lt, x < l)                                        \
+    DEFINE_SCALAR_FKERNEL(W, nan, x != x)
+
+DEFINE_SCALAR_FKERNELS(32)
+DEFINE_SCALAR_FKERNELS(64)
+
+// REL_DELTA keeps the elements with lo <= new - old <= hi
+#define DEFINE_SCALAR_FREL(W, OP, EXPR)                                        \
+    static size_t scalar_frel_f##W##_##OP(const uint8_t *old,                  \
+                                          const uint8_t *cur, size_t n,        \
+                                          double lo, double hi,                \
+                                          uint32_t *hits) {                    \
+        const FLOAT_##W l = (FLOAT_##W)lo, h = (FLOAT_##W)hi;                  \
+        (void)l;                                                               \
+        (void)h;                                                               \
+        size_t k = 0;                                                          \
+        for (size_t i = 0; i < n; i++) {                                       \
+            FLOAT_##W o, v;                                                    \
+            memcpy(&o, old + i * sizeof(o), sizeof(o));                        \
+            memcpy(&v, cur + i * sizeof(v), sizeof(v));                        \
+            o = flush_f##W(o);                                                 \
+            v = flush_f##W(v);                                                 \
+            FLOAT_##W d = (FLOAT_##W)(v - o);                                  \
+            (void)d;                                                           \
+            hits[k] = (uint32_t)i;                                             \
+            k += (EXPR);                                                       \
+        }                                                                      \
+        return k;                                                              \
+    }
+
+#define DEFINE_SCALAR_FRELS(W)                                                 \
+    DEFINE_SCALAR_FREL(W, changed, v < o || v > o)                             \
+    DEFINE_SCALAR_FREL(W, unchanged, v == o)                                   \
+    DEFINE_SCALAR_FREL(W, increased, v > o)                                    \
+    DEFINE_SCALAR_FREL(W, decreased, v < o)                                    \
+    DEFINE_SCALAR_FREL(W, delta, l <= d && d <= h)
+
+DEFINE_SCALAR_FRELS(32)
+DEFINE_SCALAR_FRELS(64)
+
+/**
+ * NOTE:
+ * A vector kernel loads one vector at a time, turns the compare into a
+ * bitmask of lanes (LVL_mask_uW) and pulls the hits out of it with tzcnt.
+ * SHIFT converts a mask bit into an element index: SSE2/AVX2 have no 16-bit
+ * movemask, so the byte mask is used and every other bit is kept. The
+ * remaining elements go through the scalar kernel.
+ */
+#define DEFINE_VEC_KERNEL(LVL, W, OP, OPID, VEC_BYTES, SHIFT)                  \
+    TARGET_##LVL static size_t LVL##_u##W##_##OP(                              \
+        const uint8_t *data, size_t n, uint64_t target, uint32_t *hits) {      \
+        const size_t per = (VEC_BYTES) / sizeof(uint##W##_t);                  \
+        VEC_##LVL t = LVL##_splat_u##W(target);                                \
+        size_t i = 0, k = 0;                                                   \
+        for (; i + per <= n; i += per) {                                       \
+            uint64_t m = LVL##_mask_u##W(                                      \
+                LVL##_load(data + i * sizeof(uint##W##_t)), t, OPID);          \
+            while (m) {                                                        \
+                hits[k++] = (uint32_t)(i + (__builtin_ctzll(m) >> (SHIFT)));   \
+                m &= m - 1;                                                    \
+            }                                                                  \
+        }                                                                      \
+        size_t tail = scalar_u##W##_##OP(data + i * sizeof(uint##W##_t),       \
+                                         n - i, target, hits + k);             \
+        for (size_t j = 0; j < tail; j++) {                                    \
+            hits[k + j] += (uint32_t)i;                                        \
+        }                                                                      \
+        return k + tail;                                                       \
+    }
+
+/**
+ * NOTE:
+ * A vector pair kernel masks two overlapping loads, one byte apart, compares
+ * them and ands their lane masks.
+ */
+#define DEFINE_VEC_PAIR(LVL, VEC_BYTES)                                        \
+    TARGET_##LVL static size_t LVL##_pair(                                     \
+        const uint8_t *data, size_t n, uint8_t b0, uint8_t m0, uint8_t b1,     \
+        uint8_t m1, uint32_t *hits) {                                          \
+        VEC_##LVL t0 = LVL##_splat_u8(b0), k0 = LVL##_splat_u8(m0);            \
+        VEC_##LVL t1 = LVL##_splat_u8(b1), k1 = LVL##_splat_u8(m1);            \
+        size_t i = 0, k = 0;                                                   \
+        for (; i + (VEC_BYTES) <= n; i += (VEC_BYTES)) {                       \
+            VEC_##LVL x0 = LVL##_and(LVL##_load(data + i), k0);                \
+            VEC_##LVL x1 = LVL##_and(LVL##_load(data + i + 1), k1);            \
+            uint64_t m = LVL##_mask_u8(x0, t0, OP_EQ) &                        \
+                         LVL##_mask_u8(x1, t1, OP_EQ);                         \
+            while (m) {                                                        \
+                hits[k++] = (uint32_t)(i + __builtin_ctzll(m));                \
+                m &= m - 1;                                                    \
+            }                                                                  \
+        }                                                                      \
+        size_t tail =                                                          \
+            scalar_pair(data + i, n - i, b0, m0, b1, m1, hits + k);            \
+        for (size_t j = 0; j < tail; j++) {                                    \
+            hits[k + j] += (uint32_t)i;                                        \
+        }                                                                      \
+        return k + tail;                                                       \
+    }
+
+/**
+ * Keep every other bit of a mask, packed: the lane mask of 16-bit lanes
+ * taken from a byte movemask (SHIFT 1).
+ */
+static inline uint64_t even_bits(uint64_t m) {
+    m &= 0x5555555555555555ULL;
+    m = (m | m >> 1) & 0x3333333333333333ULL;
+    m = (m | m >> 2) & 0x0F0F0F0F0F0F0F0FULL;
+    m = (m | m >> 4) & 0x00FF00FF00FF00FFULL;
+    m = (m | m >> 8) & 0x0000FFFF0000FFFFULL;
+    return (m | m >> 16) & 0x00000000FFFFFFFFULL;
+}
+
+/**
+ * NOTE:
+ * A vector range kernel fills one word of the bitmap from the lane masks of
+ * the 64 elements it covers (64 is a multiple of the lanes of any vector),
+ * and leaves the last partial word to the scalar kernel.
+ */
+#define DEFINE_VEC_RANGE(LVL, W, VEC_BYTES, SHIFT)                             \
+    TARGET_##LVL static void LVL##_range_u##W(                                 \
+        const uint8_t *data, size_t n, uint64_t flip, uint64_t mask,           \
+        uint64_t lo, uint64_t end, uint64_t *bits) {                           \
+        const size_t per = (VEC_BYTES) / sizeof(uint##W##_t);                  \
+        VEC_##LVL f = LVL##_splat_u##W(flip), k = LVL##_splat_u##W(mask);      \
+        VEC_##LVL l = LVL##_splat_u##W(lo), e = LVL##_splat_u##W(end);         \
+        size_t i = 0;                                                          \
+        for (; i + 64 <= n; i += 64) {                                         \
+            uint64_t word = 0;                                                 \
+            for (size_t j = 0; j < 64; j += per) {                             \
+                const uint8_t *at = data + (i + j) * sizeof(uint##W##_t);     \
+                VEC_##LVL x = LVL##_load(at);                                  \
+                x = LVL##_and(LVL##_xor(x, f), k);                             \
+                uint64_t m =                                                   \
+                    LVL##_mask_u##W(LVL##_sub_u##W(x, l), e, OP_LT);           \
+                word |= (SHIFT ? even_bits(m) : m) << j;                       \
+            }                                                                  \
+            bits[i / 64] = word;                                               \
+        }                                                                      \
+        scalar_range_u##W(data + i * sizeof(uint##W##_t), n - i, flip, mask,   \
+                          lo, end, bits + i / 64);                             \
+    }
+
+/**
+ * NOTE:
+ * A vector diff kernel fills one word of the bitmap per 64 bytes, from one
+ * (AVX-512), two (AVX2) or four (SSE2) byte compares.
+ */
+#define DEFINE_VEC_DIFF(LVL, VEC_BYTES)                                        \
+    TARGET_##LVL static void LVL##_diff(const uint8_t *old,                    \
+                                        const uint8_t *cur, size_t n,          \
+                                        uint64_t *bits) {                      \
+        size_t i = 0;                                                          \
+        for (; i + 64 <= n; i += 64) {                                         \
+            uint64_t word = 0;                                                 \
+            for (size_t j = 0; j < 64; j += (VEC_BYTES)) {                     \
+                word |= LVL##_mask_u8(LVL##_load(old + i + j),                 \
+                                      LVL##_load(cur + i + j), OP_NE)          \
+                        << j;                                                  \
+            }                                                                  \
+            bits[i / 64] = word;                                               \
+        }                                                                      \
+        scalar_diff(old + i, cur + i, n - i, bits + i / 64);                   \
+    }
+
+#define DEFINE_VEC_KERNELS(LVL, W, VEC_BYTES, SHIFT)                           \
+    DEFINE_VEC_KERNEL(LVL, W, eq, OP_EQ, VEC_BYTES, SHIFT)                     \
+    DEFINE_VEC_KERNEL(LVL, W, ne, OP_NE, VEC_BYTES, SHIFT)                     \
+    DEFINE_VEC_KERNEL(LVL, W, gt, OP_GT, VEC_BYTES, SHIFT)                     \
+    DEFINE_VEC_KERNEL(LVL, W, lt, OP_LT, VEC_BYTES, SHIFT)                     \
+    DEFINE_VEC_RELS(LVL, W, VEC_BYTES, SHIFT)                                  \
+    DEFINE_VEC_RANGE(LVL, W, VEC_BYTES, SHIFT)
+
+// Lane mask of one relation, with o/v the old/new vectors
+#define REL_MASK_changed(LVL, W, o, v, l, e) LVL##_mask_u##W(v, o, OP_NE)
+#define REL_MASK_unchanged(LVL, W, o, v, l, e) LVL##_mask_u##W(v, o, OP_EQ)
+#define REL_MASK_increased(LVL, W, o, v, l, e)                                 \
+    LVL##_mask_u##W(LVL##_xor(v, l), LVL##_xor(o, l), OP_GT)
+#define REL_MASK_decreased(LVL, W, o, v, l, e)                                 \
+    LVL##_mask_u##W(LVL##_xor(v, l), LVL##_xor(o, l), OP_LT)
+#define REL_MASK_delta(LVL, W, o, v, l, e)                                     \
+    LVL##_mask_u##W(LVL##_sub_u##W(LVL##_sub_u##W(v, o), l), e, OP_LT)
+
+/**
+ * NOTE:
+ * A vector relation kernel loads one vector of each buffer at a time and
+ * turns the relation into a lane mask, just like DEFINE_VEC_KERNEL does.
+ */
+#define DEFINE_VEC_REL(LVL, W, OP, VEC_BYTES, SHIFT)                           \
+    TARGET_##LVL static size_t LVL##_rel_u##W##_##OP(                          \
+        const uint8_t *old, const uint8_t *cur, size_t n, uint64_t lo,         \
+        uint64_t end, uint32_t *hits) {                                        \
+        const size_t per = (VEC_BYTES) / sizeof(uint##W##_t);                  \
+        VEC_##LVL l = LVL##_splat_u##W(lo);                                    \
+        VEC_##LVL e = LVL##_splat_u##W(end);                                   \
+        (void)l;                                                               \
+        (void)e;                                                               \
+        size_t i = 0, k = 0;                                                   \
+        for (; i + per <= n; i += per) {                                       \
+            VEC_##LVL o = LVL##_load(old + i * sizeof(uint##W##_t));           \
+            VEC_##LVL v = LVL##_load(cur + i * sizeof(uint##W##_t));           \
+            uint64_t m = REL_MASK_##OP(LVL, W, o, v, l, e);                    \
+            while (m) {                                                        \
+                hits[k++] = (uint32_t)(i + (__builtin_ctzll(m) >> (SHIFT)));   \
+                m &= m - 1;                                                    \
+            }                                                                  \
+        }                                                                      \
+        size_t tail = scalar_rel_u##W##_##OP(old + i * sizeof(uint##W##_t),    \
+                                             cur + i * sizeof(uint##W##_t),    \
+                                             n - i, lo, end, hits + k);        \
+        for (size_t j = 0; j < tail; j++) {                                    \
+            hits[k + j] += (uint32_t)i;                                        \
+        }                                                                      \
+        return k + tail;                                                       \
+    }
+
+#define DEFINE_VEC_RELS(LVL, W, VEC_BYTES, SHIFT)                              \
+    DEFINE_VEC_REL(LVL, W, changed, VEC_BYTES, SHIFT)                          \
+    DEFINE_VEC_REL(LVL, W, unchanged, VEC_BYTES, SHIFT)                        \
+    DEFINE_VEC_REL(LVL, W, increased, VEC_BYTES, SHIFT)                        \
+    DEFINE_VEC_REL(LVL, W, decreased, VEC_BYTES, SHIFT)                        \
+    DEFINE_VEC_REL(LVL, W, delta, VEC_BYTES, SHIFT)
+
+// Lane mask of one fcmp_op_t or float relation, from LVL_fcmp_fW()
+#define FCMP_MASK_range(LVL, W, x, l, h)                                       \
+    (LVL##_fcmp_f##W(l, x, FP_LE) & LVL##_fcmp_f##W(x, h, FP_LE))
+#define FCMP_MASK_outside(LVL, W, x, l, h)                                     \
+    (LVL##_fcmp_f##W(x, l, FP_LT) | LVL##_fcmp_f##W(h, x, FP_LT))
+#define FCMP_MASK_gt(LVL, W, x, l, h) LVL##_fcmp_f##W(h, x, FP_LT)
+#define FCMP_MASK_lt(LVL, W, x, l, h) LVL##_fcmp_f##W(x, l, FP_LT)
+#define FCMP_MASK_nan(LVL, W, x, l, h) LVL##_fcmp_f##W(x, x, FP_UNORD)
+#define FREL_MASK_changed(LVL, W, o, v, l, h) LVL##_fcmp_f##W(v, o, FP_NE)
+#define FREL_MASK_unchanged(LVL, W, o, v, l, h) LVL##_fcmp_f##W(v, o, FP_EQ)
+#define FREL_MASK_increased(LVL, W, o, v, l, h) LVL##_fcmp_f##W(o, v, FP_LT)
+#define FREL_MASK_decreased(LVL, W, o, v, l, h) LVL##_fcmp_f##W(v, o, FP_LT)
+#define FREL_MASK_delta(LVL, W, o, v, l, h)                                    \
+    FCMP_MASK_range(LVL, W, LVL##_fsub_f##W(v, o), l, h)
+
+/**
+ * NOTE:
+ * Vector floating-point kernels work like the integer ones, on flushed
+ * elements. Every lane is a whole element, so no mask bit is dropped.
+ */
+#define DEFINE_VEC_FKERNEL(LVL, W, OP, VEC_BYTES)                              \
+    TARGET_##LVL static size_t LVL##_f##W##_##OP(                              \
+        const uint8_t *data, size_t n, double lo, double hi, uint32_t *hits) { \
+        const size_t per = (VEC_BYTES) / sizeof(FLOAT_##W);                    \
+        FVEC_##LVL##_##W l = LVL##_fsplat_f##W(lo);                            \
+        FVEC_##LVL##_##W h = LVL##_fsplat_f##W(hi);                            \
+        (void)l;                                                               \
+        (void)h;                                                               \
+        size_t i = 0, k = 0;                                                   \
+        for (; i + per <= n; i += per) {                                       \
+            FVEC_##LVL##_##W x = LVL##_flush_f##W(                             \
+                LVL##_fload_f##W(data + i * sizeof(FLOAT_##W)));               \
+            uint64_t m = FCMP_MASK_##OP(LVL, W, x, l, h);                      \
+            while (m) {                                                        \
+                hits[k++] = (uint32_t)(i + __builtin_ctzll(m));                \
+                m &= m - 1;                                                    \
+            }                                                                  \
+        }                                                                      \
+        size_t tail = scalar_f##W##_##OP(data + i * sizeof(FLOAT_##W), n - i,  \
+                                         lo, hi, hits + k);                    \
+        for (size_t j = 0; j < tail; j++) {                                    \
+            hits[k + j] += (uint32_t)i;                                        \
+        }                                                                      \
+        return k + tail;                                                       \
+    }
+
+#define DEFINE_VEC_FREL(LVL, W, OP, VEC_BYTES)                                 \
+    TARGET_##LVL static size_t LVL##_frel_f##W##_##OP(                         \
+        const uint8_t *old, const uint8_t *cur, size_t n, double lo,           \
+        double hi, uint32_t *hits) {                                           \
+        const size_t per = (VEC_BYTES) / sizeof(FLOAT_##W);                    \
+        FVEC_##LVL##_##W l = LVL##_fsplat_f##W(lo);                            \
+        FVEC_##LVL##_##W h = LVL##_fsplat_f##W(hi);                            \
+        (void)l;                                                               \
+        (void)h;                                                               \
+        size_t i = 0, k = 0;                                                   \
+        for (; i + per <= n; i += per) {                                       \
+            FVEC_##LVL##_##W o = LVL##_flush_f##W(                             \
+                LVL##_fload_f##W(old + i * sizeof(FLOAT_##W)));                \
+            FVEC_##LVL##_##W v = LVL##_flush_f##W(                             \
+                LVL##_fload_f##W(cur + i * sizeof(FLOAT_##W)));                \
+            uint64_t m = FREL_MASK_##OP(LVL, W, o, v, l, h);                   \
+            while (m) {                                                        \
+                hits[k++] = (uint32_t)(i + __builtin_ctzll(m));                \
+                m &= m - 1;                                                    \
+            }                                                                  \
+        }                                                                      \
+        size_t tail = scalar_frel_f##W##_##OP(old + i * sizeof(FLOAT_##W),     \
+                                              cur + i * sizeof(FLOAT_##W),     \
+                                              n - i, lo, hi, hits + k);        \
+        for (size_t j = 0; j < tail; j++) {                                    \
+            hits[k + j] += (uint32_t)i;                                        \
+        }                                                                      \
+        return k + tail;                                                       \
+    }
+
+#define DEFINE_VEC_FKERNELS(LVL, W, VEC_BYTES)                                 \
+    DEFINE_VEC_FKERNEL(LVL, W, range, VEC_BYTES)                               \
+    DEFINE_VEC_FKERNEL(LVL, W, outside, VEC_BYTES)                             \
+    DEFINE_VEC_FKERNEL(LVL, W, gt, VEC_BYTES)                                  \
+    DEFINE_VEC_FKERNEL(LVL, W, lt, VEC_BYTES)                                  \
+    DEFINE_VEC_FKERNEL(LVL, W, nan, VEC_BYTES)                                 \
+    DEFINE_VEC_FREL(LVL, W, changed, VEC_BYTES)                                \
+    DEFINE_VEC_FREL(LVL, W, unchanged, VEC_BYTES)                              \
+    DEFINE_VEC_FREL(LVL, W, increased, VEC_BYTES)                              \
+    DEFINE_VEC_FREL(LVL, W, decreased, VEC_BYTES)                              \
+    DEFINE_VEC_FREL(LVL, W, delta, VEC_BYTES)
+
+#if SIMD_X86
+
+/**
+ * NOTE:
+ * SSE2 and AVX2 only compare signed integers, so both sides get their sign
+ * bit flipped first, which maps unsigned order onto signed order.
+ */
+
+// ---- SSE2 ----------------------------------------------------------------
+#define TARGET_sse2 __attribute__((target("sse2")))
+typedef __m128i VEC_sse2;
+
+TARGET_sse2 static inline __m128i sse2_load(const uint8_t *p) {
+    return _mm_loadu_si128((const __m128i *)p);
+}
+#define sse2_sub_u8(a, b) _mm_sub_epi8(a, b)
+#define sse2_sub_u16(a, b) _mm_sub_epi16(a, b)
+#define sse2_sub_u32(a, b) _mm_sub_epi32(a, b)
+#define sse2_sub_u64(a, b) _mm_sub_epi64(a, b)
+#define sse2_and(a, b) _mm_and_si128(a, b)
+#define sse2_xor(a, b) _mm_xor_si128(a, b)
+TARGET_sse2 static inline __m128i sse2_splat_u8(uint64_t v) {
+    return _mm_set1_epi8((char)v);
+}
+TARGET_sse2 static inline __m128i sse2_splat_u16(uint64_t v) {
+    return _mm_set1_epi16((short)v);
+}
+TARGET_sse2 static inline __m128i sse2_splat_u32(uint64_t v) {
+    return _mm_set1_epi32((int)v);
+}
+TARGET_sse2 static inline __m128i sse2_splat_u64(uint64_t v) {
+    return _mm_set1_epi64x((long long)v);
+}
+
+TARGET_sse2 static inline uint64_t sse2_mask_u8(__m128i x, __m128i t,
+                                                int op) {
+    __m128i s = _mm_set1_epi8((char)0x80);
+    __m128i r;
+    switch (op) {
+    case OP_EQ:
+    case OP_NE:
+        r = _mm_cmpeq_epi8(x, t);
+        break;
+    case OP_GT:
+        r = _mm_cmpgt_epi8(_mm_xor_si128(x, s), _mm_xor_si128(t, s));
+        break;
+    default:
+        r = _mm_cmpgt_epi8(_mm_xor_si128(t, s), _mm_xor_si128(x, s));
+        break;
+    }
+    uint64_t m = (unsigned)_mm_movemask_epi8(r);
+    return op == OP_NE ? ~m & 0xFFFF : m;
+}
+
+TARGET_sse2 static inline uint64_t sse2_mask_u16(__m128i x, __m128i t,
+                                                 int op) {
+    __m128i s = _mm_set1_epi16((short)0x8000);
+    __m128i r;
+    switch (op) {
+    case OP_EQ:
+    case OP_NE:
+        r = _mm_cmpeq_epi16(x, t);
+        break;
+    case OP_GT:
+        r = _mm_cmpgt_epi16(_mm_xor_si128(x, s), _mm_xor_si128(t, s));
+        break;
+    default:
+        r = _mm_cmpgt_epi16(_mm_xor_si128(t, s), _mm_xor_si128(x, s));
+        break;
+    }
+    uint64_t m = (unsigned)_mm_movemask_epi8(r);
+    return (op == OP_NE ? ~m : m) & 0x5555;
+}
+
+TARGET_sse2 static inline uint64_t sse2_mask_u32(__m128i x, __m128i t,
+                                                 int op) {
+    __m128i s = _mm_set1_epi32((int)0x80000000u);
+    __m128i r;
+    switch (op) {
+    case OP_EQ:
+    case OP_NE:
+        r = _mm_cmpeq_epi32(x, t);
+        break;
+    case OP_GT:
+        r = _mm_cmpgt_epi32(_mm_xor_si128(x, s), _mm_xor_si128(t, s));
+        break;
+    default:
+        r = _mm_cmpgt_epi32(_mm_xor_si128(t, s), _mm_xor_si128(x, s));
+        break;
+    }
+    uint64_t m = (unsigned)_mm_movemask_ps(_mm_castsi128_ps(r));
+    return op == OP_NE ? ~m & 0xF : m;
+}
+
+/**
+ * SSE2 has no 64-bit compares, so they are built from 32-bit halves:
+ * a > b  <=>  hi(a) > hi(b) || (hi(a) == hi(b) && lo(a) > lo(b)),
+ * with both halves compared as unsigned.
+ */
+TARGET_sse2 static inline __m128i sse2_gt_u64(__m128i a, __m128i b) {
+    __m128i s = _mm_set1_epi32((int)0x80000000u);
+    __m128i gt = _mm_cmpgt_epi32(_mm_xor_si128(a, s), _mm_xor_si128(b, s));
+    __m128i eq = _mm_cmpeq_epi32(a, b);
+    __m128i gt_hi = _mm_shuffle_epi32(gt, _MM_SHUFFLE(3, 3, 1, 1));
+    __m128i gt_lo = _mm_shuffle_epi32(gt, _MM_SHUFFLE(2, 2, 0, 0));
+    __m128i eq_hi = _mm_shuffle_epi32(eq, _MM_SHUFFLE(3, 3, 1, 1));
+    return _mm_or_si128(gt_hi, _mm_and_si128(eq_hi, gt_lo));
+}
+
+TARGET_sse2 static inline uint64_t sse2_mask_u64(__m128i x, __m128i t,
+                                                 int op) {
+    __m128i r;
+    switch (op) {
+    case OP_EQ:
+    case OP_NE: {
+        __m128i eq = _mm_cmpeq_epi32(x, t);
+        r = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+        break;
+    }
+    case OP_GT:
+        r = sse2_gt_u64(x, t);
+        break;
+    default:
+        r = sse2_gt_u64(t, x);
+        break;
+    }
+    uint64_t m = (unsigned)_mm_movemask_pd(_mm_castsi128_pd(r));
+    return op == OP_NE ? ~m & 0x3 : m;
+}
+
+DEFINE_VEC_KERNELS(sse2, 8, 16, 0)
+DEFINE_VEC_KERNELS(sse2, 16, 16, 1)
+DEFINE_VEC_KERNELS(sse2, 32, 16, 0)
+DEFINE_VEC_KERNELS(sse2, 64, 16, 0)
+DEFINE_VEC_PAIR(sse2, 16)
+DEFINE_VEC_DIFF(sse2, 16)
+
+// Floating-point lanes: flushing clears the lanes with |x| < MIN
+typedef __m128 FVEC_sse2_32;
+typedef __m128d FVEC_sse2_64;
+#define sse2_fload_f32(p) _mm_loadu_ps((const float *)(p))
+#define sse2_fload_f64(p) _mm_loadu_pd((const double *)(p))
+#define sse2_fsplat_f32(v) _mm_set1_ps((float)(v))
+#define sse2_fsplat_f64(v) _mm_set1_pd(v)
+#define sse2_fsub_f32(a, b) _mm_sub_ps(a, b)
+#define sse2_fsub_f64(a, b) _mm_sub_pd(a, b)
+
+TARGET_sse2 static inline __m128 sse2_flush_f32(__m128 x) {
+    __m128 a = _mm_and_ps(x, _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF)));
+    return _mm_andnot_ps(_mm_cmplt_ps(a, _mm_set1_ps(FLT_MIN)), x);
+}
+
+TARGET_sse2 static inline __m128d sse2_flush_f64(__m128d x) {
+    __m128d a = _mm_and_pd(
+        x, _mm_castsi128_pd(_mm_set1_epi64x(0x7FFFFFFFFFFFFFFFLL)));
+    return _mm_andnot_pd(_mm_cmplt_pd(a, _mm_set1_pd(DBL_MIN)), x);
+}
+
+// SSE2 has no ordered not-equal, so it is built from not-equal and ordered
+#define DEFINE_SSE2_FCMP(W, VEC, SUFFIX, MOVEMASK)                             \
+    TARGET_sse2 static inline uint64_t sse2_fcmp_f##W(VEC a, VEC b, int p) {   \
+        VEC r;                                                                 \
+        switch (p) {                                                           \
+        case FP_LT:                                                            \
+            r = _mm_cmplt_##SUFFIX(a, b);                                      \
+            break;                                                             \
+        case FP_LE:                                                            \
+            r = _mm_cmple_##SUFFIX(a, b);                                      \
+            break;                                                             \
+        case FP_EQ:                                                            \
+            r = _mm_cmpeq_##SUFFIX(a, b);                                      \
+            break;                                                             \
+        case FP_NE:                                                            \
+            r = _mm_and_##SUFFIX(_mm_cmpneq_##SUFFIX(a, b),                    \
+                                 _mm_cmpord_##SUFFIX(a, b));                   \
+            break;                                                             \
+        default:                                                               \
+            r = _mm_cmpunord_##SUFFIX(a, b);                                   \
+            break;                                                             \
+        }                                                                      \
+        return (unsigned)MOVEMASK(r);                                          \
+    }
+
+DEFINE_SSE2_FCMP(32, __m128, ps, _mm_movemask_ps)
+DEFINE_SSE2_FCMP(64, __m128d, pd, _mm_movemask_pd)
+
+DEFINE_VEC_FKERNELS(sse2, 32, 16)
+DEFINE_VEC_FKERNELS(sse2, 64, 16)
+
+// ---- AVX2 ----------------------------------------------------------------
+#define TARGET_avx2 __attribute__((target("avx2,bmi")))
+typedef __m256i VEC_avx2;
+
+TARGET_avx2 static inline __m256i avx2_load(const uint8_t *p) {
+    return _mm256_loadu_si256((const __m256i *)p);
+}
+#define avx2_sub_u8(a, b) _mm256_sub_epi8(a, b)
+#define avx2_sub_u16(a, b) _mm256_sub_epi16(a, b)
+#define avx2_sub_u32(a, b) _mm256_sub_epi32(a, b)
+#define avx2_sub_u64(a, b) _mm256_sub_epi64(a, b)
+#define avx2_and(a, b) _mm256_and_si256(a, b)
+#define avx2_xor(a, b) _mm256_xor_si256(a, b)
+TARGET_avx2 static inline __m256i avx2_splat_u8(uint64_t v) {
+    return _mm256_set1_epi8((char)v);
+}
+TARGET_avx2 static inline __m256i avx2_splat_u16(uint64_t v) {
+    return _mm256_set1_epi16((short)v);
+}
+TARGET_avx2 static inline __m256i avx2_splat_u32(uint64_t v) {
+    return _mm256_set1_epi32((int)v);
+}
+TARGET_avx2 static inline __m256i avx2_splat_u64(uint64_t v) {
+    return _mm256_set1_epi64x((long long)v);
+}
+
+// One mask function per lane width, differing only in the intrinsics used
+#define DEFINE_AVX2_MASK(W, SIGN, CMPEQ, CMPGT, MOVEMASK, ALL)                 \
+    TARGET_avx2 static inline uint64_t avx2_mask_u##W(__m256i x, __m256i t,    \
+                                                      int op) {                \
+        __m256i s = SIGN;                                                      \
+        __m256i r;                                                             \
+        switch (op) {                                                          \
+        case OP_EQ:                                                            \
+        case OP_NE:                                                            \
+            r = CMPEQ(x, t);                                                   \
+            break;                                                             \
+        case OP_GT:                                                            \
+            r = CMPGT(_mm256_xor_si256(x, s), _mm256_xor_si256(t, s));         \
+            break;                                                             \
+        default:                                                               \
+            r = CMPGT(_mm256_xor_si256(t, s), _mm256_xor_si256(x, s));         \
+            break;                                                             \
+        }                                                                      \
+        uint64_t m = (uint32_t)MOVEMASK(r);                                    \
+        return (op == OP_NE ? ~m : m) & (ALL);                                 \
+    }
+
+#define AVX2_MOVEMASK_8(r) _mm256_movemask_epi8(r)
+#define AVX2_MOVEMASK_32(r) _mm256_movemask_ps(_mm256_castsi256_ps(r))
+#define AVX2_MOVEMASK_64(r) _mm256_movemask_pd(_mm256_castsi256_pd(r))
+
+DEFINE_AVX2_MASK(8, _mm256_set1_epi8((char)0x80), _mm256_cmpeq_epi8,
+                 _mm256_cmpgt_epi8, AVX2_MOVEMASK_8, 0xFFFFFFFFu)
+DEFINE_AVX2_MASK(16, _mm256_set1_epi16((short)0x8000), _mm256_cmpeq_epi16,
+                 _mm256_cmpgt_epi16, AVX2_MOVEMASK_8, 0x55555555u)
+DEFINE_AVX2_MASK(32, _mm256_set1_epi32((int)0x80000000u), _mm256_cmpeq_epi32,
+                 _mm256_cmpgt_epi32, AVX2_MOVEMASK_32, 0xFFu)
+DEFINE_AVX2_MASK(64, _mm256_set1_epi64x((long long)0x8000000000000000ull),
+                 _mm256_cmpeq_epi64, _mm256_cmpgt_epi64, AVX2_MOVEMASK_64,
+                 0xFu)
+
+DEFINE_VEC_KERNELS(avx2, 8, 32, 0)
+DEFINE_VEC_KERNELS(avx2, 16, 32, 1)
+DEFINE_VEC_KERNELS(avx2, 32, 32, 0)
+DEFINE_VEC_KERNELS(avx2, 64, 32, 0)
+DEFINE_VEC_PAIR(avx2, 32)
+DEFINE_VEC_DIFF(avx2, 32)
+
+typedef __m256 FVEC_avx2_32;
+typedef __m256d FVEC_avx2_64;
+#define avx2_fload_f32(p) _mm256_loadu_ps((const float *)(p))
+#define avx2_fload_f64(p) _mm256_loadu_pd((const double *)(p))
+#define avx2_fsplat_f32(v) _mm256_set1_ps((float)(v))
+#define avx2_fsplat_f64(v) _mm256_set1_pd(v)
+#define avx2_fsub_f32(a, b) _mm256_sub_ps(a, b)
+#define avx2_fsub_f64(a, b) _mm256_sub_pd(a, b)
+
+TARGET_avx2 static inline __m256 avx2_flush_f32(__m256 x) {
+    __m256 a =
+        _mm256_and_ps(x, _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF)));
+    return _mm256_andnot_ps(
+        _mm256_cmp_ps(a, _mm256_set1_ps(FLT_MIN), _CMP_LT_OQ), x);
+}
+
+TARGET_avx2 static inline __m256d avx2_flush_f64(__m256d x) {
+    __m256d a = _mm256_and_pd(
+        x, _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FFFFFFFFFFFFFFFLL)));
+    return _mm256_andnot_pd(
+        _mm256_cmp_pd(a, _mm256_set1_pd(DBL_MIN), _CMP_LT_OQ), x);
+}
+
+// AVX has every predicate, with ordered (_OQ) ones failing on NaN
+#define DEFINE_AVX2_FCMP(W, VEC, CMP, MOVEMASK)                                \
+    TARGET_avx2 static inline uint64_t avx2_fcmp_f##W(VEC a, VEC b, int p) {   \
+        VEC r;                                                                 \
+        switch (p) {                                                           \
+        case FP_LT:                                                            \
+            r = CMP(a, b, _CMP_LT_OQ);                                         \
+            break;                                                             \
+        case FP_LE:                                                            \
+            r = CMP(a, b, _CMP_LE_OQ);                                         \
+            break;                                                             \
+        case FP_EQ:                                                            \
+            r = CMP(a, b, _CMP_EQ_OQ);                                         \
+            break;                                                             \
+        case FP_NE:                                                            \
+            r = CMP(a, b, _CMP_NEQ_OQ);                                        \
+            break;                                                             \
+        default:                                                               \
+            r = CMP(a, b, _CMP_UNORD_Q);                                       \
+            break;                                                             \
+        }                                                                      \
+        return (unsigned)MOVEMASK(r);                                          \
+    }
+
+DEFINE_AVX2_FCMP(32, __m256, _mm256_cmp_ps, _mm256_movemask_ps)
+DEFINE_AVX2_FCMP(64, __m256d, _mm256_cmp_pd, _mm256_movemask_pd)
+
+DEFINE_VEC_FKERNELS(avx2, 32, 32)
+DEFINE_VEC_FKERNELS(avx2, 64, 32)
+
+// ---- AVX-512 -------------------------------------------------------------
+// Unsigned compares straight into a mask register, no sign flipping needed
+#define TARGET_avx512 __attribute__((target("avx512f,avx512bw,bmi")))
+typedef __m512i VEC_avx512;
+
+TARGET_avx512 static inline __m512i avx512_load(const uint8_t *p) {
+    return _mm512_loadu_si512((const void *)p);
+}
+#define avx512_sub_u8(a, b) _mm512_sub_epi8(a, b)
+#define avx512_sub_u16(a, b) _mm512_sub_epi16(a, b)
+#define avx512_sub_u32(a, b) _mm512_sub_epi32(a, b)
+#define avx512_sub_u64(a, b) _mm512_sub_epi64(a, b)
+#define avx512_and(a, b) _mm512_and_si512(a, b)
+#define avx512_xor(a, b) _mm512_xor_si512(a, b)
+TARGET_avx512 static inline __m512i avx512_splat_u8(uint64_t v) {
+    return _mm512_set1_epi8((char)v);
+}
+TARGET_avx512 static inline __m512i avx512_splat_u16(uint64_t v) {
+    return _mm512_set1_epi16((short)v);
+}
+TARGET_avx512 static inline __m512i avx512_splat_u32(uint64_t v) {
+    return _mm512_set1_epi32((int)v);
+}
+TARGET_avx512 static inline __m512i avx512_splat_u64(uint64_t v) {
+    return _mm512_set1_epi64((long long)v);
+}
+
+#define DEFINE_AVX512_MASK(W, CMP)                                             \
+    TARGET_avx512 static inline uint64_t avx512_mask_u##W(                     \
+        __m512i x, __m512i t, int op) {                                        \
+        switch (op) {                                                          \
+        case OP_EQ:                                                            \
+            return CMP(x, t, _MM_CMPINT_EQ);                                   \
+        case OP_NE:                                                            \
+            return CMP(x, t, _MM_CMPINT_NE);                                   \
+        case OP_GT:                                                            \
+            return CMP(x, t, _MM_CMPINT_NLE);                                  \
+        default:                                                               \
+            return CMP(x, t, _MM_CMPINT_LT);                                   \
+        }                                                                      \
+    }
+
+DEFINE_AVX512_MASK(8, _mm512_cmp_epu8_mask)
+DEFINE_AVX512_MASK(16, _mm512_cmp_epu16_mask)
+DEFINE_AVX512_MASK(32, _mm512_cmp_epu32_mask)
+DEFINE_AVX512_MASK(64, _mm512_cmp_epu64_mask)
+
+DEFINE_VEC_KERNELS(avx512, 8, 64, 0)
+DEFINE_VEC_KERNELS(avx512, 16, 64, 0)
+DEFINE_VEC_KERNELS(avx512, 32, 64, 0)
+DEFINE_VEC_KERNELS(avx512, 64, 64, 0)
+DEFINE_VEC_PAIR(avx512, 64)
+DEFINE_VEC_DIFF(avx512, 64)
+
+typedef __m512 FVEC_avx512_32;
+typedef __m512d FVEC_avx512_64;
+#define avx512_fload_f32(p) _mm512_loadu_ps((const void *)(p))
+#define avx512_fload_f64(p) _mm512_loadu_pd((const void *)(p))
+#define avx512_fsplat_f32(v) _mm512_set1_ps((float)(v))
+#define avx512_fsplat_f64(v) _mm512_set1_pd(v)
+#define avx512_fsub_f32(a, b) _mm512_sub_ps(a, b)
+#define avx512_fsub_f64(a, b) _mm512_sub_pd(a, b)
+
+TARGET_avx512 static inline __m512 avx512_flush_f32(__m512 x) {
+    __mmask16 d = _mm512_cmp_ps_mask(_mm512_abs_ps(x),
+                                     _mm512_set1_ps(FLT_MIN), _CMP_LT_OQ);
+    return _mm512_mask_mov_ps(x, d, _mm512_setzero_ps());
+}
+
+TARGET_avx512 static inline __m512d avx512_flush_f64(__m512d x) {
+    __mmask8 d = _mm512_cmp_pd_mask(_mm512_abs_pd(x),
+                                    _mm512_set1_pd(DBL_MIN), _CMP_LT_OQ);
+    return _mm512_mask_mov_pd(x, d, _mm512_setzero_pd());
+}
+
+#define DEFINE_AVX512_FCMP(W, VEC, CMP)                                        \
+    TARGET_avx512 static inline uint64_t avx512_fcmp_f##W(VEC a, VEC b,        \
+                                                          int p) {             \
+        switch (p) {                                                           \
+        case FP_LT:                                                            \
+            return CMP(a, b, _CMP_LT_OQ);                                      \
+        case FP_LE:                                                            \
+            return CMP(a, b, _CMP_LE_OQ);                                      \
+        case FP_EQ:                                                            \
+            return CMP(a, b, _CMP_EQ_OQ);                                      \
+        case FP_NE:                                                            \
+            return CMP(a, b, _CMP_NEQ_OQ);                                     \
+        default:                                                               \
+            return CMP(a, b, _CMP_UNORD_Q);                                    \
+        }                                                                      \
+    }
+
+DEFINE_AVX512_FCMP(32, __m512, _mm512_cmp_ps_mask)
+DEFINE_AVX512_FCMP(64, __m512d, _mm512_cmp_pd_mask)
+
+DEFINE_VEC_FKERNELS(avx512, 32, 64)
+DEFINE_VEC_FKERNELS(avx512, 64, 64)
+
+#endif // SIMD_X86
+
+#define KERNEL_ROW(LVL, W)                                                     \
+    { LVL##_u##W##_eq, LVL##_u##W##_ne, LVL##_u##W##_gt, LVL##_u##W##_lt }
+#define KERNEL_LEVEL(LVL)                                                      \
+    {                                                                          \
+        KERNEL_ROW(LVL, 8), KERNEL_ROW(LVL, 16), KERNEL_ROW(LVL, 32),          \
+            KERNEL_ROW(LVL, 64)                                                \
+    }
+
+// Every kernel, by [simd_level_t][scan_type_t][cmp_op_t]
+static const cmp_kernel_t g_kernels[SIMD_LEVELS][4][4] = {
+    KERNEL_LEVEL(scalar),
+#if SIMD_X86
+    KERNEL_LEVEL(sse2),
+    KERNEL_LEVEL(avx2),
+    KERNEL_LEVEL(avx512),
+#endif
+};
+
+#define REL_ROW(LVL, W)                                                        \
+    {                                                                          \
+        LVL##_rel_u##W##_changed, LVL##_rel_u##W##_unchanged,                  \
+            LVL##_rel_u##W##_increased, LVL##_rel_u##W##_decreased,            \
+            LVL##_rel_u##W##_delta                                             \
+    }
+#define REL_LEVEL(LVL)                                                         \
+    {                                                                          \
+        REL_ROW(LVL, 8), REL_ROW(LVL, 16), REL_ROW(LVL, 32), REL_ROW(LVL, 64)  \
+    }
+
+// Every relation kernel, by [simd_level_t][scan_type_t][rel_op_t]
+static const rel_kernel_t g_rel_kernels[SIMD_LEVELS][4][5] = {
+    REL_LEVEL(scalar),
+#if SIMD_X86
+    REL_LEVEL(sse2),
+    REL_LEVEL(avx2),
+    REL_LEVEL(avx512),
+#endif
+};
+
+#define FKERNEL_ROW(LVL, W)                                                    \
+    {                                                                          \
+        LVL##_f##W##_range, LVL##_f##W##_outside, LVL##_f##W##_gt,             \
+            LVL##_f##W##_lt, LVL##_f##W##_nan                                  \
+    }
+#define FKERNEL_LEVEL(LVL)                                                     \
+    { FKERNEL_ROW(LVL, 32), FKERNEL_ROW(LVL, 64) }
+
+// Every floating-point kernel, by [simd_level_t][float, double][fcmp_op_t]
+static const fcmp_kernel_t g_fkernels[SIMD_LEVELS][2][5] = {
+    FKERNEL_LEVEL(scalar),
+#if SIMD_X86
+    FKERNEL_LEVEL(sse2),
+    FKERNEL_LEVEL(avx2),
+    FKERNEL_LEVEL(avx512),
+#endif
+};
+
+#define FREL_ROW(LVL, W)                                                       \
+    {                                                                          \
+        LVL##_frel_f##W##_changed, LVL##_frel_f##W##_unchanged,                \
+            LVL##_frel_f##W##_increased, LVL##_frel_f##W##_decreased,          \
+            LVL##_frel_f##W##_delta                                            \
+    }
+#define FREL_LEVEL(LVL)                                                        \
+    { FREL_ROW(LVL, 32), FREL_ROW(LVL, 64) }
+
+// Every floating-point relation kernel, by [level][float, double][rel_op_t]
+static const frel_kernel_t g_frel_kernels[SIMD_LEVELS][2][5] = {
+    FREL_LEVEL(scalar),
+#if SIMD_X86
+    FREL_LEVEL(sse2),
+    FREL_LEVEL(avx2),
+    FREL_LEVEL(avx512),
+#endif
+};
+
+#define RANGE_LEVEL(LVL)                                                       \
+    {                                                                          \
+        LVL##_range_u8, LVL##_range_u16, LVL##_range_u32, LVL##_range_u64      \
+    }
+
+// Every range kernel, by [simd_level_t][scan_type_t]
+static const range_kernel_t g_range_kernels[SIMD_LEVELS][4] = {
+    RANGE_LEVEL(scalar),
+#if SIMD_X86
+    RANGE_LEVEL(sse2),
+    RANGE_LEVEL(avx2),
+    RANGE_LEVEL(avx512),
+#endif
+};
+
+// Every pair kernel, by simd_level_t
+static const pair_kernel_t g_pair_kernels[SIMD_LEVELS] = {
+    scalar_pair,
+#if SIMD_X86
+    sse2_pair,
+    avx2_pair,
+    avx512_pair,
+#endif
+};
+
+// Every diff kernel, by simd_level_t
+static const diff_kernel_t g_diff_kernels[SIMD_LEVELS] = {
+    scalar_diff,
+#if SIMD_X86
+    sse2_diff,
+    avx2_diff,
+    avx512_diff,
+#endif
+};
+
+/**
+ * Check whether the running CPU (and OS) supports a level.
+ */
+static bool level_supported(simd_level_t level) {
+#if SIMD_X86
+    __builtin_cpu_init();
+    switch (level) {
+    case SIMD_SCALAR:
+        return true;
+    case SIMD_SSE2:
+        return __builtin_cpu_supports("sse2");
+    case SIMD_AVX2:
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi");
+    case SIMD_AVX512:
+        return __builtin_cpu_supports("avx512f") &&
+               __builtin_cpu_supports("avx512bw") &&
+               __builtin_cpu_supports("bmi");
+    default:
+        return false;
+    }
+#else
+    return level == SIMD_SCALAR;
+#endif
+}
+
+/**
+ * Get the best vector level of the running CPU, detected with cpuid on the
+ * first call. The environment variable LLCE_SIMD (scalar, sse2, avx2 or
+ * avx512) caps it, e.g. to compare the kernels against each other.
+ *
+ * @return The level search_compare() uses.
+ */
+simd_level_t simd_level(void) {
+    static int cached = -1;
+    if (cached >= 0) {
+        return (simd_level_t)cached;
+    }
+
+    simd_level_t cap = SIMD_LEVELS - 1;
+    const char *env = getenv("LLCE_SIMD");
+    for (int l = 0; env && l < SIMD_LEVELS; l++) {
+        if (strcmp(env, simd_level_name((simd_level_t)l)) == 0) {
+            cap = (simd_level_t)l;
+        }
+    }
+
+    simd_level_t best = SIMD_SCALAR;
+    for (int l = SIMD_SCALAR + 1; l <= (int)cap; l++) {
+        if (level_supported((simd_level_t)l)) {
+            best = (simd_level_t)l;
+        }
+    }
+    cached = (int)best;
+    return best;
+}
+
+/**
+ * Get the printable name of a level.
+ */
+const char *simd_level_name(simd_level_t level) {
+    static const char *names[SIMD_LEVELS] = {"scalar", "sse2", "avx2",
+                                             "avx512"};
+    return level < SIMD_LEVELS ? names[level] : "?";
+}
+
+/**
+ * Get the comparison kernel of a level.
+ *
+ * @param level Vector level, see simd_level().
+ * @param type Type of the elements.
+ * @param cmp Comparison operation.
+ * @return The kernel, or NULL if the running CPU lacks the level or the
+ * arguments are invalid.
+ */
+cmp_kernel_t cmp_kernel(simd_level_t level, scan_type_t type, cmp_op_t cmp) {
+    if (level >= SIMD_LEVELS || (unsigned)type > SCAN_TYPE_QWORD ||
+        (unsigned)cmp > CMP_LT || !level_supported(level)) {
+        return NULL;
+    }
+    return g_kernels[level][type][cmp];
+}
+
+/**
+ * Get the relation kernel of a level.
+ *
+ * @param level Vector level, see simd_level().
+ * @param type Type of the elements.
+ * @param op Relation between the old and the new value.
+ * @return The kernel, or NULL if the running CPU lacks the level or the
+ * arguments are invalid.
+ */
+rel_kernel_t rel_kernel(simd_level_t level, scan_type_t type, rel_op_t op) {
+    if (level >= SIMD_LEVELS || (unsigned)type > SCAN_TYPE_QWORD ||
+        (unsigned)op > REL_DELTA || !level_supported(level)) {
+        return NULL;
+    }
+    return g_rel_kernels[level][type][op];
+}
+
+/**
+ * Get the floating-point comparison kernel of a level.
+ *
+ * @param level Vector level, see simd_level().
+ * @param type SCAN_TYPE_FLOAT or SCAN_TYPE_DOUBLE.
+ * @param op Comparison against the bounds.
+ * @return The kernel, or NULL if the running CPU lacks the level or the
+ * arguments are invalid.
+ */
+fcmp_kernel_t fcmp_kernel(simd_level_t level, scan_type_t type,
+                          fcmp_op_t op) {
+    if (level >= SIMD_LEVELS ||
+        (type != SCAN_TYPE_FLOAT && type != SCAN_TYPE_DOUBLE) ||
+        (unsigned)op > FCMP_NAN || !level_supported(level)) {
+        return NULL;
+    }
+    return g_fkernels[level][type - SCAN_TYPE_FLOAT][op];
+}
+
+/**
+ * Get the floating-point relation kernel of a level.
+ *
+ * @param level Vector level, see simd_level().
+ * @param type SCAN_TYPE_FLOAT or SCAN_TYPE_DOUBLE.
+ * @param op Relation between the old and the new value.
+ * @return The kernel, or NULL if the running CPU lacks the level or the
+ * arguments are invalid.
+ */
+frel_kernel_t frel_kernel(simd_level_t level, scan_type_t type,
+                          rel_op_t op) {
+    if (level >= SIMD_LEVELS ||
+        (type != SCAN_TYPE_FLOAT && type != SCAN_TYPE_DOUBLE) ||
+        (unsigned)op > REL_DELTA || !level_supported(level)) {
+        return NULL;
+    }
+    return g_frel_kernels[level][type - SCAN_TYPE_FLOAT][op];
+}
+
+/**
+ * Get the byte pair kernel of a level.
+ *
+ * @param level Vector level, see simd_level().
+ * @return The kernel, or NULL if the running CPU lacks the level.
+ */
+pair_kernel_t pair_kernel(simd_level_t level) {
+    if (level >= SIMD_LEVELS || !level_supported(level)) {
+        return NULL;
+    }
+    return g_pair_kernels[level];
+}
+
+/**
+ * Get the predicate range kernel of a level.
+ *
+ * @param level Vector level, see simd_level().
+ * @param type Type of the elements (an integer type).
+ * @return The kernel, or NULL if the running CPU lacks the level or the
+ * arguments are invalid.
+ */
+range_kernel_t range_kernel(simd_level_t level, scan_type_t type) {
+    if (level >= SIMD_LEVELS || (unsigned)type > SCAN_TYPE_QWORD ||
+        !level_supported(level)) {
+        return NULL;
+    }
+    return g_range_kernels[level][type];
+}
+
+/**
+ * Get the byte diff kernel of a level.
+ *
+ * @param level Vector level, see simd_level().
+ * @return The kernel, or NULL if the running CPU lacks the level.
+ */
+diff_kernel_t diff_kernel(simd_level_t level) {
+    if (level >= SIMD_LEVELS || !level_supported(level)) {
+        return NULL;
+    }
+    return g_diff_kernels[level];
+}
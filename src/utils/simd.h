@@ -0,0 +1,83 @@
+// src/utils/simd.h
+#pragma once
+#include "scan.h" // scan_type_t, cmp_op_t
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Vectorized comparison kernels for search_compare().
+ * A kernel compares `n` consecutive elements of one scan_type_t against a
+ * (zero-extended) target with one cmp_op_t, and writes the index of every
+ * matching element to `hits` (room for `n` entries), in ascending order.
+ * Vector kernels build a bitmask of matching lanes per vector and walk it
+ * with tzcnt, so the cost of a miss is a compare and a movemask.
+ */
+typedef size_t (*cmp_kernel_t)(const uint8_t *data, size_t n, uint64_t target,
+                               uint32_t *hits);
+
+/**
+ * Relation kernels for search_relation_set(): the same, but comparing the
+ * elements of two buffers (old and new) with each other. REL_DELTA keeps
+ * the elements whose wrapped difference new - old lies in [lo, lo + end).
+ * REL_INCREASED and REL_DECREASED compare the values XOR lo: 0 orders them
+ * as unsigned, the sign bit as signed.
+ */
+typedef size_t (*rel_kernel_t)(const uint8_t *old, const uint8_t *cur,
+                               size_t n, uint64_t lo, uint64_t end,
+                               uint32_t *hits);
+
+/**
+ * Floating-point kernels for SCAN_TYPE_FLOAT and SCAN_TYPE_DOUBLE: the same,
+ * but against the bounds [lo, hi] of an fcmp_op_t, or with REL_DELTA
+ * keeping the elements with lo <= new - old <= hi. Denormals compare as
+ * zero, and NaN only matches FCMP_NAN.
+ */
+typedef size_t (*fcmp_kernel_t)(const uint8_t *data, size_t n, double lo,
+                                double hi, uint32_t *hits);
+typedef size_t (*frel_kernel_t)(const uint8_t *old, const uint8_t *cur,
+                                size_t n, double lo, double hi,
+                                uint32_t *hits);
+
+/**
+ * Byte pair kernel, the prefilter of signature and text scans: writes every
+ * position i < n with (data[i] & m0) == b0 and (data[i + 1] & m1) == b1 to
+ * `hits` (reading n + 1 bytes), in ascending order. A mask of 0xFF is an
+ * exact byte, 0xDF an ASCII letter in either case, 0x00 any byte.
+ */
+typedef size_t (*pair_kernel_t)(const uint8_t *data, size_t n, uint8_t b0,
+                                uint8_t m0, uint8_t b1, uint8_t m1,
+                                uint32_t *hits);
+
+/**
+ * Range kernels for predicates (see pred.h): set bit i of `bits` (one word
+ * per 64 elements, the bits past n cleared) when the element passes
+ * ((x ^ flip) & mask) - lo < end, a wrapped compare in its width.
+ */
+typedef void (*range_kernel_t)(const uint8_t *data, size_t n, uint64_t flip,
+                               uint64_t mask, uint64_t lo, uint64_t end,
+                               uint64_t *bits);
+
+/**
+ * Diff kernel for detect_memory_changes(): set bit i of `bits` (one word per
+ * 64 bytes, the bits past n cleared) when old[i] != cur[i].
+ */
+typedef void (*diff_kernel_t)(const uint8_t *old, const uint8_t *cur,
+                              size_t n, uint64_t *bits);
+
+typedef enum {
+    SIMD_SCALAR, // portable C
+    SIMD_SSE2,   // 128-bit
+    SIMD_AVX2,   // 256-bit
+    SIMD_AVX512, // 512-bit, AVX-512F + BW
+    SIMD_LEVELS,
+} simd_level_t;
+
+simd_level_t simd_level(void);
+const char *simd_level_name(simd_level_t level);
+cmp_kernel_t cmp_kernel(simd_level_t level, scan_type_t type, cmp_op_t cmp);
+rel_kernel_t rel_kernel(simd_level_t level, scan_type_t type, rel_op_t op);
+fcmp_kernel_t fcmp_kernel(simd_level_t level, scan_type_t type, fcmp_op_t op);
+frel_kernel_t frel_kernel(simd_level_t level, scan_type_t type, rel_op_t op);
+pair_kernel_t pair_kernel(simd_level_t level);
+range_kernel_t range_kernel(simd_level_t level, scan_type_t type);
+diff_kernel_t diff_kernel(simd_level_t level);
@@ -0,0 +1,364 @@
+// src/utils/snapfile.c
+#include "snapfile.h"
+#include "hash.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static size_t align_up(size_t value, size_t align) {
+    return (value + align - 1) / align * align;
+}
+
+static size_t region_pages(uint64_t len) {
+    return (size_t)align_up(len, page_size()) / page_size();
+}
+
+/**
+ *  Writes a whole buffer at an offset of a file, retrying short writes.
+ *
+ *  @return 0 on success, or an error code on failure.
+ */
+static int pwrite_all(int fd, const void *buf, size_t len, off_t offset) {
+    const uint8_t *p = buf;
+    while (len > 0) {
+        ssize_t n = pwrite(fd, p, len, offset);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+        p += n;
+        len -= (size_t)n;
+        offset += n;
+    }
+    return 0;
+}
+
+/**
+ *  Reads a whole buffer from an offset of a file.
+ *
+ *  @return 0 on success, EINVAL if the file is too short, or an error code.
+ */
+static int pread_all(int fd, void *buf, size_t len, off_t offset) {
+    uint8_t *p = buf;
+    while (len > 0) {
+        ssize_t n = pread(fd, p, len, offset);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+        if (n == 0) {
+            return EINVAL;
+        }
+        p += n;
+        len -= (size_t)n;
+        offset += n;
+    }
+    return 0;
+}
+
+static uint64_t page_checksum(const mem_region_t *region, size_t page) {
+    size_t ps = page_size();
+    size_t offset = page * ps;
+    size_t len = region->len - offset < ps ? region->len - offset : ps;
+    return hash64(region->data + offset, len, 0);
+}
+
+/**
+ *  Saves a snapshot to a file (see snapfile.h for the layout).
+ *  Hash-only regions can't be saved.
+ *
+ *  @param path      The file to create (or truncate).
+ *  @param all       The regions of the snapshot.
+ *  @param all_count Number of regions.
+ *  @param proc_name Name of the captured process, stored in the header.
+ *  @param checksums true to store a checksum of every page.
+ *  @return 0 on success, or an error code on failure.
+ */
+int snapshot_save(const char *path,            // [in]
+                  const mem_region_t *all,     // [in]
+                  size_t all_count,            // [in]
+                  const char *proc_name,       // [in]
+                  bool checksums               // [in]
+) {
+    size_t ps = page_size();
+
+    // Regions the scan couldn't read anything from have no data to save
+    mem_region_t *regions = malloc((all_count ? all_count : 1) *
+                                   sizeof(*regions));
+    if (!regions) {
+        return ENOMEM;
+    }
+    size_t count = 0;
+    for (size_t i = 0; i < all_count; i++) {
+        if (region_hash_only(&all[i])) {
+            free(regions);
+            return EINVAL;
+        }
+        if (all[i].data) {
+            regions[count++] = all[i];
+        }
+    }
+
+    // Lay out the header, region table and per-region metadata first
+    snapfile_region_t *table = calloc(count ? count : 1, sizeof(*table));
+    if (!table) {
+        free(regions);
+        return ENOMEM;
+    }
+    size_t meta_end = sizeof(snapfile_header_t) + count * sizeof(*table);
+    for (size_t i = 0; i < count; i++) {
+        size_t pages = region_pages(regions[i].len);
+        table[i].start = regions[i].start;
+        table[i].len = regions[i].len;
+        if (regions[i].pages) {
+            table[i].pages_offset = meta_end;
+            meta_end += pages;
+        }
+        if (checksums) {
+            meta_end = align_up(meta_end, sizeof(uint64_t));
+            table[i].sums_offset = meta_end;
+            meta_end += pages * sizeof(uint64_t);
+        }
+    }
+    size_t data_end = align_up(meta_end, ps);
+    for (size_t i = 0; i < count; i++) {
+        table[i].data_offset = data_end;
+        data_end += align_up(regions[i].len, ps);
+    }
+
+    uint8_t *meta = calloc(1, meta_end);
+    if (!meta) {
+        free(table);
+        free(regions);
+        return ENOMEM;
+    }
+    snapfile_header_t *header = (snapfile_header_t *)meta;
+    memcpy(header->magic, SNAPFILE_MAGIC, sizeof(header->magic));
+    header->version = SNAPFILE_VERSION;
+    header->flags = checksums ? SNAPFILE_CHECKSUMS : 0;
+    header->page_size = ps;
+    header->region_count = count;
+    if (proc_name) {
+        snprintf(header->proc_name, sizeof(header->proc_name), "%s",
+                 proc_name);
+    }
+    memcpy(meta + sizeof(*header), table, count * sizeof(*table));
+    for (size_t i = 0; i < count; i++) {
+        size_t pages = region_pages(regions[i].len);
+        if (table[i].pages_offset) {
+            memcpy(meta + table[i].pages_offset, regions[i].pages, pages);
+        }
+        if (table[i].sums_offset) {
+            uint64_t *sums = (uint64_t *)(meta + table[i].sums_offset);
+            for (size_t p = 0; p < pages; p++) {
+                // The page hashes of a scan are exactly these checksums
+                sums[p] = regions[i].hashes ? regions[i].hashes[p]
+                                            : page_checksum(&regions[i], p);
+            }
+        }
+    }
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        int rc = errno;
+        free(meta);
+        free(table);
+        free(regions);
+        return rc;
+    }
+
+    int rc = pwrite_all(fd, meta, meta_end, 0);
+
+    // Write the runs of data pages only; holes stay holes of the file
+    for (size_t i = 0; i < count && rc == 0; i++) {
+        const mem_region_t *r = &regions[i];
+        size_t pages = region_pages(r->len);
+        size_t p = 0;
+        while (p < pages && rc == 0) {
+            if (region_page_state(r, p) != PAGE_DATA) {
+                p++;
+                continue;
+            }
+            size_t run = p;
+            while (run < pages && region_page_state(r, run) == PAGE_DATA) {
+                run++;
+            }
+            size_t offset = p * ps;
+            size_t len = (run * ps < r->len ? run * ps : r->len) - offset;
+            rc = pwrite_all(fd, r->data + offset, len,
+                            (off_t)(table[i].data_offset + offset));
+            p = run;
+        }
+    }
+
+    // Extend the file over trailing holes and the padding of the last block
+    if (rc == 0 && ftruncate(fd, (off_t)data_end) != 0) {
+        rc = errno;
+    }
+    if (close(fd) != 0 && rc == 0) {
+        rc = errno;
+    }
+    if (rc != 0) {
+        unlink(path);
+    }
+
+    free(meta);
+    free(table);
+    free(regions);
+    return rc;
+}
+
+/**
+ *  Checks the stored checksums of a loaded region.
+ *
+ *  @return 0 if every page matches, EBADMSG otherwise.
+ */
+static int verify_region(const mem_region_t *region) {
+    size_t pages = region_pages(region->len);
+    for (size_t p = 0; p < pages; p++) {
+        if (region->hashes[p] != page_checksum(region, p)) {
+            fprintf(stderr, "snapshot: checksum mismatch at 0x%lx\n",
+                    region->start + p * page_size());
+            return EBADMSG;
+        }
+    }
+    return 0;
+}
+
+/**
+ *  Loads a snapshot file saved by snapshot_save().
+ *  The data of every region is a read-only mmap of the file, so pages are
+ *  only read from disk when they are touched. All regions get one fresh
+ *  generation id.
+ *
+ *  @param path          The file to load.
+ *  @param verify        true to check the page checksums (reads everything).
+ *  @param regions       Pointer to store the loaded regions.
+ *  @param count         Pointer to store the number of regions.
+ *  @param proc_name     Buffer for the captured process name, or NULL.
+ *  @param proc_name_len Size of proc_name.
+ *  @return 0 on success, EINVAL for a malformed file, ENOTSUP for a file
+ *          from a machine with another page size, EBADMSG for a checksum
+ *          mismatch, or an error code on failure.
+ */
+int snapshot_load(const char *path,       // [in]
+                  bool verify,            // [in]
+                  mem_region_t **regions, // [out]
+                  size_t *count,          // [out]
+                  char *proc_name,        // [out]
+                  size_t proc_name_len    // [in]
+) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return errno;
+    }
+
+    struct stat st;
+    snapfile_header_t header;
+    int rc = fstat(fd, &st) != 0 ? errno : 0;
+    if (rc == 0) {
+        rc = pread_all(fd, &header, sizeof(header), 0);
+    }
+    if (rc == 0 && (memcmp(header.magic, SNAPFILE_MAGIC,
+                           sizeof(header.magic)) != 0 ||
+                    header.version != SNAPFILE_VERSION)) {
+        rc = EINVAL;
+    }
+    if (rc == 0 && header.page_size != page_size()) {
+        rc = ENOTSUP;
+    }
+    if (rc == 0 && header.region_count > ((uint64_t)st.st_size -
+                                          sizeof(header)) /
+                                             sizeof(snapfile_region_t)) {
+        rc = EINVAL;
+    }
+    if (rc != 0) {
+        close(fd);
+        return rc;
+    }
+    if (verify && !(header.flags & SNAPFILE_CHECKSUMS)) {
+        fprintf(stderr, "snapshot: %s has no checksums to verify\n", path);
+        verify = false;
+    }
+
+    size_t n = (size_t)header.region_count;
+    snapfile_region_t *table = malloc((n ? n : 1) * sizeof(*table));
+    mem_region_t *out = calloc(n ? n : 1, sizeof(*out));
+    if (!table || !out) {
+        free(table);
+        free(out);
+        close(fd);
+        return ENOMEM;
+    }
+    rc = pread_all(fd, table, n * sizeof(*table), sizeof(header));
+
+    uint64_t gen = scan_gen_next();
+    size_t loaded = 0;
+    for (; loaded < n && rc == 0; loaded++) {
+        const snapfile_region_t *e = &table[loaded];
+        mem_region_t *r = &out[loaded];
+        size_t pages = region_pages(e->len);
+        size_t map_len = pages * page_size();
+        if (e->len == 0 || e->data_offset % page_size() != 0 ||
+            e->data_offset > (uint64_t)st.st_size ||
+            map_len > (uint64_t)st.st_size - e->data_offset) {
+            rc = EINVAL;
+            break;
+        }
+
+        void *data = mmap(NULL, map_len, PROT_READ, MAP_PRIVATE, fd,
+                          (off_t)e->data_offset);
+        if (data == MAP_FAILED) {
+            rc = errno;
+            break;
+        }
+        r->start = e->start;
+        r->len = e->len;
+        r->data = data;
+        r->cap = map_len;
+        r->mapped = true;
+        r->gen = gen;
+
+        if (e->pages_offset) {
+            r->pages = malloc(pages);
+            if (!r->pages) {
+                rc = ENOMEM;
+                break;
+            }
+            rc = pread_all(fd, r->pages, pages, (off_t)e->pages_offset);
+        }
+        if (rc == 0 && e->sums_offset) {
+            // The checksums double as the page hashes of the region
+            r->hashes = malloc(pages * sizeof(uint64_t));
+            rc = r->hashes ? pread_all(fd, r->hashes, pages * sizeof(uint64_t),
+                                       (off_t)e->sums_offset)
+                           : ENOMEM;
+        }
+        if (rc == 0 && verify) {
+            rc = verify_region(r);
+        }
+    }
+    free(table);
+    close(fd);
+
+    if (rc != 0) {
+        free_mem_regions(out, n); // untouched entries are all zero
+        return rc;
+    }
+    if (proc_name && proc_name_len > 0) {
+        header.proc_name[sizeof(header.proc_name) - 1] = '\0';
+        snprintf(proc_name, proc_name_len, "%s", header.proc_name);
+    }
+    *regions = out;
+    *count = n;
+    return 0;
+}
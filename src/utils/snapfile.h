@@ -0,0 +1,49 @@
+// src/utils/snapfile.h
+#pragma once
+#include "probe.h" // mem_region_t
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * On-disk snapshot format (native byte order, little-endian on x86-64):
+ *
+ *   offset 0       snapfile_header_t
+ *                  snapfile_region_t[region_count]
+ *                  per region: page states (pages bytes, if any)
+ *                              page checksums (pages * 8 bytes, if any)
+ *   page aligned   per region: data (len bytes, padded to a page)
+ *
+ * Every data block starts on a page boundary of the file, so a loader can
+ * mmap it directly and use the mapping as the region buffer. Hole pages
+ * (PAGE_ZERO / PAGE_UNKNOWN) are not written, which leaves them as holes of
+ * a sparse file.
+ */
+
+#define SNAPFILE_MAGIC "LLCESNAP"
+#define SNAPFILE_VERSION 1
+
+// Header flags
+#define SNAPFILE_CHECKSUMS (1u << 0) // per-page hash64() of the data
+
+typedef struct {
+    char magic[8];         // SNAPFILE_MAGIC, not NUL-terminated
+    uint32_t version;      // SNAPFILE_VERSION
+    uint32_t flags;        // SNAPFILE_* flags
+    uint64_t page_size;    // page size of the machine that wrote the file
+    uint64_t region_count; // entries of the region table
+    char proc_name[256];   // name of the captured process
+} snapfile_header_t;
+
+typedef struct {
+    uint64_t start;        // region base address in the target
+    uint64_t len;          // region length in bytes
+    uint64_t data_offset;  // page-aligned file offset of the data
+    uint64_t pages_offset; // file offset of the page states, 0 if all data
+    uint64_t sums_offset;  // file offset of the page checksums, 0 if none
+} snapfile_region_t;
+
+int snapshot_save(const char *path, const mem_region_t *regions, size_t count,
+                  const char *proc_name, bool checksums);
+int snapshot_load(const char *path, bool verify, mem_region_t **regions,
+                  size_t *count, char *proc_name, size_t proc_name_len);
@@ -0,0 +1,1034 @@
+// src/utils/text.c
+#include "text.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Limits of a compiled regex
+#define RX_MAX_NFA 8192  // NFA states, after expanding counted repeats
+#define RX_MAX_DFA 4096  // DFA states, they are numbered in 16 bits
+#define RX_MAX_REPEAT 255 // largest bound of {m,n}
+
+// A set of byte values
+typedef struct {
+    uint64_t w[4];
+} byteset_t;
+
+static inline void set_add(byteset_t *s, unsigned b) {
+    s->w[b >> 6] |= 1ULL << (b & 63);
+}
+
+static inline bool set_has(const byteset_t *s, unsigned b) {
+    return s->w[b >> 6] >> (b & 63) & 1;
+}
+
+static void set_add_range(byteset_t *s, unsigned lo, unsigned hi) {
+    for (unsigned b = lo; b <= hi; b++) {
+        set_add(s, b);
+    }
+}
+
+static inline bool is_ascii_alpha(uint32_t c) {
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+}
+
+/**
+ * Decode one UTF-8 character.
+ *
+ * @param p Pointer to the text, advanced past the character.
+ * @param cp Pointer to store the code point.
+ * @return 0 on success, -1 on an invalid sequence.
+ */
+static int utf8_decode(const char **p, uint32_t *cp) {
+    const uint8_t *s = (const uint8_t *)*p;
+    size_t n;
+    if (s[0] < 0x80) {
+        n = 1;
+    } else if (s[0] >> 5 == 0x6) {
+        n = 2;
+    } else if (s[0] >> 4 == 0xE) {
+        n = 3;
+    } else if (s[0] >> 3 == 0x1E) {
+        n = 4;
+    } else {
+        return -1;
+    }
+    uint32_t c = n == 1 ? s[0] : s[0] & (0x7F >> n);
+    for (size_t i = 1; i < n; i++) {
+        if ((s[i] & 0xC0) != 0x80) {
+            return -1;
+        }
+        c = c << 6 | (s[i] & 0x3F);
+    }
+    *cp = c;
+    *p += n;
+    return 0;
+}
+
+/**
+ * Encode one code point as it sits in memory.
+ *
+ * @param cp The code point.
+ * @param enc The encoding.
+ * @param out Buffer of at least 4 bytes.
+ * @return The number of bytes written.
+ */
+static size_t text_encode(uint32_t cp, text_enc_t enc, uint8_t *out) {
+    if (enc == TEXT_UTF16LE) {
+        if (cp < 0x10000) {
+            out[0] = (uint8_t)cp;
+            out[1] = (uint8_t)(cp >> 8);
+            return 2;
+        }
+        uint32_t v = cp - 0x10000;
+        uint16_t hi = (uint16_t)(0xD800 | v >> 10);
+        uint16_t lo = (uint16_t)(0xDC00 | (v & 0x3FF));
+        out[0] = (uint8_t)hi;
+        out[1] = (uint8_t)(hi >> 8);
+        out[2] = (uint8_t)lo;
+        out[3] = (uint8_t)(lo >> 8);
+        return 4;
+    }
+    if (cp < 0x80) {
+        out[0] = (uint8_t)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (uint8_t)(0xC0 | cp >> 6);
+        out[1] = (uint8_t)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (uint8_t)(0xE0 | cp >> 12);
+        out[1] = (uint8_t)(0x80 | (cp >> 6 & 0x3F));
+        out[2] = (uint8_t)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (uint8_t)(0xF0 | cp >> 18);
+    out[1] = (uint8_t)(0x80 | (cp >> 12 & 0x3F));
+    out[2] = (uint8_t)(0x80 | (cp >> 6 & 0x3F));
+    out[3] = (uint8_t)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+/**
+ * Compile a literal string into a signature. With `icase`, ASCII letters
+ * match in either case (mask 0xDF), other characters as they are.
+ *
+ * @param text The string, in UTF-8.
+ * @param enc The encoding to look for.
+ * @param icase Ignore the case of ASCII letters.
+ * @param sig Pointer to store the signature (free it with sig_free()).
+ * @return 0 on success, -1 if the string is empty or not valid UTF-8.
+ */
+int text_literal(const char *text,   // [in]
+                 text_enc_t enc,     // [in]
+                 bool icase,         // [in]
+                 signature_t *sig    // [out]
+) {
+    size_t cap = strlen(text) * 2 + 4; // UTF-16 at most doubles it
+    uint8_t *bytes = malloc(cap);
+    uint8_t *mask = malloc(cap);
+    int rc = bytes && mask ? 0 : -1;
+    size_t len = 0;
+    while (rc == 0 && *text) {
+        uint32_t cp;
+        if (utf8_decode(&text, &cp) != 0) {
+            fprintf(stderr, "ERR: The text is not valid UTF-8\n");
+            rc = -1;
+            break;
+        }
+        size_t n = text_encode(cp, enc, bytes + len);
+        memset(mask + len, 0xFF, n);
+        if (icase && is_ascii_alpha(cp)) {
+            mask[len] = 0xDF; // the low byte in UTF-16LE
+            bytes[len] &= 0xDF;
+        }
+        len += n;
+    }
+    if (rc == 0 && len == 0) {
+        fprintf(stderr, "ERR: The text is empty\n");
+        rc = -1;
+    }
+    if (rc == 0) {
+        rc = sig_from_masked(bytes, mask, len, sig);
+    }
+    free(bytes);
+    free(mask);
+    return rc;
+}
+
+/**
+ * NOTE:
+ * A regex is parsed into a tree, the tree compiled into an NFA (Thompson's
+ * construction, counted repeats expanded) and the NFA into a DFA (subset
+ * construction over classes of bytes that no transition tells apart).
+ * Characters are expanded into bytes of the encoding on the way: a literal
+ * into its encoded bytes, a class or '.' into one unit of the encoding (a
+ * byte of UTF-8, or two bytes of UTF-16LE where classes cover U+0000 to
+ * U+00FF). '.' and negated classes never match a NUL unit, so matches stay
+ * inside one C string.
+ *
+ * The scanner only needs to know whether a match starts at a position, so
+ * the DFA stops at the first accepting state: its transitions are dropped,
+ * which also keeps the DFA small.
+ */
+
+typedef enum {
+    RX_SET,    // one byte of `set`
+    RX_EMPTY,  // nothing
+    RX_CAT,    // a then b
+    RX_ALT,    // a or b
+    RX_REPEAT, // a, min to max times (max -1: unbounded)
+} rx_kind_t;
+
+typedef struct {
+    rx_kind_t kind;
+    byteset_t set;
+    int a, b;
+    int min, max;
+} rx_node_t;
+
+typedef struct {
+    const char *p; // parse position
+    text_enc_t enc;
+    bool icase;
+    rx_node_t *nodes;
+    size_t n, cap;
+    const char *err; // first error, NULL if none
+} rx_parser_t;
+
+typedef enum {
+    NFA_SET,   // on a byte of `set` to out
+    NFA_EPS,   // to out and out1 (if not -1) without a byte
+    NFA_MATCH, // accept
+} nfa_kind_t;
+
+typedef struct {
+    nfa_kind_t kind;
+    byteset_t set;
+    int out, out1;
+} nfa_state_t;
+
+typedef struct {
+    nfa_state_t *states;
+    size_t n, cap;
+    bool full;
+} nfa_t;
+
+// An NFA fragment, whose end is an NFA_EPS state with a dangling out
+typedef struct {
+    int start, end;
+} frag_t;
+
+static int rx_node(rx_parser_t *ps, rx_node_t node) {
+    if (ps->n == ps->cap) {
+        size_t cap = ps->cap ? ps->cap * 2 : 64;
+        rx_node_t *nodes = realloc(ps->nodes, cap * sizeof(*nodes));
+        if (!nodes) {
+            ps->err = "out of memory";
+            return -1;
+        }
+        ps->nodes = nodes;
+        ps->cap = cap;
+    }
+    ps->nodes[ps->n] = node;
+    return (int)ps->n++;
+}
+
+static int rx_set(rx_parser_t *ps, const byteset_t *set) {
+    return rx_node(ps, (rx_node_t){.kind = RX_SET, .set = *set});
+}
+
+static int rx_cat(rx_parser_t *ps, int a, int b) {
+    if (a < 0 || b < 0) {
+        return -1;
+    }
+    return rx_node(ps, (rx_node_t){.kind = RX_CAT, .a = a, .b = b});
+}
+
+static int rx_alt(rx_parser_t *ps, int a, int b) {
+    if (a < 0 || b < 0) {
+        return -1;
+    }
+    return rx_node(ps, (rx_node_t){.kind = RX_ALT, .a = a, .b = b});
+}
+
+/**
+ * Tree of one literal character: its encoded bytes, or both cases of an
+ * ASCII letter if the case is ignored.
+ */
+static int rx_char(rx_parser_t *ps, uint32_t cp) {
+    uint8_t buf[4];
+    size_t n = text_encode(cp, ps->enc, buf);
+    int node = -1;
+    for (size_t i = 0; i < n; i++) {
+        byteset_t set = {0};
+        set_add(&set, buf[i]);
+        if (i == 0 && ps->icase && is_ascii_alpha(cp)) {
+            set_add(&set, buf[0] ^ 0x20);
+        }
+        int byte = rx_set(ps, &set);
+        node = node < 0 ? byte : rx_cat(ps, node, byte);
+    }
+    return node;
+}
+
+/**
+ * Tree of one unit of the encoding out of a class of values (0 to 255).
+ */
+static int rx_class(rx_parser_t *ps, byteset_t set, bool negated) {
+    if (ps->icase) {
+        for (unsigned c = 'A'; c <= 'Z'; c++) {
+            if (set_has(&set, c) || set_has(&set, c | 0x20)) {
+                set_add(&set, c);
+                set_add(&set, c | 0x20);
+            }
+        }
+    }
+    if (negated) {
+        for (size_t i = 0; i < 4; i++) {
+            set.w[i] = ~set.w[i];
+        }
+    }
+    set.w[0] &= ~1ULL; // never NUL
+    int lo = rx_set(ps, &set);
+    if (ps->enc == TEXT_UTF8) {
+        return lo;
+    }
+
+    // UTF-16LE: the value is the low byte under a zero high byte, and a
+    // negated class takes every unit above U+00FF too
+    byteset_t zero = {0};
+    set_add(&zero, 0);
+    int node = rx_cat(ps, lo, rx_set(ps, &zero));
+    if (negated) {
+        byteset_t all = {{~0ULL, ~0ULL, ~0ULL, ~0ULL}};
+        byteset_t nonzero = all;
+        nonzero.w[0] &= ~1ULL;
+        node = rx_alt(ps, node,
+                      rx_cat(ps, rx_set(ps, &all), rx_set(ps, &nonzero)));
+    }
+    return node;
+}
+
+/**
+ * Add the class of an escape like \d to a set.
+ *
+ * @return true if `c` names a class (upper case: its complement).
+ */
+static bool escape_class(char c, byteset_t *set) {
+    byteset_t s = {0};
+    switch (c | 0x20) {
+    case 'd':
+        set_add_range(&s, '0', '9');
+        break;
+    case 'w':
+        set_add_range(&s, '0', '9');
+        set_add_range(&s, 'A', 'Z');
+        set_add_range(&s, 'a', 'z');
+        set_add(&s, '_');
+        break;
+    case 's':
+        set_add_range(&s, '\t', '\r');
+        set_add(&s, ' ');
+        break;
+    default:
+        return false;
+    }
+    bool negated = c >= 'A' && c <= 'Z';
+    for (size_t i = 0; i < 4; i++) {
+        set->w[i] |= negated ? ~s.w[i] : s.w[i];
+    }
+    return true;
+}
+
+static int hex_digit(char c) {
+    return c >= '0' && c <= '9'   ? c - '0'
+           : c >= 'a' && c <= 'f' ? c - 'a' + 10
+           : c >= 'A' && c <= 'F' ? c - 'A' + 10
+                                  : -1;
+}
+
+/**
+ * Parse the value of an escape that isn't a class, after the backslash.
+ *
+ * @return The value, or -1 (with ps->err set) if it is invalid.
+ */
+static long escape_value(rx_parser_t *ps) {
+    char c = *ps->p++;
+    switch (c) {
+    case 'n':
+        return '\n';
+    case 't':
+        return '\t';
+    case 'r':
+        return '\r';
+    case '0':
+        return 0;
+    case 'x': {
+        int hi = hex_digit(ps->p[0]);
+        int lo = hi < 0 ? -1 : hex_digit(ps->p[1]);
+        if (lo < 0) {
+            ps->err = "\\x needs two hex digits";
+            return -1;
+        }
+        ps->p += 2;
+        return hi << 4 | lo;
+    }
+    case '\0':
+        ps->p--;
+        ps->err = "trailing backslash";
+        return -1;
+    default:
+        return (unsigned char)c;
+    }
+}
+
+/**
+ * Parse one member of a class, a character or a \x escape.
+ *
+ * @return Its value (0 to 255), or -1 with ps->err set.
+ */
+static long class_value(rx_parser_t *ps) {
+    if (*ps->p == '\\') {
+        ps->p++;
+        return escape_value(ps);
+    }
+    uint32_t cp;
+    if (utf8_decode(&ps->p, &cp) != 0) {
+        ps->err = "invalid UTF-8";
+        return -1;
+    }
+    if (cp > (ps->enc == TEXT_UTF8 ? 0x7Fu : 0xFFu)) {
+        ps->err = ps->enc == TEXT_UTF8
+                      ? "classes only hold ASCII in UTF-8, use (a|b)"
+                      : "classes only hold U+0000 to U+00FF in UTF-16";
+        return -1;
+    }
+    return cp;
+}
+
+// Parse a class after its '['
+static int parse_class(rx_parser_t *ps) {
+    byteset_t set = {0};
+    bool negated = *ps->p == '^';
+    ps->p += negated;
+    bool first = true;
+    while (*ps->p != ']' || first) {
+        first = false;
+        if (*ps->p == '\0') {
+            ps->err = "missing ]";
+            return -1;
+        }
+        if (ps->p[0] == '\\' && escape_class(ps->p[1], &set)) {
+            ps->p += 2;
+            continue;
+        }
+        long lo = class_value(ps);
+        long hi = lo;
+        if (lo >= 0 && ps->p[0] == '-' && ps->p[1] != ']' && ps->p[1]) {
+            ps->p++;
+            hi = class_value(ps);
+        }
+        if (lo < 0 || hi < 0) {
+            return -1;
+        }
+        if (hi < lo) {
+            ps->err = "reversed range in class";
+            return -1;
+        }
+        set_add_range(&set, (unsigned)lo, (unsigned)hi);
+    }
+    ps->p++;
+    return rx_class(ps, set, negated);
+}
+
+static int parse_alt(rx_parser_t *ps);
+
+static int parse_atom(rx_parser_t *ps) {
+    char c = *ps->p;
+    switch (c) {
+    case '(': {
+        ps->p++;
+        if (ps->p[0] == '?' && ps->p[1] == ':') {
+            ps->p += 2;
+        }
+        int node = parse_alt(ps);
+        if (node >= 0 && *ps->p != ')') {
+            ps->err = "missing )";
+            return -1;
+        }
+        ps->p++;
+        return node;
+    }
+    case '[':
+        ps->p++;
+        return parse_class(ps);
+    case '.': {
+        ps->p++;
+        byteset_t none = {0};
+        return rx_class(ps, none, true);
+    }
+    case '\\': {
+        byteset_t set = {0};
+        if (escape_class(ps->p[1], &set)) {
+            ps->p += 2;
+            return rx_class(ps, set, false);
+        }
+        ps->p++;
+        long v = escape_value(ps);
+        if (v < 0) {
+            return -1;
+        }
+        if (ps->enc == TEXT_UTF8 && v >= 0x80) {
+            byteset_t raw = {0}; // a raw byte, not U+0080 to U+00FF
+            set_add(&raw, (unsigned)v);
+            return rx_set(ps, &raw);
+        }
+        return rx_char(ps, (uint32_t)v);
+    }
+    case '*':
+    case '+':
+    case '?':
+    case '{':
+        ps->err = "nothing to repeat";
+        return -1;
+    case '^':
+    case '$':
+        ps->err = "anchors are not supported";
+        return -1;
+    default: {
+        uint32_t cp;
+        if (utf8_decode(&ps->p, &cp) != 0) {
+            ps->err = "invalid UTF-8";
+            return -1;
+        }
+        return rx_char(ps, cp);
+    }
+    }
+}
+
+// Parse a {m}, {m,} or {m,n} bound after its '{'
+static bool parse_bound(rx_parser_t *ps, int *min, int *max) {
+    char *end;
+    long lo = strtol(ps->p, &end, 10);
+    long hi = lo;
+    if (end == ps->p) {
+        ps->err = "invalid {m,n}";
+        return false;
+    }
+    ps->p = end;
+    if (*ps->p == ',') {
+        ps->p++;
+        hi = -1;
+        if (*ps->p != '}') {
+            hi = strtol(ps->p, &end, 10);
+            if (end == ps->p) {
+                ps->err = "invalid {m,n}";
+                return false;
+            }
+            ps->p = end;
+        }
+    }
+    if (*ps->p != '}' || lo < 0 || lo > RX_MAX_REPEAT || hi > RX_MAX_REPEAT ||
+        (hi >= 0 && hi < lo)) {
+        ps->err = "invalid {m,n} (bounds go up to 255)";
+        return false;
+    }
+    ps->p++;
+    *min = (int)lo;
+    *max = (int)hi;
+    return true;
+}
+
+static int parse_repeat(rx_parser_t *ps) {
+    int node = parse_atom(ps);
+    while (node >= 0) {
+        int min, max;
+        switch (*ps->p) {
+        case '*':
+            min = 0, max = -1;
+            break;
+        case '+':
+            min = 1, max = -1;
+            break;
+        case '?':
+            min = 0, max = 1;
+            break;
+        case '{':
+            ps->p++;
+            if (!parse_bound(ps, &min, &max)) {
+                return -1;
+            }
+            ps->p--;
+            break;
+        default:
+            return node;
+        }
+        ps->p++;
+        node = rx_node(ps, (rx_node_t){
+                               .kind = RX_REPEAT, .a = node, .min = min,
+                               .max = max});
+    }
+    return node;
+}
+
+static int parse_cat(rx_parser_t *ps) {
+    int node = -1;
+    while (*ps->p && *ps->p != '|' && *ps->p != ')') {
+        int atom = parse_repeat(ps);
+        if (atom < 0) {
+            return -1;
+        }
+        node = node < 0 ? atom : rx_cat(ps, node, atom);
+    }
+    return node >= 0 ? node : rx_node(ps, (rx_node_t){.kind = RX_EMPTY});
+}
+
+static int parse_alt(rx_parser_t *ps) {
+    int node = parse_cat(ps);
+    while (node >= 0 && *ps->p == '|') {
+        ps->p++;
+        node = rx_alt(ps, node, parse_cat(ps));
+    }
+    return node;
+}
+
+static int nfa_state(nfa_t *nfa, nfa_kind_t kind) {
+    if (nfa->n == RX_MAX_NFA) {
+        nfa->full = true;
+        return -1;
+    }
+    if (nfa->n == nfa->cap) {
+        size_t cap = nfa->cap ? nfa->cap * 2 : 256;
+        nfa_state_t *states = realloc(nfa->states, cap * sizeof(*states));
+        if (!states) {
+            nfa->full = true;
+            return -1;
+        }
+        nfa->states = states;
+        nfa->cap = cap;
+    }
+    nfa->states[nfa->n] = (nfa_state_t){.kind = kind, .out = -1, .out1 = -1};
+    return (int)nfa->n++;
+}
+
+/**
+ * Compile a tree into an NFA fragment.
+ *
+ * @return false if the NFA got too large.
+ */
+static bool nfa_compile(nfa_t *nfa, const rx_node_t *nodes, int node,
+                        frag_t *f) {
+    const rx_node_t *x = &nodes[node];
+    frag_t a, b;
+    switch (x->kind) {
+    case RX_SET:
+        f->start = nfa_state(nfa, NFA_SET);
+        f->end = nfa_state(nfa, NFA_EPS);
+        if (f->end < 0) {
+            return false;
+        }
+        nfa->states[f->start].set = x->set;
+        nfa->states[f->start].out = f->end;
+        return true;
+    case RX_EMPTY:
+        f->start = f->end = nfa_state(nfa, NFA_EPS);
+        return f->end >= 0;
+    case RX_CAT:
+        if (!nfa_compile(nfa, nodes, x->a, &a) ||
+            !nfa_compile(nfa, nodes, x->b, &b)) {
+            return false;
+        }
+        nfa->states[a.end].out = b.start;
+        *f = (frag_t){a.start, b.end};
+        return true;
+    case RX_ALT:
+        if (!nfa_compile(nfa, nodes, x->a, &a) ||
+            !nfa_compile(nfa, nodes, x->b, &b)) {
+            return false;
+        }
+        f->start = nfa_state(nfa, NFA_EPS);
+        f->end = nfa_state(nfa, NFA_EPS);
+        if (f->end < 0) {
+            return false;
+        }
+        nfa->states[f->start].out = a.start;
+        nfa->states[f->start].out1 = b.start;
+        nfa->states[a.end].out = f->end;
+        nfa->states[b.end].out = f->end;
+        return true;
+    case RX_REPEAT:
+        break;
+    }
+
+    // min copies in a row, then (max - min) optional ones or a loop
+    f->start = nfa_state(nfa, NFA_EPS);
+    f->end = nfa_state(nfa, NFA_EPS);
+    if (f->end < 0) {
+        return false;
+    }
+    int tail = f->start;
+    int copies = x->max < 0 ? x->min + 1 : x->max;
+    for (int i = 0; i < copies; i++) {
+        if (!nfa_compile(nfa, nodes, x->a, &a)) {
+            return false;
+        }
+        int entry = a.start;
+        if (i >= x->min) {
+            entry = nfa_state(nfa, NFA_EPS);
+            if (entry < 0) {
+                return false;
+            }
+            nfa->states[entry].out = a.start;
+            nfa->states[entry].out1 = f->end;
+        }
+        nfa->states[tail].out = entry;
+        tail = a.end;
+        if (x->max < 0 && i == copies - 1) {
+            tail = entry; // loop back to the optional copy
+            nfa->states[a.end].out = entry;
+        }
+    }
+    if (x->max >= 0 || copies == 0) {
+        nfa->states[tail].out = f->end;
+    }
+    return true;
+}
+
+/**
+ * Add the epsilon closure of an NFA state to a set of states.
+ */
+static void nfa_closure(const nfa_t *nfa, int state, uint64_t *set,
+                        int *stack) {
+    size_t top = 0;
+    stack[top++] = state;
+    while (top > 0) {
+        int s = stack[--top];
+        if (s < 0 || set[s >> 6] >> (s & 63) & 1) {
+            continue;
+        }
+        set[s >> 6] |= 1ULL << (s & 63);
+        if (nfa->states[s].kind == NFA_EPS) {
+            stack[top++] = nfa->states[s].out;
+            stack[top++] = nfa->states[s].out1;
+        }
+    }
+}
+
+// Open-addressed table of the DFA states by their NFA state set
+typedef struct {
+    uint64_t *sets; // the NFA state set of every DFA state, `words` each
+    size_t words;
+    int *slots; // DFA state + 1, 0 if free
+    size_t nslots;
+} dfa_index_t;
+
+static size_t set_hash(const uint64_t *set, size_t words) {
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < words; i++) {
+        h = (h ^ set[i]) * 1099511628211ULL;
+    }
+    return (size_t)(h ^ h >> 29);
+}
+
+/**
+ * Find the DFA state of an NFA state set, adding it if it is new.
+ *
+ * @return The DFA state, or -1 if there are too many.
+ */
+static int dfa_intern(dfa_index_t *ix, size_t *nstates, const uint64_t *set) {
+    size_t i = set_hash(set, ix->words) & (ix->nslots - 1);
+    for (; ix->slots[i]; i = (i + 1) & (ix->nslots - 1)) {
+        int s = ix->slots[i] - 1;
+        if (memcmp(ix->sets + (size_t)s * ix->words, set,
+                   ix->words * sizeof(*set)) == 0) {
+            return s;
+        }
+    }
+    if (*nstates == RX_MAX_DFA) {
+        return -1;
+    }
+    int s = (int)(*nstates)++;
+    memcpy(ix->sets + (size_t)s * ix->words, set, ix->words * sizeof(*set));
+    ix->slots[i] = s + 1;
+    return s;
+}
+
+/**
+ * Build the DFA of an NFA by subset construction.
+ *
+ * @return 0 on success, -1 (with *err set) on failure.
+ */
+static int dfa_build(const nfa_t *nfa, int start, text_regex_t *re,
+                     const char **err) {
+    // Bytes in the same class take the same transitions everywhere: every
+    // set splits the classes it cuts through
+    int cls[256] = {0}, split[512], renum[512];
+    unsigned rep[256];
+    size_t nclasses = 1;
+    for (size_t s = 0; s < nfa->n; s++) {
+        if (nfa->states[s].kind != NFA_SET) {
+            continue;
+        }
+        memset(split, -1, sizeof(split));
+        for (unsigned b = 0; b < 256; b++) {
+            if (set_has(&nfa->states[s].set, b)) {
+                if (split[cls[b]] < 0) {
+                    split[cls[b]] = (int)nclasses++;
+                }
+                cls[b] = split[cls[b]];
+            }
+        }
+        // Number them from 0 again, some classes lost all their bytes
+        memset(renum, -1, sizeof(renum));
+        nclasses = 0;
+        for (unsigned b = 0; b < 256; b++) {
+            if (renum[cls[b]] < 0) {
+                renum[cls[b]] = (int)nclasses++;
+            }
+            cls[b] = renum[cls[b]];
+        }
+    }
+    for (unsigned b = 256; b-- > 0;) {
+        rep[cls[b]] = b;
+    }
+
+    size_t words = (nfa->n + 63) / 64;
+    dfa_index_t ix = {.words = words, .nslots = RX_MAX_DFA * 2};
+    ix.sets = calloc((size_t)RX_MAX_DFA * words, sizeof(uint64_t));
+    ix.slots = calloc(ix.nslots, sizeof(int));
+    uint64_t *set = calloc(words, sizeof(uint64_t));
+    int *stack = malloc(nfa->n * 2 * sizeof(int) + sizeof(int));
+    re->next = calloc((size_t)RX_MAX_DFA * 256, sizeof(uint16_t));
+    re->accept = calloc(RX_MAX_DFA, sizeof(bool));
+    int rc = 0;
+    if (!ix.sets || !ix.slots || !set || !stack || !re->next || !re->accept) {
+        *err = "out of memory";
+        rc = -1;
+        goto out;
+    }
+
+    size_t nstates = 0;
+    dfa_intern(&ix, &nstates, set); // 0: dead
+    nfa_closure(nfa, start, set, stack);
+    dfa_intern(&ix, &nstates, set); // 1: start
+    for (size_t d = 1; d < nstates && rc == 0; d++) {
+        const uint64_t *from = ix.sets + d * words;
+        for (size_t s = 0; s < nfa->n; s++) {
+            if (from[s >> 6] >> (s & 63) & 1 &&
+                nfa->states[s].kind == NFA_MATCH) {
+                re->accept[d] = true;
+            }
+        }
+        if (re->accept[d]) {
+            continue; // matched, see the NOTE above
+        }
+        for (size_t c = 0; c < nclasses; c++) {
+            memset(set, 0, words * sizeof(*set));
+            for (size_t s = 0; s < nfa->n; s++) {
+                if (from[s >> 6] >> (s & 63) & 1 &&
+                    nfa->states[s].kind == NFA_SET &&
+                    set_has(&nfa->states[s].set, rep[c])) {
+                    nfa_closure(nfa, nfa->states[s].out, set, stack);
+                }
+            }
+            int to = dfa_intern(&ix, &nstates, set);
+            if (to < 0) {
+                *err = "regex too complex";
+                rc = -1;
+                break;
+            }
+            for (unsigned b = 0; b < 256; b++) {
+                if (cls[b] == (int)c) {
+                    re->next[d * 256 + b] = (uint16_t)to;
+                }
+            }
+        }
+    }
+    re->nstates = nstates;
+    uint16_t *next = realloc(re->next, nstates * 256 * sizeof(*next));
+    re->next = next ? next : re->next;
+
+out:
+    free(ix.sets);
+    free(ix.slots);
+    free(set);
+    free(stack);
+    return rc;
+}
+
+/**
+ * The smallest masked byte (see pair_kernel_t) that every byte of a set
+ * passes: the bits all of them share are fixed, the others are free.
+ */
+static void enclose(const byteset_t *set, uint8_t *byte, uint8_t *mask) {
+    unsigned all = 0xFF, any = 0;
+    for (unsigned b = 0; b < 256; b++) {
+        if (set_has(set, b)) {
+            all &= b;
+            any |= b;
+        }
+    }
+    *mask = (uint8_t)~(all ^ any);
+    *byte = (uint8_t)(all & *mask);
+}
+
+/**
+ * Find the shortest match and the prefilter of a DFA.
+ *
+ * @return 0 on success, -1 (with *err set) if the regex matches the empty
+ *         string or nothing at all.
+ */
+static int dfa_analyze(text_regex_t *re, const char **err) {
+    if (re->accept[1]) {
+        *err = "regex matches the empty text";
+        return -1;
+    }
+
+    // Breadth-first from the start for the shortest match
+    uint16_t *queue = malloc(re->nstates * sizeof(*queue));
+    size_t *depth = calloc(re->nstates, sizeof(*depth));
+    if (!queue || !depth) {
+        free(queue);
+        free(depth);
+        *err = "out of memory";
+        return -1;
+    }
+    size_t head = 0, tail = 0;
+    queue[tail++] = 1;
+    depth[1] = 1;
+    re->min_len = 0;
+    while (head < tail && re->min_len == 0) {
+        uint16_t s = queue[head++];
+        for (unsigned b = 0; b < 256; b++) {
+            uint16_t t = re->next[s * 256 + b];
+            if (t != 0 && depth[t] == 0) {
+                depth[t] = depth[s] + 1;
+                queue[tail++] = t;
+                if (re->accept[t]) {
+                    re->min_len = depth[s];
+                }
+            }
+        }
+    }
+    free(queue);
+    free(depth);
+    if (re->min_len == 0) {
+        *err = "regex can't match anything";
+        return -1;
+    }
+
+    // The bytes that can come first and second in a match
+    byteset_t first = {0}, second = {0};
+    for (unsigned b = 0; b < 256; b++) {
+        uint16_t s = re->next[256 + b];
+        if (s == 0) {
+            continue;
+        }
+        set_add(&first, b);
+        for (unsigned c = 0; c < 256; c++) {
+            if (re->accept[s] || re->next[s * 256 + c] != 0) {
+                set_add(&second, c);
+            }
+        }
+    }
+    enclose(&first, &re->first[0], &re->first_mask[0]);
+    enclose(&second, &re->first[1], &re->first_mask[1]);
+    if (re->min_len < 2) {
+        re->first[1] = re->first_mask[1] = 0;
+    }
+    return 0;
+}
+
+/**
+ * Compile a regex for text search. Syntax: literal characters, '.', classes
+ * like [a-z_] and [^0-9] with \d \w \s (and \D \W \S) in or outside of them,
+ * \xHH \n \t \r \0 and escaped metacharacters, groups (...), alternation |
+ * and the repeats * + ? {m} {m,} {m,n}.
+ *
+ * @param pattern The regex, in UTF-8.
+ * @param enc The encoding of the text to look for.
+ * @param icase Ignore the case of ASCII letters.
+ * @param re Pointer to store the regex (free it with text_regex_free()).
+ * @return 0 on success, -1 (with a message) on failure.
+ */
+int text_regex_compile(const char *pattern, // [in]
+                       text_enc_t enc,      // [in]
+                       bool icase,          // [in]
+                       text_regex_t *re     // [out]
+) {
+    memset(re, 0, sizeof(*re));
+    rx_parser_t ps = {.p = pattern, .enc = enc, .icase = icase};
+    int root = parse_alt(&ps);
+    if (root >= 0 && *ps.p == ')') {
+        ps.err = "unmatched )";
+    }
+
+    nfa_t nfa = {0};
+    frag_t f = {0};
+    int match = -1;
+    if (!ps.err && root >= 0) {
+        if (!nfa_compile(&nfa, ps.nodes, root, &f) ||
+            (match = nfa_state(&nfa, NFA_MATCH)) < 0) {
+            ps.err = "regex too large";
+        } else {
+            nfa.states[f.end].out = match;
+        }
+    }
+    const char *err = ps.err;
+    if (!err && dfa_build(&nfa, f.start, re, &err) == 0) {
+        dfa_analyze(re, &err);
+    }
+    free(ps.nodes);
+    free(nfa.states);
+
+    if (err && ps.err && *ps.p) {
+        fprintf(stderr, "ERR: Invalid regex at \"%s\": %s\n", ps.p, err);
+    } else if (err) {
+        fprintf(stderr, "ERR: Invalid regex: %s\n", err);
+    }
+    if (err) {
+        text_regex_free(re);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Free the memory of a regex.
+ */
+void text_regex_free(text_regex_t *re) {
+    free(re->next);
+    free(re->accept);
+    re->next = NULL;
+    re->accept = NULL;
+    re->nstates = 0;
+}
+
+/**
+ * Check whether a match of a regex starts at a position.
+ *
+ * @param re The regex.
+ * @param data The data at the position.
+ * @param avail Number of bytes readable at data.
+ * @return The length of the shortest match there, 0 if there is none.
+ */
+size_t text_regex_match(const text_regex_t *re, const uint8_t *data,
+                        size_t avail) {
+    if (avail > TEXT_MAX_MATCH) {
+        avail = TEXT_MAX_MATCH;
+    }
+    size_t s = 1;
+    for (size_t i = 0; i < avail; i++) {
+        s = re->next[s * 256 + data[i]];
+        if (s == 0) {
+            return 0;
+        }
+        if (re->accept[s]) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,42 @@
+// src/utils/text.h
+#pragma once
+#include "sig.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Text search: strings as they sit in memory, encoded as UTF-8 or UTF-16LE
+ * (the wchar_t of Windows programs, Java and JavaScript strings). A literal
+ * compiles into a signature, with ASCII letters masked to either case when
+ * the case is ignored, so it runs through the signature scanner as is.
+ *
+ * A regex compiles into a DFA over bytes: the scanner finds the possible
+ * first two bytes of a match with the vector pair kernel and runs the DFA
+ * from there, one table lookup per byte, until it accepts or dies.
+ */
+typedef enum {
+    TEXT_UTF8,
+    TEXT_UTF16LE,
+} text_enc_t;
+
+// Longest match a regex can have in bytes, longer ones aren't found
+#define TEXT_MAX_MATCH 4096
+
+typedef struct {
+    uint16_t *next; // next[state * 256 + byte], state 0 is dead, 1 the start
+    bool *accept;   // accept[state]
+    size_t nstates;
+    size_t min_len; // shortest match in bytes (at least 1)
+    // Prefilter: the first two bytes b of a match pass (b & mask) == byte
+    uint8_t first[2];
+    uint8_t first_mask[2];
+} text_regex_t;
+
+int text_literal(const char *text, text_enc_t enc, bool icase,
+                 signature_t *sig);
+int text_regex_compile(const char *pattern, text_enc_t enc, bool icase,
+                       text_regex_t *re);
+void text_regex_free(text_regex_t *re);
+size_t text_regex_match(const text_regex_t *re, const uint8_t *data,
+                        size_t avail);
@@ -0,0 +1,292 @@
+// src/utils/threadpool.c
+#include "threadpool.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// The task range currently owned by one worker
+typedef struct {
+    pthread_mutex_t lock;
+    size_t lo; // next task to run (inclusive)
+    size_t hi; // end of the range (exclusive)
+} pool_range_t;
+
+typedef struct {
+    pthread_t thread;
+    size_t id;
+    pool_range_t range;
+} pool_worker_t;
+
+typedef struct {
+    pool_worker_t *workers;
+    size_t nworkers;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work_cv; // signaled when a new job is posted
+    pthread_cond_t done_cv; // signaled when the last worker goes idle
+    pthread_mutex_t run_lock; // serializes pool_run() callers
+    bool stop;
+    size_t job_seq; // bumped for every posted job
+    size_t active;  // workers still working on the current job
+    pool_task_fn fn;
+    void *ctx;
+} pool_t;
+
+static pool_t *g_pool = NULL;
+
+/**
+ * Take the next task from the worker's own range.
+ *
+ * @return true if a task was taken into `task`.
+ */
+static bool take_own(pool_worker_t *w, size_t *task) {
+    bool ok = false;
+    pthread_mutex_lock(&w->range.lock);
+    if (w->range.lo < w->range.hi) {
+        *task = w->range.lo++;
+        ok = true;
+    }
+    pthread_mutex_unlock(&w->range.lock);
+    return ok;
+}
+
+/**
+ * Steal the upper half of some other worker's remaining range.
+ *
+ * @return true if anything was stolen into the worker's own range.
+ */
+static bool steal(pool_t *pool, pool_worker_t *w) {
+    for (size_t k = 1; k < pool->nworkers; k++) {
+        pool_worker_t *victim = &pool->workers[(w->id + k) % pool->nworkers];
+        size_t lo = 0, hi = 0;
+
+        pthread_mutex_lock(&victim->range.lock);
+        size_t left = victim->range.hi - victim->range.lo;
+        if (left > 0) {
+            size_t mid = victim->range.lo + left / 2;
+            lo = mid;
+            hi = victim->range.hi;
+            victim->range.hi = mid;
+        }
+        pthread_mutex_unlock(&victim->range.lock);
+
+        if (hi > lo) {
+            pthread_mutex_lock(&w->range.lock);
+            w->range.lo = lo;
+            w->range.hi = hi;
+            pthread_mutex_unlock(&w->range.lock);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Main loop of a worker thread: wait for a job, drain the own range, steal
+ * from the others until nothing is left, report idle, repeat.
+ */
+static void *worker_fn(void *arg) {
+    pool_worker_t *w = arg;
+    pool_t *pool = g_pool;
+    size_t seen = 0;
+
+    while (true) {
+        pthread_mutex_lock(&pool->lock);
+        while (!pool->stop && pool->job_seq == seen) {
+            pthread_cond_wait(&pool->work_cv, &pool->lock);
+        }
+        if (pool->stop) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        seen = pool->job_seq;
+        pool_task_fn fn = pool->fn;
+        void *ctx = pool->ctx;
+        pthread_mutex_unlock(&pool->lock);
+
+        size_t task;
+        while (take_own(w, &task) || (steal(pool, w) && take_own(w, &task))) {
+            fn(ctx, task, w->id);
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->active == 0) {
+            pthread_cond_signal(&pool->done_cv);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return NULL;
+}
+
+/**
+ * Start the shared pool with the given number of worker threads.
+ * Does nothing if the pool is already running.
+ *
+ * @param nthreads Number of workers, 0 for one per online CPU.
+ * @return 0 on success, or an error code on failure.
+ */
+int pool_start(size_t nthreads) {
+    if (g_pool) {
+        return 0;
+    }
+    if (nthreads == 0) {
+        long procs = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = procs > 0 ? (size_t)procs : 1;
+    }
+
+    pool_t *pool = calloc(1, sizeof(*pool));
+    if (!pool) {
+        return ENOMEM;
+    }
+    pool->workers = calloc(nthreads, sizeof(*pool->workers));
+    if (!pool->workers) {
+        free(pool);
+        return ENOMEM;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_mutex_init(&pool->run_lock, NULL);
+    pthread_cond_init(&pool->work_cv, NULL);
+    pthread_cond_init(&pool->done_cv, NULL);
+    g_pool = pool;
+
+    for (size_t i = 0; i < nthreads; i++) {
+        pool_worker_t *w = &pool->workers[i];
+        w->id = i;
+        pthread_mutex_init(&w->range.lock, NULL);
+        if (pthread_create(&w->thread, NULL, worker_fn, w) != 0) {
+            pthread_mutex_destroy(&w->range.lock);
+            break;
+        }
+        pool->nworkers++;
+    }
+
+    if (pool->nworkers == 0) {
+        pool_stop();
+        return EAGAIN;
+    }
+    return 0;
+}
+
+/**
+ * Stop the shared pool and join its workers.
+ */
+void pool_stop(void) {
+    pool_t *pool = g_pool;
+    if (!pool) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->work_cv);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (size_t i = 0; i < pool->nworkers; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
+        pthread_mutex_destroy(&pool->workers[i].range.lock);
+    }
+    g_pool = NULL;
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_mutex_destroy(&pool->run_lock);
+    pthread_cond_destroy(&pool->work_cv);
+    pthread_cond_destroy(&pool->done_cv);
+    free(pool->workers);
+    free(pool);
+}
+
+/**
+ * Number of distinct worker ids pool_run() may pass to a task function.
+ * Use it to size per-worker buffers.
+ *
+ * @return The number of workers, or 1 if the pool isn't running.
+ */
+size_t pool_workers(void) { return g_pool ? g_pool->nworkers : 1; }
+
+/**
+ * Run tasks 0..ntasks-1 on the shared pool and wait for all of them.
+ * The tasks are handed out to the workers in contiguous blocks, so
+ * neighboring tasks tend to run on the same core.
+ *
+ * @param ntasks Number of tasks.
+ * @param fn Task function, called as fn(ctx, task, worker).
+ * @param ctx Context pointer passed to every call.
+ * @return 0 on success.
+ */
+int pool_run(size_t ntasks, pool_task_fn fn, void *ctx) {
+    pool_t *pool = g_pool;
+    if (ntasks == 0) {
+        return 0;
+    }
+    if (!pool) {
+        for (size_t t = 0; t < ntasks; t++) {
+            fn(ctx, t, 0);
+        }
+        return 0;
+    }
+
+    pthread_mutex_lock(&pool->run_lock);
+    for (size_t i = 0; i < pool->nworkers; i++) {
+        pool_range_t *r = &pool->workers[i].range;
+        pthread_mutex_lock(&r->lock);
+        r->lo = i * ntasks / pool->nworkers;
+        r->hi = (i + 1) * ntasks / pool->nworkers;
+        pthread_mutex_unlock(&r->lock);
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->fn = fn;
+    pool->ctx = ctx;
+    pool->active = pool->nworkers;
+    pool->job_seq++;
+    pthread_cond_broadcast(&pool->work_cv);
+    while (pool->active > 0) {
+        pthread_cond_wait(&pool->done_cv, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    pthread_mutex_unlock(&pool->run_lock);
+    return 0;
+}
+
+/**
+ * Cut a list of items of the given byte lengths into slices of at most
+ * `slice_len` bytes, so that work can be balanced by bytes rather than by
+ * item count. Empty items produce no slice.
+ *
+ * @param lens Length of every item.
+ * @param n Number of items.
+ * @param slice_len Maximum slice length (should be a multiple of the
+ *                  element size the caller works with).
+ * @param count Pointer to store the number of slices.
+ * @return A malloc'd array of slices, or NULL on failure (or if empty).
+ */
+pool_slice_t *pool_slice(const size_t *lens, // [in]
+                         size_t n,           // [in]
+                         size_t slice_len,   // [in]
+                         size_t *count       // [out]
+) {
+    *count = 0;
+    size_t total = 0;
+    for (size_t i = 0; i < n; i++) {
+        total += (lens[i] + slice_len - 1) / slice_len;
+    }
+    if (total == 0) {
+        return NULL;
+    }
+
+    pool_slice_t *slices = malloc(total * sizeof(*slices));
+    if (!slices) {
+        return NULL;
+    }
+    size_t k = 0;
+    for (size_t i = 0; i < n; i++) {
+        for (size_t off = 0; off < lens[i]; off += slice_len) {
+            size_t len = lens[i] - off < slice_len ? lens[i] - off : slice_len;
+            slices[k++] = (pool_slice_t){.index = i, .offset = off, .len = len};
+        }
+    }
+    *count = total;
+    return slices;
+}
@@ -0,0 +1,28 @@
+// src/utils/threadpool.h
+#pragma once
+#include <stddef.h>
+
+/**
+ * A long-lived pool of worker threads shared by scan, search and detect.
+ * A job is a range of task indices [0, ntasks). Each worker owns a slice of
+ * that range and steals half of another worker's remaining slice when its
+ * own runs dry, so uneven tasks still keep every core busy.
+ *
+ * If the pool isn't running, pool_run() executes the tasks inline.
+ */
+typedef void (*pool_task_fn)(void *ctx, size_t task, size_t worker);
+
+int pool_start(size_t nthreads);
+void pool_stop(void);
+size_t pool_workers(void);
+int pool_run(size_t ntasks, pool_task_fn fn, void *ctx);
+
+// A byte range of the n-th item of a list, used to balance work by bytes
+typedef struct {
+    size_t index;  // item the slice belongs to
+    size_t offset; // start offset within the item
+    size_t len;    // length of the slice
+} pool_slice_t;
+
+pool_slice_t *pool_slice(const size_t *lens, size_t n, size_t slice_len,
+                         size_t *count);